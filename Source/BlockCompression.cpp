@@ -0,0 +1,499 @@
+///////////////////////////////////////////////////////////////////////////////
+// blockcompression.cpp
+// ============
+// encode and decode BC1 and BC3 compressed texture blocks on the CPU
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BlockCompression.h"
+#include "JobSystem.h"
+
+#include <cmath>
+#include <cstdlib>
+
+// declaration of global variables
+namespace
+{
+	// steps of power iteration for the principal color axis
+	const int g_AxisIterations = 4;
+
+	// pack an 8-bit color into 5:6:5 bits, rounding to nearest
+	unsigned short PackColor565(float r, float g, float b)
+	{
+		int r5 = (int)((r * 31.0f / 255.0f) + 0.5f);
+		int g6 = (int)((g * 63.0f / 255.0f) + 0.5f);
+		int b5 = (int)((b * 31.0f / 255.0f) + 0.5f);
+
+		r5 = (r5 < 0) ? 0 : ((r5 > 31) ? 31 : r5);
+		g6 = (g6 < 0) ? 0 : ((g6 > 63) ? 63 : g6);
+		b5 = (b5 < 0) ? 0 : ((b5 > 31) ? 31 : b5);
+
+		return((unsigned short)((r5 << 11) | (g6 << 5) | b5));
+	}
+
+	// expand 5:6:5 bits back to 8 bits per channel
+	void UnpackColor565(unsigned short color, int rgb[3])
+	{
+		int r5 = (color >> 11) & 31;
+		int g6 = (color >> 5) & 63;
+		int b5 = color & 31;
+
+		rgb[0] = (r5 << 3) | (r5 >> 2);
+		rgb[1] = (g6 << 2) | (g6 >> 4);
+		rgb[2] = (b5 << 3) | (b5 >> 2);
+	}
+
+	// the four colors of a color block - the two interpolated
+	// colors are only used when the first endpoint is the larger
+	void BuildColorPalette(unsigned short color0, unsigned short color1, int palette[4][4])
+	{
+		UnpackColor565(color0, palette[0]);
+		UnpackColor565(color1, palette[1]);
+		palette[0][3] = 255;
+		palette[1][3] = 255;
+
+		for (int c = 0; c < 3; c++)
+		{
+			if (color0 > color1)
+			{
+				palette[2][c] = ((2 * palette[0][c]) + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + (2 * palette[1][c])) / 3;
+			}
+			else
+			{
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+				palette[3][c] = 0;
+			}
+		}
+		palette[2][3] = 255;
+		palette[3][3] = (color0 > color1) ? 255 : 0;
+	}
+
+	// the eight alpha values of an alpha block
+	void BuildAlphaPalette(int alpha0, int alpha1, int palette[8])
+	{
+		palette[0] = alpha0;
+		palette[1] = alpha1;
+		if (alpha0 > alpha1)
+		{
+			for (int i = 0; i < 6; i++)
+			{
+				palette[i + 2] = (((6 - i) * alpha0) + ((1 + i) * alpha1)) / 7;
+			}
+		}
+		else
+		{
+			for (int i = 0; i < 4; i++)
+			{
+				palette[i + 2] = (((4 - i) * alpha0) + ((1 + i) * alpha1)) / 5;
+			}
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	// endpoints along the principal axis of the block's colors, with
+	// the index of the nearest palette color for every texel
+	void EncodeColorBlock(const unsigned char* pTexels, unsigned char* pBlock)
+	{
+		float mean[3] = { 0.0f, 0.0f, 0.0f };
+		float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+		float axis[3] = { 1.0f, 1.0f, 1.0f };
+
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				mean[c] += pTexels[(i * 4) + c];
+			}
+		}
+		for (int c = 0; c < 3; c++)
+		{
+			mean[c] /= 16.0f;
+		}
+		for (int i = 0; i < 16; i++)
+		{
+			float r = pTexels[(i * 4) + 0] - mean[0];
+			float g = pTexels[(i * 4) + 1] - mean[1];
+			float b = pTexels[(i * 4) + 2] - mean[2];
+
+			covariance[0] += r * r;
+			covariance[1] += r * g;
+			covariance[2] += r * b;
+			covariance[3] += g * g;
+			covariance[4] += g * b;
+			covariance[5] += b * b;
+		}
+
+		// power iteration converges on the axis of largest spread
+		for (int step = 0; step < g_AxisIterations; step++)
+		{
+			float x = (covariance[0] * axis[0]) + (covariance[1] * axis[1]) + (covariance[2] * axis[2]);
+			float y = (covariance[1] * axis[0]) + (covariance[3] * axis[1]) + (covariance[4] * axis[2]);
+			float z = (covariance[2] * axis[0]) + (covariance[4] * axis[1]) + (covariance[5] * axis[2]);
+			float length = sqrtf((x * x) + (y * y) + (z * z));
+
+			if (length < 1e-6f)
+			{
+				break;
+			}
+			axis[0] = x / length;
+			axis[1] = y / length;
+			axis[2] = z / length;
+		}
+
+		int minTexel = 0;
+		int maxTexel = 0;
+		float minProjection = 0.0f;
+		float maxProjection = 0.0f;
+		for (int i = 0; i < 16; i++)
+		{
+			float projection =
+				((pTexels[(i * 4) + 0] - mean[0]) * axis[0]) +
+				((pTexels[(i * 4) + 1] - mean[1]) * axis[1]) +
+				((pTexels[(i * 4) + 2] - mean[2]) * axis[2]);
+
+			if ((i == 0) || (projection < minProjection))
+			{
+				minProjection = projection;
+				minTexel = i;
+			}
+			if ((i == 0) || (projection > maxProjection))
+			{
+				maxProjection = projection;
+				maxTexel = i;
+			}
+		}
+
+		const unsigned char* pMax = pTexels + (maxTexel * 4);
+		const unsigned char* pMin = pTexels + (minTexel * 4);
+		unsigned short color0 = PackColor565(pMax[0], pMax[1], pMax[2]);
+		unsigned short color1 = PackColor565(pMin[0], pMin[1], pMin[2]);
+		unsigned int indices = 0;
+
+		// the larger endpoint goes first, for the four color mode
+		if (color0 < color1)
+		{
+			unsigned short swap = color0;
+			color0 = color1;
+			color1 = swap;
+		}
+
+		if (color0 != color1)
+		{
+			int palette[4][4];
+
+			BuildColorPalette(color0, color1, palette);
+			for (int i = 0; i < 16; i++)
+			{
+				int bestIndex = 0;
+				int bestDistance = 0;
+
+				for (int p = 0; p < 4; p++)
+				{
+					int dr = pTexels[(i * 4) + 0] - palette[p][0];
+					int dg = pTexels[(i * 4) + 1] - palette[p][1];
+					int db = pTexels[(i * 4) + 2] - palette[p][2];
+					int distance = (dr * dr) + (dg * dg) + (db * db);
+
+					if ((p == 0) || (distance < bestDistance))
+					{
+						bestDistance = distance;
+						bestIndex = p;
+					}
+				}
+				indices |= (unsigned int)bestIndex << (i * 2);
+			}
+		}
+
+		pBlock[0] = (unsigned char)(color0 & 0xFF);
+		pBlock[1] = (unsigned char)(color0 >> 8);
+		pBlock[2] = (unsigned char)(color1 & 0xFF);
+		pBlock[3] = (unsigned char)(color1 >> 8);
+		for (int i = 0; i < 4; i++)
+		{
+			pBlock[4 + i] = (unsigned char)((indices >> (i * 8)) & 0xFF);
+		}
+	}
+
+	// endpoints at the smallest and largest alpha, eight values apart
+	void EncodeAlphaBlock(const unsigned char* pTexels, unsigned char* pBlock)
+	{
+		int alpha0 = 0;
+		int alpha1 = 255;
+		unsigned long long indices = 0;
+
+		for (int i = 0; i < 16; i++)
+		{
+			int alpha = pTexels[(i * 4) + 3];
+
+			alpha0 = (alpha > alpha0) ? alpha : alpha0;
+			alpha1 = (alpha < alpha1) ? alpha : alpha1;
+		}
+
+		if (alpha0 != alpha1)
+		{
+			int palette[8];
+
+			BuildAlphaPalette(alpha0, alpha1, palette);
+			for (int i = 0; i < 16; i++)
+			{
+				int alpha = pTexels[(i * 4) + 3];
+				int bestIndex = 0;
+				int bestDistance = 256;
+
+				for (int p = 0; p < 8; p++)
+				{
+					int distance = abs(alpha - palette[p]);
+
+					if (distance < bestDistance)
+					{
+						bestDistance = distance;
+						bestIndex = p;
+					}
+				}
+				indices |= (unsigned long long)bestIndex << (i * 3);
+			}
+		}
+
+		pBlock[0] = (unsigned char)alpha0;
+		pBlock[1] = (unsigned char)alpha1;
+		for (int i = 0; i < 6; i++)
+		{
+			pBlock[2 + i] = (unsigned char)((indices >> (i * 8)) & 0xFF);
+		}
+	}
+
+	// gather the 4 x 4 RGBA texels of a block, repeating the last
+	// row and column past the edges of the image
+	void FetchBlock(
+		const unsigned char* pPixels,
+		int width,
+		int height,
+		int colorChannels,
+		int blockX,
+		int blockY,
+		unsigned char* pTexels)
+	{
+		for (int y = 0; y < 4; y++)
+		{
+			int pixelY = (blockY * 4) + y;
+			pixelY = (pixelY < height) ? pixelY : (height - 1);
+
+			for (int x = 0; x < 4; x++)
+			{
+				int pixelX = (blockX * 4) + x;
+				pixelX = (pixelX < width) ? pixelX : (width - 1);
+
+				const unsigned char* pPixel = pPixels + ((((size_t)pixelY * width) + pixelX) * colorChannels);
+				unsigned char* pTexel = pTexels + (((y * 4) + x) * 4);
+
+				pTexel[0] = pPixel[0];
+				pTexel[1] = (colorChannels > 1) ? pPixel[1] : pPixel[0];
+				pTexel[2] = (colorChannels > 2) ? pPixel[2] : pPixel[0];
+				pTexel[3] = (colorChannels > 3) ? pPixel[3] : 255;
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  EncodeBC1Block()
+ *
+ *  This function is used for compressing the color of a
+ *  block to BC1.  The endpoints are the two texels furthest
+ *  apart along the principal axis of the block's colors, so
+ *  a gradient in any direction keeps its two ends.
+ ***********************************************************/
+void EncodeBC1Block(const unsigned char* pTexels, unsigned char* pBlock)
+{
+	EncodeColorBlock(pTexels, pBlock);
+}
+
+/***********************************************************
+ *  EncodeBC3Block()
+ *
+ *  This function is used for compressing a block to BC3 -
+ *  an alpha block followed by a BC1 color block.
+ ***********************************************************/
+void EncodeBC3Block(const unsigned char* pTexels, unsigned char* pBlock)
+{
+	EncodeAlphaBlock(pTexels, pBlock);
+	EncodeColorBlock(pTexels, pBlock + 8);
+}
+
+/***********************************************************
+ *  DecodeBC1Block()
+ *
+ *  This function is used for expanding a BC1 block back to
+ *  RGBA texels, the same way the GPU samples it.
+ ***********************************************************/
+void DecodeBC1Block(const unsigned char* pBlock, unsigned char* pTexels)
+{
+	unsigned short color0 = (unsigned short)(pBlock[0] | (pBlock[1] << 8));
+	unsigned short color1 = (unsigned short)(pBlock[2] | (pBlock[3] << 8));
+	unsigned int indices = pBlock[4] | (pBlock[5] << 8) | (pBlock[6] << 16) | ((unsigned int)pBlock[7] << 24);
+	int palette[4][4];
+
+	BuildColorPalette(color0, color1, palette);
+	for (int i = 0; i < 16; i++)
+	{
+		int index = (indices >> (i * 2)) & 3;
+
+		for (int c = 0; c < 4; c++)
+		{
+			pTexels[(i * 4) + c] = (unsigned char)palette[index][c];
+		}
+	}
+}
+
+/***********************************************************
+ *  DecodeBC3Block()
+ *
+ *  This function is used for expanding a BC3 block back to
+ *  RGBA texels.
+ ***********************************************************/
+void DecodeBC3Block(const unsigned char* pBlock, unsigned char* pTexels)
+{
+	unsigned long long indices = 0;
+	int palette[8];
+
+	DecodeBC1Block(pBlock + 8, pTexels);
+
+	BuildAlphaPalette(pBlock[0], pBlock[1], palette);
+	for (int i = 0; i < 6; i++)
+	{
+		indices |= (unsigned long long)pBlock[2 + i] << (i * 8);
+	}
+	for (int i = 0; i < 16; i++)
+	{
+		pTexels[(i * 4) + 3] = (unsigned char)palette[(indices >> (i * 3)) & 7];
+	}
+}
+
+/***********************************************************
+ *  GetCompressedSize()
+ *
+ *  This function is used for getting the number of bytes of
+ *  an image once it is compressed.  Partial blocks at the
+ *  edges take a whole block.
+ ***********************************************************/
+size_t GetCompressedSize(int width, int height, bool bAlpha)
+{
+	size_t blocksX = (size_t)((width + 3) / 4);
+	size_t blocksY = (size_t)((height + 3) / 4);
+
+	blocksX = (blocksX > 0) ? blocksX : 1;
+	blocksY = (blocksY > 0) ? blocksY : 1;
+
+	return(blocksX * blocksY * (bAlpha ? BC3_BLOCK_BYTES : BC1_BLOCK_BYTES));
+}
+
+/***********************************************************
+ *  CompressImage()
+ *
+ *  This function is used for compressing a whole image on
+ *  the job system.  The threads take the next row of blocks
+ *  one at a time, and every block is written to its own
+ *  place, so no other locking is needed.
+ ***********************************************************/
+void CompressImage(
+	const unsigned char* pPixels,
+	int width,
+	int height,
+	int colorChannels,
+	bool bAlpha,
+	std::vector<unsigned char>& blocks,
+	unsigned int threadCount)
+{
+	const int blocksX = (width + 3) / 4;
+	const int blocksY = (height + 3) / 4;
+	const size_t blockBytes = bAlpha ? BC3_BLOCK_BYTES : BC1_BLOCK_BYTES;
+
+	blocks.resize(GetCompressedSize(width, height, bAlpha));
+
+	GetJobSystem().ParallelFor((size_t)blocksY, 1, [&](size_t firstRow, size_t lastRow)
+	{
+		unsigned char texels[64];
+
+		for (int blockY = (int)firstRow; blockY < (int)lastRow; blockY++)
+		{
+			unsigned char* pRow = blocks.data() + ((size_t)blockY * blocksX * blockBytes);
+
+			for (int blockX = 0; blockX < blocksX; blockX++)
+			{
+				FetchBlock(pPixels, width, height, colorChannels, blockX, blockY, texels);
+				if (bAlpha)
+				{
+					EncodeBC3Block(texels, pRow + (blockX * blockBytes));
+				}
+				else
+				{
+					EncodeBC1Block(texels, pRow + (blockX * blockBytes));
+				}
+			}
+		}
+	}, threadCount);
+}
+
+/***********************************************************
+ *  ComputeCompressedPSNR()
+ *
+ *  This function is used for measuring the quality of a
+ *  compressed image.  Every block is decoded and compared to
+ *  the source pixels it was made from.  100 dB is returned
+ *  for an exact match.
+ ***********************************************************/
+double ComputeCompressedPSNR(
+	const unsigned char* pPixels,
+	int width,
+	int height,
+	int colorChannels,
+	bool bAlpha,
+	const unsigned char* pBlocks)
+{
+	const int blocksX = (width + 3) / 4;
+	const size_t blockBytes = bAlpha ? BC3_BLOCK_BYTES : BC1_BLOCK_BYTES;
+	const int channels = bAlpha ? colorChannels : ((colorChannels < 3) ? colorChannels : 3);
+	double squaredError = 0.0;
+	unsigned char texels[64];
+
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			int blockX = x / 4;
+			int blockY = y / 4;
+
+			// decode each block once, at its first texel
+			if ((x % 4) == 0)
+			{
+				const unsigned char* pBlock = pBlocks + ((((size_t)blockY * blocksX) + blockX) * blockBytes);
+				if (bAlpha)
+				{
+					DecodeBC3Block(pBlock, texels);
+				}
+				else
+				{
+					DecodeBC1Block(pBlock, texels);
+				}
+			}
+
+			const unsigned char* pPixel = pPixels + ((((size_t)y * width) + x) * colorChannels);
+			const unsigned char* pTexel = texels + ((((y % 4) * 4) + (x % 4)) * 4);
+			for (int c = 0; c < channels; c++)
+			{
+				double difference = (double)pPixel[c] - (double)pTexel[c];
+				squaredError += difference * difference;
+			}
+		}
+	}
+
+	double meanSquaredError = squaredError / ((double)width * height * channels);
+	if (meanSquaredError <= 0.0)
+	{
+		return(100.0);
+	}
+
+	return(10.0 * log10((255.0 * 255.0) / meanSquaredError));
+}
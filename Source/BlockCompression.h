@@ -0,0 +1,50 @@
+///////////////////////////////////////////////////////////////////////////////
+// blockcompression.h
+// ============
+// encode and decode BC1 and BC3 compressed texture blocks on the CPU
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// bytes in one compressed 4 x 4 block
+const size_t BC1_BLOCK_BYTES = 8;
+const size_t BC3_BLOCK_BYTES = 16;
+
+// compress one 4 x 4 block of RGBA texels (64 bytes, rows top to
+// bottom) - BC1 keeps the color only, BC3 adds an alpha block
+void EncodeBC1Block(const unsigned char* pTexels, unsigned char* pBlock);
+void EncodeBC3Block(const unsigned char* pTexels, unsigned char* pBlock);
+
+// expand one compressed block back to 4 x 4 RGBA texels
+void DecodeBC1Block(const unsigned char* pBlock, unsigned char* pTexels);
+void DecodeBC3Block(const unsigned char* pBlock, unsigned char* pTexels);
+
+// bytes of an image of the passed in size once it is compressed
+size_t GetCompressedSize(int width, int height, bool bAlpha);
+
+// compress an RGB or RGBA image to BC1 (no alpha) or BC3 (alpha),
+// spreading the rows of blocks over up to threadCount threads
+// of the job system (0 = all of them).  Edge blocks repeat the last
+// row and column.
+void CompressImage(
+	const unsigned char* pPixels,
+	int width,
+	int height,
+	int colorChannels,
+	bool bAlpha,
+	std::vector<unsigned char>& blocks,
+	unsigned int threadCount = 0);
+
+// peak signal-to-noise ratio in dB of the compressed image against
+// the source pixels, over the channels that the source has
+double ComputeCompressedPSNR(
+	const unsigned char* pPixels,
+	int width,
+	int height,
+	int colorChannels,
+	bool bAlpha,
+	const unsigned char* pBlocks);
@@ -0,0 +1,445 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerareplay.cpp
+// ============
+// replay a scripted camera path and compare its frame times with a baseline
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CameraReplay.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+// declaration of global variables
+namespace
+{
+	// the built-in camera path - it starts at the default view
+	// of ViewManager, circles the nightstand and ends on the
+	// orthographic projection
+	const CAMERA_KEYFRAME g_DefaultPath[] =
+	{
+		{ 0.0f, glm::vec3(0.0f, 5.0f, 12.0f), glm::vec3(0.0f, -0.5f, -2.0f), 80.0f, false },
+		{ 2.0f, glm::vec3(9.0f, 6.0f, 8.0f), glm::vec3(-1.0f, -0.6f, -1.0f), 70.0f, false },
+		{ 4.0f, glm::vec3(11.0f, 3.0f, 0.0f), glm::vec3(-1.0f, -0.25f, 0.0f), 55.0f, false },
+		{ 5.5f, glm::vec3(3.0f, 2.0f, 3.0f), glm::vec3(-0.5f, -0.3f, -1.0f), 45.0f, false },
+		{ 7.0f, glm::vec3(-8.0f, 7.0f, 7.0f), glm::vec3(1.0f, -0.7f, -1.0f), 80.0f, false },
+		{ 8.0f, glm::vec3(0.0f, 5.0f, 12.0f), glm::vec3(0.0f, -0.5f, -2.0f), 80.0f, true },
+		{ 10.0f, glm::vec3(0.0f, 12.0f, 6.0f), glm::vec3(0.0f, -1.5f, -1.0f), 80.0f, true }
+	};
+
+	/***********************************************************
+	 *  ReadBaselineValues()
+	 *
+	 *  Read every "name": number pair of a JSON file, at any
+	 *  depth - the baseline files are flat enough that the
+	 *  names do not repeat.
+	 ***********************************************************/
+	bool ReadBaselineValues(const char* filename, std::map<std::string, double>& values)
+	{
+		std::ifstream file(filename);
+		std::stringstream text;
+
+		if (file.is_open() == false)
+		{
+			return(false);
+		}
+		text << file.rdbuf();
+		const std::string json = text.str();
+
+		size_t position = json.find('"');
+		while (position != std::string::npos)
+		{
+			size_t nameEnd = json.find('"', position + 1);
+			if (nameEnd == std::string::npos)
+			{
+				break;
+			}
+			std::string name = json.substr(position + 1, nameEnd - position - 1);
+
+			size_t valueStart = json.find_first_not_of(" \t\r\n", nameEnd + 1);
+			if ((valueStart != std::string::npos) && (json[valueStart] == ':'))
+			{
+				const char* pValue = json.c_str() + valueStart + 1;
+				char* pEnd = NULL;
+				double value = strtod(pValue, &pEnd);
+
+				if (pEnd != pValue)
+				{
+					values[name] = value;
+				}
+			}
+			position = json.find('"', nameEnd + 1);
+		}
+
+		return(true);
+	}
+}
+
+/***********************************************************
+ *  CameraPath()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+CameraPath::CameraPath()
+{
+	SetDefaultPath();
+}
+
+/***********************************************************
+ *  SetDefaultPath()
+ *
+ *  This method is used for replacing the keyframes with the
+ *  built-in path.
+ ***********************************************************/
+void CameraPath::SetDefaultPath()
+{
+	m_keyframes.assign(g_DefaultPath, g_DefaultPath + sizeof(g_DefaultPath) / sizeof(g_DefaultPath[0]));
+}
+
+/***********************************************************
+ *  LoadFile()
+ *
+ *  This method is used for reading the keyframes of a path
+ *  from a text file.  The keyframes are sorted by time, and
+ *  the path is left as it was when no line can be read.
+ ***********************************************************/
+bool CameraPath::LoadFile(const char* filename)
+{
+	std::ifstream file(filename);
+	std::vector<CAMERA_KEYFRAME> keyframes;
+	std::string line;
+	int lineNumber = 0;
+
+	if (file.is_open() == false)
+	{
+		std::cout << "Could not open camera path:" << filename << std::endl;
+		return(false);
+	}
+
+	while (std::getline(file, line))
+	{
+		CAMERA_KEYFRAME keyframe;
+		int orthographic = 0;
+
+		lineNumber++;
+		line = line.substr(0, line.find('#'));
+		if (line.find_first_not_of(" \t\r") == std::string::npos)
+		{
+			continue;
+		}
+
+		std::istringstream values(line);
+		if (!(values >> keyframe.time
+			>> keyframe.position.x >> keyframe.position.y >> keyframe.position.z
+			>> keyframe.front.x >> keyframe.front.y >> keyframe.front.z
+			>> keyframe.zoom >> orthographic))
+		{
+			std::cout << "Could not read camera path line " << lineNumber << ":" << filename << std::endl;
+			return(false);
+		}
+		keyframe.bOrthographic = (orthographic != 0);
+		keyframes.push_back(keyframe);
+	}
+
+	if (keyframes.empty())
+	{
+		std::cout << "Could not find any keyframes in camera path:" << filename << std::endl;
+		return(false);
+	}
+
+	std::stable_sort(keyframes.begin(), keyframes.end(),
+		[](const CAMERA_KEYFRAME& a, const CAMERA_KEYFRAME& b) { return(a.time < b.time); });
+	m_keyframes = keyframes;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Sample()
+ *
+ *  This method is used for blending the two keyframes
+ *  around a time.  The direction is blended and then made
+ *  unit length again, so that it turns rather than cuts
+ *  through the camera.
+ ***********************************************************/
+CAMERA_KEYFRAME CameraPath::Sample(float time) const
+{
+	if (time <= m_keyframes.front().time)
+	{
+		return(m_keyframes.front());
+	}
+	if (time >= m_keyframes.back().time)
+	{
+		return(m_keyframes.back());
+	}
+
+	size_t next = 1;
+	while (m_keyframes[next].time <= time)
+	{
+		next++;
+	}
+	const CAMERA_KEYFRAME& from = m_keyframes[next - 1];
+	const CAMERA_KEYFRAME& to = m_keyframes[next];
+	float blend = (time - from.time) / (to.time - from.time);
+	CAMERA_KEYFRAME sample;
+
+	sample.time = time;
+	sample.position = glm::mix(from.position, to.position, blend);
+	sample.front = glm::mix(glm::normalize(from.front), glm::normalize(to.front), blend);
+	if (glm::length(sample.front) < 0.0001f)
+	{
+		sample.front = to.front;
+	}
+	sample.front = glm::normalize(sample.front);
+	sample.zoom = from.zoom + (to.zoom - from.zoom) * blend;
+	sample.bOrthographic = from.bOrthographic;
+
+	return(sample);
+}
+
+/***********************************************************
+ *  GetDuration()
+ *
+ *  This method is used for getting the time of the last
+ *  keyframe.
+ ***********************************************************/
+float CameraPath::GetDuration() const
+{
+	return(m_keyframes.back().time);
+}
+
+/***********************************************************
+ *  ReplayBenchmark()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ReplayBenchmark::ReplayBenchmark()
+{
+	m_firstFrame = 0;
+	m_fixedDeltaTime = 0.0f;
+}
+
+/***********************************************************
+ *  BeginRecording()
+ *
+ *  This method is used for starting a recording, forgetting
+ *  any frames that were recorded before.
+ ***********************************************************/
+void ReplayBenchmark::BeginRecording(uint64_t firstFrame, float fixedDeltaTime)
+{
+	m_firstFrame = firstFrame;
+	m_fixedDeltaTime = fixedDeltaTime;
+	m_drawCalls.clear();
+	m_stateChanges.clear();
+	m_visible.clear();
+	m_metrics.clear();
+}
+
+/***********************************************************
+ *  AddFrame()
+ *
+ *  This method is used for recording the counters of the
+ *  next frame.
+ ***********************************************************/
+void ReplayBenchmark::AddFrame(size_t drawCalls, int stateChanges, size_t visible)
+{
+	m_drawCalls.push_back(drawCalls);
+	m_stateChanges.push_back(stateChanges);
+	m_visible.push_back(visible);
+}
+
+/***********************************************************
+ *  Finish()
+ *
+ *  This method is used for computing the metrics of the
+ *  recorded frames.  The times come from the frame timer,
+ *  for the frames from the first recorded one on.
+ ***********************************************************/
+void ReplayBenchmark::Finish(const FrameTimer& frameTimer)
+{
+	std::vector<FRAME_SAMPLE> samples;
+	std::vector<double> cpuTimes;
+	std::vector<double> renderTimes;
+	std::vector<double> gpuTimes;
+	double drawCalls = 0.0;
+	double stateChanges = 0.0;
+	double visible = 0.0;
+
+	frameTimer.GetSamples(samples);
+	for (size_t i = 0; i < samples.size(); i++)
+	{
+		if ((samples[i].frame < m_firstFrame) || (samples[i].frame >= m_firstFrame + m_drawCalls.size()))
+		{
+			continue;
+		}
+		cpuTimes.push_back(samples[i].cpuMilliseconds);
+		renderTimes.push_back(samples[i].sectionMilliseconds[FRAME_SECTION_RENDER]);
+		if (samples[i].gpuMilliseconds >= 0.0)
+		{
+			gpuTimes.push_back(samples[i].gpuMilliseconds);
+		}
+	}
+	std::sort(cpuTimes.begin(), cpuTimes.end());
+	std::sort(renderTimes.begin(), renderTimes.end());
+	std::sort(gpuTimes.begin(), gpuTimes.end());
+
+	for (size_t i = 0; i < m_drawCalls.size(); i++)
+	{
+		drawCalls += (double)m_drawCalls[i];
+		stateChanges += (double)m_stateChanges[i];
+		visible += (double)m_visible[i];
+	}
+	if (m_drawCalls.empty() == false)
+	{
+		drawCalls /= (double)m_drawCalls.size();
+		stateChanges /= (double)m_drawCalls.size();
+		visible /= (double)m_drawCalls.size();
+	}
+
+	if (cpuTimes.size() < m_drawCalls.size())
+	{
+		std::cout << "INFO: Only " << cpuTimes.size() << " of the " << m_drawCalls.size()
+			<< " replayed frames were timed" << std::endl;
+	}
+
+	m_metrics.clear();
+	m_metrics.push_back({ "cpu_ms_p50", GetPercentile(cpuTimes, 50.0), false });
+	m_metrics.push_back({ "cpu_ms_p95", GetPercentile(cpuTimes, 95.0), false });
+	m_metrics.push_back({ "cpu_ms_p99", GetPercentile(cpuTimes, 99.0), false });
+	m_metrics.push_back({ "render_ms_p50", GetPercentile(renderTimes, 50.0), false });
+	m_metrics.push_back({ "render_ms_p95", GetPercentile(renderTimes, 95.0), false });
+	if (gpuTimes.empty() == false)
+	{
+		m_metrics.push_back({ "gpu_ms_p50", GetPercentile(gpuTimes, 50.0), false });
+		m_metrics.push_back({ "gpu_ms_p95", GetPercentile(gpuTimes, 95.0), false });
+	}
+	m_metrics.push_back({ "draw_calls_mean", drawCalls, true });
+	m_metrics.push_back({ "state_changes_mean", stateChanges, true });
+	// more visible objects are not worse, so this one is only
+	// reported, and compared like a counter when it changes
+	m_metrics.push_back({ "visible_mean", visible, true });
+}
+
+/***********************************************************
+ *  Report()
+ *
+ *  This method is used for displaying the metrics of the
+ *  replay.
+ ***********************************************************/
+void ReplayBenchmark::Report() const
+{
+	std::cout << "INFO: Camera replay of " << m_drawCalls.size() << " frames, "
+		<< m_fixedDeltaTime * 1000.0f << " ms apart" << std::endl;
+	for (size_t i = 0; i < m_metrics.size(); i++)
+	{
+		std::cout << "INFO:   " << std::left << std::setw(20) << m_metrics[i].name << std::right
+			<< std::fixed << std::setprecision(3) << m_metrics[i].value << std::defaultfloat << std::setprecision(6) << std::endl;
+	}
+}
+
+/***********************************************************
+ *  WriteBaseline()
+ *
+ *  This method is used for writing the metrics into a JSON
+ *  file, with the frame count and time step they belong to.
+ ***********************************************************/
+bool ReplayBenchmark::WriteBaseline(const char* filename) const
+{
+	FILE* pFile = fopen(filename, "w");
+
+	if (NULL == pFile)
+	{
+		std::cout << "Could not write replay baseline:" << filename << std::endl;
+		return(false);
+	}
+
+	fprintf(pFile, "{\n");
+	fprintf(pFile, "  \"frames\": %zu,\n", m_drawCalls.size());
+	fprintf(pFile, "  \"fixed_delta_time\": %.6f,\n", m_fixedDeltaTime);
+	fprintf(pFile, "  \"metrics\": {\n");
+	for (size_t i = 0; i < m_metrics.size(); i++)
+	{
+		fprintf(pFile, "    \"%s\": %.4f%s\n", m_metrics[i].name.c_str(), m_metrics[i].value,
+			(i + 1 < m_metrics.size()) ? "," : "");
+	}
+	fprintf(pFile, "  }\n}\n");
+
+	if (fclose(pFile) != 0)
+	{
+		std::cout << "Could not write replay baseline:" << filename << std::endl;
+		return(false);
+	}
+	std::cout << "INFO: Wrote the replay baseline " << filename << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  CompareBaseline()
+ *
+ *  This method is used for comparing every metric with the
+ *  same one in a baseline file.  A baseline of another
+ *  frame count or time step is not compared at all, since
+ *  its path was not the same.  Metrics that are missing
+ *  from either side, such as GPU times on a driver with no
+ *  timer queries, are skipped.
+ ***********************************************************/
+bool ReplayBenchmark::CompareBaseline(const char* filename, double thresholdPercent) const
+{
+	std::map<std::string, double> baseline;
+	bool bPassed = true;
+
+	if (ReadBaselineValues(filename, baseline) == false)
+	{
+		std::cout << "Could not read replay baseline:" << filename << std::endl;
+		return(false);
+	}
+	if ((baseline["frames"] != (double)m_drawCalls.size()) ||
+		(std::fabs(baseline["fixed_delta_time"] - m_fixedDeltaTime) > 0.000001))
+	{
+		std::cout << "Could not compare with the replay baseline, it was recorded over "
+			<< baseline["frames"] << " frames of " << baseline["fixed_delta_time"] << " s:" << filename << std::endl;
+		return(false);
+	}
+
+	std::cout << "INFO: Comparing with the replay baseline " << filename
+		<< " (" << thresholdPercent << "% threshold for times)" << std::endl;
+	for (size_t i = 0; i < m_metrics.size(); i++)
+	{
+		const METRIC& metric = m_metrics[i];
+		std::map<std::string, double>::const_iterator found = baseline.find(metric.name);
+
+		if (found == baseline.end())
+		{
+			continue;
+		}
+
+		double reference = found->second;
+		double change = (reference != 0.0) ? ((metric.value - reference) / reference) * 100.0 : 0.0;
+		bool bRegressed = false;
+		if (metric.bCounter)
+		{
+			// the baseline keeps 4 decimals of the means
+			bRegressed = (std::fabs(metric.value - reference) > 0.0001);
+		}
+		else
+		{
+			bRegressed = (metric.value > reference * (1.0 + thresholdPercent / 100.0));
+		}
+		bPassed = bPassed && (bRegressed == false);
+
+		std::cout << "INFO:   " << std::left << std::setw(20) << metric.name << std::right
+			<< std::fixed << std::setprecision(3) << " baseline " << reference << "  now " << metric.value
+			<< std::showpos << std::setprecision(1) << "  " << change << "%" << std::noshowpos << std::defaultfloat << std::setprecision(6)
+			<< (bRegressed ? "  REGRESSED" : "") << std::endl;
+	}
+
+	return(bPassed);
+}
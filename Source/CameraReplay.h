@@ -0,0 +1,118 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerareplay.h
+// ============
+// replay a scripted camera path and compare its frame times with a baseline
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FrameTimer.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  CAMERA_KEYFRAME
+ *
+ *  Where the camera is at a time along a camera path.
+ *  Between two keyframes the position, the direction and
+ *  the zoom are blended, while the projection switches at
+ *  the keyframe.
+ ***********************************************************/
+struct CAMERA_KEYFRAME
+{
+	// seconds from the start of the path
+	float time;
+	glm::vec3 position;
+	glm::vec3 front;
+	// vertical field of view in degrees
+	float zoom;
+	bool bOrthographic;
+};
+
+/***********************************************************
+ *  CameraPath
+ *
+ *  This class holds the keyframes of a camera path, in time
+ *  order, and samples the camera at any time along it.
+ ***********************************************************/
+class CameraPath
+{
+public:
+	// constructor
+	CameraPath();
+
+	// use the built-in path, which flies around the scene and
+	// switches to the orthographic projection near the end
+	void SetDefaultPath();
+	// read a path from a text file, one keyframe per line:
+	//   time  px py pz  fx fy fz  zoom  orthographic(0 or 1)
+	// with # starting a comment - false when it cannot be read
+	bool LoadFile(const char* filename);
+
+	// the camera at a time along the path, which is held at the
+	// first and last keyframes outside of it
+	CAMERA_KEYFRAME Sample(float time) const;
+	// time of the last keyframe
+	float GetDuration() const;
+	size_t GetKeyframeCount() const { return(m_keyframes.size()); }
+
+private:
+	std::vector<CAMERA_KEYFRAME> m_keyframes;
+};
+
+/***********************************************************
+ *  ReplayBenchmark
+ *
+ *  This class records the render counters of every frame
+ *  of a camera replay, and turns them and the frame times
+ *  into metrics that are written into, or compared with, a
+ *  JSON baseline file.  Every metric is better when lower:
+ *  a time regresses when it grows by more than the
+ *  threshold, and a counter, which the same path always
+ *  repeats, when it grows at all.
+ ***********************************************************/
+class ReplayBenchmark
+{
+public:
+	// constructor
+	ReplayBenchmark();
+
+	// start recording with the passed in frame - the frames before
+	// it, while the scene was loading, are left out
+	void BeginRecording(uint64_t firstFrame, float fixedDeltaTime);
+	// record the render counters of a frame
+	void AddFrame(size_t drawCalls, int stateChanges, size_t visible);
+	// compute the metrics from the recorded frames and their times
+	void Finish(const FrameTimer& frameTimer);
+
+	// output the metrics
+	void Report() const;
+	// write the metrics into a JSON baseline file
+	bool WriteBaseline(const char* filename) const;
+	// compare the metrics with a JSON baseline file, reporting each
+	// one - false when any of them regressed, or the file cannot
+	// be read
+	bool CompareBaseline(const char* filename, double thresholdPercent) const;
+
+private:
+	// a measured value of the replay
+	struct METRIC
+	{
+		std::string name;
+		double value;
+		// counters must not grow at all, times within the threshold
+		bool bCounter;
+	};
+
+	uint64_t m_firstFrame;
+	float m_fixedDeltaTime;
+	std::vector<size_t> m_drawCalls;
+	std::vector<int> m_stateChanges;
+	std::vector<size_t> m_visible;
+	std::vector<METRIC> m_metrics;
+};
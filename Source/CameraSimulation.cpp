@@ -0,0 +1,337 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerasimulation.cpp
+// ============
+// move the camera on its own thread, at a fixed rate, apart from rendering
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CameraSimulation.h"
+
+#include <algorithm>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// every direction the camera moves in, each with a bit of the
+	// held movements
+	const Camera_Movement g_Movements[] = { FORWARD, BACKWARD, LEFT, RIGHT, UP, DOWN };
+	// time step of every tick, in seconds
+	const float g_TickSeconds = 1.0f / (float)CameraSimulation::TICKS_PER_SECOND;
+	const std::chrono::nanoseconds g_TickDuration(1000000000 / CameraSimulation::TICKS_PER_SECOND);
+	// when the update thread falls further behind than this, such as
+	// after the process was paused, the missed ticks are skipped
+	// rather than run all at once
+	const int g_MaxTicksBehind = CameraSimulation::TICKS_PER_SECOND / 4;
+
+	/***********************************************************
+	 *  GetCameraState()
+	 *
+	 *  Copy what the scene is seen from out of a camera.
+	 ***********************************************************/
+	CAMERA_STATE GetCameraState(const Camera& camera, bool bOrthographic)
+	{
+		CAMERA_STATE state;
+
+		state.position = camera.Position;
+		state.front = camera.Front;
+		state.up = camera.Up;
+		state.zoom = camera.Zoom;
+		state.bOrthographic = bOrthographic;
+
+		return(state);
+	}
+}
+
+/***********************************************************
+ *  CameraSimulation()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+CameraSimulation::CameraSimulation()
+{
+	m_pCamera = NULL;
+	m_bStopping = false;
+	m_heldMovements = 0;
+	m_mouseX = 0.0f;
+	m_mouseY = 0.0f;
+	m_scroll = 0.0f;
+	m_bOrthographic = false;
+	m_bStatePending = false;
+	m_tick = 0;
+}
+
+/***********************************************************
+ *  ~CameraSimulation()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+CameraSimulation::~CameraSimulation()
+{
+	Stop();
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for publishing the camera as tick 0
+ *  and starting the update thread, which runs tick 1 one
+ *  time step later.
+ ***********************************************************/
+void CameraSimulation::Start(Camera* pCamera, bool bOrthographic)
+{
+	if ((NULL == pCamera) || IsRunning())
+	{
+		return;
+	}
+
+	m_pCamera = pCamera;
+	m_bStopping = false;
+	m_heldMovements = 0;
+	m_mouseX = 0.0f;
+	m_mouseY = 0.0f;
+	m_scroll = 0.0f;
+	m_bOrthographic = bOrthographic;
+	m_bStatePending = false;
+	m_currentState = GetCameraState(*pCamera, bOrthographic);
+	m_previousState = m_currentState;
+	m_tick = 0;
+	m_startTime = std::chrono::steady_clock::now();
+
+	m_thread = std::thread(&CameraSimulation::UpdateThread, this);
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method is used for stopping the update thread and
+ *  waiting for it to end.
+ ***********************************************************/
+void CameraSimulation::Stop()
+{
+	if (IsRunning() == false)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStopping = true;
+	}
+	m_wakeThread.notify_all();
+	m_thread.join();
+	m_pCamera = NULL;
+}
+
+/***********************************************************
+ *  SetHeldMovements()
+ *
+ *  This method is used for setting the movement keys that
+ *  are held down - the camera keeps moving every tick until
+ *  they are released.
+ ***********************************************************/
+void CameraSimulation::SetHeldMovements(uint32_t movementBits)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_heldMovements = movementBits;
+}
+
+/***********************************************************
+ *  AddMouseMovement()
+ *
+ *  This method is used for adding mouse movement to be
+ *  applied by the next tick.
+ ***********************************************************/
+void CameraSimulation::AddMouseMovement(float xOffset, float yOffset)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_mouseX += xOffset;
+	m_mouseY += yOffset;
+}
+
+/***********************************************************
+ *  AddMouseScroll()
+ *
+ *  This method is used for adding scrolling to be applied
+ *  by the next tick.
+ ***********************************************************/
+void CameraSimulation::AddMouseScroll(float yOffset)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_scroll += yOffset;
+}
+
+/***********************************************************
+ *  SetOrthographic()
+ *
+ *  This method is used for switching the projection from
+ *  the next tick on.
+ ***********************************************************/
+void CameraSimulation::SetOrthographic(bool bOrthographic)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_bOrthographic = bOrthographic;
+}
+
+/***********************************************************
+ *  SetState()
+ *
+ *  This method is used for moving the camera to a state,
+ *  such as the last pose of a replay.  Both published
+ *  states are set to it, so that it is shown at once, and
+ *  the update thread moves the camera there on the next
+ *  tick, before it applies any new input.
+ ***********************************************************/
+void CameraSimulation::SetState(const CAMERA_STATE& state)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_mouseX = 0.0f;
+	m_mouseY = 0.0f;
+	m_scroll = 0.0f;
+	m_bOrthographic = state.bOrthographic;
+	m_bStatePending = true;
+	m_pendingState = state;
+	m_previousState = state;
+	m_currentState = state;
+}
+
+/***********************************************************
+ *  GetInterpolatedState()
+ *
+ *  This method is used for getting the camera at the
+ *  current time minus one tick, which always lies between
+ *  the last two ticks while the update thread keeps up.
+ *  The positions and the zoom are blended in a straight
+ *  line and the directions are made unit length again; the
+ *  projection is the one of the last tick.
+ ***********************************************************/
+CAMERA_STATE CameraSimulation::GetInterpolatedState() const
+{
+	CAMERA_STATE previous;
+	CAMERA_STATE current;
+	CAMERA_STATE state;
+	double blend = 0.0;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		previous = m_previousState;
+		current = m_currentState;
+
+		// ticks elapsed since the start, minus the last tick
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - m_startTime;
+		blend = (elapsed.count() / (double)g_TickSeconds) - (double)m_tick;
+	}
+	float alpha = (float)std::min(std::max(blend, 0.0), 1.0);
+
+	state.position = glm::mix(previous.position, current.position, alpha);
+	state.front = glm::normalize(glm::mix(previous.front, current.front, alpha));
+	state.up = glm::normalize(glm::mix(previous.up, current.up, alpha));
+	state.zoom = previous.zoom + (current.zoom - previous.zoom) * alpha;
+	state.bOrthographic = current.bOrthographic;
+
+	return(state);
+}
+
+/***********************************************************
+ *  GetTickCount()
+ *
+ *  This method is used for getting the number of ticks the
+ *  update thread has run.
+ ***********************************************************/
+uint64_t CameraSimulation::GetTickCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return(m_tick);
+}
+
+/***********************************************************
+ *  UpdateThread()
+ *
+ *  This method is run by the update thread.  It waits for
+ *  each tick to be due, takes the input gathered since the
+ *  last one, moves the camera by one time step and
+ *  publishes the new state.  The ticks are due at fixed
+ *  times from the start, so a late wake-up is made up by
+ *  the next tick rather than adding up.
+ ***********************************************************/
+void CameraSimulation::UpdateThread()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	while (true)
+	{
+		std::chrono::steady_clock::time_point due = m_startTime + g_TickDuration * (m_tick + 1);
+
+		if (m_wakeThread.wait_until(lock, due, [this]() { return(m_bStopping); }))
+		{
+			return;
+		}
+
+		// skip ahead when too far behind, keeping the tick count
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (now - due > g_TickDuration * g_MaxTicksBehind)
+		{
+			m_startTime += std::chrono::duration_cast<std::chrono::steady_clock::duration>(now - due);
+		}
+
+		// take the input, and leave the lock while the camera moves
+		uint32_t heldMovements = m_heldMovements;
+		float mouseX = m_mouseX;
+		float mouseY = m_mouseY;
+		float scroll = m_scroll;
+		bool bOrthographic = m_bOrthographic;
+		bool bStatePending = m_bStatePending;
+		CAMERA_STATE pendingState = m_pendingState;
+		m_mouseX = 0.0f;
+		m_mouseY = 0.0f;
+		m_scroll = 0.0f;
+		m_bStatePending = false;
+		lock.unlock();
+
+		if (bStatePending)
+		{
+			SetCameraState(*m_pCamera, pendingState);
+		}
+
+		for (size_t i = 0; i < sizeof(g_Movements) / sizeof(g_Movements[0]); i++)
+		{
+			if ((heldMovements & (1u << g_Movements[i])) != 0)
+			{
+				m_pCamera->ProcessKeyboard(g_Movements[i], g_TickSeconds);
+			}
+		}
+		if ((mouseX != 0.0f) || (mouseY != 0.0f))
+		{
+			m_pCamera->ProcessMouseMovement(mouseX, mouseY);
+		}
+		if (scroll != 0.0f)
+		{
+			m_pCamera->ProcessMouseScroll(scroll);
+		}
+		CAMERA_STATE state = GetCameraState(*m_pCamera, bOrthographic);
+
+		lock.lock();
+		m_previousState = m_currentState;
+		m_currentState = state;
+		m_tick++;
+	}
+}
+
+/***********************************************************
+ *  SetCameraState()
+ *
+ *  This function is used for moving a camera to a state.
+ *  The camera keeps its direction as a yaw and a pitch, in
+ *  degrees, which are worked out from the direction; mouse
+ *  movement of zero then rebuilds the direction vectors.
+ ***********************************************************/
+void SetCameraState(Camera& camera, const CAMERA_STATE& state)
+{
+	glm::vec3 front = glm::normalize(state.front);
+
+	camera.Position = state.position;
+	camera.Yaw = glm::degrees(std::atan2(front.z, front.x));
+	camera.Pitch = glm::degrees(std::asin(std::min(std::max(front.y, -1.0f), 1.0f)));
+	camera.Zoom = state.zoom;
+	camera.ProcessMouseMovement(0.0f, 0.0f);
+}
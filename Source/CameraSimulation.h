@@ -0,0 +1,122 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerasimulation.h
+// ============
+// move the camera on its own thread, at a fixed rate, apart from rendering
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "camera.h"
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+/***********************************************************
+ *  CAMERA_STATE
+ *
+ *  What the scene is seen from after a simulation tick -
+ *  everything the view and projection matrices are built
+ *  from.
+ ***********************************************************/
+struct CAMERA_STATE
+{
+	glm::vec3 position;
+	glm::vec3 front;
+	glm::vec3 up;
+	// vertical field of view in degrees
+	float zoom;
+	bool bOrthographic;
+};
+
+/***********************************************************
+ *  CameraSimulation
+ *
+ *  This class runs the camera on an update thread that
+ *  ticks TICKS_PER_SECOND times a second, however long the
+ *  frames take to render.  The window events are still
+ *  polled on the main thread, which hands the held movement
+ *  keys and the mouse movement to the update thread; each
+ *  tick applies them with the same time step, so the camera
+ *  moves at the same speed at any frame rate.
+ *
+ *  Every tick publishes the camera state next to the one of
+ *  the tick before, and the render thread blends the two
+ *  for the time it renders at, one tick behind the update
+ *  thread, so the motion stays smooth when the frame and
+ *  tick rates differ.  Once started, the camera belongs to
+ *  the update thread until Stop().
+ ***********************************************************/
+class CameraSimulation
+{
+public:
+	// update rate of the camera
+	static const int TICKS_PER_SECOND = 120;
+
+	// constructor
+	CameraSimulation();
+	// destructor
+	~CameraSimulation();
+
+	// start ticking the passed in camera on the update thread
+	void Start(Camera* pCamera, bool bOrthographic);
+	// stop the update thread, handing the camera back
+	void Stop();
+	bool IsRunning() const { return(m_thread.joinable()); }
+
+	// input for the next tick, from the thread that polls the window
+	// events - the movement keys held down, one bit for each
+	// Camera_Movement, the mouse movement and scrolling since the
+	// last call, and the projection
+	void SetHeldMovements(uint32_t movementBits);
+	void AddMouseMovement(float xOffset, float yOffset);
+	void AddMouseScroll(float yOffset);
+	void SetOrthographic(bool bOrthographic);
+
+	// move the camera to the passed in state, from the next tick on -
+	// it is shown from now, and input gathered so far is dropped
+	void SetState(const CAMERA_STATE& state);
+
+	// the camera at the current time, blended between the last two
+	// ticks - from any thread
+	CAMERA_STATE GetInterpolatedState() const;
+	// number of ticks run so far
+	uint64_t GetTickCount() const;
+
+private:
+	// the camera, only touched by the update thread while it runs
+	Camera* m_pCamera;
+	std::thread m_thread;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_wakeThread;
+	bool m_bStopping;
+
+	// input gathered since the last tick
+	uint32_t m_heldMovements;
+	float m_mouseX;
+	float m_mouseY;
+	float m_scroll;
+	bool m_bOrthographic;
+	// state the camera is moved to by the next tick
+	bool m_bStatePending;
+	CAMERA_STATE m_pendingState;
+
+	// states of the tick before the last one and of the last one
+	CAMERA_STATE m_previousState;
+	CAMERA_STATE m_currentState;
+	uint64_t m_tick;
+	// time of tick 0 - tick N is due N / TICKS_PER_SECOND later
+	std::chrono::steady_clock::time_point m_startTime;
+
+	// run the ticks until the simulation is stopped
+	void UpdateThread();
+};
+
+// move a camera to a state - the yaw and pitch are worked out from the
+// direction, so that mouse movement carries on from there
+void SetCameraState(Camera& camera, const CAMERA_STATE& state);
@@ -0,0 +1,294 @@
+///////////////////////////////////////////////////////////////////////////////
+// filewatcher.cpp
+// ============
+// report asset files that were changed on disk while the scene is running
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FileWatcher.h"
+
+#include <iostream>
+#include <sys/stat.h>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+	// how often the modification times are compared, when the
+	// files are not watched with inotify
+	const double g_CheckIntervalMilliseconds = 250.0;
+
+	/***********************************************************
+	 *  GetFileTime()
+	 *
+	 *  Get the modification time and the size of a file, which
+	 *  are both -1 when the file does not exist.
+	 ***********************************************************/
+	void GetFileTime(const std::string& filename, long long& modifiedTime, long long& size)
+	{
+		struct stat fileStatus;
+
+		modifiedTime = -1;
+		size = -1;
+		if (stat(filename.c_str(), &fileStatus) == 0)
+		{
+#if defined(__linux__)
+			modifiedTime = ((long long)fileStatus.st_mtim.tv_sec * 1000000000LL) + fileStatus.st_mtim.tv_nsec;
+#else
+			modifiedTime = (long long)fileStatus.st_mtime;
+#endif
+			size = (long long)fileStatus.st_size;
+		}
+	}
+}
+
+/***********************************************************
+ *  FileWatcher()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FileWatcher::FileWatcher()
+{
+	m_bCreated = false;
+	m_inotify = -1;
+}
+
+/***********************************************************
+ *  ~FileWatcher()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FileWatcher::~FileWatcher()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for starting the watch service.  When
+ *  inotify cannot be used, the files are still watched by
+ *  their modification times.
+ ***********************************************************/
+bool FileWatcher::Create()
+{
+	if (m_bCreated)
+	{
+		return(true);
+	}
+
+#if defined(__linux__)
+	m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_inotify < 0)
+	{
+		std::cout << "Could not start inotify, checking the modification times of watched files" << std::endl;
+	}
+#endif
+
+	m_lastCheck = std::chrono::steady_clock::now();
+	m_bCreated = true;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for stopping the watch service and
+ *  forgetting every watched file.
+ ***********************************************************/
+void FileWatcher::Destroy()
+{
+#if defined(__linux__)
+	if (m_inotify >= 0)
+	{
+		// closing the instance removes all of its watches
+		close(m_inotify);
+	}
+#endif
+	m_inotify = -1;
+	m_files.clear();
+	m_bCreated = false;
+}
+
+/***********************************************************
+ *  Watch()
+ *
+ *  This method is used for adding a file to the watched
+ *  files.  With inotify, the directory is watched rather
+ *  than the file, because saving a file often replaces it
+ *  with a new one - and inotify hands out one watch per
+ *  directory, however many of its files are watched.
+ ***********************************************************/
+int FileWatcher::Watch(const char* filename)
+{
+	WATCHED_FILE file;
+
+	if ((m_bCreated == false) || (NULL == filename))
+	{
+		return(-1);
+	}
+
+	for (size_t i = 0; i < m_files.size(); i++)
+	{
+		if (m_files[i].filename == filename)
+		{
+			return((int)i);
+		}
+	}
+
+	file.filename = filename;
+	size_t separator = file.filename.find_last_of("/\\");
+	if (separator == std::string::npos)
+	{
+		file.directory = ".";
+		file.name = file.filename;
+	}
+	else
+	{
+		file.directory = file.filename.substr(0, separator);
+		file.name = file.filename.substr(separator + 1);
+	}
+	file.directoryWatch = -1;
+	file.bChanged = false;
+	GetFileTime(file.filename, file.modifiedTime, file.size);
+
+#if defined(__linux__)
+	if (m_inotify >= 0)
+	{
+		file.directoryWatch = inotify_add_watch(m_inotify, file.directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (file.directoryWatch < 0)
+		{
+			std::cout << "Could not watch directory:" << file.directory << std::endl;
+			return(-1);
+		}
+	}
+#endif
+
+	m_files.push_back(file);
+
+	return((int)m_files.size() - 1);
+}
+
+/***********************************************************
+ *  Poll()
+ *
+ *  This method is used for collecting the files that have
+ *  changed since the last call.  A file that changed several
+ *  times, such as one that was written in pieces, is only
+ *  reported once.
+ ***********************************************************/
+size_t FileWatcher::Poll(std::vector<int>& changedFiles)
+{
+	size_t changedCount = 0;
+
+	if (m_bCreated == false)
+	{
+		return(0);
+	}
+
+	if (m_inotify >= 0)
+	{
+		ReadEvents();
+	}
+	else
+	{
+		CheckModifiedTimes();
+	}
+
+	for (size_t i = 0; i < m_files.size(); i++)
+	{
+		if (m_files[i].bChanged)
+		{
+			m_files[i].bChanged = false;
+			changedFiles.push_back((int)i);
+			changedCount++;
+		}
+	}
+
+	return(changedCount);
+}
+
+/***********************************************************
+ *  ReadEvents()
+ *
+ *  This method is used for reading every pending inotify
+ *  event, and marking the watched files they name.  When
+ *  the event queue overflowed, every file is marked, since
+ *  any of them may have changed.
+ ***********************************************************/
+void FileWatcher::ReadEvents()
+{
+#if defined(__linux__)
+	alignas(struct inotify_event) char buffer[4096];
+	ssize_t bytesRead = read(m_inotify, buffer, sizeof(buffer));
+
+	while (bytesRead > 0)
+	{
+		const char* pEvent = buffer;
+
+		while (pEvent < buffer + bytesRead)
+		{
+			const struct inotify_event* pHeader = (const struct inotify_event*)pEvent;
+
+			for (size_t i = 0; i < m_files.size(); i++)
+			{
+				WATCHED_FILE& file = m_files[i];
+
+				if ((pHeader->mask & IN_Q_OVERFLOW) != 0)
+				{
+					file.bChanged = true;
+				}
+				else if ((pHeader->len > 0) && (file.directoryWatch == pHeader->wd) && (file.name == pHeader->name))
+				{
+					file.bChanged = true;
+				}
+			}
+			pEvent += sizeof(struct inotify_event) + pHeader->len;
+		}
+		bytesRead = read(m_inotify, buffer, sizeof(buffer));
+	}
+#endif
+}
+
+/***********************************************************
+ *  CheckModifiedTimes()
+ *
+ *  This method is used for marking the watched files whose
+ *  modification time or size changed, a few times a second
+ *  at most.  A file that is missing, for instance while an
+ *  editor replaces it, is marked when it is back.
+ ***********************************************************/
+void FileWatcher::CheckModifiedTimes()
+{
+	auto now = std::chrono::steady_clock::now();
+
+	if (std::chrono::duration<double, std::milli>(now - m_lastCheck).count() < g_CheckIntervalMilliseconds)
+	{
+		return;
+	}
+	m_lastCheck = now;
+
+	for (size_t i = 0; i < m_files.size(); i++)
+	{
+		WATCHED_FILE& file = m_files[i];
+		long long modifiedTime = 0;
+		long long size = 0;
+
+		GetFileTime(file.filename, modifiedTime, size);
+		if (modifiedTime < 0)
+		{
+			continue;
+		}
+		if ((modifiedTime != file.modifiedTime) || (size != file.size))
+		{
+			file.modifiedTime = modifiedTime;
+			file.size = size;
+			file.bChanged = true;
+		}
+	}
+}
@@ -0,0 +1,76 @@
+///////////////////////////////////////////////////////////////////////////////
+// filewatcher.h
+// ============
+// report asset files that were changed on disk while the scene is running
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  FileWatcher
+ *
+ *  This class watches a set of files for changes.  On Linux
+ *  the directory of every file is watched with inotify, so
+ *  a change costs nothing until it happens, and files that
+ *  editors save by writing a new file and renaming it over
+ *  the old one are caught as well.  Elsewhere the
+ *  modification times of the files are compared a few
+ *  times a second.  Nothing blocks: Poll() is called once
+ *  per frame and returns right away.
+ ***********************************************************/
+class FileWatcher
+{
+public:
+	// constructor
+	FileWatcher();
+	// destructor
+	~FileWatcher();
+
+	// start the watch service
+	bool Create();
+	void Destroy();
+	bool IsCreated() const { return(m_bCreated); }
+
+	// start watching a file, returning its ID - a file that is
+	// already watched keeps its ID, and -1 is returned on failure
+	int Watch(const char* filename);
+	// name of a watched file, as it was passed to Watch()
+	const std::string& GetFilename(int fileID) const { return(m_files[fileID].filename); }
+
+	// add the IDs of the files that changed since the last call,
+	// each once, and return the number that were added
+	size_t Poll(std::vector<int>& changedFiles);
+
+private:
+	// a file that is being watched
+	struct WATCHED_FILE
+	{
+		std::string filename;
+		// the directory part, and the name within the directory
+		std::string directory;
+		std::string name;
+		// inotify watch of the directory
+		int directoryWatch;
+		// modification time and size when last checked
+		long long modifiedTime;
+		long long size;
+		bool bChanged;
+	};
+
+	bool m_bCreated;
+	std::vector<WATCHED_FILE> m_files;
+	// inotify instance, -1 when it is not used
+	int m_inotify;
+	// last time the modification times were compared
+	std::chrono::steady_clock::time_point m_lastCheck;
+
+	// read the pending inotify events
+	void ReadEvents();
+	// compare the modification times with the last ones
+	void CheckModifiedTimes();
+};
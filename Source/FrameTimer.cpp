@@ -0,0 +1,474 @@
+///////////////////////////////////////////////////////////////////////////////
+// frametimer.cpp
+// ============
+// measure the CPU and GPU time of every frame and report their percentiles
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameTimer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// names of the sections, in FRAME_SECTION order
+	const char* const g_SectionNames[FRAME_SECTIONS] = { "view", "render", "swap" };
+
+	/***********************************************************
+	 *  ReportTimes()
+	 *
+	 *  Output the percentiles and the worst of a set of times,
+	 *  which are sorted in place.
+	 ***********************************************************/
+	void ReportTimes(const char* name, std::vector<double>& times)
+	{
+		if (times.empty())
+		{
+			std::cout << "INFO:   " << std::setw(6) << name << "  not measured" << std::endl;
+			return;
+		}
+
+		std::sort(times.begin(), times.end());
+		std::cout << "INFO:   " << std::setw(6) << name << std::fixed << std::setprecision(3)
+			<< "  p50 " << GetPercentile(times, 50.0)
+			<< "  p95 " << GetPercentile(times, 95.0)
+			<< "  p99 " << GetPercentile(times, 99.0)
+			<< "  worst " << times.back() << std::defaultfloat << std::setprecision(6) << std::endl;
+	}
+}
+
+/***********************************************************
+ *  GetPercentile()
+ *
+ *  This function is used for getting a percentile of sorted
+ *  times, by nearest rank - the smallest time that at least
+ *  that percent of the times are not above.
+ ***********************************************************/
+double GetPercentile(const std::vector<double>& sortedTimes, double percentile)
+{
+	size_t rank = (size_t)std::ceil((percentile / 100.0) * (double)sortedTimes.size());
+
+	if (sortedTimes.empty())
+	{
+		return(0.0);
+	}
+	rank = std::max<size_t>(rank, 1);
+	rank = std::min(rank, sortedTimes.size());
+
+	return(sortedTimes[rank - 1]);
+}
+
+/***********************************************************
+ *  FrameTimer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameTimer::FrameTimer(size_t frameCapacity)
+{
+	size_t slotCount = 1;
+
+	while (slotCount < frameCapacity)
+	{
+		slotCount <<= 1;
+	}
+	m_slots.reset(new FRAME_SLOT[slotCount]);
+	for (size_t i = 0; i < slotCount; i++)
+	{
+		m_slots[i].sequence.store(0, std::memory_order_relaxed);
+	}
+	m_slotMask = slotCount - 1;
+	m_storedFrames.store(0, std::memory_order_relaxed);
+
+	for (int i = 0; i < GPU_LATENCY; i++)
+	{
+		m_queries[i] = 0;
+		m_pending[i].bPending = false;
+	}
+	m_bQueriesCreated = false;
+	m_bQueryActive = false;
+	m_frame = 0;
+}
+
+/***********************************************************
+ *  ~FrameTimer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameTimer::~FrameTimer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the GPU timer queries.
+ *  Timer queries are core in OpenGL 3.3.
+ ***********************************************************/
+void FrameTimer::Create()
+{
+	if (m_bQueriesCreated)
+	{
+		return;
+	}
+
+	if ((GLEW_VERSION_3_3 || GLEW_ARB_timer_query) == false)
+	{
+		std::cout << "Could not create GPU timer queries, timing the CPU only" << std::endl;
+		return;
+	}
+
+	glGenQueries(GPU_LATENCY, m_queries);
+	m_bQueriesCreated = true;
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for deleting the GPU timer queries.
+ *  The frames still waiting for their GPU time wait for it
+ *  here, since nothing is drawn anymore.
+ ***********************************************************/
+void FrameTimer::Destroy()
+{
+	if (m_bQueriesCreated == false)
+	{
+		return;
+	}
+
+	if (m_bQueryActive)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		m_bQueryActive = false;
+	}
+
+	for (uint64_t frame = (m_frame > GPU_LATENCY) ? m_frame - GPU_LATENCY : 0; frame < m_frame; frame++)
+	{
+		PENDING_FRAME& pending = m_pending[frame % GPU_LATENCY];
+
+		if (pending.bPending)
+		{
+			GLuint64 elapsed = 0;
+
+			glGetQueryObjectui64v(m_queries[frame % GPU_LATENCY], GL_QUERY_RESULT, &elapsed);
+			pending.sample.gpuMilliseconds = (double)elapsed / 1000000.0;
+			pending.bPending = false;
+			StoreFrame(pending.sample);
+		}
+	}
+
+	glDeleteQueries(GPU_LATENCY, m_queries);
+	for (int i = 0; i < GPU_LATENCY; i++)
+	{
+		m_queries[i] = 0;
+	}
+	m_bQueriesCreated = false;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for starting to time a frame.  The
+ *  GPU times that arrived are collected first, since the
+ *  query of the oldest frame is reused for this one.
+ ***********************************************************/
+void FrameTimer::BeginFrame()
+{
+	m_frameStart = std::chrono::steady_clock::now();
+	m_current.frame = m_frame;
+	m_current.cpuMilliseconds = 0.0;
+	for (int i = 0; i < FRAME_SECTIONS; i++)
+	{
+		m_current.sectionMilliseconds[i] = 0.0;
+	}
+	m_current.gpuMilliseconds = -1.0;
+
+	if (m_bQueriesCreated)
+	{
+		CollectGPUTimes(true);
+		glBeginQuery(GL_TIME_ELAPSED, m_queries[m_frame % GPU_LATENCY]);
+		m_bQueryActive = true;
+	}
+}
+
+/***********************************************************
+ *  EndGPUWork()
+ *
+ *  This method is used for ending the GPU query of the frame,
+ *  after its last draw call.
+ ***********************************************************/
+void FrameTimer::EndGPUWork()
+{
+	if (m_bQueryActive)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		m_bQueryActive = false;
+	}
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for finishing the CPU times of a
+ *  frame.  Without GPU queries the frame is stored now,
+ *  otherwise when its GPU time is read.
+ ***********************************************************/
+void FrameTimer::EndFrame()
+{
+	EndGPUWork();
+	m_current.cpuMilliseconds = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - m_frameStart).count();
+
+	if (m_bQueriesCreated)
+	{
+		PENDING_FRAME& pending = m_pending[m_frame % GPU_LATENCY];
+
+		pending.sample = m_current;
+		pending.bPending = true;
+		// store the ones that are already done, without waiting
+		CollectGPUTimes(false);
+	}
+	else
+	{
+		StoreFrame(m_current);
+	}
+	m_frame++;
+}
+
+/***********************************************************
+ *  BeginSection()
+ *
+ *  This method is used for starting to time a section of
+ *  the frame.
+ ***********************************************************/
+void FrameTimer::BeginSection(FRAME_SECTION section)
+{
+	m_sectionStart[section] = std::chrono::steady_clock::now();
+}
+
+/***********************************************************
+ *  EndSection()
+ *
+ *  This method is used for adding the time since the section
+ *  began to the section, which may be timed several times
+ *  in a frame.
+ ***********************************************************/
+void FrameTimer::EndSection(FRAME_SECTION section)
+{
+	m_current.sectionMilliseconds[section] += std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - m_sectionStart[section]).count();
+}
+
+/***********************************************************
+ *  CollectGPUTimes()
+ *
+ *  This method is used for reading the GPU times of the
+ *  pending frames, oldest first, stopping at the first one
+ *  that has not arrived so that the frames are stored in
+ *  order.  Only the oldest frame is stored without its GPU
+ *  time, when its query has to be reused - waiting for it
+ *  would stall the CPU until the GPU caught up.
+ ***********************************************************/
+void FrameTimer::CollectGPUTimes(bool bReuseOldest)
+{
+	uint64_t oldest = (m_frame >= GPU_LATENCY) ? m_frame - GPU_LATENCY : 0;
+
+	// when the current frame is not pending yet, the oldest one
+	// may still be one frame older
+	if (bReuseOldest == false)
+	{
+		oldest = (m_frame + 1 >= GPU_LATENCY) ? m_frame + 1 - GPU_LATENCY : 0;
+	}
+
+	for (uint64_t frame = oldest; frame <= m_frame; frame++)
+	{
+		int index = (int)(frame % GPU_LATENCY);
+		PENDING_FRAME& pending = m_pending[index];
+		GLint available = GL_FALSE;
+
+		if ((pending.bPending == false) || (pending.sample.frame != frame))
+		{
+			continue;
+		}
+
+		glGetQueryObjectiv(m_queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available == GL_TRUE)
+		{
+			GLuint64 elapsed = 0;
+
+			glGetQueryObjectui64v(m_queries[index], GL_QUERY_RESULT, &elapsed);
+			pending.sample.gpuMilliseconds = (double)elapsed / 1000000.0;
+		}
+		else if ((bReuseOldest == false) || (index != (int)(m_frame % GPU_LATENCY)))
+		{
+			break;
+		}
+		pending.bPending = false;
+		StoreFrame(pending.sample);
+	}
+}
+
+/***********************************************************
+ *  StoreFrame()
+ *
+ *  This method is used for writing a frame into the next
+ *  slot of the ring.  The sequence of the slot is made odd
+ *  before the write and even after it, so that a reader
+ *  can tell a slot that changed while it was copied.
+ ***********************************************************/
+void FrameTimer::StoreFrame(const FRAME_SAMPLE& sample)
+{
+	uint64_t stored = m_storedFrames.load(std::memory_order_relaxed);
+	FRAME_SLOT& slot = m_slots[stored & m_slotMask];
+	uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+
+	slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.sample = sample;
+	slot.sequence.store(sequence + 2, std::memory_order_release);
+	m_storedFrames.store(stored + 1, std::memory_order_release);
+}
+
+/***********************************************************
+ *  GetSamples()
+ *
+ *  This method is used for copying the frames in the ring,
+ *  oldest first.  A slot that the rendering thread wrote
+ *  while it was copied is left out rather than waited for.
+ ***********************************************************/
+size_t FrameTimer::GetSamples(std::vector<FRAME_SAMPLE>& samples) const
+{
+	uint64_t stored = m_storedFrames.load(std::memory_order_acquire);
+	uint64_t first = (stored > m_slotMask + 1) ? stored - (m_slotMask + 1) : 0;
+
+	samples.clear();
+	samples.reserve((size_t)(stored - first));
+	for (uint64_t i = first; i < stored; i++)
+	{
+		const FRAME_SLOT& slot = m_slots[i & m_slotMask];
+		uint64_t before = slot.sequence.load(std::memory_order_acquire);
+		FRAME_SAMPLE sample = slot.sample;
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (((before & 1) == 0) && (slot.sequence.load(std::memory_order_relaxed) == before))
+		{
+			samples.push_back(sample);
+		}
+	}
+
+	return(samples.size());
+}
+
+/***********************************************************
+ *  Report()
+ *
+ *  This method is used for displaying the percentiles of
+ *  the stored frames, and the sections of the worst frame,
+ *  which show where a hitch came from.
+ ***********************************************************/
+void FrameTimer::Report() const
+{
+	std::vector<FRAME_SAMPLE> samples;
+	std::vector<double> times;
+	size_t worst = 0;
+
+	if (GetSamples(samples) == 0)
+	{
+		return;
+	}
+
+	std::cout << "INFO: Frame times of the last " << samples.size() << " frames in ms" << std::endl;
+	times.resize(samples.size());
+	for (size_t i = 0; i < samples.size(); i++)
+	{
+		times[i] = samples[i].cpuMilliseconds;
+		if (samples[i].cpuMilliseconds > samples[worst].cpuMilliseconds)
+		{
+			worst = i;
+		}
+	}
+	ReportTimes("frame", times);
+
+	for (int s = 0; s < FRAME_SECTIONS; s++)
+	{
+		for (size_t i = 0; i < samples.size(); i++)
+		{
+			times[i] = samples[i].sectionMilliseconds[s];
+		}
+		ReportTimes(g_SectionNames[s], times);
+	}
+
+	times.clear();
+	for (size_t i = 0; i < samples.size(); i++)
+	{
+		if (samples[i].gpuMilliseconds >= 0.0)
+		{
+			times.push_back(samples[i].gpuMilliseconds);
+		}
+	}
+	ReportTimes("gpu", times);
+
+	const FRAME_SAMPLE& worstFrame = samples[worst];
+	std::cout << "INFO: Worst frame " << worstFrame.frame << ": " << worstFrame.cpuMilliseconds << " ms";
+	for (int s = 0; s < FRAME_SECTIONS; s++)
+	{
+		std::cout << ", " << g_SectionNames[s] << " " << worstFrame.sectionMilliseconds[s];
+	}
+	if (worstFrame.gpuMilliseconds >= 0.0)
+	{
+		std::cout << ", gpu " << worstFrame.gpuMilliseconds;
+	}
+	std::cout << std::endl;
+}
+
+/***********************************************************
+ *  WriteCSV()
+ *
+ *  This method is used for writing the stored frames into a
+ *  CSV file, one row per frame, with -1 for a GPU time that
+ *  was not measured.
+ ***********************************************************/
+bool FrameTimer::WriteCSV(const char* filename) const
+{
+	std::vector<FRAME_SAMPLE> samples;
+	FILE* pFile = fopen(filename, "w");
+
+	if (NULL == pFile)
+	{
+		std::cout << "Could not write frame times:" << filename << std::endl;
+		return(false);
+	}
+
+	GetSamples(samples);
+	fprintf(pFile, "frame,cpu_ms");
+	for (int s = 0; s < FRAME_SECTIONS; s++)
+	{
+		fprintf(pFile, ",%s_ms", g_SectionNames[s]);
+	}
+	fprintf(pFile, ",gpu_ms\n");
+	for (size_t i = 0; i < samples.size(); i++)
+	{
+		const FRAME_SAMPLE& sample = samples[i];
+
+		fprintf(pFile, "%llu,%.4f", (unsigned long long)sample.frame, sample.cpuMilliseconds);
+		for (int s = 0; s < FRAME_SECTIONS; s++)
+		{
+			fprintf(pFile, ",%.4f", sample.sectionMilliseconds[s]);
+		}
+		fprintf(pFile, ",%.4f\n", sample.gpuMilliseconds);
+	}
+
+	if (fclose(pFile) != 0)
+	{
+		std::cout << "Could not write frame times:" << filename << std::endl;
+		return(false);
+	}
+	std::cout << "INFO: Wrote " << samples.size() << " frame times to " << filename << std::endl;
+
+	return(true);
+}
@@ -0,0 +1,142 @@
+///////////////////////////////////////////////////////////////////////////////
+// frametimer.h
+// ============
+// measure the CPU and GPU time of every frame and report their percentiles
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// parts of a frame that are timed on the CPU
+enum FRAME_SECTION
+{
+	// PrepareSceneView() - camera and projection
+	FRAME_SECTION_VIEW = 0,
+	// RenderScene() - culling, sorting and draw submission
+	FRAME_SECTION_RENDER,
+	// glfwSwapBuffers() - includes waiting for the GPU and vsync
+	FRAME_SECTION_SWAP,
+	FRAME_SECTIONS
+};
+
+/***********************************************************
+ *  FRAME_SAMPLE
+ *
+ *  The times of one frame, in milliseconds.  The GPU time
+ *  is the time the GPU spent on the commands of the frame,
+ *  and is -1 when the driver has no timer queries or the
+ *  result did not arrive in time.
+ ***********************************************************/
+struct FRAME_SAMPLE
+{
+	uint64_t frame;
+	// from BeginFrame() to EndFrame()
+	double cpuMilliseconds;
+	double sectionMilliseconds[FRAME_SECTIONS];
+	double gpuMilliseconds;
+};
+
+// percentile (0 to 100) of times sorted in ascending order, by
+// nearest rank - 0 when there are no times
+double GetPercentile(const std::vector<double>& sortedTimes, double percentile);
+
+/***********************************************************
+ *  FrameTimer
+ *
+ *  This class times every frame on the CPU, around each
+ *  section of the main loop, and on the GPU with one
+ *  GL_TIME_ELAPSED query per frame.  The queries are read
+ *  GPU_LATENCY frames later, and only when their result is
+ *  available, so that timing never stalls the pipeline.  A
+ *  frame is stored once its GPU time is known.
+ *
+ *  The frames are kept in a ring that is written by the
+ *  rendering thread and can be read from any thread without
+ *  a lock: each slot has a sequence number that is odd while
+ *  the slot is being written, so a reader copies a slot and
+ *  keeps the copy only when the sequence did not change.
+ *  The oldest frames are overwritten once the ring is full.
+ ***********************************************************/
+class FrameTimer
+{
+public:
+	// frames between a query and reading its result
+	static const int GPU_LATENCY = 4;
+
+	// constructor - the ring keeps the last frameCapacity frames,
+	// rounded up to a power of two
+	FrameTimer(size_t frameCapacity = 8192);
+	// destructor
+	~FrameTimer();
+
+	// create the GPU timer queries, needing the OpenGL context -
+	// without them, only the CPU times are measured
+	void Create();
+	void Destroy();
+
+	// start and end a frame, on the rendering thread.  The GPU query
+	// covers the commands from BeginFrame() to EndGPUWork(), which
+	// should come before the buffers are swapped.
+	void BeginFrame();
+	void EndGPUWork();
+	void EndFrame();
+	// time a section of the frame
+	void BeginSection(FRAME_SECTION section);
+	void EndSection(FRAME_SECTION section);
+
+	// copy the stored frames, oldest first, from any thread -
+	// returns the number copied
+	size_t GetSamples(std::vector<FRAME_SAMPLE>& samples) const;
+
+	// output the 50th, 95th and 99th percentile and the worst time
+	// of the frame, each section and the GPU, and the worst frame
+	void Report() const;
+	// write every stored frame into a CSV file
+	bool WriteCSV(const char* filename) const;
+
+private:
+	// a slot of the frame ring
+	struct FRAME_SLOT
+	{
+		std::atomic<uint64_t> sequence;
+		FRAME_SAMPLE sample;
+	};
+	// a frame whose GPU time has not been read yet
+	struct PENDING_FRAME
+	{
+		FRAME_SAMPLE sample;
+		bool bPending;
+	};
+
+	std::unique_ptr<FRAME_SLOT[]> m_slots;
+	size_t m_slotMask;
+	// number of frames ever stored - only the rendering thread
+	// writes it
+	std::atomic<uint64_t> m_storedFrames;
+
+	// one query and pending frame for each of the last frames
+	GLuint m_queries[GPU_LATENCY];
+	PENDING_FRAME m_pending[GPU_LATENCY];
+	bool m_bQueriesCreated;
+	bool m_bQueryActive;
+
+	uint64_t m_frame;
+	std::chrono::steady_clock::time_point m_frameStart;
+	std::chrono::steady_clock::time_point m_sectionStart[FRAME_SECTIONS];
+	FRAME_SAMPLE m_current;
+
+	// read the GPU times that arrived, storing their frames in order -
+	// the frame whose query is about to be reused is stored without
+	// one when it has not arrived
+	void CollectGPUTimes(bool bReuseOldest);
+	// add a finished frame to the ring
+	void StoreFrame(const FRAME_SAMPLE& sample);
+};
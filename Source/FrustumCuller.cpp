@@ -0,0 +1,301 @@
+///////////////////////////////////////////////////////////////////////////////
+// frustumculler.cpp
+// ============
+// test the bounding volumes of many objects against the view frustum
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrustumCuller.h"
+#include "JobSystem.h"
+
+#include <atomic>
+#include <cmath>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define FRUSTUM_CULLER_SIMD
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#define TARGET_SSE2
+#else
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#endif
+#endif
+
+/***********************************************************
+ *  ExtractFrustumPlanes()
+ *
+ *  This function is used for getting the six frustum planes
+ *  from the rows of a view-projection matrix.  The planes are
+ *  normalized so that the plane distances are in world units.
+ ***********************************************************/
+void ExtractFrustumPlanes(const glm::mat4& viewProjection, FRUSTUM_PLANES& frustum)
+{
+	const glm::mat4& m = viewProjection;
+	// glm matrices are column-major, so m[column][row]
+	glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+	glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+	glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+	glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+	frustum.planes[0] = row3 + row0;	// left
+	frustum.planes[1] = row3 - row0;	// right
+	frustum.planes[2] = row3 + row1;	// bottom
+	frustum.planes[3] = row3 - row1;	// top
+	frustum.planes[4] = row3 + row2;	// near
+	frustum.planes[5] = row3 - row2;	// far
+
+	for (int i = 0; i < 6; i++)
+	{
+		glm::vec4& plane = frustum.planes[i];
+		float length = sqrtf((plane.x * plane.x) + (plane.y * plane.y) + (plane.z * plane.z));
+
+		if (length > 0.0f)
+		{
+			plane.x /= length;
+			plane.y /= length;
+			plane.z /= length;
+			plane.w /= length;
+		}
+	}
+}
+
+/***********************************************************
+ *  TransformBoundingVolume()
+ *
+ *  This function is used for moving a bounding volume into
+ *  world space.  The box stays axis-aligned by growing to
+ *  hold the rotated box, and the sphere is scaled by the
+ *  largest scale of the model matrix.
+ ***********************************************************/
+BOUNDING_VOLUME TransformBoundingVolume(const BOUNDING_VOLUME& bounds, const glm::mat4& model)
+{
+	BOUNDING_VOLUME world;
+	float maxScale = 0.0f;
+
+	glm::vec4 center = model * glm::vec4(bounds.center, 1.0f);
+	world.center = glm::vec3(center.x, center.y, center.z);
+
+	for (int row = 0; row < 3; row++)
+	{
+		world.extents[row] =
+			(fabsf(model[0][row]) * bounds.extents.x) +
+			(fabsf(model[1][row]) * bounds.extents.y) +
+			(fabsf(model[2][row]) * bounds.extents.z);
+	}
+
+	for (int column = 0; column < 3; column++)
+	{
+		float scale = sqrtf(
+			(model[column][0] * model[column][0]) +
+			(model[column][1] * model[column][1]) +
+			(model[column][2] * model[column][2]));
+		if (scale > maxScale)
+		{
+			maxScale = scale;
+		}
+	}
+	world.radius = bounds.radius * maxScale;
+
+	return(world);
+}
+
+/***********************************************************
+ *  Resize()
+ *
+ *  This method is used for setting the number of objects.
+ *  New objects are visible until they are tested.
+ ***********************************************************/
+void FrustumCuller::Resize(size_t count)
+{
+	m_centerX.resize(count, 0.0f);
+	m_centerY.resize(count, 0.0f);
+	m_centerZ.resize(count, 0.0f);
+	m_extentX.resize(count, 0.0f);
+	m_extentY.resize(count, 0.0f);
+	m_extentZ.resize(count, 0.0f);
+	m_radius.resize(count, 0.0f);
+	m_visible.resize(count, 1);
+}
+
+/***********************************************************
+ *  SetBounds()
+ *
+ *  This method is used for setting the world space bounding
+ *  volume of an object.
+ ***********************************************************/
+void FrustumCuller::SetBounds(size_t index, const BOUNDING_VOLUME& bounds)
+{
+	m_centerX[index] = bounds.center.x;
+	m_centerY[index] = bounds.center.y;
+	m_centerZ[index] = bounds.center.z;
+	m_extentX[index] = bounds.extents.x;
+	m_extentY[index] = bounds.extents.y;
+	m_extentZ[index] = bounds.extents.z;
+	m_radius[index] = bounds.radius;
+}
+
+/***********************************************************
+ *  CullRange()
+ *
+ *  This method is used for testing the objects from first to
+ *  last one at a time.  For each plane, the distance from
+ *  the center is compared to the smaller of the box's
+ *  projected radius and the sphere radius.
+ ***********************************************************/
+size_t FrustumCuller::CullRange(const FRUSTUM_PLANES& frustum, size_t first, size_t last)
+{
+	size_t visibleCount = 0;
+
+	for (size_t i = first; i < last; i++)
+	{
+		uint8_t bVisible = 1;
+
+		for (int p = 0; p < 6; p++)
+		{
+			const glm::vec4& plane = frustum.planes[p];
+			float distance = (plane.x * m_centerX[i]) + (plane.y * m_centerY[i]) + (plane.z * m_centerZ[i]) + plane.w;
+			float boxRadius = (fabsf(plane.x) * m_extentX[i]) + (fabsf(plane.y) * m_extentY[i]) + (fabsf(plane.z) * m_extentZ[i]);
+			float radius = (boxRadius < m_radius[i]) ? boxRadius : m_radius[i];
+
+			if (distance < -radius)
+			{
+				bVisible = 0;
+				break;
+			}
+		}
+
+		m_visible[i] = bVisible;
+		visibleCount += bVisible;
+	}
+
+	return(visibleCount);
+}
+
+/***********************************************************
+ *  CullScalar()
+ *
+ *  This method is used for testing every object one at a
+ *  time, for comparing against the SIMD path.
+ ***********************************************************/
+size_t FrustumCuller::CullScalar(const FRUSTUM_PLANES& frustum)
+{
+	return(CullRange(frustum, 0, m_visible.size()));
+}
+
+#ifdef FRUSTUM_CULLER_SIMD
+namespace
+{
+	/***********************************************************
+	 *  CullSSE2()
+	 *
+	 *  Tests groups of four objects against all six planes and
+	 *  writes a visible byte per object.  The arithmetic is the
+	 *  same as CullRange(), so the results are identical.
+	 ***********************************************************/
+	TARGET_SSE2 size_t CullSSE2(
+		const FRUSTUM_PLANES& frustum,
+		const float* centerX, const float* centerY, const float* centerZ,
+		const float* extentX, const float* extentY, const float* extentZ,
+		const float* radius,
+		uint8_t* visible,
+		size_t groupCount)
+	{
+		const __m128 signMask = _mm_set1_ps(-0.0f);
+		size_t visibleCount = 0;
+
+		for (size_t g = 0; g < groupCount; g++)
+		{
+			size_t i = g * 4;
+			__m128 cx = _mm_loadu_ps(centerX + i);
+			__m128 cy = _mm_loadu_ps(centerY + i);
+			__m128 cz = _mm_loadu_ps(centerZ + i);
+			__m128 ex = _mm_loadu_ps(extentX + i);
+			__m128 ey = _mm_loadu_ps(extentY + i);
+			__m128 ez = _mm_loadu_ps(extentZ + i);
+			__m128 r = _mm_loadu_ps(radius + i);
+			// all four objects start out visible
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+			for (int p = 0; p < 6; p++)
+			{
+				const glm::vec4& plane = frustum.planes[p];
+				__m128 nx = _mm_set1_ps(plane.x);
+				__m128 ny = _mm_set1_ps(plane.y);
+				__m128 nz = _mm_set1_ps(plane.z);
+
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)), _mm_mul_ps(nz, cz)), _mm_set1_ps(plane.w));
+				__m128 boxRadius = _mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(_mm_andnot_ps(signMask, nx), ex),
+					_mm_mul_ps(_mm_andnot_ps(signMask, ny), ey)),
+					_mm_mul_ps(_mm_andnot_ps(signMask, nz), ez));
+				__m128 limit = _mm_xor_ps(_mm_min_ps(boxRadius, r), signMask);
+
+				inside = _mm_andnot_ps(_mm_cmplt_ps(distance, limit), inside);
+				if (_mm_movemask_ps(inside) == 0)
+				{
+					break;
+				}
+			}
+
+			int mask = _mm_movemask_ps(inside);
+			for (int lane = 0; lane < 4; lane++)
+			{
+				uint8_t bVisible = (uint8_t)((mask >> lane) & 1);
+				visible[i + lane] = bVisible;
+				visibleCount += bVisible;
+			}
+		}
+
+		return(visibleCount);
+	}
+}
+#endif
+
+/***********************************************************
+ *  CullBlock()
+ *
+ *  This method is used for testing the objects from first to
+ *  last.  Groups of four are tested with SSE2, and the
+ *  objects left over are tested one at a time.
+ ***********************************************************/
+size_t FrustumCuller::CullBlock(const FRUSTUM_PLANES& frustum, size_t first, size_t last)
+{
+#ifdef FRUSTUM_CULLER_SIMD
+	size_t groupCount = (last - first) / 4;
+	size_t visibleCount = CullSSE2(
+		frustum,
+		m_centerX.data() + first, m_centerY.data() + first, m_centerZ.data() + first,
+		m_extentX.data() + first, m_extentY.data() + first, m_extentZ.data() + first,
+		m_radius.data() + first,
+		m_visible.data() + first,
+		groupCount);
+
+	return(visibleCount + CullRange(frustum, first + groupCount * 4, last));
+#else
+	return(CullRange(frustum, first, last));
+#endif
+}
+
+/***********************************************************
+ *  Cull()
+ *
+ *  This method is used for testing every object against the
+ *  frustum, in blocks spread over the job system when there
+ *  are many objects.  Each block writes only its own
+ *  visible bytes, and adds its count once at the end.
+ ***********************************************************/
+size_t FrustumCuller::Cull(const FRUSTUM_PLANES& frustum)
+{
+	// objects in a block, a multiple of the SSE2 group - fewer
+	// objects are tested on the calling thread
+	const size_t blockSize = 4096;
+	std::atomic<size_t> visibleCount(0);
+
+	GetJobSystem().ParallelFor(m_visible.size(), blockSize, [&](size_t first, size_t last)
+	{
+		visibleCount.fetch_add(CullBlock(frustum, first, last), std::memory_order_relaxed);
+	});
+
+	return(visibleCount.load());
+}
@@ -0,0 +1,88 @@
+///////////////////////////////////////////////////////////////////////////////
+// frustumculler.h
+// ============
+// test the bounding volumes of many objects against the view frustum
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  BOUNDING_VOLUME
+ *
+ *  Axis-aligned box (center and half extents) together with
+ *  a bounding sphere around the same center.  An object is
+ *  outside a plane when either of the two is outside it.
+ ***********************************************************/
+struct BOUNDING_VOLUME
+{
+	glm::vec3 center;
+	glm::vec3 extents;
+	float radius;
+};
+
+/***********************************************************
+ *  FRUSTUM_PLANES
+ *
+ *  The six planes of a view frustum, as (normal, distance)
+ *  with the normals pointing into the frustum.
+ ***********************************************************/
+struct FRUSTUM_PLANES
+{
+	glm::vec4 planes[6];
+};
+
+// extract the normalized frustum planes from a view-projection matrix
+void ExtractFrustumPlanes(const glm::mat4& viewProjection, FRUSTUM_PLANES& frustum);
+
+// transform an object space bounding volume into world space
+BOUNDING_VOLUME TransformBoundingVolume(const BOUNDING_VOLUME& bounds, const glm::mat4& model);
+
+/***********************************************************
+ *  FrustumCuller
+ *
+ *  This class holds the world space bounding volumes of the
+ *  objects in structure-of-arrays form, and tests them all
+ *  against the frustum planes, four objects at a time with
+ *  SSE2 when it is available, and in blocks on the job
+ *  system when there are many.
+ ***********************************************************/
+class FrustumCuller
+{
+public:
+	// set the number of objects, keeping the existing volumes
+	void Resize(size_t count);
+	// set the world space bounding volume of an object
+	void SetBounds(size_t index, const BOUNDING_VOLUME& bounds);
+
+	// test every object against the frustum, returning the number
+	// of visible objects
+	size_t Cull(const FRUSTUM_PLANES& frustum);
+	// same as Cull(), one object at a time - the results are
+	// identical to the SIMD path
+	size_t CullScalar(const FRUSTUM_PLANES& frustum);
+
+	size_t Size() const { return(m_visible.size()); }
+	// result of the last test for an object
+	bool IsVisible(size_t index) const { return(m_visible[index] != 0); }
+
+private:
+	std::vector<float> m_centerX;
+	std::vector<float> m_centerY;
+	std::vector<float> m_centerZ;
+	std::vector<float> m_extentX;
+	std::vector<float> m_extentY;
+	std::vector<float> m_extentZ;
+	std::vector<float> m_radius;
+	std::vector<uint8_t> m_visible;
+
+	// test the objects in [first, last) one at a time
+	size_t CullRange(const FRUSTUM_PLANES& frustum, size_t first, size_t last);
+	// test the objects in [first, last), four at a time with SSE2
+	size_t CullBlock(const FRUSTUM_PLANES& frustum, size_t first, size_t last);
+};
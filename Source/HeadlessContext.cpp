@@ -0,0 +1,522 @@
+///////////////////////////////////////////////////////////////////////////////
+// headlesscontext.cpp
+// ============
+// render into an offscreen framebuffer with an EGL context and no display
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "HeadlessContext.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#if defined(__linux__)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+	// OpenGL versions to ask for, newest first - llvmpipe offers 4.5
+	const int g_ContextVersions[][2] = { { 4, 6 }, { 4, 5 }, { 4, 3 }, { 4, 1 }, { 3, 3 } };
+	// largest block of a stored (not compressed) deflate stream
+	const size_t g_StoredBlockBytes = 65535;
+
+	/***********************************************************
+	 *  UpdateCRC()
+	 *
+	 *  Add bytes to the CRC-32 of a PNG chunk.
+	 ***********************************************************/
+	uint32_t UpdateCRC(uint32_t crc, const unsigned char* pBytes, size_t byteCount)
+	{
+		static uint32_t table[256];
+		static bool bTableBuilt = false;
+
+		if (bTableBuilt == false)
+		{
+			for (uint32_t n = 0; n < 256; n++)
+			{
+				uint32_t c = n;
+				for (int k = 0; k < 8; k++)
+				{
+					c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+				}
+				table[n] = c;
+			}
+			bTableBuilt = true;
+		}
+
+		crc = ~crc;
+		for (size_t i = 0; i < byteCount; i++)
+		{
+			crc = table[(crc ^ pBytes[i]) & 0xFF] ^ (crc >> 8);
+		}
+
+		return(~crc);
+	}
+
+	/***********************************************************
+	 *  AppendBigEndian()
+	 *
+	 *  Append a 32-bit value, most significant byte first.
+	 ***********************************************************/
+	void AppendBigEndian(std::vector<unsigned char>& bytes, uint32_t value)
+	{
+		bytes.push_back((unsigned char)(value >> 24));
+		bytes.push_back((unsigned char)(value >> 16));
+		bytes.push_back((unsigned char)(value >> 8));
+		bytes.push_back((unsigned char)value);
+	}
+
+	/***********************************************************
+	 *  WriteChunk()
+	 *
+	 *  Write a PNG chunk - its length, type, data and CRC.
+	 ***********************************************************/
+	bool WriteChunk(FILE* pFile, const char* type, const std::vector<unsigned char>& data)
+	{
+		std::vector<unsigned char> header;
+
+		AppendBigEndian(header, (uint32_t)data.size());
+		header.insert(header.end(), type, type + 4);
+
+		uint32_t crc = UpdateCRC(0, (const unsigned char*)type, 4);
+		crc = UpdateCRC(crc, data.data(), data.size());
+		std::vector<unsigned char> footer;
+		AppendBigEndian(footer, crc);
+
+		return((fwrite(header.data(), 1, header.size(), pFile) == header.size()) &&
+			(data.empty() || (fwrite(data.data(), 1, data.size(), pFile) == data.size())) &&
+			(fwrite(footer.data(), 1, footer.size(), pFile) == footer.size()));
+	}
+
+	/***********************************************************
+	 *  WriteRGBAFile()
+	 *
+	 *  Write RGBA pixels, top row first, into a PNG file.  The
+	 *  image data is a zlib stream of stored deflate blocks:
+	 *  the file is larger than a compressed one, but needs no
+	 *  compression library and takes no time to write.
+	 ***********************************************************/
+	bool WriteRGBAFile(const char* filename, int width, int height, const std::vector<unsigned char>& pixels)
+	{
+		const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		const size_t rowBytes = (size_t)width * 4;
+		std::vector<unsigned char> rows;
+		std::vector<unsigned char> header;
+		std::vector<unsigned char> data;
+		uint32_t adlerA = 1;
+		uint32_t adlerB = 0;
+
+		// every row starts with its filter type, 0 for none
+		rows.reserve((rowBytes + 1) * (size_t)height);
+		for (int y = 0; y < height; y++)
+		{
+			rows.push_back(0);
+			rows.insert(rows.end(), pixels.begin() + (size_t)y * rowBytes, pixels.begin() + (size_t)(y + 1) * rowBytes);
+		}
+		for (size_t i = 0; i < rows.size(); i++)
+		{
+			adlerA = (adlerA + rows[i]) % 65521;
+			adlerB = (adlerB + adlerA) % 65521;
+		}
+
+		AppendBigEndian(header, (uint32_t)width);
+		AppendBigEndian(header, (uint32_t)height);
+		// 8 bits per channel, RGBA, deflate, no interlacing
+		const unsigned char format[5] = { 8, 6, 0, 0, 0 };
+		header.insert(header.end(), format, format + 5);
+
+		data.reserve(rows.size() + (rows.size() / g_StoredBlockBytes + 1) * 5 + 6);
+		data.push_back(0x78);
+		data.push_back(0x01);
+		for (size_t offset = 0; (offset < rows.size()) || (offset == 0); offset += g_StoredBlockBytes)
+		{
+			size_t blockBytes = std::min(g_StoredBlockBytes, rows.size() - offset);
+			bool bLast = (offset + blockBytes >= rows.size());
+
+			data.push_back(bLast ? 1 : 0);
+			data.push_back((unsigned char)blockBytes);
+			data.push_back((unsigned char)(blockBytes >> 8));
+			data.push_back((unsigned char)~blockBytes);
+			data.push_back((unsigned char)(~blockBytes >> 8));
+			data.insert(data.end(), rows.begin() + offset, rows.begin() + offset + blockBytes);
+			if (bLast)
+			{
+				break;
+			}
+		}
+		AppendBigEndian(data, (adlerB << 16) | adlerA);
+
+		FILE* pFile = fopen(filename, "wb");
+		if (NULL == pFile)
+		{
+			return(false);
+		}
+		bool bWritten = (fwrite(signature, 1, sizeof(signature), pFile) == sizeof(signature)) &&
+			WriteChunk(pFile, "IHDR", header) &&
+			WriteChunk(pFile, "IDAT", data) &&
+			WriteChunk(pFile, "IEND", std::vector<unsigned char>());
+
+		return((fclose(pFile) == 0) && bWritten);
+	}
+
+#if defined(__linux__)
+	/***********************************************************
+	 *  HasExtension()
+	 *
+	 *  Check an EGL extension string for a whole name.
+	 ***********************************************************/
+	bool HasExtension(const char* extensions, const char* name)
+	{
+		size_t nameLength = strlen(name);
+		const char* pFound = extensions;
+
+		while ((NULL != pFound) && (NULL != (pFound = strstr(pFound, name))))
+		{
+			if ((pFound[nameLength] == ' ') || (pFound[nameLength] == 0))
+			{
+				return(true);
+			}
+			pFound += nameLength;
+		}
+
+		return(false);
+	}
+
+	/***********************************************************
+	 *  OpenDisplay()
+	 *
+	 *  Open and initialize the first EGL display that needs no
+	 *  window system - EGL_NO_DISPLAY when there is none.
+	 ***********************************************************/
+	EGLDisplay OpenDisplay(std::string& displayName)
+	{
+		const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+			(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		EGLDisplay display = EGL_NO_DISPLAY;
+
+		if ((NULL != getPlatformDisplay) && HasExtension(clientExtensions, "EGL_MESA_platform_surfaceless"))
+		{
+			display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+			if ((display != EGL_NO_DISPLAY) && (eglInitialize(display, NULL, NULL) == EGL_TRUE))
+			{
+				displayName = "surfaceless";
+				return(display);
+			}
+		}
+
+		PFNEGLQUERYDEVICESEXTPROC queryDevices =
+			(PFNEGLQUERYDEVICESEXTPROC)eglGetProcAddress("eglQueryDevicesEXT");
+		if ((NULL != getPlatformDisplay) && (NULL != queryDevices) && HasExtension(clientExtensions, "EGL_EXT_platform_device"))
+		{
+			EGLDeviceEXT device = NULL;
+			EGLint deviceCount = 0;
+
+			if ((queryDevices(1, &device, &deviceCount) == EGL_TRUE) && (deviceCount > 0))
+			{
+				display = getPlatformDisplay(EGL_PLATFORM_DEVICE_EXT, device, NULL);
+				if ((display != EGL_NO_DISPLAY) && (eglInitialize(display, NULL, NULL) == EGL_TRUE))
+				{
+					displayName = "device";
+					return(display);
+				}
+			}
+		}
+
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+		if ((display != EGL_NO_DISPLAY) && (eglInitialize(display, NULL, NULL) == EGL_TRUE))
+		{
+			displayName = "default";
+			return(display);
+		}
+
+		return(EGL_NO_DISPLAY);
+	}
+#endif
+}
+
+/***********************************************************
+ *  HeadlessContext()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+HeadlessContext::HeadlessContext()
+{
+	m_display = NULL;
+	m_context = NULL;
+	m_surface = NULL;
+	m_framebuffer = 0;
+	m_colorBuffer = 0;
+	m_depthBuffer = 0;
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  ~HeadlessContext()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+HeadlessContext::~HeadlessContext()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating an OpenGL core profile
+ *  context with EGL, the newest version the driver offers,
+ *  and making it current.
+ ***********************************************************/
+bool HeadlessContext::Create()
+{
+#if defined(__linux__)
+	const EGLint configAttributes[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_ALPHA_SIZE, 8,
+		EGL_NONE };
+	EGLConfig config = NULL;
+	EGLint configCount = 0;
+
+	EGLDisplay display = OpenDisplay(m_displayName);
+	if (display == EGL_NO_DISPLAY)
+	{
+		std::cout << "Could not open an EGL display" << std::endl;
+		return(false);
+	}
+	m_display = display;
+
+	// a surfaceless display may have no pbuffer configs, and
+	// needs no surface at all
+	if ((eglChooseConfig(display, configAttributes, &config, 1, &configCount) == EGL_FALSE) || (configCount == 0))
+	{
+		if ((eglChooseConfig(display, configAttributes + 2, &config, 1, &configCount) == EGL_FALSE) || (configCount == 0))
+		{
+			std::cout << "Could not find an EGL config for OpenGL" << std::endl;
+			Destroy();
+			return(false);
+		}
+	}
+
+	if (eglBindAPI(EGL_OPENGL_API) == EGL_FALSE)
+	{
+		std::cout << "Could not bind the OpenGL API to EGL" << std::endl;
+		Destroy();
+		return(false);
+	}
+
+	for (size_t i = 0; (i < sizeof(g_ContextVersions) / sizeof(g_ContextVersions[0])) && (NULL == m_context); i++)
+	{
+		const EGLint contextAttributes[] = {
+			EGL_CONTEXT_MAJOR_VERSION, g_ContextVersions[i][0],
+			EGL_CONTEXT_MINOR_VERSION, g_ContextVersions[i][1],
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE };
+		EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+
+		if (context != EGL_NO_CONTEXT)
+		{
+			m_context = context;
+		}
+	}
+	if (NULL == m_context)
+	{
+		std::cout << "Could not create an OpenGL 3.3 core context with EGL" << std::endl;
+		Destroy();
+		return(false);
+	}
+
+	if (HasExtension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context") == false)
+	{
+		const EGLint surfaceAttributes[] = { EGL_WIDTH, 16, EGL_HEIGHT, 16, EGL_NONE };
+		EGLSurface surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+
+		if (surface == EGL_NO_SURFACE)
+		{
+			std::cout << "Could not create an EGL pbuffer" << std::endl;
+			Destroy();
+			return(false);
+		}
+		m_surface = surface;
+	}
+
+	EGLSurface surface = (NULL != m_surface) ? (EGLSurface)m_surface : EGL_NO_SURFACE;
+	if (eglMakeCurrent(display, surface, surface, (EGLContext)m_context) == EGL_FALSE)
+	{
+		std::cout << "Could not make the EGL context current" << std::endl;
+		Destroy();
+		return(false);
+	}
+
+	std::cout << "INFO: Created a headless OpenGL context on the " << m_displayName
+		<< " EGL display" << ((NULL == m_surface) ? ", without a surface" : ", with a pbuffer") << std::endl;
+
+	return(true);
+#else
+	std::cout << "Could not create a headless context, EGL is only used on Linux" << std::endl;
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the framebuffer and the
+ *  context.
+ ***********************************************************/
+void HeadlessContext::Destroy()
+{
+	if ((m_framebuffer != 0) && (NULL != m_context))
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		glDeleteRenderbuffers(1, &m_colorBuffer);
+		glDeleteRenderbuffers(1, &m_depthBuffer);
+	}
+	m_framebuffer = 0;
+	m_colorBuffer = 0;
+	m_depthBuffer = 0;
+
+#if defined(__linux__)
+	if (NULL != m_display)
+	{
+		EGLDisplay display = (EGLDisplay)m_display;
+
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (NULL != m_context)
+		{
+			eglDestroyContext(display, (EGLContext)m_context);
+		}
+		if (NULL != m_surface)
+		{
+			eglDestroySurface(display, (EGLSurface)m_surface);
+		}
+		eglTerminate(display);
+	}
+#endif
+	m_display = NULL;
+	m_context = NULL;
+	m_surface = NULL;
+}
+
+/***********************************************************
+ *  CreateFramebuffer()
+ *
+ *  This method is used for creating the framebuffer object
+ *  that stands in for the window - an RGBA8 color buffer
+ *  and a 24-bit depth buffer of the passed in size.
+ ***********************************************************/
+bool HeadlessContext::CreateFramebuffer(int width, int height)
+{
+	GLint maxSize = 0;
+
+	glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxSize);
+	if ((width <= 0) || (height <= 0) || (width > maxSize) || (height > maxSize))
+	{
+		std::cout << "Could not create a " << width << " x " << height
+			<< " framebuffer, " << maxSize << " pixels max" << std::endl;
+		return(false);
+	}
+
+	glGenRenderbuffers(1, &m_colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glGenRenderbuffers(1, &m_depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Could not create a complete framebuffer" << std::endl;
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		return(false);
+	}
+
+	m_width = width;
+	m_height = height;
+	BindFramebuffer();
+
+	return(true);
+}
+
+/***********************************************************
+ *  BindFramebuffer()
+ *
+ *  This method is used for making the framebuffer object the
+ *  target of the draws, covering all of it.
+ ***********************************************************/
+void HeadlessContext::BindFramebuffer()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, m_width, m_height);
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for submitting the commands of the
+ *  frame.  There is no swap to wait on, so the driver
+ *  limits how far the CPU gets ahead of the GPU.
+ ***********************************************************/
+void HeadlessContext::EndFrame()
+{
+	glFlush();
+}
+
+/***********************************************************
+ *  WritePNG()
+ *
+ *  This method is used for reading back the framebuffer and
+ *  writing it into a PNG file, top row first as an image
+ *  is viewed.  The alpha is made opaque, since blending
+ *  leaves it at whatever the last draw wrote.
+ ***********************************************************/
+bool HeadlessContext::WritePNG(const char* filename)
+{
+	std::vector<unsigned char> pixels((size_t)m_width * m_height * 4);
+	std::vector<unsigned char> flipped(pixels.size());
+	const size_t rowBytes = (size_t)m_width * 4;
+
+	if (m_framebuffer == 0)
+	{
+		return(false);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+	for (int y = 0; y < m_height; y++)
+	{
+		memcpy(&flipped[(size_t)y * rowBytes], &pixels[(size_t)(m_height - 1 - y) * rowBytes], rowBytes);
+	}
+	for (size_t i = 3; i < flipped.size(); i += 4)
+	{
+		flipped[i] = 255;
+	}
+
+	if (WriteRGBAFile(filename, m_width, m_height, flipped) == false)
+	{
+		std::cout << "Could not write image:" << filename << std::endl;
+		return(false);
+	}
+	std::cout << "INFO: Wrote the last frame to " << filename << std::endl;
+
+	return(true);
+}
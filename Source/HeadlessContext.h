@@ -0,0 +1,68 @@
+///////////////////////////////////////////////////////////////////////////////
+// headlesscontext.h
+// ============
+// render into an offscreen framebuffer with an EGL context and no display
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <string>
+
+/***********************************************************
+ *  HeadlessContext
+ *
+ *  This class creates an OpenGL core profile context with
+ *  EGL, which needs no window system, and a framebuffer
+ *  object of any size for the scene to be rendered into.
+ *  The EGL display is the Mesa surfaceless platform when
+ *  it is there, which includes llvmpipe on machines with
+ *  no GPU, then the first EGL device, then the default
+ *  display.  The context is made current without a surface
+ *  when the driver allows it, and with a small pbuffer
+ *  otherwise - either way, the frames go to the framebuffer
+ *  object.  EGL is only used on Linux.
+ ***********************************************************/
+class HeadlessContext
+{
+public:
+	// constructor
+	HeadlessContext();
+	// destructor
+	~HeadlessContext();
+
+	// create the context and make it current - the framebuffer is
+	// created with CreateFramebuffer(), once OpenGL is loaded
+	bool Create();
+	void Destroy();
+	// create the framebuffer object the frames are rendered into
+	bool CreateFramebuffer(int width, int height);
+
+	// bind the framebuffer and set the viewport to its size
+	void BindFramebuffer();
+	// hand the frame to the GPU, in place of swapping buffers
+	void EndFrame();
+
+	// write the current contents of the framebuffer into a PNG file
+	bool WritePNG(const char* filename);
+
+	int GetWidth() const { return(m_width); }
+	int GetHeight() const { return(m_height); }
+	// name of the EGL display that was used
+	const std::string& GetDisplayName() const { return(m_displayName); }
+
+private:
+	// EGL handles, kept as void* so that EGL stays out of the header
+	void* m_display;
+	void* m_context;
+	void* m_surface;
+	std::string m_displayName;
+
+	GLuint m_framebuffer;
+	GLuint m_colorBuffer;
+	GLuint m_depthBuffer;
+	int m_width;
+	int m_height;
+};
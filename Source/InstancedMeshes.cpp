@@ -0,0 +1,622 @@
+///////////////////////////////////////////////////////////////////////////////
+// instancedmeshes.cpp
+// ============
+// basic shape meshes that are drawn many times with one instanced draw call
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "InstancedMeshes.h"
+
+#include <cmath>
+#include <cstddef>
+
+// declaration of global variables
+namespace
+{
+	// number of floats in a vertex - position, normal and UV
+	const int g_FloatsPerVertex = 8;
+	// first vertex attribute location of the instance data
+	const GLuint g_InstanceAttribute = 3;
+	// number of segments around the round meshes
+	const int g_RoundSlices = 36;
+
+	// append one interleaved vertex to the vertex list
+	void AddVertex(
+		std::vector<GLfloat>& vertices,
+		glm::vec3 position,
+		glm::vec3 normal,
+		glm::vec2 UV)
+	{
+		vertices.push_back(position.x);
+		vertices.push_back(position.y);
+		vertices.push_back(position.z);
+		vertices.push_back(normal.x);
+		vertices.push_back(normal.y);
+		vertices.push_back(normal.z);
+		vertices.push_back(UV.x);
+		vertices.push_back(UV.y);
+	}
+
+	// append a quad of the four passed in vertices, counter-clockwise
+	void AddQuad(
+		std::vector<GLfloat>& vertices,
+		std::vector<GLuint>& indices,
+		const glm::vec3 corners[4],
+		glm::vec3 normal)
+	{
+		GLuint first = (GLuint)(vertices.size() / g_FloatsPerVertex);
+
+		AddVertex(vertices, corners[0], normal, glm::vec2(0.0f, 0.0f));
+		AddVertex(vertices, corners[1], normal, glm::vec2(1.0f, 0.0f));
+		AddVertex(vertices, corners[2], normal, glm::vec2(1.0f, 1.0f));
+		AddVertex(vertices, corners[3], normal, glm::vec2(0.0f, 1.0f));
+
+		indices.push_back(first);
+		indices.push_back(first + 1);
+		indices.push_back(first + 2);
+		indices.push_back(first);
+		indices.push_back(first + 2);
+		indices.push_back(first + 3);
+	}
+}
+
+/***********************************************************
+ *  InstancedMeshes()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+InstancedMeshes::InstancedMeshes()
+{
+	MESH_RANGE emptyRange = { 0, 0, 0 };
+
+	for (int i = 0; i < SHAPE_COUNT; i++)
+	{
+		m_meshRanges[i] = emptyRange;
+	}
+	m_bArenaChanged = false;
+	m_vao = 0;
+	m_vbo = 0;
+	m_ibo = 0;
+	m_instanceBuffer = 0;
+	m_instanceCapacity = 0;
+	m_commandBuffer = 0;
+	m_commandCapacity = 0;
+}
+
+/***********************************************************
+ *  ~InstancedMeshes()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+InstancedMeshes::~InstancedMeshes()
+{
+	if (m_vao != 0)
+	{
+		glDeleteVertexArrays(1, &m_vao);
+		m_vao = 0;
+	}
+	if (m_vbo != 0)
+	{
+		glDeleteBuffers(1, &m_vbo);
+		m_vbo = 0;
+	}
+	if (m_ibo != 0)
+	{
+		glDeleteBuffers(1, &m_ibo);
+		m_ibo = 0;
+	}
+	if (m_instanceBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_instanceBuffer);
+		m_instanceBuffer = 0;
+	}
+	if (m_commandBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_commandBuffer);
+		m_commandBuffer = 0;
+	}
+}
+
+/***********************************************************
+ *  SetInstanceData()
+ *
+ *  This method is used for copying the instances of the
+ *  current frame into the instance buffer.  The old buffer
+ *  storage is orphaned, so that the copy never waits for
+ *  draws of the previous frame that are still using it.
+ ***********************************************************/
+void InstancedMeshes::SetInstanceData(const INSTANCE_DATA* instances, size_t count)
+{
+	if (m_instanceBuffer == 0)
+	{
+		glGenBuffers(1, &m_instanceBuffer);
+	}
+
+	if (count > m_instanceCapacity)
+	{
+		m_instanceCapacity = count;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, m_instanceCapacity * sizeof(INSTANCE_DATA), NULL, GL_STREAM_DRAW);
+	if (count > 0)
+	{
+		glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(INSTANCE_DATA), instances);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/***********************************************************
+ *  AddMesh()
+ *
+ *  This method is used for appending the vertices and
+ *  indices of a shape to the geometry arena.  The indices
+ *  stay relative to the shape's first vertex, which is kept
+ *  as the base vertex of its draws.  Loading a shape a
+ *  second time leaves the old copy unused in the arena.
+ ***********************************************************/
+void InstancedMeshes::AddMesh(
+	SHAPE shape,
+	const std::vector<GLfloat>& vertices,
+	const std::vector<GLuint>& indices)
+{
+	MESH_RANGE& range = m_meshRanges[shape];
+
+	range.firstIndex = (GLuint)m_arenaIndices.size();
+	range.indexCount = (GLuint)indices.size();
+	range.baseVertex = (GLint)(m_arenaVertices.size() / g_FloatsPerVertex);
+
+	m_arenaVertices.insert(m_arenaVertices.end(), vertices.begin(), vertices.end());
+	m_arenaIndices.insert(m_arenaIndices.end(), indices.begin(), indices.end());
+	m_bArenaChanged = true;
+}
+
+/***********************************************************
+ *  UploadArena()
+ *
+ *  This method is used for copying the geometry arena into
+ *  the vertex and index buffers, creating the vertex array
+ *  the first time.  Nothing is copied when no shape was
+ *  loaded since the last upload.
+ ***********************************************************/
+bool InstancedMeshes::UploadArena()
+{
+	const GLsizei stride = sizeof(GLfloat) * g_FloatsPerVertex;
+
+	if (m_bArenaChanged == false)
+	{
+		return(m_vao != 0);
+	}
+
+	if (m_vao == 0)
+	{
+		glGenVertexArrays(1, &m_vao);
+		glGenBuffers(1, &m_vbo);
+		glGenBuffers(1, &m_ibo);
+		if (m_instanceBuffer == 0)
+		{
+			glGenBuffers(1, &m_instanceBuffer);
+		}
+
+		glBindVertexArray(m_vao);
+		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibo);
+
+		// position, normal and texture coordinate
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(GLfloat) * 3));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(GLfloat) * 6));
+		glEnableVertexAttribArray(2);
+
+		// model matrix columns, color and parameters advance once per instance
+		for (GLuint i = 0; i < 6; i++)
+		{
+			glEnableVertexAttribArray(g_InstanceAttribute + i);
+			glVertexAttribDivisor(g_InstanceAttribute + i, 1);
+		}
+		BindInstanceAttributes(0);
+	}
+	else
+	{
+		glBindVertexArray(m_vao);
+	}
+
+	// BindInstanceAttributes() leaves no array buffer bound
+	glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+	glBufferData(GL_ARRAY_BUFFER, m_arenaVertices.size() * sizeof(GLfloat), m_arenaVertices.data(), GL_STATIC_DRAW);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_arenaIndices.size() * sizeof(GLuint), m_arenaIndices.data(), GL_STATIC_DRAW);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	m_bArenaChanged = false;
+
+	return(true);
+}
+
+/***********************************************************
+ *  AddFrustumMesh()
+ *
+ *  This method is used for adding a round mesh going from
+ *  a radius at y = 0 to a radius at y = 1, which covers the
+ *  cylinder, the tapered cylinder and the cone.
+ ***********************************************************/
+void InstancedMeshes::AddFrustumMesh(
+	SHAPE shape,
+	float bottomRadius,
+	float topRadius,
+	bool bTopCap)
+{
+	std::vector<GLfloat> vertices;
+	std::vector<GLuint> indices;
+	const float twoPi = 6.28318530718f;
+	// the side normals lean up by the change in radius
+	const float slope = bottomRadius - topRadius;
+
+	// sides - the first vertex of the ring is repeated at the end
+	// so that the texture wraps around exactly once
+	for (int i = 0; i <= g_RoundSlices; i++)
+	{
+		float u = (float)i / (float)g_RoundSlices;
+		float x = cosf(u * twoPi);
+		float z = sinf(u * twoPi);
+		glm::vec3 normal = glm::normalize(glm::vec3(x, slope, z));
+
+		AddVertex(vertices, glm::vec3(x * bottomRadius, 0.0f, z * bottomRadius), normal, glm::vec2(u, 0.0f));
+		AddVertex(vertices, glm::vec3(x * topRadius, 1.0f, z * topRadius), normal, glm::vec2(u, 1.0f));
+	}
+	for (GLuint i = 0; i < (GLuint)g_RoundSlices; i++)
+	{
+		GLuint bottom = i * 2;
+
+		indices.push_back(bottom);
+		indices.push_back(bottom + 1);
+		indices.push_back(bottom + 2);
+		indices.push_back(bottom + 2);
+		indices.push_back(bottom + 1);
+		indices.push_back(bottom + 3);
+	}
+
+	// flat caps with planar texture mapping
+	for (int cap = 0; cap < 2; cap++)
+	{
+		bool bTop = (cap == 1);
+		float y = bTop ? 1.0f : 0.0f;
+		float radius = bTop ? topRadius : bottomRadius;
+		glm::vec3 normal(0.0f, bTop ? 1.0f : -1.0f, 0.0f);
+		GLuint center = (GLuint)(vertices.size() / g_FloatsPerVertex);
+
+		if (bTop && (bTopCap == false))
+		{
+			continue;
+		}
+
+		AddVertex(vertices, glm::vec3(0.0f, y, 0.0f), normal, glm::vec2(0.5f, 0.5f));
+		for (int i = 0; i <= g_RoundSlices; i++)
+		{
+			float angle = ((float)i / (float)g_RoundSlices) * twoPi;
+			float x = cosf(angle);
+			float z = sinf(angle);
+
+			AddVertex(vertices, glm::vec3(x * radius, y, z * radius), normal,
+				glm::vec2(0.5f + (x * 0.5f), 0.5f + (z * 0.5f)));
+		}
+		for (GLuint i = 0; i < (GLuint)g_RoundSlices; i++)
+		{
+			indices.push_back(center);
+			indices.push_back(bTop ? center + i + 2 : center + i + 1);
+			indices.push_back(bTop ? center + i + 1 : center + i + 2);
+		}
+	}
+
+	AddMesh(shape, vertices, indices);
+}
+
+/***********************************************************
+ *  LoadPlaneMesh()
+ *
+ *  This method is used for creating a plane of 2 x 2 units
+ *  in the XZ plane, facing up.
+ ***********************************************************/
+void InstancedMeshes::LoadPlaneMesh()
+{
+	std::vector<GLfloat> vertices;
+	std::vector<GLuint> indices;
+	const glm::vec3 corners[4] = {
+		glm::vec3(-1.0f, 0.0f, 1.0f),
+		glm::vec3(1.0f, 0.0f, 1.0f),
+		glm::vec3(1.0f, 0.0f, -1.0f),
+		glm::vec3(-1.0f, 0.0f, -1.0f) };
+
+	AddQuad(vertices, indices, corners, glm::vec3(0.0f, 1.0f, 0.0f));
+	AddMesh(SHAPE_PLANE, vertices, indices);
+}
+
+/***********************************************************
+ *  LoadBoxMesh()
+ *
+ *  This method is used for creating a 1 x 1 x 1 box that is
+ *  centered on the origin.
+ ***********************************************************/
+void InstancedMeshes::LoadBoxMesh()
+{
+	std::vector<GLfloat> vertices;
+	std::vector<GLuint> indices;
+	const float h = 0.5f;
+	const glm::vec3 front[4] = {
+		glm::vec3(-h, -h, h), glm::vec3(h, -h, h), glm::vec3(h, h, h), glm::vec3(-h, h, h) };
+	const glm::vec3 back[4] = {
+		glm::vec3(h, -h, -h), glm::vec3(-h, -h, -h), glm::vec3(-h, h, -h), glm::vec3(h, h, -h) };
+	const glm::vec3 left[4] = {
+		glm::vec3(-h, -h, -h), glm::vec3(-h, -h, h), glm::vec3(-h, h, h), glm::vec3(-h, h, -h) };
+	const glm::vec3 right[4] = {
+		glm::vec3(h, -h, h), glm::vec3(h, -h, -h), glm::vec3(h, h, -h), glm::vec3(h, h, h) };
+	const glm::vec3 top[4] = {
+		glm::vec3(-h, h, h), glm::vec3(h, h, h), glm::vec3(h, h, -h), glm::vec3(-h, h, -h) };
+	const glm::vec3 bottom[4] = {
+		glm::vec3(-h, -h, -h), glm::vec3(h, -h, -h), glm::vec3(h, -h, h), glm::vec3(-h, -h, h) };
+
+	AddQuad(vertices, indices, front, glm::vec3(0.0f, 0.0f, 1.0f));
+	AddQuad(vertices, indices, back, glm::vec3(0.0f, 0.0f, -1.0f));
+	AddQuad(vertices, indices, left, glm::vec3(-1.0f, 0.0f, 0.0f));
+	AddQuad(vertices, indices, right, glm::vec3(1.0f, 0.0f, 0.0f));
+	AddQuad(vertices, indices, top, glm::vec3(0.0f, 1.0f, 0.0f));
+	AddQuad(vertices, indices, bottom, glm::vec3(0.0f, -1.0f, 0.0f));
+	AddMesh(SHAPE_BOX, vertices, indices);
+}
+
+/***********************************************************
+ *  LoadCylinderMesh()
+ *
+ *  This method is used for creating a cylinder of radius 1
+ *  and height 1, standing on the origin.
+ ***********************************************************/
+void InstancedMeshes::LoadCylinderMesh()
+{
+	AddFrustumMesh(SHAPE_CYLINDER, 1.0f, 1.0f, true);
+}
+
+/***********************************************************
+ *  LoadConeMesh()
+ *
+ *  This method is used for creating a cone with a base of
+ *  radius 1 on the origin and the point at a height of 1.
+ ***********************************************************/
+void InstancedMeshes::LoadConeMesh()
+{
+	AddFrustumMesh(SHAPE_CONE, 1.0f, 0.0f, false);
+}
+
+/***********************************************************
+ *  LoadTaperedCylinderMesh()
+ *
+ *  This method is used for creating a cylinder of height 1
+ *  that narrows from a radius of 1 at the bottom to a
+ *  radius of 0.5 at the top.
+ ***********************************************************/
+void InstancedMeshes::LoadTaperedCylinderMesh()
+{
+	AddFrustumMesh(SHAPE_TAPERED_CYLINDER, 1.0f, 0.5f, true);
+}
+
+/***********************************************************
+ *  LoadPyramid4Mesh()
+ *
+ *  This method is used for creating a pyramid with a 1 x 1
+ *  square base and a height of 1, centered on the origin.
+ ***********************************************************/
+void InstancedMeshes::LoadPyramid4Mesh()
+{
+	std::vector<GLfloat> vertices;
+	std::vector<GLuint> indices;
+	const glm::vec3 apex(0.0f, 0.5f, 0.0f);
+	const glm::vec3 base[4] = {
+		glm::vec3(-0.5f, -0.5f, 0.5f),
+		glm::vec3(0.5f, -0.5f, 0.5f),
+		glm::vec3(0.5f, -0.5f, -0.5f),
+		glm::vec3(-0.5f, -0.5f, -0.5f) };
+	const glm::vec3 bottom[4] = { base[3], base[2], base[1], base[0] };
+
+	// one triangle per side, each with its own face normal
+	for (int i = 0; i < 4; i++)
+	{
+		const glm::vec3& a = base[i];
+		const glm::vec3& b = base[(i + 1) % 4];
+		glm::vec3 normal = glm::normalize(glm::cross(b - a, apex - a));
+		GLuint first = (GLuint)(vertices.size() / g_FloatsPerVertex);
+
+		AddVertex(vertices, a, normal, glm::vec2(0.0f, 0.0f));
+		AddVertex(vertices, b, normal, glm::vec2(1.0f, 0.0f));
+		AddVertex(vertices, apex, normal, glm::vec2(0.5f, 1.0f));
+		indices.push_back(first);
+		indices.push_back(first + 1);
+		indices.push_back(first + 2);
+	}
+
+	AddQuad(vertices, indices, bottom, glm::vec3(0.0f, -1.0f, 0.0f));
+	AddMesh(SHAPE_PYRAMID4, vertices, indices);
+}
+
+/***********************************************************
+ *  BindInstanceAttributes()
+ *
+ *  This method is used for pointing the instance attributes
+ *  of the bound vertex array at the passed in instance, so
+ *  that a draw starts reading the instance buffer there.
+ ***********************************************************/
+void InstancedMeshes::BindInstanceAttributes(size_t firstInstance)
+{
+	const GLsizei stride = sizeof(INSTANCE_DATA);
+	const size_t base = firstInstance * sizeof(INSTANCE_DATA);
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	for (GLuint column = 0; column < 4; column++)
+	{
+		glVertexAttribPointer(g_InstanceAttribute + column, 4, GL_FLOAT, GL_FALSE, stride,
+			(void*)(base + offsetof(INSTANCE_DATA, model) + (sizeof(glm::vec4) * column)));
+	}
+	glVertexAttribPointer(g_InstanceAttribute + 4, 4, GL_FLOAT, GL_FALSE, stride,
+		(void*)(base + offsetof(INSTANCE_DATA, color)));
+	glVertexAttribPointer(g_InstanceAttribute + 5, 4, GL_FLOAT, GL_FALSE, stride,
+		(void*)(base + offsetof(INSTANCE_DATA, params)));
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/***********************************************************
+ *  DrawMeshInstanced()
+ *
+ *  This method is used for drawing count instances of a
+ *  loaded shape with a single draw call.  The instance
+ *  attributes are pointed at the first instance, so this
+ *  works on OpenGL 3.3 without base instances.
+ ***********************************************************/
+void InstancedMeshes::DrawMeshInstanced(SHAPE shape, size_t firstInstance, size_t count)
+{
+	const MESH_RANGE& range = m_meshRanges[shape];
+
+	if ((range.indexCount == 0) || (count == 0) || (UploadArena() == false))
+	{
+		return;
+	}
+
+	glBindVertexArray(m_vao);
+	BindInstanceAttributes(firstInstance);
+	glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (GLsizei)range.indexCount, GL_UNSIGNED_INT,
+		(void*)(range.firstIndex * sizeof(GLuint)), (GLsizei)count, range.baseVertex);
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  Draw*MeshInstanced()
+ *
+ *  These methods are used for drawing count instances of the
+ *  basic shapes, starting at the passed in instance.
+ ***********************************************************/
+void InstancedMeshes::DrawPlaneMeshInstanced(size_t firstInstance, size_t count)
+{
+	DrawMeshInstanced(SHAPE_PLANE, firstInstance, count);
+}
+
+void InstancedMeshes::DrawBoxMeshInstanced(size_t firstInstance, size_t count)
+{
+	DrawMeshInstanced(SHAPE_BOX, firstInstance, count);
+}
+
+void InstancedMeshes::DrawCylinderMeshInstanced(size_t firstInstance, size_t count)
+{
+	DrawMeshInstanced(SHAPE_CYLINDER, firstInstance, count);
+}
+
+void InstancedMeshes::DrawConeMeshInstanced(size_t firstInstance, size_t count)
+{
+	DrawMeshInstanced(SHAPE_CONE, firstInstance, count);
+}
+
+void InstancedMeshes::DrawTaperedCylinderMeshInstanced(size_t firstInstance, size_t count)
+{
+	DrawMeshInstanced(SHAPE_TAPERED_CYLINDER, firstInstance, count);
+}
+
+void InstancedMeshes::DrawPyramid4MeshInstanced(size_t firstInstance, size_t count)
+{
+	DrawMeshInstanced(SHAPE_PYRAMID4, firstInstance, count);
+}
+
+/***********************************************************
+ *  IsMultiDrawIndirectSupported()
+ *
+ *  This method is used for checking whether the driver can
+ *  take indirect multi-draw calls that use base instances.
+ ***********************************************************/
+bool InstancedMeshes::IsMultiDrawIndirectSupported() const
+{
+	return(GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance));
+}
+
+/***********************************************************
+ *  ClearDrawCommands()
+ *
+ *  This method is used for removing the indirect draw
+ *  commands of the last frame.
+ ***********************************************************/
+void InstancedMeshes::ClearDrawCommands()
+{
+	m_drawCommands.clear();
+}
+
+/***********************************************************
+ *  AddDrawCommand()
+ *
+ *  This method is used for adding an indirect draw command
+ *  for count instances of a shape.  The first instance is
+ *  passed as the base instance, so each command reads its
+ *  own instances without moving the instance attributes.
+ ***********************************************************/
+size_t InstancedMeshes::AddDrawCommand(SHAPE shape, size_t firstInstance, size_t count)
+{
+	const MESH_RANGE& range = m_meshRanges[shape];
+	DRAW_ELEMENTS_COMMAND command;
+
+	command.count = range.indexCount;
+	command.instanceCount = (GLuint)count;
+	command.firstIndex = range.firstIndex;
+	command.baseVertex = range.baseVertex;
+	command.baseInstance = (GLuint)firstInstance;
+	m_drawCommands.push_back(command);
+
+	return(m_drawCommands.size() - 1);
+}
+
+/***********************************************************
+ *  UploadDrawCommands()
+ *
+ *  This method is used for copying the indirect draw
+ *  commands into the command buffer.  As with the instance
+ *  buffer, the old storage is orphaned first.
+ ***********************************************************/
+void InstancedMeshes::UploadDrawCommands()
+{
+	if (m_commandBuffer == 0)
+	{
+		glGenBuffers(1, &m_commandBuffer);
+	}
+
+	if (m_drawCommands.size() > m_commandCapacity)
+	{
+		m_commandCapacity = m_drawCommands.size();
+	}
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, m_commandCapacity * sizeof(DRAW_ELEMENTS_COMMAND), NULL, GL_STREAM_DRAW);
+	if (m_drawCommands.empty() == false)
+	{
+		glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0,
+			m_drawCommands.size() * sizeof(DRAW_ELEMENTS_COMMAND), m_drawCommands.data());
+	}
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+/***********************************************************
+ *  MultiDrawCommands()
+ *
+ *  This method is used for submitting count of the uploaded
+ *  draw commands, starting at the passed in command, with a
+ *  single glMultiDrawElementsIndirect() call.
+ ***********************************************************/
+void InstancedMeshes::MultiDrawCommands(size_t firstCommand, size_t count)
+{
+	if ((count == 0) || (m_commandBuffer == 0) || (UploadArena() == false))
+	{
+		return;
+	}
+
+	glBindVertexArray(m_vao);
+	// the base instance of each command does the offsetting
+	BindInstanceAttributes(0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+		(void*)(firstCommand * sizeof(DRAW_ELEMENTS_COMMAND)), (GLsizei)count, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindVertexArray(0);
+}
@@ -0,0 +1,162 @@
+///////////////////////////////////////////////////////////////////////////////
+// instancedmeshes.h
+// ============
+// basic shape meshes that are drawn many times with one instanced draw call
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  InstancedMeshes
+ *
+ *  This class builds the same unit shapes as ShapeMeshes -
+ *  plane, box, cylinder, cone, tapered cylinder and 4-sided
+ *  pyramid - with an extra per-instance vertex stream, so
+ *  that any number of copies of a shape are drawn with one
+ *  draw call.
+ *
+ *  All of the shapes share one vertex buffer and one index
+ *  buffer (the geometry arena) behind a single vertex array,
+ *  with the base vertex and first index of every shape kept,
+ *  so that switching shapes never rebinds vertex state and a
+ *  whole list of draws can be submitted with one indirect
+ *  multi-draw call.
+ *
+ *  Vertex attribute locations:
+ *    0 position, 1 normal, 2 texture coordinate,
+ *    3-6 instance model matrix, 7 instance color,
+ *    8 instance parameters (see INSTANCE_DATA)
+ ***********************************************************/
+class InstancedMeshes
+{
+public:
+	// constructor
+	InstancedMeshes();
+	// destructor
+	~InstancedMeshes();
+
+	// per-instance data read by the instanced vertex shader
+	struct INSTANCE_DATA
+	{
+		glm::mat4 model;
+		glm::vec4 color;
+		// x: material index, y: texture array layer + 1
+		// (0 when no texture is used), z and w: texture UV scale
+		glm::vec4 params;
+	};
+
+	// shapes in the geometry arena
+	enum SHAPE
+	{
+		SHAPE_PLANE = 0,
+		SHAPE_BOX,
+		SHAPE_CYLINDER,
+		SHAPE_CONE,
+		SHAPE_TAPERED_CYLINDER,
+		SHAPE_PYRAMID4,
+		SHAPE_COUNT
+	};
+
+	// copy the instances for the frame into the instance buffer
+	void SetInstanceData(const INSTANCE_DATA* instances, size_t count);
+
+	void LoadPlaneMesh();
+	void LoadBoxMesh();
+	void LoadCylinderMesh();
+	void LoadConeMesh();
+	void LoadTaperedCylinderMesh();
+	void LoadPyramid4Mesh();
+
+	// draw count instances of a shape, starting at the passed
+	// in instance of the instance buffer
+	void DrawPlaneMeshInstanced(size_t firstInstance, size_t count);
+	void DrawBoxMeshInstanced(size_t firstInstance, size_t count);
+	void DrawCylinderMeshInstanced(size_t firstInstance, size_t count);
+	void DrawConeMeshInstanced(size_t firstInstance, size_t count);
+	void DrawTaperedCylinderMeshInstanced(size_t firstInstance, size_t count);
+	void DrawPyramid4MeshInstanced(size_t firstInstance, size_t count);
+
+	// true when the driver supports glMultiDrawElementsIndirect
+	// with base instances (OpenGL 4.3, or the ARB extensions)
+	bool IsMultiDrawIndirectSupported() const;
+	// remove the indirect draw commands of the last frame
+	void ClearDrawCommands();
+	// add an indirect draw command for count instances of a shape,
+	// returning the index of the command
+	size_t AddDrawCommand(SHAPE shape, size_t firstInstance, size_t count);
+	size_t GetDrawCommandCount() const { return(m_drawCommands.size()); }
+	// copy the indirect draw commands into the command buffer -
+	// call once per frame, after all commands have been added
+	void UploadDrawCommands();
+	// submit count of the uploaded commands, starting at the
+	// passed in command, with one glMultiDrawElementsIndirect call
+	void MultiDrawCommands(size_t firstCommand, size_t count);
+
+private:
+	// location of a shape in the geometry arena
+	struct MESH_RANGE
+	{
+		GLuint firstIndex;
+		GLuint indexCount;
+		GLint baseVertex;
+	};
+
+	// layout of an indirect draw command, as OpenGL reads it
+	struct DRAW_ELEMENTS_COMMAND
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	// geometry of every loaded shape, kept until it is uploaded
+	std::vector<GLfloat> m_arenaVertices;
+	std::vector<GLuint> m_arenaIndices;
+	MESH_RANGE m_meshRanges[SHAPE_COUNT];
+	// true when shapes were loaded since the arena was uploaded
+	bool m_bArenaChanged;
+
+	// the vertex array and buffers of the geometry arena
+	GLuint m_vao;
+	GLuint m_vbo;
+	GLuint m_ibo;
+
+	// buffer holding the instances of the current frame
+	GLuint m_instanceBuffer;
+	// number of instances the buffer has room for
+	size_t m_instanceCapacity;
+
+	// indirect draw commands of the current frame
+	std::vector<DRAW_ELEMENTS_COMMAND> m_drawCommands;
+	GLuint m_commandBuffer;
+	size_t m_commandCapacity;
+
+	// add a shape to the geometry arena from interleaved vertices
+	// (position, normal, UV) and triangle indices
+	void AddMesh(
+		SHAPE shape,
+		const std::vector<GLfloat>& vertices,
+		const std::vector<GLuint>& indices);
+	// build a cylinder-like mesh with a radius at the bottom (y = 0)
+	// and another at the top (y = 1) - a top radius of 0 is a cone
+	void AddFrustumMesh(
+		SHAPE shape,
+		float bottomRadius,
+		float topRadius,
+		bool bTopCap);
+	// copy the geometry arena into the vertex and index buffers
+	// if any shape was loaded since the last upload
+	bool UploadArena();
+	// point the instance attributes at the passed in instance
+	void BindInstanceAttributes(size_t firstInstance);
+	// draw instances of a loaded shape
+	void DrawMeshInstanced(SHAPE shape, size_t firstInstance, size_t count);
+};
@@ -0,0 +1,480 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.cpp
+// ============
+// run jobs on a pool of worker threads that steal work from each other
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+
+// declaration of global variables
+namespace
+{
+	// the job system and worker index of the calling thread, so a
+	// worker finds its own deque - NULL outside of every pool
+	thread_local const JobSystem* g_pWorkerSystem = NULL;
+	thread_local int g_WorkerIndex = -1;
+
+	// how long a waiting thread sleeps before it looks for queued
+	// jobs again
+	const std::chrono::milliseconds g_WaitInterval(1);
+
+	/***********************************************************
+	 *  RANGE_STATE
+	 *
+	 *  A range being run by ParallelFor(), shared with the
+	 *  jobs that help with it.  A helper job that only starts
+	 *  after the range is done finds no blocks left and ends,
+	 *  so the state outlives the call while the body does not
+	 *  need to.
+	 ***********************************************************/
+	struct RANGE_STATE
+	{
+		std::atomic<size_t> nextBlock;
+		std::atomic<size_t> finishedBlocks;
+		size_t blockCount;
+		size_t grainSize;
+		size_t count;
+		const JobSystem::RANGE_JOB* pBody;
+		// notified when the last block has finished
+		std::mutex mutex;
+		std::condition_variable done;
+	};
+
+	/***********************************************************
+	 *  RunRangeBlocks()
+	 *
+	 *  Run the blocks of a range, one at a time, until none
+	 *  are left to take.  The thread that finishes the last
+	 *  block wakes the one waiting for the range.
+	 ***********************************************************/
+	void RunRangeBlocks(RANGE_STATE& state)
+	{
+		size_t block = 0;
+
+		while ((block = state.nextBlock.fetch_add(1)) < state.blockCount)
+		{
+			size_t first = block * state.grainSize;
+			size_t last = std::min(first + state.grainSize, state.count);
+
+			(*state.pBody)(first, last);
+			if (state.finishedBlocks.fetch_add(1, std::memory_order_acq_rel) + 1 == state.blockCount)
+			{
+				std::lock_guard<std::mutex> lock(state.mutex);
+				state.done.notify_all();
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  JobCounter()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+JobCounter::JobCounter()
+	: m_count(0)
+{
+}
+
+/***********************************************************
+ *  JobSystem()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+JobSystem::JobSystem()
+	: m_nextQueue(0), m_queuedJobs(0)
+{
+	m_workerCount = 0;
+	m_bStopping = false;
+}
+
+/***********************************************************
+ *  ~JobSystem()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+JobSystem::~JobSystem()
+{
+	Stop();
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for starting the worker threads,
+ *  each with an empty deque.
+ ***********************************************************/
+void JobSystem::Start(unsigned int workerCount)
+{
+	Stop();
+
+	m_bStopping = false;
+	m_nextQueue = 0;
+	m_queues.reset((workerCount > 0) ? new WORKER_QUEUE[workerCount] : NULL);
+	m_workerCount = workerCount;
+	for (unsigned int i = 0; i < workerCount; i++)
+	{
+		m_workers.push_back(std::thread(&JobSystem::WorkerThread, this, i));
+	}
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method is used for stopping the worker threads once
+ *  every queued job has been run, including the jobs that
+ *  those jobs queue.
+ ***********************************************************/
+void JobSystem::Stop()
+{
+	if (m_workers.empty())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_bStopping = true;
+	}
+	m_wakeWorkers.notify_all();
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+	m_workers.clear();
+	m_workerCount = 0;
+	m_queues.reset();
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method is used for queueing a job.  A job with a
+ *  dependency that has not reached zero is kept with the
+ *  dependency, and queued by the thread that finishes the
+ *  last job of it.
+ ***********************************************************/
+void JobSystem::Run(JOB job, JobCounter* pCounter, JobCounter* pDependency)
+{
+	QUEUED_JOB queuedJob;
+
+	if (NULL != pCounter)
+	{
+		pCounter->m_count.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	if (NULL != pDependency)
+	{
+		std::lock_guard<std::mutex> lock(pDependency->m_mutex);
+
+		if (pDependency->m_count.load(std::memory_order_acquire) != 0)
+		{
+			JobCounter::WAITING_JOB waitingJob;
+
+			waitingJob.job = std::move(job);
+			waitingJob.pCounter = pCounter;
+			pDependency->m_waitingJobs.push_back(std::move(waitingJob));
+			return;
+		}
+	}
+
+	queuedJob.job = std::move(job);
+	queuedJob.pCounter = pCounter;
+	Enqueue(queuedJob);
+}
+
+/***********************************************************
+ *  Wait()
+ *
+ *  This method is used for waiting until the jobs of a
+ *  counter have finished.  While any are left, the calling
+ *  thread runs queued jobs, and sleeps briefly when there
+ *  are none.
+ ***********************************************************/
+void JobSystem::Wait(JobCounter& counter)
+{
+	while (counter.IsDone() == false)
+	{
+		if (RunNextJob())
+		{
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(counter.m_mutex);
+		counter.m_done.wait_for(lock, g_WaitInterval, [&counter]() { return(counter.IsDone()); });
+	}
+
+	// the thread that finished the last job lets go of the counter
+	// before this can return
+	std::lock_guard<std::mutex> lock(counter.m_mutex);
+}
+
+/***********************************************************
+ *  ParallelFor()
+ *
+ *  This method is used for running a body over a range of
+ *  items.  One job less than the number of threads is
+ *  queued, and those jobs and the calling thread take the
+ *  next block of the range until none are left, so that
+ *  blocks that take longer even out.  The calling thread
+ *  then waits only for the blocks that other threads are
+ *  still running - never for a helper job that is queued
+ *  behind other work - and runs queued jobs in the meantime,
+ *  as Wait() does, or sleeps until the last block is done.
+ ***********************************************************/
+void JobSystem::ParallelFor(size_t count, size_t grainSize, const RANGE_JOB& body, unsigned int maxThreads)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	grainSize = std::max<size_t>(grainSize, 1);
+	size_t blockCount = (count + grainSize - 1) / grainSize;
+	size_t threadCount = (size_t)m_workerCount + 1;
+	if (maxThreads != 0)
+	{
+		threadCount = std::min<size_t>(threadCount, maxThreads);
+	}
+	threadCount = std::min(threadCount, blockCount);
+
+	if (threadCount <= 1)
+	{
+		body(0, count);
+		return;
+	}
+
+	std::shared_ptr<RANGE_STATE> pState = std::make_shared<RANGE_STATE>();
+	pState->nextBlock = 0;
+	pState->finishedBlocks = 0;
+	pState->blockCount = blockCount;
+	pState->grainSize = grainSize;
+	pState->count = count;
+	pState->pBody = &body;
+
+	for (size_t i = 1; i < threadCount; i++)
+	{
+		Run([pState]() { RunRangeBlocks(*pState); });
+	}
+	RunRangeBlocks(*pState);
+
+	RANGE_STATE& state = *pState;
+	while (state.finishedBlocks.load(std::memory_order_acquire) < blockCount)
+	{
+		if (RunNextJob())
+		{
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(state.mutex);
+		state.done.wait_for(lock, g_WaitInterval,
+			[&state, blockCount]() { return(state.finishedBlocks.load(std::memory_order_acquire) >= blockCount); });
+	}
+}
+
+/***********************************************************
+ *  WorkerThread()
+ *
+ *  This method is run by every worker thread.  It runs jobs
+ *  from its own deque or stolen from the others, and sleeps
+ *  when every deque is empty.  It ends once the system is
+ *  stopping and no jobs are left.
+ ***********************************************************/
+void JobSystem::WorkerThread(unsigned int workerIndex)
+{
+	g_pWorkerSystem = this;
+	g_WorkerIndex = (int)workerIndex;
+
+	while (true)
+	{
+		if (RunNextJob())
+		{
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_wakeMutex);
+		m_wakeWorkers.wait(lock, [this]() { return(m_bStopping || (m_queuedJobs.load() > 0)); });
+		if (m_bStopping && (m_queuedJobs.load() == 0))
+		{
+			break;
+		}
+	}
+
+	g_pWorkerSystem = NULL;
+	g_WorkerIndex = -1;
+}
+
+/***********************************************************
+ *  Enqueue()
+ *
+ *  This method is used for adding a job to the back of the
+ *  calling worker's deque, or of the next deque in turn for
+ *  threads outside of the pool, and waking a worker for it.
+ ***********************************************************/
+void JobSystem::Enqueue(QUEUED_JOB& queuedJob)
+{
+	if (m_workerCount == 0)
+	{
+		queuedJob.job();
+		FinishJob(queuedJob.pCounter);
+		return;
+	}
+
+	int workerIndex = GetWorkerIndex();
+	unsigned int queueIndex = (workerIndex >= 0) ? (unsigned int)workerIndex :
+		(m_nextQueue.fetch_add(1, std::memory_order_relaxed) % m_workerCount);
+
+	// the count is raised before the job can be taken, so a worker
+	// never lowers it below zero, and with the wake mutex held, so a
+	// worker cannot see it unchanged and then miss the notification
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_queuedJobs.fetch_add(1);
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_queues[queueIndex].mutex);
+		m_queues[queueIndex].jobs.push_back(std::move(queuedJob));
+	}
+	m_wakeWorkers.notify_one();
+}
+
+/***********************************************************
+ *  RunNextJob()
+ *
+ *  This method is used for running one queued job.  A
+ *  worker takes the newest job of its own deque; otherwise
+ *  the oldest job of the next deque that has one is stolen.
+ ***********************************************************/
+bool JobSystem::RunNextJob()
+{
+	const size_t queueCount = m_workerCount;
+	int workerIndex = GetWorkerIndex();
+	QUEUED_JOB queuedJob;
+	bool bFound = false;
+
+	if (queueCount == 0)
+	{
+		return(false);
+	}
+
+	if (workerIndex >= 0)
+	{
+		WORKER_QUEUE& queue = m_queues[workerIndex];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+
+		if (queue.jobs.empty() == false)
+		{
+			queuedJob = std::move(queue.jobs.back());
+			queue.jobs.pop_back();
+			bFound = true;
+		}
+	}
+
+	size_t firstVictim = (workerIndex >= 0) ? (size_t)workerIndex + 1 : 0;
+	for (size_t i = 0; (bFound == false) && (i < queueCount); i++)
+	{
+		size_t victim = (firstVictim + i) % queueCount;
+		if ((int)victim == workerIndex)
+		{
+			continue;
+		}
+
+		WORKER_QUEUE& queue = m_queues[victim];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+
+		if (queue.jobs.empty() == false)
+		{
+			queuedJob = std::move(queue.jobs.front());
+			queue.jobs.pop_front();
+			bFound = true;
+		}
+	}
+
+	if (bFound == false)
+	{
+		return(false);
+	}
+
+	m_queuedJobs.fetch_sub(1);
+	queuedJob.job();
+	FinishJob(queuedJob.pCounter);
+
+	return(true);
+}
+
+/***********************************************************
+ *  FinishJob()
+ *
+ *  This method is used for counting down the counter of a
+ *  finished job.  When it reaches zero, the waiting threads
+ *  are woken and the jobs held back for it are queued.
+ ***********************************************************/
+void JobSystem::FinishJob(JobCounter* pCounter)
+{
+	std::vector<JobCounter::WAITING_JOB> waitingJobs;
+
+	if (NULL == pCounter)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(pCounter->m_mutex);
+
+		if (pCounter->m_count.fetch_sub(1, std::memory_order_acq_rel) != 1)
+		{
+			return;
+		}
+		waitingJobs.swap(pCounter->m_waitingJobs);
+		pCounter->m_done.notify_all();
+	}
+
+	// the counter may be gone from here on
+	for (size_t i = 0; i < waitingJobs.size(); i++)
+	{
+		QUEUED_JOB queuedJob;
+
+		queuedJob.job = std::move(waitingJobs[i].job);
+		queuedJob.pCounter = waitingJobs[i].pCounter;
+		Enqueue(queuedJob);
+	}
+}
+
+/***********************************************************
+ *  GetWorkerIndex()
+ *
+ *  This method is used for finding the worker that is the
+ *  calling thread.
+ ***********************************************************/
+int JobSystem::GetWorkerIndex() const
+{
+	return((g_pWorkerSystem == this) ? g_WorkerIndex : -1);
+}
+
+/***********************************************************
+ *  GetJobSystem()
+ *
+ *  This function is used for getting the job system shared
+ *  by the whole program.  It is started on the first call,
+ *  with one worker fewer than the CPU cores, since the
+ *  calling thread runs jobs while it waits for them - but
+ *  at least one, so that jobs queued without waiting, such
+ *  as texture decodes, never run on the rendering thread.
+ ***********************************************************/
+JobSystem& GetJobSystem()
+{
+	static JobSystem jobSystem;
+	static std::once_flag started;
+
+	std::call_once(started, []()
+	{
+		unsigned int coreCount = std::max(1u, std::thread::hardware_concurrency());
+		jobSystem.Start(std::max(1u, coreCount - 1));
+	});
+
+	return(jobSystem);
+}
@@ -0,0 +1,151 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.h
+// ============
+// run jobs on a pool of worker threads that steal work from each other
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  JobCounter
+ *
+ *  This class counts the jobs of a group that have not
+ *  finished yet.  A thread can wait for the count to reach
+ *  zero with JobSystem::Wait(), and jobs can be held back
+ *  until it has, to run after the group.  A counter must be
+ *  waited for before it is destroyed.
+ ***********************************************************/
+class JobCounter
+{
+public:
+	// constructor
+	JobCounter();
+
+	// true when every job of the group has finished - use
+	// JobSystem::Wait() before destroying the counter
+	bool IsDone() const { return(m_count.load(std::memory_order_acquire) == 0); }
+
+private:
+	friend class JobSystem;
+
+	// a job held back until the count reaches zero
+	struct WAITING_JOB
+	{
+		std::function<void()> job;
+		JobCounter* pCounter;
+	};
+
+	std::atomic<int> m_count;
+	// taken by the thread that finishes a job, and by Wait() before
+	// it returns, so the counter is not freed while still in use
+	std::mutex m_mutex;
+	std::condition_variable m_done;
+	std::vector<WAITING_JOB> m_waitingJobs;
+
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+};
+
+/***********************************************************
+ *  JobSystem
+ *
+ *  This class runs jobs on a pool of worker threads.  Each
+ *  worker has its own deque of jobs: it adds the jobs it
+ *  creates and takes its next job at the back, where the
+ *  data is still in its cache, and when its deque is empty
+ *  it steals the oldest job from the front of another one.
+ *  Jobs from threads outside the pool are handed out to the
+ *  deques in turn.  Idle workers sleep until a job arrives.
+ *
+ *  A thread that waits for a group of jobs runs queued jobs
+ *  in the meantime, so waiting from inside a job does not
+ *  tie up its worker.  With no workers, every job is run on
+ *  the thread that adds it.
+ ***********************************************************/
+class JobSystem
+{
+public:
+	typedef std::function<void()> JOB;
+	// a job over the items [first, last) of a range
+	typedef std::function<void(size_t first, size_t last)> RANGE_JOB;
+
+	// constructor
+	JobSystem();
+	// destructor
+	~JobSystem();
+
+	// start workerCount worker threads, after stopping the running
+	// ones - the queued jobs are finished first
+	void Start(unsigned int workerCount);
+	void Stop();
+	unsigned int GetWorkerCount() const { return(m_workerCount); }
+
+	// queue a job - the counter, if any, counts it until it has
+	// finished, and the job does not start before the dependency,
+	// if any, has reached zero
+	void Run(JOB job, JobCounter* pCounter = NULL, JobCounter* pDependency = NULL);
+	// wait until every job counted by the counter has finished,
+	// running queued jobs in the meantime
+	void Wait(JobCounter& counter);
+
+	// run the body over [0, count) in blocks of grainSize items on up
+	// to maxThreads threads (0 = every worker), the calling thread
+	// included, returning once every block is done.  The blocks
+	// start at multiples of grainSize, and ranges of one block are
+	// run on the calling thread without any jobs.
+	void ParallelFor(size_t count, size_t grainSize, const RANGE_JOB& body, unsigned int maxThreads = 0);
+
+private:
+	// a job in a worker deque
+	struct QUEUED_JOB
+	{
+		JOB job;
+		JobCounter* pCounter;
+	};
+	// the deque of a worker, which the other threads steal from
+	struct WORKER_QUEUE
+	{
+		std::mutex mutex;
+		std::deque<QUEUED_JOB> jobs;
+	};
+
+	std::vector<std::thread> m_workers;
+	// set before the workers start, which read it, and cleared
+	// after they end
+	unsigned int m_workerCount;
+	std::unique_ptr<WORKER_QUEUE[]> m_queues;
+	// deque the next job from outside the pool is added to
+	std::atomic<unsigned int> m_nextQueue;
+	// jobs in all of the deques, for the workers to sleep on
+	std::atomic<size_t> m_queuedJobs;
+	std::mutex m_wakeMutex;
+	std::condition_variable m_wakeWorkers;
+	bool m_bStopping;
+
+	// run jobs until the system is stopped
+	void WorkerThread(unsigned int workerIndex);
+	// add a job to a deque, or run it when there are no workers
+	void Enqueue(QUEUED_JOB& queuedJob);
+	// take a job from the deque of the calling worker, or steal one,
+	// and run it - false when there were none
+	bool RunNextJob();
+	// count a job as finished, queueing the jobs that waited for it
+	void FinishJob(JobCounter* pCounter);
+	// index of the calling thread's worker, -1 outside of the pool
+	int GetWorkerIndex() const;
+};
+
+// the job system shared by the whole program, started on first use
+// with one worker for each CPU core after the first, and at least one
+JobSystem& GetJobSystem();
@@ -1,5 +1,7 @@
 #include <iostream>         // error handling and output
 #include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // strcmp
+#include <cstdio>           // sscanf
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -13,6 +15,12 @@
 #include "ViewManager.h"
 #include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "TransformBatch.h"
+#include "UniformRegistry.h"
+#include "ProgramCache.h"
+#include "FrameTimer.h"
+#include "HeadlessContext.h"
+#include "CameraReplay.h"
 
 // Namespace for declaring global variables
 namespace
@@ -29,12 +37,53 @@ namespace
 	ShaderManager* g_ShaderManager = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
 	ViewManager* g_ViewManager = nullptr;
+	// uniform registry object for setting shader uniforms without name lookups
+	UniformRegistry* g_UniformRegistry = nullptr;
+	// frame timer object for measuring the CPU and GPU time of every frame
+	FrameTimer* g_FrameTimer = nullptr;
+	// offscreen context object for rendering without a display window
+	HeadlessContext* g_HeadlessContext = nullptr;
+
+	// shader files of the main shader program
+	const char* const g_VertexShaderName = "../../Utilities/shaders/vertexShader.glsl";
+	const char* const g_FragmentShaderName = "../../Utilities/shaders/fragmentShader.glsl";
+	// CSV file the frame times are written to on exit - only with
+	// "-frametimes filename", "-headless" or "-replay", so that an
+	// interactive run leaves no file behind
+	const char* g_FrameTimesName = "frametimes.csv";
+	bool g_bWriteFrameTimes = false;
+
+	// headless mode - "-headless" renders "-frames N" frames of
+	// "-size WIDTHxHEIGHT" into a framebuffer, and "-png filename"
+	// writes the last one into an image file
+	bool g_bHeadless = false;
+	int g_HeadlessFrames = 300;
+	int g_HeadlessWidth = 1000;
+	int g_HeadlessHeight = 800;
+	const char* g_HeadlessImageName = nullptr;
+
+	// replay benchmark - "-replay" flies the camera along the built-in
+	// path, or the one in "-camerapath filename", once the scene has
+	// loaded, then compares the frame times with "-baseline filename"
+	// and fails when any of them is more than "-threshold percent"
+	// slower.  The baseline is written when it does not exist yet, or
+	// with "-writebaseline".
+	bool g_bReplay = false;
+	const char* g_CameraPathName = nullptr;
+	const char* g_ReplayBaselineName = "replay_baseline.json";
+	bool g_bWriteReplayBaseline = false;
+	double g_ReplayThreshold = 10.0;
+	// the replay always steps the camera by 1/60 of a second
+	const float g_ReplayDeltaTime = 1.0f / 60.0f;
 }
 
 // Function declarations - all functions that are called manually
 // need to be pre-declared at the beginning of the source code.
 bool InitializeGLFW();
 bool InitializeGLEW();
+void ParseHeadlessOptions(int argc, char* argv[]);
+void ParseReplayOptions(int argc, char* argv[]);
+bool FinishReplay(const ReplayBenchmark& replayBenchmark);
 
 
 /***********************************************************
@@ -45,8 +94,39 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+	// the model matrix benchmark does not need a display window
+	if ((argc > 1) && (strcmp(argv[1], "-benchtransforms") == 0))
+	{
+		exit((RunModelMatrixBenchmark() == true) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+	// neither does the job system scaling benchmark
+	if ((argc > 1) && (strcmp(argv[1], "-benchjobs") == 0))
+	{
+		SceneManager::BenchmarkJobScaling();
+		exit(EXIT_SUCCESS);
+	}
+	// baking the texture cache does not need a display window either -
+	// "-baketextures -compress" bakes BC1/BC3 compressed textures
+	if ((argc > 1) && (strcmp(argv[1], "-baketextures") == 0))
+	{
+		bool bCompress = (argc > 2) && (strcmp(argv[2], "-compress") == 0);
+		exit((SceneManager::BakeSceneTextures(bCompress) == true) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	ParseHeadlessOptions(argc, argv);
+	ParseReplayOptions(argc, argv);
+
+	if (g_bHeadless)
+	{
+		// an EGL context needs no display, so GLFW is not used at all
+		g_HeadlessContext = new HeadlessContext();
+		if (g_HeadlessContext->Create() == false)
+		{
+			return(EXIT_FAILURE);
+		}
+	}
 	// if GLFW fails initialization, then terminate the application
-	if (InitializeGLFW() == false)
+	else if (InitializeGLFW() == false)
 	{
 		return(EXIT_FAILURE);
 	}
@@ -58,7 +138,10 @@ int main(int argc, char* argv[])
 		g_ShaderManager);
 
 	// try to create the main display window
-	g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
+	if (g_bHeadless == false)
+	{
+		g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
+	}
 
 	// if GLEW fails initialization, then terminate the application
 	if (InitializeGLEW() == false)
@@ -66,20 +149,96 @@ int main(int argc, char* argv[])
 		return(EXIT_FAILURE);
 	}
 
-	// load the shader code from the external GLSL files
-	g_ShaderManager->LoadShaders(
-		"../../Utilities/shaders/vertexShader.glsl",
-		"../../Utilities/shaders/fragmentShader.glsl");
+	// the framebuffer stands in for the window
+	if (g_bHeadless)
+	{
+		if (g_HeadlessContext->CreateFramebuffer(g_HeadlessWidth, g_HeadlessHeight) == false)
+		{
+			return(EXIT_FAILURE);
+		}
+		g_ViewManager->CreateHeadlessView(g_HeadlessWidth, g_HeadlessHeight);
+	}
+
+	// the mip chain benchmark compares against the driver, so it
+	// needs the OpenGL context of the window
+	if ((argc > 1) && (strcmp(argv[1], "-benchmips") == 0))
+	{
+		SceneManager::BenchmarkMipGeneration();
+		exit(EXIT_SUCCESS);
+	}
+
+	// load the shader code from the external GLSL files - the linked
+	// program comes from the program binary cache when the files and
+	// the driver are unchanged since the last launch
+	g_ShaderManager->m_programID = LoadCachedProgram(
+		g_VertexShaderName,
+		g_FragmentShaderName);
 	g_ShaderManager->use();
 
+	// resolve the shader uniform locations once, now that the
+	// shader program is loaded and in use
+	g_UniformRegistry = new UniformRegistry();
+	g_UniformRegistry->AttachCurrentProgram();
+	g_ViewManager->ResolveShaderUniforms(g_UniformRegistry);
+
 	// try to create a new scene manager object and prepare the 3D scene
 	g_SceneManager = new SceneManager(g_ShaderManager);
+	g_SceneManager->ResolveShaderUniforms(g_UniformRegistry);
+	// "-texturebudget MB" changes the GPU memory kept for textures,
+	// 0 for no limit
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (strcmp(argv[i], "-texturebudget") == 0)
+		{
+			g_SceneManager->SetTextureBudget((size_t)atoi(argv[i + 1]) * 1024 * 1024);
+		}
+		if (strcmp(argv[i], "-frametimes") == 0)
+		{
+			g_FrameTimesName = argv[i + 1];
+			g_bWriteFrameTimes = true;
+		}
+	}
 	g_SceneManager->PrepareScene();
+	// edits to the shader files are relinked while the scene runs
+	g_SceneManager->WatchShaderProgram(g_UniformRegistry, g_VertexShaderName, g_FragmentShaderName);
+	// the instanced shader program needs the camera as well
+	g_ViewManager->ResolveShaderUniforms(g_SceneManager->GetInstancedUniformRegistry());
+
+	// time every frame on the CPU and the GPU
+	g_FrameTimer = new FrameTimer();
+	g_FrameTimer->Create();
+
+	CameraPath cameraPath;
+	ReplayBenchmark replayBenchmark;
+	bool bReplayStarted = false;
+	int exitCode = EXIT_SUCCESS;
+	if (g_bReplay && (NULL != g_CameraPathName) && (cameraPath.LoadFile(g_CameraPathName) == false))
+	{
+		return(EXIT_FAILURE);
+	}
 
 	// loop will keep running until the application is closed 
-	// or until an error has occurred
-	while (!glfwWindowShouldClose(g_Window))
+	// or until an error has occurred - or, when headless, until
+	// the frames have been rendered or the replay has ended
+	for (int frame = 0; g_bHeadless ? (g_bReplay || (frame < g_HeadlessFrames)) : !glfwWindowShouldClose(g_Window); frame++)
 	{
+		// the replay starts once streaming is over, so that every
+		// replayed frame draws the final textures
+		if (g_bReplay && (bReplayStarted == false) && g_SceneManager->IsSceneLoaded())
+		{
+			std::cout << "INFO: Replaying the camera path of " << cameraPath.GetKeyframeCount()
+				<< " keyframes from frame " << frame << std::endl;
+			g_ViewManager->StartCameraReplay(&cameraPath, g_ReplayDeltaTime);
+			replayBenchmark.BeginRecording((uint64_t)frame, g_ReplayDeltaTime);
+			bReplayStarted = true;
+		}
+
+		g_FrameTimer->BeginFrame();
+		if (g_bHeadless)
+		{
+			g_HeadlessContext->BindFramebuffer();
+		}
+
 		// Enable z-depth
 		glEnable(GL_DEPTH_TEST);
 
@@ -88,17 +247,69 @@ int main(int argc, char* argv[])
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		// convert from 3D object space to 2D view
+		g_FrameTimer->BeginSection(FRAME_SECTION_VIEW);
 		g_ViewManager->PrepareSceneView();
+		// cull the objects outside of the camera's view
+		g_SceneManager->SetViewProjection(g_ViewManager->GetViewProjection());
+		g_FrameTimer->EndSection(FRAME_SECTION_VIEW);
 
 		// refresh the 3D scene
+		g_FrameTimer->BeginSection(FRAME_SECTION_RENDER);
 		g_SceneManager->RenderScene();
-
+		g_FrameTimer->EndSection(FRAME_SECTION_RENDER);
+		if (bReplayStarted)
+		{
+			const SceneManager::RENDER_STATS& stats = g_SceneManager->GetFrameStats();
+			replayBenchmark.AddFrame(stats.drawCalls, stats.stateChangesSorted, stats.visible);
+		}
+		g_FrameTimer->EndGPUWork();
 
 		// Flips the the back buffer with the front buffer every frame.
-		glfwSwapBuffers(g_Window);
+		g_FrameTimer->BeginSection(FRAME_SECTION_SWAP);
+		if (g_bHeadless)
+		{
+			g_HeadlessContext->EndFrame();
+		}
+		else
+		{
+			glfwSwapBuffers(g_Window);
+		}
+		g_FrameTimer->EndSection(FRAME_SECTION_SWAP);
 
 		// query the latest GLFW events
-		glfwPollEvents();
+		if (g_bHeadless == false)
+		{
+			glfwPollEvents();
+		}
+
+		g_FrameTimer->EndFrame();
+
+		// the replay ends with the frame at the last keyframe
+		if (bReplayStarted && g_ViewManager->IsCameraReplayDone())
+		{
+			break;
+		}
+	}
+
+	// the last frames wait for their GPU times while the OpenGL
+	// context still exists
+	g_FrameTimer->Destroy();
+	g_FrameTimer->Report();
+	if (g_bWriteFrameTimes || g_bHeadless || g_bReplay)
+	{
+		g_FrameTimer->WriteCSV(g_FrameTimesName);
+	}
+	if (g_bHeadless && (NULL != g_HeadlessImageName))
+	{
+		g_HeadlessContext->WritePNG(g_HeadlessImageName);
+	}
+	if (g_bReplay)
+	{
+		replayBenchmark.Finish(*g_FrameTimer);
+		if (FinishReplay(replayBenchmark) == false)
+		{
+			exitCode = EXIT_FAILURE;
+		}
 	}
 
 	// clear the allocated manager objects from memory
@@ -117,9 +328,27 @@ int main(int argc, char* argv[])
 		delete g_ShaderManager;
 		g_ShaderManager = NULL;
 	}
+	if (NULL != g_UniformRegistry)
+	{
+		g_UniformRegistry->ReportCounters();
+		delete g_UniformRegistry;
+		g_UniformRegistry = NULL;
+	}
+	if (NULL != g_FrameTimer)
+	{
+		delete g_FrameTimer;
+		g_FrameTimer = NULL;
+	}
+	// the context goes last, after every object that freed OpenGL
+	// resources in it
+	if (NULL != g_HeadlessContext)
+	{
+		delete g_HeadlessContext;
+		g_HeadlessContext = NULL;
+	}
 
-	// Terminates the program successfully
-	exit(EXIT_SUCCESS); 
+	// Terminates the program, unsuccessfully when the replay regressed
+	exit(exitCode); 
 }
 
 /***********************************************************
@@ -160,8 +389,16 @@ bool InitializeGLEW()
 	// -----------------------------------------
 	GLenum GLEWInitResult = GLEW_OK;
 
-	// try to initialize the GLEW library
-	GLEWInitResult = glewInit();
+	// try to initialize the GLEW library - a headless context is
+	// not a GLX or WGL one, so only the OpenGL entry points are loaded
+	if (g_bHeadless)
+	{
+		GLEWInitResult = glewContextInit();
+	}
+	else
+	{
+		GLEWInitResult = glewInit();
+	}
 	if (GLEW_OK != GLEWInitResult)
 	{
 		std::cerr << glewGetErrorString(GLEWInitResult) << std::endl;
@@ -174,4 +411,107 @@ bool InitializeGLEW()
 	std::cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << "\n" << std::endl;
 
 	return(true);
-}
\ No newline at end of file
+}
+
+/***********************************************************
+ *	ParseHeadlessOptions()
+ *
+ *  This function is used to read the headless mode options
+ *  from the command line, in any order.
+ ***********************************************************/
+void ParseHeadlessOptions(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-headless") == 0)
+		{
+			g_bHeadless = true;
+		}
+		else if ((strcmp(argv[i], "-frames") == 0) && (i + 1 < argc))
+		{
+			g_HeadlessFrames = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "-size") == 0) && (i + 1 < argc))
+		{
+			if (sscanf(argv[++i], "%dx%d", &g_HeadlessWidth, &g_HeadlessHeight) != 2)
+			{
+				std::cout << "Could not read the frame size, expected WIDTHxHEIGHT:" << argv[i] << std::endl;
+			}
+		}
+		else if ((strcmp(argv[i], "-png") == 0) && (i + 1 < argc))
+		{
+			g_HeadlessImageName = argv[++i];
+		}
+	}
+}
+
+/***********************************************************
+ *	ParseReplayOptions()
+ *
+ *  This function is used to read the replay benchmark
+ *  options from the command line, in any order.
+ ***********************************************************/
+void ParseReplayOptions(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-replay") == 0)
+		{
+			g_bReplay = true;
+		}
+		else if ((strcmp(argv[i], "-camerapath") == 0) && (i + 1 < argc))
+		{
+			g_CameraPathName = argv[++i];
+		}
+		else if ((strcmp(argv[i], "-baseline") == 0) && (i + 1 < argc))
+		{
+			g_ReplayBaselineName = argv[++i];
+		}
+		else if (strcmp(argv[i], "-writebaseline") == 0)
+		{
+			g_bWriteReplayBaseline = true;
+		}
+		else if ((strcmp(argv[i], "-threshold") == 0) && (i + 1 < argc))
+		{
+			g_ReplayThreshold = atof(argv[++i]);
+		}
+	}
+}
+
+/***********************************************************
+ *	FinishReplay()
+ *
+ *  This function is used to report a finished replay, and
+ *  to write it as the baseline or compare it with the
+ *  baseline.  It returns false when the replay regressed,
+ *  or did not reach the end of its path.
+ ***********************************************************/
+bool FinishReplay(const ReplayBenchmark& replayBenchmark)
+{
+	if (g_ViewManager->IsCameraReplayDone() == false)
+	{
+		std::cout << "Could not finish the camera replay, the window was closed" << std::endl;
+		return(false);
+	}
+	replayBenchmark.Report();
+
+	FILE* pBaseline = fopen(g_ReplayBaselineName, "r");
+	bool bBaselineExists = (NULL != pBaseline);
+	if (NULL != pBaseline)
+	{
+		fclose(pBaseline);
+	}
+
+	if (g_bWriteReplayBaseline || (bBaselineExists == false))
+	{
+		return(replayBenchmark.WriteBaseline(g_ReplayBaselineName));
+	}
+	if (replayBenchmark.CompareBaseline(g_ReplayBaselineName, g_ReplayThreshold) == false)
+	{
+		std::cout << "INFO: The camera replay regressed against " << g_ReplayBaselineName << std::endl;
+		return(false);
+	}
+	std::cout << "INFO: The camera replay is within " << g_ReplayThreshold << "% of " << g_ReplayBaselineName << std::endl;
+
+	return(true);
+}
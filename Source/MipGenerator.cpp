@@ -0,0 +1,988 @@
+///////////////////////////////////////////////////////////////////////////////
+// mipgenerator.cpp
+// ============
+// generate texture mip chains on the CPU with SIMD filters
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MipGenerator.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <thread>
+
+// the SIMD paths are only available on x86 processors
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define MIP_GENERATOR_SIMD
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define TARGET_SSE2
+#define TARGET_AVX2
+#else
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// declaration of global variables
+namespace
+{
+	// rows of a level that one job filters
+	const uint32_t g_BandRows = 32;
+	// half widths of the filters, in texels of the smaller level
+	const float g_BoxRadius = 0.5f;
+	const float g_WindowedSincRadius = 3.0f;
+	// shape of the Kaiser window - higher is smoother
+	const float g_KaiserBeta = 4.0f;
+	const float g_Pi = 3.14159265358979f;
+	// steps of the search for the alpha scale of a level
+	const int g_CoverageSearchSteps = 10;
+
+	// instruction sets that can be used for filtering
+	enum MIP_PATH
+	{
+		PATH_UNKNOWN = 0,
+		PATH_SCALAR,
+		PATH_SSE2,
+		PATH_AVX2
+	};
+	MIP_PATH g_MipPath = PATH_UNKNOWN;
+
+	/***********************************************************
+	 *  SRGB_TABLES
+	 *
+	 *  The linear value of every 8-bit sRGB code, and the
+	 *  linear value halfway between each code and the next,
+	 *  so that encoding is a search for the nearest code.
+	 ***********************************************************/
+	struct SRGB_TABLES
+	{
+		float toLinear[256];
+		float thresholds[255];
+
+		SRGB_TABLES()
+		{
+			for (int i = 0; i < 256; i++)
+			{
+				toLinear[i] = Decode(i / 255.0);
+			}
+			for (int i = 0; i < 255; i++)
+			{
+				thresholds[i] = Decode((i + 0.5) / 255.0);
+			}
+		}
+
+		static float Decode(double value)
+		{
+			if (value <= 0.04045)
+			{
+				return((float)(value / 12.92));
+			}
+			return((float)pow((value + 0.055) / 1.055, 2.4));
+		}
+	};
+
+	const SRGB_TABLES& GetSRGBTables()
+	{
+		static const SRGB_TABLES tables;
+		return(tables);
+	}
+
+	/***********************************************************
+	 *  FILTER_TAPS
+	 *
+	 *  The source texels and weights of every texel of a
+	 *  smaller level, along one axis.  Every texel reads the
+	 *  same number of taps, starting at its first source
+	 *  texel, with zero weights where it needs fewer.
+	 ***********************************************************/
+	struct FILTER_TAPS
+	{
+		uint32_t tapCount;
+		std::vector<int> first;
+		std::vector<float> weights;
+	};
+
+	/***********************************************************
+	 *  Sinc()
+	 *
+	 *  Normalized sinc, sin(pi x) / (pi x).
+	 ***********************************************************/
+	double Sinc(double x)
+	{
+		if (fabs(x) < 1e-6)
+		{
+			return(1.0);
+		}
+		x *= g_Pi;
+		return(sin(x) / x);
+	}
+
+	/***********************************************************
+	 *  BesselI0()
+	 *
+	 *  Modified Bessel function of the first kind, order 0,
+	 *  for the Kaiser window.
+	 ***********************************************************/
+	double BesselI0(double x)
+	{
+		double sum = 1.0;
+		double term = 1.0;
+
+		for (int k = 1; k < 25; k++)
+		{
+			double half = x / (2.0 * k);
+			term *= half * half;
+			sum += term;
+		}
+
+		return(sum);
+	}
+
+	/***********************************************************
+	 *  GetFilterRadius()
+	 *
+	 *  Half width of a filter, in texels of the smaller level.
+	 ***********************************************************/
+	float GetFilterRadius(MIP_FILTER filter)
+	{
+		return((filter == MIP_FILTER_BOX) ? g_BoxRadius : g_WindowedSincRadius);
+	}
+
+	/***********************************************************
+	 *  GetFilterWeight()
+	 *
+	 *  Weight of a filter at a distance, in texels of the
+	 *  smaller level.
+	 ***********************************************************/
+	double GetFilterWeight(MIP_FILTER filter, double t)
+	{
+		double radius = GetFilterRadius(filter);
+
+		switch (filter)
+		{
+		case MIP_FILTER_KAISER:
+		{
+			if (fabs(t) >= radius)
+			{
+				return(0.0);
+			}
+			double r = t / radius;
+			return(Sinc(t) * BesselI0(g_KaiserBeta * sqrt(1.0 - (r * r))) / BesselI0(g_KaiserBeta));
+		}
+		case MIP_FILTER_LANCZOS:
+			if (fabs(t) >= radius)
+			{
+				return(0.0);
+			}
+			return(Sinc(t) * Sinc(t / radius));
+		default:
+			return((fabs(t) <= radius) ? 1.0 : 0.0);
+		}
+	}
+
+	/***********************************************************
+	 *  BuildFilterTaps()
+	 *
+	 *  Work out the taps for resampling one axis from the
+	 *  source size to the level size.  Taps that fall outside
+	 *  of the source repeat the edge texel, and the weights
+	 *  of every texel add up to 1.
+	 ***********************************************************/
+	void BuildFilterTaps(uint32_t sourceSize, uint32_t levelSize, MIP_FILTER filter, FILTER_TAPS& taps)
+	{
+		const double ratio = (double)sourceSize / (double)levelSize;
+		const double support = GetFilterRadius(filter) * ratio;
+		std::vector<int> low(levelSize);
+		std::vector<std::vector<double> > weights(levelSize);
+
+		taps.tapCount = 1;
+		for (uint32_t i = 0; i < levelSize; i++)
+		{
+			double center = (i + 0.5) * ratio;
+			int first = (int)floor(center - support);
+			int last = (int)ceil(center + support);
+			int clampedFirst = std::max(first, 0);
+			int clampedLast = std::min(last, (int)sourceSize - 1);
+			double sum = 0.0;
+
+			weights[i].assign((size_t)(clampedLast - clampedFirst + 1), 0.0);
+			for (int s = first; s <= last; s++)
+			{
+				double weight = GetFilterWeight(filter, ((s + 0.5) - center) / ratio);
+				int clamped = std::min(std::max(s, 0), (int)sourceSize - 1);
+
+				weights[i][(size_t)(clamped - clampedFirst)] += weight;
+				sum += weight;
+			}
+			for (size_t k = 0; k < weights[i].size(); k++)
+			{
+				weights[i][k] = (sum != 0.0) ? (weights[i][k] / sum) : 0.0;
+			}
+			low[i] = clampedFirst;
+			taps.tapCount = std::max(taps.tapCount, (uint32_t)weights[i].size());
+		}
+
+		// every texel reads tapCount source texels, so the first one
+		// moves back where that would run past the last source texel
+		taps.first.resize(levelSize);
+		taps.weights.assign((size_t)levelSize * taps.tapCount, 0.0f);
+		for (uint32_t i = 0; i < levelSize; i++)
+		{
+			int first = std::min(low[i], (int)sourceSize - (int)taps.tapCount);
+			float* pWeights = &taps.weights[(size_t)i * taps.tapCount];
+
+			taps.first[i] = first;
+			for (size_t k = 0; k < weights[i].size(); k++)
+			{
+				pWeights[(size_t)(low[i] - first) + k] = (float)weights[i][k];
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  FilterRowScalar()
+	 *
+	 *  Resample one row of RGBA float texels horizontally.
+	 ***********************************************************/
+	void FilterRowScalar(const float* pSource, const FILTER_TAPS& taps, uint32_t levelWidth, float* pRow)
+	{
+		for (uint32_t x = 0; x < levelWidth; x++)
+		{
+			const float* pWeights = &taps.weights[(size_t)x * taps.tapCount];
+			const float* pTexel = pSource + ((size_t)taps.first[x] * 4);
+			float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+			for (uint32_t k = 0; k < taps.tapCount; k++)
+			{
+				for (int c = 0; c < 4; c++)
+				{
+					sum[c] = sum[c] + (pWeights[k] * pTexel[(k * 4) + c]);
+				}
+			}
+			memcpy(pRow + ((size_t)x * 4), sum, sizeof(sum));
+		}
+	}
+
+	/***********************************************************
+	 *  FilterColumnsScalar()
+	 *
+	 *  Resample floatCount floats of a row vertically, from
+	 *  rows of texels that were already resampled horizontally
+	 *  and are rowFloats apart.
+	 ***********************************************************/
+	void FilterColumnsScalar(
+		const float* pRows,
+		size_t rowFloats,
+		size_t floatCount,
+		const float* pWeights,
+		uint32_t tapCount,
+		float* pLevelRow)
+	{
+		for (size_t f = 0; f < floatCount; f++)
+		{
+			float sum = 0.0f;
+
+			for (uint32_t k = 0; k < tapCount; k++)
+			{
+				sum = sum + (pWeights[k] * pRows[(k * rowFloats) + f]);
+			}
+			pLevelRow[f] = sum;
+		}
+	}
+
+#ifdef MIP_GENERATOR_SIMD
+	/***********************************************************
+	 *  FilterRowSSE2()
+	 *
+	 *  Resample one row horizontally, with the four channels
+	 *  of a texel in one SSE register.
+	 ***********************************************************/
+	TARGET_SSE2 void FilterRowSSE2(const float* pSource, const FILTER_TAPS& taps, uint32_t levelWidth, float* pRow)
+	{
+		for (uint32_t x = 0; x < levelWidth; x++)
+		{
+			const float* pWeights = &taps.weights[(size_t)x * taps.tapCount];
+			const float* pTexel = pSource + ((size_t)taps.first[x] * 4);
+			__m128 sum = _mm_setzero_ps();
+
+			for (uint32_t k = 0; k < taps.tapCount; k++)
+			{
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(pWeights[k]), _mm_loadu_ps(pTexel + (k * 4))));
+			}
+			_mm_storeu_ps(pRow + ((size_t)x * 4), sum);
+		}
+	}
+
+	/***********************************************************
+	 *  FilterColumnsSSE2()
+	 *
+	 *  Resample one row vertically, 4 floats at a time - every
+	 *  float of the row uses the same weights.
+	 ***********************************************************/
+	TARGET_SSE2 void FilterColumnsSSE2(
+		const float* pRows,
+		size_t rowFloats,
+		size_t floatCount,
+		const float* pWeights,
+		uint32_t tapCount,
+		float* pLevelRow)
+	{
+		size_t f = 0;
+
+		for (; f + 4 <= floatCount; f += 4)
+		{
+			__m128 sum = _mm_setzero_ps();
+
+			for (uint32_t k = 0; k < tapCount; k++)
+			{
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(pWeights[k]), _mm_loadu_ps(pRows + (k * rowFloats) + f)));
+			}
+			_mm_storeu_ps(pLevelRow + f, sum);
+		}
+		if (f < floatCount)
+		{
+			FilterColumnsScalar(pRows + f, rowFloats, floatCount - f, pWeights, tapCount, pLevelRow + f);
+		}
+	}
+
+	/***********************************************************
+	 *  FilterColumnsAVX2()
+	 *
+	 *  Resample one row vertically, 8 floats (2 texels) at a
+	 *  time.  The multiply and add are kept apart, so that the
+	 *  results match the other paths bit for bit.
+	 ***********************************************************/
+	TARGET_AVX2 void FilterColumnsAVX2(
+		const float* pRows,
+		size_t rowFloats,
+		size_t floatCount,
+		const float* pWeights,
+		uint32_t tapCount,
+		float* pLevelRow)
+	{
+		size_t f = 0;
+
+		for (; f + 8 <= floatCount; f += 8)
+		{
+			__m256 sum = _mm256_setzero_ps();
+
+			for (uint32_t k = 0; k < tapCount; k++)
+			{
+				sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(pWeights[k]), _mm256_loadu_ps(pRows + (k * rowFloats) + f)));
+			}
+			_mm256_storeu_ps(pLevelRow + f, sum);
+		}
+		if (f < floatCount)
+		{
+			FilterColumnsSSE2(pRows + f, rowFloats, floatCount - f, pWeights, tapCount, pLevelRow + f);
+		}
+	}
+
+	/***********************************************************
+	 *  DetectMipPath()
+	 *
+	 *  Find the widest instruction set that the CPU and the
+	 *  operating system both support.
+	 ***********************************************************/
+	MIP_PATH DetectMipPath()
+	{
+#if defined(_MSC_VER)
+		int cpuInfo[4] = { 0 };
+		__cpuid(cpuInfo, 0);
+		int maxLeaf = cpuInfo[0];
+
+		__cpuid(cpuInfo, 1);
+		bool bSSE2 = (cpuInfo[3] & (1 << 26)) != 0;
+		bool bOSXSAVE = (cpuInfo[2] & (1 << 27)) != 0;
+		bool bAVX = (cpuInfo[2] & (1 << 28)) != 0;
+		bool bAVX2 = false;
+		if ((maxLeaf >= 7) && bOSXSAVE && bAVX && ((_xgetbv(0) & 6) == 6))
+		{
+			__cpuidex(cpuInfo, 7, 0);
+			bAVX2 = (cpuInfo[1] & (1 << 5)) != 0;
+		}
+		if (bAVX2)
+			return(PATH_AVX2);
+		if (bSSE2)
+			return(PATH_SSE2);
+#else
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2"))
+			return(PATH_AVX2);
+		if (__builtin_cpu_supports("sse2"))
+			return(PATH_SSE2);
+#endif
+		return(PATH_SCALAR);
+	}
+#endif
+
+	/***********************************************************
+	 *  GetMipPath()
+	 *
+	 *  Return the instruction set used for filtering,
+	 *  detecting it on the first call.
+	 ***********************************************************/
+	MIP_PATH GetMipPath()
+	{
+		if (g_MipPath == PATH_UNKNOWN)
+		{
+#ifdef MIP_GENERATOR_SIMD
+			g_MipPath = DetectMipPath();
+#else
+			g_MipPath = PATH_SCALAR;
+#endif
+		}
+
+		return(g_MipPath);
+	}
+
+	/***********************************************************
+	 *  RunParallel()
+	 *
+	 *  Run jobCount jobs over up to threadCount threads of the
+	 *  job system (0 = all of them), the calling thread
+	 *  included, with each thread taking the next job until
+	 *  none are left.
+	 ***********************************************************/
+	void RunParallel(size_t jobCount, unsigned int threadCount, const std::function<void(size_t)>& job)
+	{
+		GetJobSystem().ParallelFor(jobCount, 1, [&job](size_t first, size_t last)
+		{
+			for (size_t i = first; i < last; i++)
+			{
+				job(i);
+			}
+		}, threadCount);
+	}
+
+	/***********************************************************
+	 *  MIP_CHAIN
+	 *
+	 *  The state of one image while its chain is generated -
+	 *  the level that was just finished and the one being
+	 *  filtered from it, as linear RGBA floats.
+	 ***********************************************************/
+	struct MIP_CHAIN
+	{
+		MIP_IMAGE* pImage;
+		std::vector<float> source;
+		std::vector<float> level;
+		uint32_t width;
+		uint32_t height;
+		uint32_t levelWidth;
+		uint32_t levelHeight;
+		// where the level being filtered goes in the texels
+		size_t levelOffset;
+		// channel that holds alpha, or -1
+		int alphaChannel;
+		float coverage;
+		float alphaScale;
+		FILTER_TAPS horizontal;
+		FILTER_TAPS vertical;
+	};
+
+	// a band of rows of one level
+	struct MIP_BAND
+	{
+		size_t chain;
+		uint32_t firstRow;
+		uint32_t lastRow;
+	};
+
+	/***********************************************************
+	 *  ComputeAlphaCoverage()
+	 *
+	 *  Share of the texels of a level whose scaled alpha is
+	 *  above the cutoff.
+	 ***********************************************************/
+	float ComputeAlphaCoverage(const std::vector<float>& texels, int alphaChannel, float scale, float cutoff)
+	{
+		size_t covered = 0;
+		size_t texelCount = texels.size() / 4;
+
+		for (size_t i = 0; i < texelCount; i++)
+		{
+			if (std::min(texels[(i * 4) + alphaChannel] * scale, 1.0f) > cutoff)
+			{
+				covered++;
+			}
+		}
+
+		return((texelCount > 0) ? ((float)covered / (float)texelCount) : 0.0f);
+	}
+
+	/***********************************************************
+	 *  FindAlphaScale()
+	 *
+	 *  Search for the alpha reference that gives a level the
+	 *  same coverage as level 0, and return the scale that
+	 *  moves that reference to the cutoff.
+	 ***********************************************************/
+	float FindAlphaScale(const std::vector<float>& texels, int alphaChannel, float cutoff, float targetCoverage)
+	{
+		float minReference = 0.0f;
+		float maxReference = 1.0f;
+		float reference = cutoff;
+
+		// fully clear or fully covered images have nothing to keep
+		if ((targetCoverage <= 0.0f) || (targetCoverage >= 1.0f))
+		{
+			return(1.0f);
+		}
+
+		for (int step = 0; step < g_CoverageSearchSteps; step++)
+		{
+			float coverage = ComputeAlphaCoverage(texels, alphaChannel, 1.0f, reference);
+
+			if (coverage > targetCoverage)
+			{
+				minReference = reference;
+			}
+			else if (coverage < targetCoverage)
+			{
+				maxReference = reference;
+			}
+			else
+			{
+				break;
+			}
+			reference = (minReference + maxReference) * 0.5f;
+		}
+
+		return((reference > 0.0f) ? (cutoff / reference) : 1.0f);
+	}
+
+	/***********************************************************
+	 *  EncodeChannel()
+	 *
+	 *  Convert a filtered linear value back to 8 bits.
+	 ***********************************************************/
+	unsigned char EncodeChannel(float value, bool bSRGB)
+	{
+		if (bSRGB)
+		{
+			const SRGB_TABLES& tables = GetSRGBTables();
+			return((unsigned char)(std::upper_bound(tables.thresholds, tables.thresholds + 255, value) - tables.thresholds));
+		}
+
+		value = std::min(std::max(value, 0.0f), 1.0f);
+		return((unsigned char)((value * 255.0f) + 0.5f));
+	}
+
+	/***********************************************************
+	 *  GenerateChains()
+	 *
+	 *  Generate the mip chains of all of the images with the
+	 *  passed in instruction set.  Every level of every image
+	 *  is split into bands of rows that are filtered in
+	 *  parallel - first horizontally into a scratch buffer,
+	 *  then vertically into the level - and then written out
+	 *  as 8-bit texels, also in parallel.
+	 ***********************************************************/
+	void GenerateChains(
+		MIP_IMAGE* images,
+		size_t imageCount,
+		const MIP_OPTIONS& options,
+		unsigned int threadCount,
+		MIP_PATH path)
+	{
+		const SRGB_TABLES& tables = GetSRGBTables();
+		std::vector<MIP_CHAIN> chains(imageCount);
+		std::vector<MIP_BAND> bands;
+
+		// level 0 is copied as it is, and converted to linear floats
+		RunParallel(imageCount, threadCount, [&](size_t i)
+		{
+			MIP_IMAGE& image = images[i];
+			MIP_CHAIN& chain = chains[i];
+			const uint32_t channels = image.colorChannels;
+
+			chain.pImage = &image;
+			chain.width = 0;
+			chain.height = 0;
+			image.texels.clear();
+			if ((NULL == image.pPixels) || (image.width == 0) || (image.height == 0) ||
+				(channels == 0) || (channels > 4))
+			{
+				return;
+			}
+
+			size_t texelCount = (size_t)image.width * image.height;
+			image.texels.resize(GetMipChainBytes(image.width, image.height, channels));
+			memcpy(image.texels.data(), image.pPixels, texelCount * channels);
+
+			chain.width = image.width;
+			chain.height = image.height;
+			chain.levelOffset = texelCount * channels;
+			chain.alphaChannel = ((channels == 2) || (channels == 4)) ? (int)channels - 1 : -1;
+			chain.source.assign(texelCount * 4, 0.0f);
+			for (size_t t = 0; t < texelCount; t++)
+			{
+				for (uint32_t c = 0; c < channels; c++)
+				{
+					unsigned char value = image.pPixels[(t * channels) + c];
+					bool bColor = ((int)c != chain.alphaChannel);
+
+					chain.source[(t * 4) + c] = (options.bSRGB && bColor) ? tables.toLinear[value] : (value / 255.0f);
+				}
+			}
+
+			chain.coverage = 0.0f;
+			if (options.bPreserveAlphaCoverage && (chain.alphaChannel >= 0))
+			{
+				chain.coverage = ComputeAlphaCoverage(chain.source, chain.alphaChannel, 1.0f, options.alphaCutoff);
+			}
+		});
+
+		while (true)
+		{
+			bands.clear();
+			for (size_t i = 0; i < imageCount; i++)
+			{
+				MIP_CHAIN& chain = chains[i];
+
+				if ((chain.width <= 1) && (chain.height <= 1))
+				{
+					continue;
+				}
+
+				chain.levelWidth = (chain.width > 1) ? (chain.width / 2) : 1;
+				chain.levelHeight = (chain.height > 1) ? (chain.height / 2) : 1;
+				BuildFilterTaps(chain.width, chain.levelWidth, options.filter, chain.horizontal);
+				BuildFilterTaps(chain.height, chain.levelHeight, options.filter, chain.vertical);
+				chain.level.resize((size_t)chain.levelWidth * chain.levelHeight * 4);
+
+				for (uint32_t row = 0; row < chain.levelHeight; row += g_BandRows)
+				{
+					MIP_BAND band;
+					band.chain = i;
+					band.firstRow = row;
+					band.lastRow = std::min(row + g_BandRows, chain.levelHeight);
+					bands.push_back(band);
+				}
+			}
+			if (bands.empty())
+			{
+				break;
+			}
+
+			RunParallel(bands.size(), threadCount, [&](size_t b)
+			{
+				const MIP_BAND& band = bands[b];
+				MIP_CHAIN& chain = chains[band.chain];
+				const FILTER_TAPS& vertical = chain.vertical;
+				const size_t sourceFloats = (size_t)chain.width * 4;
+				const size_t rowFloats = (size_t)chain.levelWidth * 4;
+				int firstSourceRow = vertical.first[band.firstRow];
+				int lastSourceRow = vertical.first[band.lastRow - 1] + (int)vertical.tapCount;
+				std::vector<float> rows((size_t)(lastSourceRow - firstSourceRow) * rowFloats);
+
+				// the source rows that the band reads, resampled horizontally
+				for (int row = firstSourceRow; row < lastSourceRow; row++)
+				{
+					const float* pSource = chain.source.data() + ((size_t)row * sourceFloats);
+					float* pRow = rows.data() + ((size_t)(row - firstSourceRow) * rowFloats);
+
+#ifdef MIP_GENERATOR_SIMD
+					if (path != PATH_SCALAR)
+					{
+						FilterRowSSE2(pSource, chain.horizontal, chain.levelWidth, pRow);
+						continue;
+					}
+#endif
+					FilterRowScalar(pSource, chain.horizontal, chain.levelWidth, pRow);
+				}
+
+				for (uint32_t y = band.firstRow; y < band.lastRow; y++)
+				{
+					const float* pRows = rows.data() + ((size_t)(vertical.first[y] - firstSourceRow) * rowFloats);
+					const float* pWeights = &vertical.weights[(size_t)y * vertical.tapCount];
+					float* pLevelRow = chain.level.data() + ((size_t)y * rowFloats);
+
+#ifdef MIP_GENERATOR_SIMD
+					if (path == PATH_AVX2)
+					{
+						FilterColumnsAVX2(pRows, rowFloats, rowFloats, pWeights, vertical.tapCount, pLevelRow);
+						continue;
+					}
+					if (path == PATH_SSE2)
+					{
+						FilterColumnsSSE2(pRows, rowFloats, rowFloats, pWeights, vertical.tapCount, pLevelRow);
+						continue;
+					}
+#endif
+					FilterColumnsScalar(pRows, rowFloats, rowFloats, pWeights, vertical.tapCount, pLevelRow);
+				}
+			});
+
+			// the alpha scale needs the whole level
+			for (size_t i = 0; i < imageCount; i++)
+			{
+				MIP_CHAIN& chain = chains[i];
+
+				chain.alphaScale = 1.0f;
+				if (options.bPreserveAlphaCoverage && (chain.alphaChannel >= 0) && (chain.level.empty() == false))
+				{
+					chain.alphaScale = FindAlphaScale(chain.level, chain.alphaChannel, options.alphaCutoff, chain.coverage);
+				}
+			}
+
+			RunParallel(bands.size(), threadCount, [&](size_t b)
+			{
+				const MIP_BAND& band = bands[b];
+				MIP_CHAIN& chain = chains[band.chain];
+				const uint32_t channels = chain.pImage->colorChannels;
+				unsigned char* pTexels = chain.pImage->texels.data() + chain.levelOffset;
+
+				for (uint32_t y = band.firstRow; y < band.lastRow; y++)
+				{
+					for (uint32_t x = 0; x < chain.levelWidth; x++)
+					{
+						size_t texel = ((size_t)y * chain.levelWidth) + x;
+						const float* pValue = chain.level.data() + (texel * 4);
+
+						for (uint32_t c = 0; c < channels; c++)
+						{
+							if ((int)c == chain.alphaChannel)
+							{
+								pTexels[(texel * channels) + c] = EncodeChannel(pValue[c] * chain.alphaScale, false);
+							}
+							else
+							{
+								pTexels[(texel * channels) + c] = EncodeChannel(pValue[c], options.bSRGB);
+							}
+						}
+					}
+				}
+			});
+
+			// the finished level is the source of the next one
+			for (size_t i = 0; i < imageCount; i++)
+			{
+				MIP_CHAIN& chain = chains[i];
+
+				if ((chain.width <= 1) && (chain.height <= 1))
+				{
+					continue;
+				}
+				chain.levelOffset += (size_t)chain.levelWidth * chain.levelHeight * chain.pImage->colorChannels;
+				chain.source.swap(chain.level);
+				chain.width = chain.levelWidth;
+				chain.height = chain.levelHeight;
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  GetFilterName()
+	 *
+	 *  Name of a filter, for the benchmark output.
+	 ***********************************************************/
+	const char* GetFilterName(MIP_FILTER filter)
+	{
+		switch (filter)
+		{
+		case MIP_FILTER_KAISER:
+			return("Kaiser");
+		case MIP_FILTER_LANCZOS:
+			return("Lanczos");
+		default:
+			return("box");
+		}
+	}
+}
+
+/***********************************************************
+ *  GetDefaultMipOptions()
+ *
+ *  This function is used for getting the options that the
+ *  texture cache and the texture uploads use.
+ ***********************************************************/
+MIP_OPTIONS GetDefaultMipOptions()
+{
+	MIP_OPTIONS options;
+
+	options.filter = MIP_FILTER_KAISER;
+	options.bSRGB = true;
+	options.bPreserveAlphaCoverage = true;
+	options.alphaCutoff = 0.5f;
+
+	return(options);
+}
+
+/***********************************************************
+ *  CountMipLevels()
+ *
+ *  This function is used for counting the mip levels of an
+ *  image, down to 1 x 1.
+ ***********************************************************/
+uint32_t CountMipLevels(uint32_t width, uint32_t height)
+{
+	uint32_t levelCount = 1;
+
+	while ((width > 1) || (height > 1))
+	{
+		width = (width > 1) ? (width / 2) : 1;
+		height = (height > 1) ? (height / 2) : 1;
+		levelCount++;
+	}
+
+	return(levelCount);
+}
+
+/***********************************************************
+ *  GetMipChainBytes()
+ *
+ *  This function is used for adding up the bytes of every
+ *  level of a mip chain.
+ ***********************************************************/
+size_t GetMipChainBytes(uint32_t width, uint32_t height, uint32_t colorChannels)
+{
+	size_t bytes = (size_t)width * height * colorChannels;
+
+	while ((width > 1) || (height > 1))
+	{
+		width = (width > 1) ? (width / 2) : 1;
+		height = (height > 1) ? (height / 2) : 1;
+		bytes += (size_t)width * height * colorChannels;
+	}
+
+	return(bytes);
+}
+
+/***********************************************************
+ *  GenerateMipChains()
+ *
+ *  This function is used for generating the mip chains of
+ *  a set of images with the widest available SIMD
+ *  instructions.
+ ***********************************************************/
+void GenerateMipChains(
+	MIP_IMAGE* images,
+	size_t imageCount,
+	const MIP_OPTIONS& options,
+	unsigned int threadCount)
+{
+	if ((NULL == images) || (imageCount == 0))
+	{
+		return;
+	}
+
+	GenerateChains(images, imageCount, options, threadCount, GetMipPath());
+}
+
+/***********************************************************
+ *  GenerateMipChainsScalar()
+ *
+ *  This function is used for generating the mip chains of
+ *  a set of images without any SIMD instructions.
+ ***********************************************************/
+void GenerateMipChainsScalar(
+	MIP_IMAGE* images,
+	size_t imageCount,
+	const MIP_OPTIONS& options,
+	unsigned int threadCount)
+{
+	if ((NULL == images) || (imageCount == 0))
+	{
+		return;
+	}
+
+	GenerateChains(images, imageCount, options, threadCount, PATH_SCALAR);
+}
+
+/***********************************************************
+ *  GetMipGeneratorPathName()
+ *
+ *  This function is used for getting the name of the
+ *  instruction set that is used for filtering.
+ ***********************************************************/
+const char* GetMipGeneratorPathName()
+{
+	switch (GetMipPath())
+	{
+	case PATH_AVX2:
+		return("AVX2");
+	case PATH_SSE2:
+		return("SSE2");
+	default:
+		return("scalar");
+	}
+}
+
+/***********************************************************
+ *  RunMipGeneratorBenchmark()
+ *
+ *  This function is used for timing every filter on the
+ *  passed in images with the scalar path, the SIMD path on
+ *  one thread and the SIMD path on every core, and checking
+ *  that the SIMD results match the scalar ones.
+ ***********************************************************/
+void RunMipGeneratorBenchmark(MIP_IMAGE* images, size_t imageCount)
+{
+	const MIP_FILTER filters[] = { MIP_FILTER_BOX, MIP_FILTER_KAISER, MIP_FILTER_LANCZOS };
+	const unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<std::vector<unsigned char> > scalarTexels(imageCount);
+	size_t sourceBytes = 0;
+
+	for (size_t i = 0; i < imageCount; i++)
+	{
+		sourceBytes += (size_t)images[i].width * images[i].height * images[i].colorChannels;
+	}
+	std::cout << "INFO: Mip chain benchmark, " << imageCount << " images, "
+		<< (sourceBytes / 1024) << " KB of level 0 texels, "
+		<< GetMipGeneratorPathName() << " path" << std::endl;
+
+	for (size_t f = 0; f < sizeof(filters) / sizeof(filters[0]); f++)
+	{
+		MIP_OPTIONS options = GetDefaultMipOptions();
+		int largestDifference = 0;
+
+		options.filter = filters[f];
+
+		auto start = std::chrono::steady_clock::now();
+		GenerateMipChainsScalar(images, imageCount, options, 1);
+		double scalarTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		for (size_t i = 0; i < imageCount; i++)
+		{
+			scalarTexels[i].swap(images[i].texels);
+		}
+
+		start = std::chrono::steady_clock::now();
+		GenerateMipChains(images, imageCount, options, 1);
+		double simdTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		start = std::chrono::steady_clock::now();
+		GenerateMipChains(images, imageCount, options, threadCount);
+		double threadedTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		for (size_t i = 0; i < imageCount; i++)
+		{
+			const std::vector<unsigned char>& texels = images[i].texels;
+
+			if (texels.size() != scalarTexels[i].size())
+			{
+				largestDifference = 255;
+				continue;
+			}
+			for (size_t t = 0; t < texels.size(); t++)
+			{
+				largestDifference = std::max(largestDifference, abs((int)texels[t] - (int)scalarTexels[i][t]));
+			}
+		}
+
+		std::cout << "INFO: Mip chains (" << GetFilterName(filters[f]) << ", sRGB, alpha coverage)"
+			<< " scalar: " << scalarTime << " ms"
+			<< ", " << GetMipGeneratorPathName() << ": " << simdTime << " ms"
+			<< ", " << GetMipGeneratorPathName() << " on " << threadCount << " threads: " << threadedTime << " ms"
+			<< " (" << ((threadedTime > 0.0) ? (scalarTime / threadedTime) : 1.0) << "x)"
+			<< ", largest difference from scalar: " << largestDifference << std::endl;
+	}
+}
@@ -0,0 +1,96 @@
+///////////////////////////////////////////////////////////////////////////////
+// mipgenerator.h
+// ============
+// generate texture mip chains on the CPU with SIMD filters
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// filter that each mip level is resampled from the one before with
+enum MIP_FILTER
+{
+	// average of the 2 x 2 texels under each texel
+	MIP_FILTER_BOX = 0,
+	// Kaiser windowed sinc, 3 texels wide - sharp, little ringing
+	MIP_FILTER_KAISER,
+	// Lanczos windowed sinc, 3 lobes - sharpest, some ringing
+	MIP_FILTER_LANCZOS
+};
+
+/***********************************************************
+ *  MIP_OPTIONS
+ *
+ *  How a mip chain is generated.  With bSRGB, the color
+ *  channels are decoded from sRGB before they are filtered
+ *  and encoded again after, so that darker texels do not
+ *  win the average.  With bPreserveAlphaCoverage, the alpha
+ *  of every level is scaled so that the same share of
+ *  texels is above alphaCutoff as in the largest level.
+ ***********************************************************/
+struct MIP_OPTIONS
+{
+	MIP_FILTER filter;
+	bool bSRGB;
+	bool bPreserveAlphaCoverage;
+	float alphaCutoff;
+};
+
+/***********************************************************
+ *  MIP_IMAGE
+ *
+ *  An image to generate the mip chain of.  The pixels are
+ *  level 0 with tightly packed rows, and still belong to
+ *  the caller.  The texels are filled with every level,
+ *  largest first, each half the size of the one before,
+ *  rounded down, and at least 1 - level 0 included.
+ ***********************************************************/
+struct MIP_IMAGE
+{
+	const unsigned char* pPixels;
+	uint32_t width;
+	uint32_t height;
+	// 1 to 4 - the last channel of 2 and 4 is alpha
+	uint32_t colorChannels;
+	std::vector<unsigned char> texels;
+};
+
+// default options - Kaiser filter, sRGB averaging and alpha
+// coverage at 0.5
+MIP_OPTIONS GetDefaultMipOptions();
+
+// number of mip levels down to 1 x 1
+uint32_t CountMipLevels(uint32_t width, uint32_t height);
+// bytes of a whole mip chain
+size_t GetMipChainBytes(uint32_t width, uint32_t height, uint32_t colorChannels);
+
+// fill the texels of every image with its mip chain, using the
+// widest instruction set (AVX2, SSE2) that the CPU supports.  Each
+// level is split into bands of rows, and the bands of every image
+// are spread over up to threadCount threads of the job system
+// (0 = all of them).
+void GenerateMipChains(
+	MIP_IMAGE* images,
+	size_t imageCount,
+	const MIP_OPTIONS& options,
+	unsigned int threadCount = 0);
+
+// same as GenerateMipChains() without any SIMD instructions - the
+// results are identical to the SIMD paths
+void GenerateMipChainsScalar(
+	MIP_IMAGE* images,
+	size_t imageCount,
+	const MIP_OPTIONS& options,
+	unsigned int threadCount = 0);
+
+// name of the instruction set used by GenerateMipChains()
+const char* GetMipGeneratorPathName();
+
+// time the scalar path, the SIMD path on one thread and the SIMD
+// path on every core with each filter, and report the largest
+// difference between the paths
+void RunMipGeneratorBenchmark(MIP_IMAGE* images, size_t imageCount);
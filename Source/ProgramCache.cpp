@@ -0,0 +1,501 @@
+///////////////////////////////////////////////////////////////////////////////
+// programcache.cpp
+// ============
+// compile shader programs, or load their linked binaries from a disk cache
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ProgramCache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+#include <vector>
+
+#if defined(_WIN32)
+#include <direct.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+	const uint64_t g_HashBasis = 14695981039346656037ull;
+	const uint64_t g_HashPrime = 1099511628211ull;
+	// directory the program binaries are written to - they are driver
+	// specific, so they are kept out of the shader sources
+	const char* const g_ProgramCacheDirectory = "ShaderCache";
+
+	/***********************************************************
+	 *  HashBytes()
+	 *
+	 *  Add bytes to a 64-bit FNV-1a hash.  A 0 byte is added
+	 *  after them, so that "ab" + "c" and "a" + "bc" differ.
+	 ***********************************************************/
+	uint64_t HashBytes(uint64_t hash, const char* pBytes, size_t byteCount)
+	{
+		for (size_t i = 0; i < byteCount; i++)
+		{
+			hash = (hash ^ (unsigned char)pBytes[i]) * g_HashPrime;
+		}
+
+		return(hash * g_HashPrime);
+	}
+
+	/***********************************************************
+	 *  HashDriver()
+	 *
+	 *  Hash the strings that name the OpenGL driver, which
+	 *  change whenever a binary from it may stop loading.
+	 ***********************************************************/
+	uint64_t HashDriver()
+	{
+		const GLenum names[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+		uint64_t hash = g_HashBasis;
+
+		for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+		{
+			const char* pName = (const char*)glGetString(names[i]);
+
+			if (NULL != pName)
+			{
+				hash = HashBytes(hash, pName, strlen(pName));
+			}
+		}
+
+		return(hash);
+	}
+
+	/***********************************************************
+	 *  DescribeDefines()
+	 *
+	 *  Turn #define lines into a short label for messages, such
+	 *  as " [USE_TEXTURE LIGHT_COUNT 2]", or "" for no defines.
+	 ***********************************************************/
+	std::string DescribeDefines(const char* defines)
+	{
+		std::istringstream lines((NULL != defines) ? defines : "");
+		std::string line;
+		std::string label;
+
+		while (std::getline(lines, line))
+		{
+			if (line.compare(0, 8, "#define ") == 0)
+			{
+				label += (label.empty() ? "" : " ") + line.substr(8);
+			}
+		}
+
+		return(label.empty() ? label : (" [" + label + "]"));
+	}
+
+	/***********************************************************
+	 *  IsBinarySupported()
+	 *
+	 *  Check that the driver can hand out program binaries
+	 *  (OpenGL 4.1) in at least one format.
+	 ***********************************************************/
+	bool IsBinarySupported()
+	{
+		GLint formatCount = 0;
+
+		if ((GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary) == false)
+		{
+			return(false);
+		}
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+
+		return(formatCount > 0);
+	}
+
+	/***********************************************************
+	 *  LoadProgramBinary()
+	 *
+	 *  Create a program from the cache file when its hashes
+	 *  match, returning 0 and the reason when it does not.
+	 ***********************************************************/
+	GLuint LoadProgramBinary(
+		const std::string& cacheName,
+		uint64_t sourceHash,
+		uint64_t driverHash,
+		double& compileMilliseconds,
+		const char*& pReason)
+	{
+		PROGRAM_CACHE_HEADER header;
+		std::vector<char> binary;
+		GLint linkStatus = GL_FALSE;
+		FILE* pFile = fopen(cacheName.c_str(), "rb");
+
+		if (NULL == pFile)
+		{
+			pReason = "no cached binary";
+			return(0);
+		}
+		if ((fread(&header, sizeof(header), 1, pFile) != 1) ||
+			(header.magic != PROGRAM_CACHE_MAGIC) ||
+			(header.version != PROGRAM_CACHE_VERSION))
+		{
+			fclose(pFile);
+			pReason = "cache file is not valid";
+			return(0);
+		}
+		if (header.sourceHash != sourceHash)
+		{
+			fclose(pFile);
+			pReason = "shader source changed";
+			return(0);
+		}
+		if (header.driverHash != driverHash)
+		{
+			fclose(pFile);
+			pReason = "driver changed";
+			return(0);
+		}
+
+		binary.resize(header.binaryBytes);
+		size_t bytesRead = fread(binary.data(), 1, binary.size(), pFile);
+		fclose(pFile);
+		if (bytesRead != binary.size())
+		{
+			pReason = "cache file is not valid";
+			return(0);
+		}
+
+		GLuint programID = glCreateProgram();
+		glProgramBinary(programID, (GLenum)header.binaryFormat, binary.data(), (GLsizei)binary.size());
+		glGetProgramiv(programID, GL_LINK_STATUS, &linkStatus);
+		if (linkStatus != GL_TRUE)
+		{
+			glDeleteProgram(programID);
+			pReason = "driver rejected the binary";
+			return(0);
+		}
+
+		compileMilliseconds = header.compileMilliseconds;
+		return(programID);
+	}
+
+	/***********************************************************
+	 *  SaveProgramBinary()
+	 *
+	 *  Write the binary of a linked program to the cache file.
+	 *  The file is written under a temporary name and then
+	 *  renamed, so that a failed write leaves no half a file.
+	 ***********************************************************/
+	void SaveProgramBinary(
+		const std::string& cacheName,
+		GLuint programID,
+		uint64_t sourceHash,
+		uint64_t driverHash,
+		double compileMilliseconds)
+	{
+		PROGRAM_CACHE_HEADER header;
+		std::vector<char> binary;
+		GLint binaryBytes = 0;
+		GLsizei writtenBytes = 0;
+		GLenum binaryFormat = 0;
+
+		glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &binaryBytes);
+		if (binaryBytes <= 0)
+		{
+			return;
+		}
+		binary.resize((size_t)binaryBytes);
+		glGetProgramBinary(programID, binaryBytes, &writtenBytes, &binaryFormat, binary.data());
+
+		header.magic = PROGRAM_CACHE_MAGIC;
+		header.version = PROGRAM_CACHE_VERSION;
+		header.sourceHash = sourceHash;
+		header.driverHash = driverHash;
+		header.binaryFormat = (uint32_t)binaryFormat;
+		header.binaryBytes = (uint32_t)writtenBytes;
+		header.compileMilliseconds = compileMilliseconds;
+
+		// the directory may already exist, which fopen() finds out
+#if defined(_WIN32)
+		_mkdir(g_ProgramCacheDirectory);
+#else
+		mkdir(g_ProgramCacheDirectory, 0755);
+#endif
+
+		std::string tempName = cacheName + ".tmp";
+		FILE* pFile = fopen(tempName.c_str(), "wb");
+		if (NULL == pFile)
+		{
+			std::cout << "Could not write program cache:" << tempName << std::endl;
+			return;
+		}
+		bool bWritten = (fwrite(&header, sizeof(header), 1, pFile) == 1) &&
+			(fwrite(binary.data(), 1, (size_t)writtenBytes, pFile) == (size_t)writtenBytes);
+		bWritten = (fclose(pFile) == 0) && bWritten;
+
+		// rename() does not replace an existing file on Windows
+		remove(cacheName.c_str());
+		if ((bWritten == false) || (rename(tempName.c_str(), cacheName.c_str()) != 0))
+		{
+			std::cout << "Could not write program cache:" << cacheName << std::endl;
+			remove(tempName.c_str());
+		}
+	}
+}
+
+/***********************************************************
+ *  ReadShaderFile()
+ *
+ *  This function is used for reading the source of a GLSL
+ *  file into a string.
+ ***********************************************************/
+bool ReadShaderFile(const char* filename, std::string& source)
+{
+	std::ifstream file(filename);
+	std::stringstream text;
+
+	if (file.is_open() == false)
+	{
+		std::cout << "Could not read shader file:" << filename << std::endl;
+		return(false);
+	}
+	text << file.rdbuf();
+	source = text.str();
+
+	return(true);
+}
+
+/***********************************************************
+ *  CompileShaderSource()
+ *
+ *  This function is used for compiling GLSL source into a
+ *  new shader.  0 is returned when it does not compile, and
+ *  the compile log is displayed.
+ ***********************************************************/
+GLuint CompileShaderSource(GLenum shaderType, const std::string& source, const char* name)
+{
+	const char* pText = source.c_str();
+	GLint compileStatus = GL_FALSE;
+	GLuint shaderID = glCreateShader(shaderType);
+
+	glShaderSource(shaderID, 1, &pText, NULL);
+	glCompileShader(shaderID);
+	glGetShaderiv(shaderID, GL_COMPILE_STATUS, &compileStatus);
+	if (compileStatus != GL_TRUE)
+	{
+		char log[1024] = { 0 };
+
+		glGetShaderInfoLog(shaderID, sizeof(log), NULL, log);
+		std::cout << "Could not compile shader:" << name << std::endl << log << std::endl;
+		glDeleteShader(shaderID);
+		return(0);
+	}
+
+	return(shaderID);
+}
+
+/***********************************************************
+ *  LinkShaders()
+ *
+ *  This function is used for linking a vertex and fragment
+ *  shader into a program.  The shaders are detached again,
+ *  so that deleting them frees them.
+ ***********************************************************/
+bool LinkShaders(GLuint programID, GLuint vertexShaderID, GLuint fragmentShaderID)
+{
+	GLint linkStatus = GL_FALSE;
+
+	glAttachShader(programID, vertexShaderID);
+	glAttachShader(programID, fragmentShaderID);
+	glLinkProgram(programID);
+	glDetachShader(programID, vertexShaderID);
+	glDetachShader(programID, fragmentShaderID);
+	glGetProgramiv(programID, GL_LINK_STATUS, &linkStatus);
+
+	return(linkStatus == GL_TRUE);
+}
+
+/***********************************************************
+ *  InjectDefines()
+ *
+ *  This function is used for compiling one GLSL file into
+ *  several variants.  The defines must follow the #version
+ *  line, which has to come first, so they are inserted
+ *  after it, followed by a #line directive that numbers the
+ *  next line as it is numbered in the file.
+ ***********************************************************/
+void InjectDefines(std::string& source, const char* defines)
+{
+	size_t insertAt = 0;
+	int nextLine = 1;
+
+	if ((NULL == defines) || (defines[0] == 0))
+	{
+		return;
+	}
+
+	size_t version = source.find("#version");
+	if (version != std::string::npos)
+	{
+		insertAt = source.find('\n', version);
+		insertAt = (insertAt == std::string::npos) ? source.size() : insertAt + 1;
+	}
+	for (size_t i = 0; i < insertAt; i++)
+	{
+		if (source[i] == '\n')
+		{
+			nextLine++;
+		}
+	}
+
+	std::string injected = defines;
+	if (injected.back() != '\n')
+	{
+		injected += '\n';
+	}
+	if ((insertAt > 0) && (source[insertAt - 1] != '\n'))
+	{
+		injected.insert(0, 1, '\n');
+		nextLine++;
+	}
+	injected += "#line " + std::to_string(nextLine) + "\n";
+	source.insert(insertAt, injected);
+}
+
+/***********************************************************
+ *  GetProgramCacheName()
+ *
+ *  This function is used for naming the cache file of a
+ *  shader pair.  The same vertex shader can be linked with
+ *  several fragment shaders, and compiled with several sets
+ *  of defines, so the names and the defines are hashed in.
+ *  Only the file name of the vertex shader is kept, as the
+ *  full path is part of the hash.
+ ***********************************************************/
+std::string GetProgramCacheName(const char* vertexFile, const char* fragmentFile, const char* defines)
+{
+	uint64_t hash = g_HashBasis;
+	char suffix[32];
+
+	hash = HashBytes(hash, vertexFile, strlen(vertexFile));
+	hash = HashBytes(hash, fragmentFile, strlen(fragmentFile));
+	if ((NULL != defines) && (defines[0] != 0))
+	{
+		hash = HashBytes(hash, defines, strlen(defines));
+	}
+	snprintf(suffix, sizeof(suffix), ".%08x.progbin", (unsigned int)(hash ^ (hash >> 32)));
+
+	const char* pBaseName = vertexFile;
+	for (const char* pChar = vertexFile; *pChar != 0; pChar++)
+	{
+		if ((*pChar == '/') || (*pChar == '\\'))
+		{
+			pBaseName = pChar + 1;
+		}
+	}
+
+	return(std::string(g_ProgramCacheDirectory) + "/" + pBaseName + suffix);
+}
+
+/***********************************************************
+ *  LoadCachedProgram()
+ *
+ *  This function is used for creating a shader program from
+ *  its binary cache file, or from source when the cache
+ *  does not match.  The sources are always read and hashed
+ *  with the defines in them, so an edited shader is never
+ *  loaded from a stale binary, nor one variant from the
+ *  binary of another.
+ *  How the program was loaded is displayed, with the time
+ *  it took next to the time a compile from source takes.
+ ***********************************************************/
+GLuint LoadCachedProgram(
+	const char* vertexFile,
+	const char* fragmentFile,
+	const char* defines,
+	PROGRAM_LOAD_INFO* pInfo)
+{
+	std::string vertexSource;
+	std::string fragmentSource;
+	std::string cacheName = GetProgramCacheName(vertexFile, fragmentFile, defines);
+	std::string variantLabel = DescribeDefines(defines);
+	const char* pReason = "program binaries are not supported";
+	double compileMilliseconds = 0.0;
+	GLuint programID = 0;
+	bool bBinarySupported = IsBinarySupported();
+
+	auto loadStart = std::chrono::steady_clock::now();
+	if ((ReadShaderFile(vertexFile, vertexSource) == false) ||
+		(ReadShaderFile(fragmentFile, fragmentSource) == false))
+	{
+		return(0);
+	}
+	InjectDefines(vertexSource, defines);
+	InjectDefines(fragmentSource, defines);
+
+	uint64_t sourceHash = HashBytes(g_HashBasis, vertexSource.data(), vertexSource.size());
+	sourceHash = HashBytes(sourceHash, fragmentSource.data(), fragmentSource.size());
+	uint64_t driverHash = HashDriver();
+
+	if (bBinarySupported)
+	{
+		programID = LoadProgramBinary(cacheName, sourceHash, driverHash, compileMilliseconds, pReason);
+	}
+
+	double loadMilliseconds = 0.0;
+	bool bCacheHit = (programID != 0);
+	if (bCacheHit)
+	{
+		loadMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+		std::cout << "INFO: Shader program " << vertexFile << ", " << fragmentFile << variantLabel
+			<< " loaded from the binary cache in " << loadMilliseconds
+			<< " ms (compiling took " << compileMilliseconds << " ms)" << std::endl;
+	}
+	else
+	{
+		GLuint vertexShaderID = CompileShaderSource(GL_VERTEX_SHADER, vertexSource, vertexFile);
+		GLuint fragmentShaderID = CompileShaderSource(GL_FRAGMENT_SHADER, fragmentSource, fragmentFile);
+
+		if ((vertexShaderID != 0) && (fragmentShaderID != 0))
+		{
+			programID = glCreateProgram();
+			if (bBinarySupported)
+			{
+				glProgramParameteri(programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+			}
+			if (LinkShaders(programID, vertexShaderID, fragmentShaderID) == false)
+			{
+				char log[1024] = { 0 };
+
+				glGetProgramInfoLog(programID, sizeof(log), NULL, log);
+				std::cout << "Could not link shaders:" << vertexFile << ", " << fragmentFile << variantLabel << std::endl << log << std::endl;
+				glDeleteProgram(programID);
+				programID = 0;
+			}
+		}
+		glDeleteShader(vertexShaderID);
+		glDeleteShader(fragmentShaderID);
+		if (programID == 0)
+		{
+			return(0);
+		}
+
+		compileMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+		loadMilliseconds = compileMilliseconds;
+		std::cout << "INFO: Shader program " << vertexFile << ", " << fragmentFile << variantLabel
+			<< " compiled in " << compileMilliseconds << " ms (" << pReason << ")" << std::endl;
+
+		if (bBinarySupported)
+		{
+			SaveProgramBinary(cacheName, programID, sourceHash, driverHash, compileMilliseconds);
+		}
+	}
+
+	if (NULL != pInfo)
+	{
+		pInfo->bCacheHit = bCacheHit;
+		pInfo->loadMilliseconds = loadMilliseconds;
+		pInfo->compileMilliseconds = compileMilliseconds;
+	}
+
+	return(programID);
+}
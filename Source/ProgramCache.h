@@ -0,0 +1,91 @@
+///////////////////////////////////////////////////////////////////////////////
+// programcache.h
+// ============
+// compile shader programs, or load their linked binaries from a disk cache
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <string>
+
+// "PBC1" - the first bytes of a program binary cache file
+const uint32_t PROGRAM_CACHE_MAGIC = 0x31434250u;
+const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+/***********************************************************
+ *  PROGRAM_CACHE_HEADER
+ *
+ *  Start of a program binary cache file, followed by the
+ *  binary that glGetProgramBinary() returned.  The binary
+ *  is only loaded when both hashes match, since a driver
+ *  may reject, or worse misread, a binary from another
+ *  driver version.
+ ***********************************************************/
+struct PROGRAM_CACHE_HEADER
+{
+	uint32_t magic;
+	uint32_t version;
+	// 64-bit FNV-1a hash of the vertex and fragment sources
+	uint64_t sourceHash;
+	// 64-bit FNV-1a hash of GL_VENDOR, GL_RENDERER and GL_VERSION
+	uint64_t driverHash;
+	// format of the binary, as glGetProgramBinary() named it
+	uint32_t binaryFormat;
+	uint32_t binaryBytes;
+	// time it took to compile and link the program from source
+	double compileMilliseconds;
+};
+
+static_assert(sizeof(PROGRAM_CACHE_HEADER) == 40, "program cache header must be packed");
+
+/***********************************************************
+ *  PROGRAM_LOAD_INFO
+ *
+ *  How a program was loaded, and how long that took.
+ ***********************************************************/
+struct PROGRAM_LOAD_INFO
+{
+	// true when the program came from the binary cache
+	bool bCacheHit;
+	double loadMilliseconds;
+	// time to compile from source - measured now on a miss, and
+	// as it was when the binary was cached on a hit
+	double compileMilliseconds;
+};
+
+// read a whole GLSL file - false, and reported, when it cannot be read
+bool ReadShaderFile(const char* filename, std::string& source);
+// compile GLSL source into a new shader - 0, with the compile log
+// displayed under the passed in name, when it does not compile
+GLuint CompileShaderSource(GLenum shaderType, const std::string& source, const char* name);
+// attach the shaders to a program, link it and detach them again -
+// false when the link failed
+bool LinkShaders(GLuint programID, GLuint vertexShaderID, GLuint fragmentShaderID);
+
+// add #define lines to GLSL source, right after its #version line,
+// keeping the line numbers of compile errors those of the file -
+// the source is left as it is when defines is NULL or empty
+void InjectDefines(std::string& source, const char* defines);
+
+// name of the cache file of a vertex and fragment shader pair - in
+// the ShaderCache directory of the working directory, rather than the
+// source tree, with a hash of both file names and of the defines they
+// are compiled with
+std::string GetProgramCacheName(const char* vertexFile, const char* fragmentFile, const char* defines = NULL);
+
+// create a program from a vertex and fragment shader file, compiled
+// with the passed in #define lines, if any.  The linked binary is
+// loaded from the cache file when the sources, the defines and the
+// driver are the same as when it was written; otherwise the program
+// is compiled and linked, and its binary is written to the cache for
+// the next launch.  0 is returned when the program does not compile
+// or link.
+GLuint LoadCachedProgram(
+	const char* vertexFile,
+	const char* fragmentFile,
+	const char* defines = NULL,
+	PROGRAM_LOAD_INFO* pInfo = NULL);
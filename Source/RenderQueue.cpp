@@ -0,0 +1,136 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.cpp
+// ============
+// sort the submitted draws by render state before they are drawn
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderQueue.h"
+
+#include <cstring>
+
+/***********************************************************
+ *  MakeSortKey()
+ *
+ *  This method is used for packing the render state of a
+ *  draw into a 64-bit key.  Values that do not fit in their
+ *  field are clamped.
+ ***********************************************************/
+uint64_t RenderQueue::MakeSortKey(
+	int pass,
+	bool bTransparent,
+	int meshID,
+	int textureSlot,
+	int materialIndex)
+{
+	uint64_t sortKey = 0;
+
+	sortKey |= (uint64_t)(pass & 0xF) << 60;
+	if (bTransparent == true)
+	{
+		// keep transparent draws in submission order
+		sortKey |= (uint64_t)1 << 59;
+		return(sortKey);
+	}
+
+	uint64_t mesh = (uint64_t)(meshID & 0x3F);
+	uint64_t texture = (textureSlot < 0) ? 0 : (uint64_t)(textureSlot + 1);
+	uint64_t material = (materialIndex < 0) ? 0 : (uint64_t)(materialIndex + 1);
+	if (texture > 0x1FF)
+		texture = 0x1FF;
+	if (material > 0xFF)
+		material = 0xFF;
+
+	sortKey |= texture << 50;
+	sortKey |= mesh << 44;
+	sortKey |= material << 36;
+
+	return(sortKey);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all of the submitted
+ *  draws without freeing the storage.
+ ***********************************************************/
+void RenderQueue::Clear()
+{
+	m_keys.clear();
+	m_objects.clear();
+}
+
+/***********************************************************
+ *  Submit()
+ *
+ *  This method is used for adding a draw to the queue.
+ ***********************************************************/
+void RenderQueue::Submit(uint64_t sortKey, uint32_t objectIndex)
+{
+	m_keys.push_back(sortKey);
+	m_objects.push_back(objectIndex);
+}
+
+/***********************************************************
+ *  Sort()
+ *
+ *  This method is used for sorting the submitted draws with
+ *  a stable LSD radix sort, one byte of the key per pass.
+ *  Passes where every key has the same byte are skipped, so
+ *  the unused low bits of the keys cost nothing.
+ ***********************************************************/
+void RenderQueue::Sort()
+{
+	const size_t count = m_keys.size();
+	size_t histogram[8][256];
+
+	if (count < 2)
+	{
+		return;
+	}
+
+	// count every byte of every key in one read of the keys
+	memset(histogram, 0, sizeof(histogram));
+	for (size_t i = 0; i < count; i++)
+	{
+		uint64_t key = m_keys[i];
+		for (int pass = 0; pass < 8; pass++)
+		{
+			histogram[pass][(key >> (pass * 8)) & 0xFF]++;
+		}
+	}
+
+	m_sortedKeys.resize(count);
+	m_sortedObjects.resize(count);
+
+	for (int pass = 0; pass < 8; pass++)
+	{
+		size_t* buckets = histogram[pass];
+		int shift = pass * 8;
+
+		// nothing to do when all of the keys share this byte
+		if (buckets[(m_keys[0] >> shift) & 0xFF] == count)
+		{
+			continue;
+		}
+
+		// turn the counts into starting offsets
+		size_t offset = 0;
+		for (int b = 0; b < 256; b++)
+		{
+			size_t bucketCount = buckets[b];
+			buckets[b] = offset;
+			offset += bucketCount;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			size_t destination = buckets[(m_keys[i] >> shift) & 0xFF]++;
+			m_sortedKeys[destination] = m_keys[i];
+			m_sortedObjects[destination] = m_objects[i];
+		}
+
+		m_keys.swap(m_sortedKeys);
+		m_objects.swap(m_sortedObjects);
+	}
+}
@@ -0,0 +1,71 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.h
+// ============
+// sort the submitted draws by render state before they are drawn
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  RenderQueue
+ *
+ *  This class collects the draws for a frame along with a
+ *  64-bit sort key, and sorts them so that draws sharing the
+ *  same render state end up next to each other.
+ *
+ *  Sort key layout, from the most significant bit:
+ *    63-60  render pass
+ *    59     transparency (transparent draws go last)
+ *    58-50  texture slot + 1 (0 = no texture)
+ *    49-44  mesh ID
+ *    43-36  material index + 1 (0 = no material)
+ *  The texture sits above the mesh because all of the meshes
+ *  share one geometry arena, so a change of mesh is only a
+ *  new indirect draw command, while a change of texture ends
+ *  the multi-draw call.
+ *  Transparent draws only keep the pass and transparency
+ *  fields, so the stable sort leaves them in submission order
+ *  and they still blend in the order they were authored.
+ ***********************************************************/
+class RenderQueue
+{
+public:
+	// render passes, in the order that they are drawn
+	enum RENDER_PASS
+	{
+		PASS_MAIN = 0
+	};
+
+	// build the sort key for a draw with the passed in state
+	static uint64_t MakeSortKey(
+		int pass,
+		bool bTransparent,
+		int meshID,
+		int textureSlot,
+		int materialIndex);
+
+	// remove all of the submitted draws but keep the storage
+	void Clear();
+	// submit a draw of the passed in object for this frame
+	void Submit(uint64_t sortKey, uint32_t objectIndex);
+	// radix sort the submitted draws by their keys
+	void Sort();
+
+	size_t Size() const { return(m_objects.size()); }
+	// object index of a draw - in sorted order after Sort()
+	uint32_t GetObject(size_t index) const { return(m_objects[index]); }
+	// all of the object indices, in the current order
+	const uint32_t* GetObjects() const { return(m_objects.data()); }
+
+private:
+	std::vector<uint64_t> m_keys;
+	std::vector<uint32_t> m_objects;
+	// scratch storage for the radix sort passes
+	std::vector<uint64_t> m_sortedKeys;
+	std::vector<uint32_t> m_sortedObjects;
+};
@@ -8,6 +8,8 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "SceneManager.h"
+#include "ProgramCache.h"
+#include "JobSystem.h"
 
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -16,14 +18,92 @@
 
 #include <glm/gtx/transform.hpp>
 
+#include <chrono>
+#include <random>
+
 // declaration of global variables
 namespace
 {
 	const char* g_ModelName = "model";
 	const char* g_ColorValueName = "objectColor";
 	const char* g_TextureValueName = "objectTexture";
+	const char* g_TextureArrayValueName = "objectTextureArray";
 	const char* g_UseTextureName = "bUseTexture";
 	const char* g_UseLightingName = "bUseLighting";
+	const char* g_UVScaleName = "UVscale";
+
+	// image files of the scene textures and their tags
+	struct SCENE_TEXTURE
+	{
+		const char* filename;
+		const char* tag;
+	};
+	const SCENE_TEXTURE g_SceneTextures[] = {
+		{ "../../Utilities/textures/PencilMaterial.jpg", "pencil" },
+		{ "../../Utilities/textures/PencilMaterial2.jpg", "pencil2" },
+		{ "../../Utilities/textures/TipPencil.jpg", "tip1" },
+		{ "../../Utilities/textures/Painting.jpg", "photo" },
+		{ "../../Utilities/textures/Painting2.png", "photo2" },
+		{ "../../Utilities/textures/drywall1.jpg", "wall" },
+		{ "../../Utilities/textures/NightStand.png", "nightstand" },
+		{ "../../Utilities/textures/plasterWall.jpg", "wall2" },
+		{ "../../Utilities/textures/bookcover.png", "bookcover" },
+		{ "../../Utilities/textures/bookpaper.png", "bookpaper" } };
+	// texture and material tags of the render objects, hashed at
+	// compile time
+	constexpr TAG_NAME g_NightstandTag("nightstand");
+	constexpr TAG_NAME g_Wall2Tag("wall2");
+	constexpr TAG_NAME g_Photo2Tag("photo2");
+	constexpr TAG_NAME g_PencilTag("pencil");
+	constexpr TAG_NAME g_Pencil2Tag("pencil2");
+	constexpr TAG_NAME g_Tip1Tag("tip1");
+	constexpr TAG_NAME g_BookPaperTag("bookpaper");
+	constexpr TAG_NAME g_BookCoverTag("bookcover");
+	constexpr TAG_NAME g_WoodTag("wood");
+	constexpr TAG_NAME g_GlassTag("glass");
+	constexpr TAG_NAME g_PaperbackTag("paperback");
+	// baked texture cache, written by BakeSceneTextures()
+	const char* g_TextureCacheName = "../../Utilities/textures/SceneTextures.txc";
+
+	// most bytes of GPU memory for textures, unless it is changed
+	// with SetTextureBudget()
+	const size_t g_TextureMemoryBudget = 256 * 1024 * 1024;
+	// residency keys of texture arrays have this bit set, the keys
+	// of 2D textures are their texture slots
+	const uint32_t g_ArrayResidencyKey = 0x80000000u;
+
+	// most bytes of texture rows that are uploaded in one frame
+	const size_t g_TextureUploadBudget = 4 * 1024 * 1024;
+
+	// shader files for drawing the basic shapes with instancing
+	const char* g_InstancedVertexShaderName = "Source/shaders/instancedVertexShader.glsl";
+	const char* g_InstancedFragmentShaderName = "Source/shaders/instancedFragmentShader.glsl";
+	// size of the material array in the instanced shader
+	const int g_MaxInstancedMaterials = 16;
+	// instanced variants of each texture mode - unlit, and lit with
+	// 0 to MAX_LIGHT_SOURCES lights
+	const int g_InstancedLightingModes = MAX_LIGHT_SOURCES + 2;
+
+	// object space bounding volumes of the basic meshes, in
+	// MESH_ID order - the round meshes stand on the origin
+	const BOUNDING_VOLUME g_MeshBounds[] =
+	{
+		// plane
+		{ glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 1.0f), 1.41421356f },
+		// box
+		{ glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.5f, 0.5f, 0.5f), 0.8660254f },
+		// cylinder
+		{ glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(1.0f, 0.5f, 1.0f), 1.118034f },
+		// cone
+		{ glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(1.0f, 0.5f, 1.0f), 1.118034f },
+		// tapered cylinder
+		{ glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(1.0f, 0.5f, 1.0f), 1.118034f },
+		// 4-sided pyramid
+		{ glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.5f, 0.5f, 0.5f), 0.8660254f }
+	};
+	// objects whose bounding volumes are moved by one job - fewer
+	// objects are moved on the rendering thread
+	const size_t g_BoundsBlockSize = 1024;
 }
 
 /***********************************************************
@@ -34,7 +114,35 @@ namespace
 SceneManager::SceneManager(ShaderManager *pShaderManager)
 {
 	m_pShaderManager = pShaderManager;
+	m_pUniformRegistry = NULL;
 	m_basicMeshes = new ShapeMeshes();
+	m_loadedTextures = 0;
+	m_placeholderTextureID = 0;
+	m_bTextureArraysBuilt = false;
+	m_spareTextureUnit = 15;
+	m_textureResidency.SetBudget(g_TextureMemoryBudget);
+	m_pInstancedShader = NULL;
+	m_pInstancedRegistry = NULL;
+	m_instancedMeshes = new InstancedMeshes();
+	m_instancedVariants.resize(INSTANCED_TEXTURE_MODES * g_InstancedLightingModes);
+	for (size_t i = 0; i < m_instancedVariants.size(); i++)
+	{
+		m_instancedVariants[i].pShader = NULL;
+		m_instancedVariants[i].pRegistry = NULL;
+		m_instancedVariants[i].bLoadTried = false;
+	}
+	m_bUseLighting = false;
+	m_bLightsChanged = false;
+	m_bSceneNodesDirty = false;
+	m_renderStats.draws = 0;
+	m_renderStats.drawCalls = 0;
+	m_renderStats.visible = 0;
+	m_renderStats.culled = 0;
+	m_renderStats.stateChangesUnsorted = 0;
+	m_renderStats.stateChangesSorted = 0;
+	m_frameStats = m_renderStats;
+	m_bFrustumSet = false;
+	ResetBoundState(m_boundState);
 }
 
 /***********************************************************
@@ -45,8 +153,32 @@ SceneManager::SceneManager(ShaderManager *pShaderManager)
 SceneManager::~SceneManager()
 {
 	m_pShaderManager = NULL;
+	m_pUniformRegistry = NULL;
 	delete m_basicMeshes;
 	m_basicMeshes = NULL;
+	delete m_instancedMeshes;
+	m_instancedMeshes = NULL;
+	for (size_t i = 0; i < m_instancedVariants.size(); i++)
+	{
+		if (NULL != m_instancedVariants[i].pRegistry)
+		{
+			delete m_instancedVariants[i].pRegistry;
+			m_instancedVariants[i].pRegistry = NULL;
+		}
+		if (NULL != m_instancedVariants[i].pShader)
+		{
+			delete m_instancedVariants[i].pShader;
+			m_instancedVariants[i].pShader = NULL;
+		}
+	}
+	m_pInstancedRegistry = NULL;
+	m_pInstancedShader = NULL;
+	DestroyGLTextures();
+	if (m_placeholderTextureID != 0)
+	{
+		glDeleteTextures(1, &m_placeholderTextureID);
+		m_placeholderTextureID = 0;
+	}
 }
 
 /***********************************************************
@@ -55,30 +187,132 @@ SceneManager::~SceneManager()
  *  This method is used for loading textures from image files,
  *  configuring the texture mapping parameters in OpenGL,
  *  generating the mipmaps, and loading the read texture into
- *  the next available texture slot in memory.
+ *  the next available texture slot in memory.  When texture
+ *  streaming is running, the slot is returned right away
+ *  with a placeholder texture, and the image is streamed in
+ *  by UpdateTextureStreaming() over the next frames.
  ***********************************************************/
-bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
+bool SceneManager::CreateGLTexture(const char* filename, const char* tag)
 {
-	int width = 0;
-	int height = 0;
-	int colorChannels = 0;
-	GLuint textureID = 0;
+	DECODED_IMAGE image;
+	bool bReturn = false;
+
+	// every tag names one texture slot
+	if (m_textureTags.Find(tag) >= 0)
+	{
+		std::cout << "Texture tag is already loaded:" << tag << std::endl;
+		return false;
+	}
+
+	// when streaming, the slot shows the placeholder until the
+	// image has been decoded and uploaded over the next frames
+	if (m_textureStreamer.IsCreated() && CreatePlaceholderTexture())
+	{
+		m_textureStreamer.Request(m_loadedTextures, filename);
+		RegisterTexture(m_placeholderTextureID, tag, filename);
+
+		return true;
+	}
 
 	// indicate to always flip images vertically when loaded
 	stbi_set_flip_vertically_on_load(true);
 
 	// try to parse the image data from the specified image file
-	unsigned char* image = stbi_load(
+	image.filename = filename;
+	image.decodeMilliseconds = 0.0;
+	image.pixels = stbi_load(
 		filename,
-		&width,
-		&height,
-		&colorChannels,
+		&image.width,
+		&image.height,
+		&image.colorChannels,
 		0);
 
+	bReturn = UploadGLTexture(image, tag);
+
+	// free the image data from local memory
+	if (NULL != image.pixels)
+	{
+		stbi_image_free(image.pixels);
+	}
+
+	return(bReturn);
+}
+
+/***********************************************************
+ *  UploadGLTexture()
+ *
+ *  This method is used for creating an OpenGL texture from
+ *  an image that was already decoded, so that the decoding
+ *  can happen on other threads.  The texture goes into the
+ *  next available texture slot, and the pixels still belong
+ *  to the caller.  When the mip chain of the image was
+ *  already generated, it is uploaded as it is.
+ ***********************************************************/
+bool SceneManager::UploadGLTexture(const DECODED_IMAGE& image, const char* tag, const MIP_IMAGE* pMipChain)
+{
+	GLuint textureID = 0;
+
+	// every tag names one texture slot
+	if (m_textureTags.Find(tag) >= 0)
+	{
+		std::cout << "Texture tag is already loaded:" << tag << std::endl;
+		return false;
+	}
+
+	textureID = CreateImageTexture(image, pMipChain);
+	if (textureID == 0)
+	{
+		return false;
+	}
+
+	// register the loaded texture and associate it with the special tag
+	RegisterTexture(textureID, tag, image.filename.c_str());
+
+	return true;
+}
+
+/***********************************************************
+ *  CreateImageTexture()
+ *
+ *  This method is used for creating the OpenGL texture of a
+ *  decoded image, with its wrapping and filtering set and
+ *  every mip level uploaded.  The mip chain is generated on
+ *  the CPU (sRGB-correct, keeping the alpha coverage) when
+ *  it is not passed in.  0 is returned when the image was
+ *  not decoded or has a channel count that is not handled.
+ ***********************************************************/
+GLuint SceneManager::CreateImageTexture(const DECODED_IMAGE& image, const MIP_IMAGE* pMipChain)
+{
+	GLuint textureID = 0;
+	MIP_IMAGE mipChain;
+
 	// if the image was successfully read from the image file
-	if (image)
+	if (image.pixels)
 	{
-		std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
+		std::cout << "Successfully loaded image:" << image.filename << ", width:" << image.width << ", height:" << image.height << ", channels:" << image.colorChannels << std::endl;
+
+		// only RGB and RGBA images are handled
+		if ((image.colorChannels != 3) && (image.colorChannels != 4))
+		{
+			std::cout << "Not implemented to handle image with " << image.colorChannels << " channels" << std::endl;
+			return 0;
+		}
+
+		// generate the texture mipmaps for mapping textures to lower resolutions
+		if ((NULL == pMipChain) || pMipChain->texels.empty())
+		{
+			mipChain.pPixels = image.pixels;
+			mipChain.width = (uint32_t)image.width;
+			mipChain.height = (uint32_t)image.height;
+			mipChain.colorChannels = (uint32_t)image.colorChannels;
+			GenerateMipChains(&mipChain, 1, GetDefaultMipOptions());
+			pMipChain = &mipChain;
+		}
+
+		const uint32_t levelCount = CountMipLevels(pMipChain->width, pMipChain->height);
+		const unsigned char* pLevel = pMipChain->texels.data();
+		uint32_t width = pMipChain->width;
+		uint32_t height = pMipChain->height;
 
 		glGenTextures(1, &textureID);
 		glBindTexture(GL_TEXTURE_2D, textureID);
@@ -89,310 +323,1450 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 		// set texture filtering parameters
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)levelCount - 1);
 
-		// if the loaded image is in RGB format
-		if (colorChannels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-		// if the loaded image is in RGBA format - it supports transparency
-		else if (colorChannels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		else
+		// the generated rows are tightly packed, whatever the width
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for (uint32_t level = 0; level < levelCount; level++)
 		{
-			std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
-			return false;
+			// if the loaded image is in RGB format
+			if (image.colorChannels == 3)
+				glTexImage2D(GL_TEXTURE_2D, (GLint)level, GL_RGB8, (GLsizei)width, (GLsizei)height, 0, GL_RGB, GL_UNSIGNED_BYTE, pLevel);
+			// if the loaded image is in RGBA format - it supports transparency
+			else
+				glTexImage2D(GL_TEXTURE_2D, (GLint)level, GL_RGBA8, (GLsizei)width, (GLsizei)height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pLevel);
+
+			pLevel += (size_t)width * height * pMipChain->colorChannels;
+			width = (width > 1) ? (width / 2) : 1;
+			height = (height > 1) ? (height / 2) : 1;
 		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
-		// generate the texture mipmaps for mapping textures to lower resolutions
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		// free the image data from local memory
-		stbi_image_free(image);
 		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
 
-		// register the loaded texture and associate it with the special tag string
-		m_textureIDs[m_loadedTextures].ID = textureID;
-		m_textureIDs[m_loadedTextures].tag = tag;
-		m_loadedTextures++;
-
-		return true;
+		return textureID;
 	}
 
-	std::cout << "Could not load image:" << filename << std::endl;
+	std::cout << "Could not load image:" << image.filename << std::endl;
 
 	// Error loading the image
-	return false;
+	return 0;
 }
 
 /***********************************************************
- *  BindGLTextures()
+ *  UploadCachedTexture()
  *
- *  This method is used for binding the loaded textures to
- *  OpenGL texture memory slots.  There are up to 16 slots.
+ *  This method is used for creating an OpenGL texture from
+ *  an entry of the baked texture cache.  Every mip level is
+ *  uploaded straight from the mapped file, so nothing is
+ *  decoded and glGenerateMipmap() is not needed.  Block
+ *  compressed entries stay compressed on the GPU, when the
+ *  driver supports their format.
  ***********************************************************/
-void SceneManager::BindGLTextures()
+bool SceneManager::UploadCachedTexture(
+	const TextureCache& textureCache,
+	const TEXTURE_CACHE_ENTRY& entry,
+	const char* tag)
 {
-	for (int i = 0; i < m_loadedTextures; i++)
+	GLuint textureID = 0;
+
+	// every tag names one texture slot
+	if (m_textureTags.Find(tag) >= 0)
 	{
-		// bind textures on corresponding texture units
-		glActiveTexture(GL_TEXTURE0 + i);
-		glBindTexture(GL_TEXTURE_2D, m_textureIDs[i].ID);
+		std::cout << "Texture tag is already loaded:" << tag << std::endl;
+		return false;
+	}
+
+	textureID = CreateCachedTexture(textureCache, entry);
+	if (textureID == 0)
+	{
+		return false;
 	}
+
+	// register the loaded texture and associate it with the special tag
+	RegisterTexture(textureID, tag, entry.sourceName);
+
+	return true;
 }
 
 /***********************************************************
- *  DestroyGLTextures()
+ *  CreateCachedTexture()
  *
- *  This method is used for freeing the memory in all the
- *  used texture memory slots.
+ *  This method is used for creating the OpenGL texture of a
+ *  baked texture cache entry, one mip level at a time.  0 is
+ *  returned when the entry is not valid or its compressed
+ *  format is not supported by the driver.
  ***********************************************************/
-void SceneManager::DestroyGLTextures()
+GLuint SceneManager::CreateCachedTexture(
+	const TextureCache& textureCache,
+	const TEXTURE_CACHE_ENTRY& entry)
 {
-	for (int i = 0; i < m_loadedTextures; i++)
+	GLuint textureID = 0;
+
+	if (((entry.colorChannels != 3) && (entry.colorChannels != 4)) || (entry.levelCount == 0))
+	{
+		return 0;
+	}
+
+	GLenum format = (entry.colorChannels == 3) ? GL_RGB : GL_RGBA;
+	GLint internalFormat = (entry.colorChannels == 3) ? GL_RGB8 : GL_RGBA8;
+	bool bCompressed = true;
+
+	switch (entry.format)
+	{
+	case CACHE_FORMAT_BC1:
+		internalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		bCompressed = GLEW_EXT_texture_compression_s3tc;
+		break;
+	case CACHE_FORMAT_BC3:
+		internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		bCompressed = GLEW_EXT_texture_compression_s3tc;
+		break;
+	case CACHE_FORMAT_BC7:
+		internalFormat = GL_COMPRESSED_RGBA_BPTC_UNORM;
+		bCompressed = GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc;
+		break;
+	default:
+		bCompressed = false;
+		break;
+	}
+	if ((entry.format != CACHE_FORMAT_RAW) && (bCompressed == false))
+	{
+		std::cout << "Compressed texture format is not supported:" << entry.sourceName << std::endl;
+		return 0;
+	}
+
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+
+	// set the texture wrapping parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	// set texture filtering parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)entry.levelCount - 1);
+
+	// the baked rows are tightly packed, whatever the width
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (uint32_t level = 0; level < entry.levelCount; level++)
 	{
-		glGenTextures(1, &m_textureIDs[i].ID);
+		uint32_t width = 0;
+		uint32_t height = 0;
+		const unsigned char* pTexels = textureCache.GetLevel(entry, level, width, height);
+
+		if (NULL == pTexels)
+		{
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+			glBindTexture(GL_TEXTURE_2D, 0);
+			glDeleteTextures(1, &textureID);
+			std::cout << "Texture cache entry is not valid:" << entry.sourceName << std::endl;
+			return 0;
+		}
+		if (bCompressed)
+		{
+			glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, (GLenum)internalFormat, (GLsizei)width, (GLsizei)height, 0,
+				(GLsizei)GetCacheLevelBytes(entry, width, height), pTexels);
+		}
+		else
+		{
+			glTexImage2D(GL_TEXTURE_2D, (GLint)level, internalFormat, (GLsizei)width, (GLsizei)height, 0,
+				format, GL_UNSIGNED_BYTE, pTexels);
+		}
 	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	return textureID;
 }
 
 /***********************************************************
- *  FindTextureID()
+ *  BakeSceneTextures()
  *
- *  This method is used for getting an ID for the previously
- *  loaded texture bitmap associated with the passed in tag.
+ *  This method is used for baking the scene textures into
+ *  the texture cache that LoadSceneTextures() reads, block
+ *  compressed when bCompress is true.  It needs no OpenGL
+ *  context, so it can run without a window.
  ***********************************************************/
-int SceneManager::FindTextureID(std::string tag)
+bool SceneManager::BakeSceneTextures(bool bCompress)
 {
-	int textureID = -1;
-	int index = 0;
-	bool bFound = false;
+	const size_t textureCount = sizeof(g_SceneTextures) / sizeof(g_SceneTextures[0]);
+	const char* sourceNames[textureCount];
 
-	while ((index < m_loadedTextures) && (bFound == false))
+	for (size_t i = 0; i < textureCount; i++)
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
-		{
-			textureID = m_textureIDs[index].ID;
-			bFound = true;
-		}
-		else
-			index++;
+		sourceNames[i] = g_SceneTextures[i].filename;
 	}
 
-	return(textureID);
+	return(BakeTextureCache(g_TextureCacheName, sourceNames, textureCount, bCompress));
 }
 
 /***********************************************************
- *  FindTextureSlot()
+ *  BenchmarkMipGeneration()
  *
- *  This method is used for getting a slot index for the previously
- *  loaded texture bitmap associated with the passed in tag.
+ *  This method is used for timing the CPU mip generator on
+ *  the scene textures, and then the whole trip to the GPU
+ *  both ways - uploading level 0 and calling
+ *  glGenerateMipmap(), against generating every level on
+ *  the CPU and uploading them all.  glFinish() is called
+ *  around each, so that the driver work is counted.
  ***********************************************************/
-int SceneManager::FindTextureSlot(std::string tag)
+void SceneManager::BenchmarkMipGeneration()
 {
-	int textureSlot = -1;
-	int index = 0;
-	bool bFound = false;
+	const size_t textureCount = sizeof(g_SceneTextures) / sizeof(g_SceneTextures[0]);
+	TextureDecoder decoder;
+	std::vector<MIP_IMAGE> mipChains;
+	std::vector<GLuint> textureIDs;
 
-	while ((index < m_loadedTextures) && (bFound == false))
+	for (size_t i = 0; i < textureCount; i++)
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
+		decoder.Add(g_SceneTextures[i].filename);
+	}
+	decoder.DecodeAll();
+
+	for (size_t i = 0; i < decoder.Size(); i++)
+	{
+		const DECODED_IMAGE& image = decoder.GetImage(i);
+		MIP_IMAGE mipChain;
+
+		if ((NULL == image.pixels) || ((image.colorChannels != 3) && (image.colorChannels != 4)))
 		{
-			textureSlot = index;
-			bFound = true;
+			std::cout << "Could not load image:" << image.filename << std::endl;
+			continue;
 		}
-		else
-			index++;
+		mipChain.pPixels = image.pixels;
+		mipChain.width = (uint32_t)image.width;
+		mipChain.height = (uint32_t)image.height;
+		mipChain.colorChannels = (uint32_t)image.colorChannels;
+		mipChains.push_back(mipChain);
+	}
+	if (mipChains.empty())
+	{
+		return;
 	}
 
-	return(textureSlot);
+	RunMipGeneratorBenchmark(mipChains.data(), mipChains.size());
+
+	textureIDs.resize(mipChains.size());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	// the driver path - level 0 only, the rest from the driver
+	glFinish();
+	auto start = std::chrono::steady_clock::now();
+	glGenTextures((GLsizei)textureIDs.size(), textureIDs.data());
+	for (size_t i = 0; i < mipChains.size(); i++)
+	{
+		const MIP_IMAGE& mipChain = mipChains[i];
+		GLenum format = (mipChain.colorChannels == 3) ? GL_RGB : GL_RGBA;
+		GLint internalFormat = (mipChain.colorChannels == 3) ? GL_RGB8 : GL_RGBA8;
+
+		glBindTexture(GL_TEXTURE_2D, textureIDs[i]);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, (GLsizei)mipChain.width, (GLsizei)mipChain.height, 0,
+			format, GL_UNSIGNED_BYTE, mipChain.pPixels);
+		glGenerateMipmap(GL_TEXTURE_2D);
+	}
+	glFinish();
+	double driverTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	glDeleteTextures((GLsizei)textureIDs.size(), textureIDs.data());
+
+	// the CPU path - every level generated here and uploaded
+	start = std::chrono::steady_clock::now();
+	GenerateMipChains(mipChains.data(), mipChains.size(), GetDefaultMipOptions());
+	double generateTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	glGenTextures((GLsizei)textureIDs.size(), textureIDs.data());
+	for (size_t i = 0; i < mipChains.size(); i++)
+	{
+		const MIP_IMAGE& mipChain = mipChains[i];
+		GLenum format = (mipChain.colorChannels == 3) ? GL_RGB : GL_RGBA;
+		GLint internalFormat = (mipChain.colorChannels == 3) ? GL_RGB8 : GL_RGBA8;
+		const uint32_t levelCount = CountMipLevels(mipChain.width, mipChain.height);
+		const unsigned char* pLevel = mipChain.texels.data();
+		uint32_t width = mipChain.width;
+		uint32_t height = mipChain.height;
+
+		glBindTexture(GL_TEXTURE_2D, textureIDs[i]);
+		for (uint32_t level = 0; level < levelCount; level++)
+		{
+			glTexImage2D(GL_TEXTURE_2D, (GLint)level, internalFormat, (GLsizei)width, (GLsizei)height, 0,
+				format, GL_UNSIGNED_BYTE, pLevel);
+			pLevel += (size_t)width * height * mipChain.colorChannels;
+			width = (width > 1) ? (width / 2) : 1;
+			height = (height > 1) ? (height / 2) : 1;
+		}
+	}
+	glFinish();
+	double cpuTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	glDeleteTextures((GLsizei)textureIDs.size(), textureIDs.data());
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	std::cout << "INFO: Mip chains of " << mipChains.size() << " textures on the GPU"
+		<< " - glGenerateMipmap(): " << driverTime << " ms"
+		<< ", CPU generator: " << cpuTime << " ms (" << generateTime << " ms generating, "
+		<< (cpuTime - generateTime) << " ms uploading)" << std::endl;
 }
 
 /***********************************************************
- *  FindMaterial()
+ *  BenchmarkJobScaling()
  *
- *  This method is used for getting a material from the previously
- *  defined materials list that is associated with the passed in tag.
+ *  This method is used for timing the work that is spread
+ *  over the job system - decoding the scene textures,
+ *  composing model matrices and culling bounding volumes -
+ *  with the job system restarted for 1 thread, then twice
+ *  as many each time, up to one per CPU core.  The speedup
+ *  is against the single thread, which runs every job
+ *  itself.
  ***********************************************************/
-bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
+void SceneManager::BenchmarkJobScaling()
 {
-	if (m_objectMaterials.size() == 0)
+	const size_t textureCount = sizeof(g_SceneTextures) / sizeof(g_SceneTextures[0]);
+	const size_t objectCount = 1000000;
+	const int repeats = 10;
+	const unsigned int coreCount = std::max(1u, std::thread::hardware_concurrency());
+	JobSystem& jobSystem = GetJobSystem();
+	std::mt19937 generator(330);
+	std::uniform_real_distribution<float> scaleRange(0.1f, 10.0f);
+	std::uniform_real_distribution<float> rotationRange(-360.0f, 360.0f);
+	std::uniform_real_distribution<float> positionRange(-50.0f, 50.0f);
+	std::vector<float> values[9];
+	std::vector<glm::mat4> modelMatrices(objectCount);
+	FrustumCuller frustumCuller;
+	FRUSTUM_PLANES frustum;
+	double baseTimes[3] = { 0.0, 0.0, 0.0 };
+
+	// random transforms, and a bounding volume at each position
+	for (int i = 0; i < 9; i++)
 	{
-		return(false);
+		values[i].resize(objectCount);
 	}
+	frustumCuller.Resize(objectCount);
+	for (size_t i = 0; i < objectCount; i++)
+	{
+		BOUNDING_VOLUME bounds;
 
-	int index = 0;
-	bool bFound = false;
-	while ((index < m_objectMaterials.size()) && (bFound == false))
+		for (int v = 0; v < 3; v++)
+		{
+			values[v][i] = scaleRange(generator);
+			values[v + 3][i] = rotationRange(generator);
+			values[v + 6][i] = positionRange(generator);
+		}
+		bounds.center = glm::vec3(values[6][i], values[7][i], values[8][i]);
+		bounds.extents = glm::vec3(values[0][i], values[1][i], values[2][i]) * 0.5f;
+		bounds.radius = glm::length(bounds.extents);
+		frustumCuller.SetBounds(i, bounds);
+	}
+	TRANSFORM_ARRAYS transforms = {
+		values[0].data(), values[1].data(), values[2].data(),
+		values[3].data(), values[4].data(), values[5].data(),
+		values[6].data(), values[7].data(), values[8].data() };
+	ExtractFrustumPlanes(
+		glm::perspective(glm::radians(80.0f), 1.25f, 0.1f, 100.0f) *
+		glm::lookAt(glm::vec3(0.0f, 5.0f, 12.0f), glm::vec3(0.0f, 4.0f, 10.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
+		frustum);
+
+	std::cout << "INFO: Job system scaling, " << textureCount << " textures decoded, "
+		<< objectCount << " transforms composed and culled " << repeats << " times" << std::endl;
+
+	for (unsigned int threadCount = 1; ; threadCount = std::min(threadCount * 2, coreCount))
 	{
-		if (m_objectMaterials[index].tag.compare(tag) == 0)
+		TextureDecoder decoder;
+		double times[3];
+		size_t visibleCount = 0;
+
+		jobSystem.Start(threadCount - 1);
+
+		for (size_t i = 0; i < textureCount; i++)
 		{
-			bFound = true;
-			material.ambientColor = m_objectMaterials[index].ambientColor;
-			material.ambientStrength = m_objectMaterials[index].ambientStrength;
-			material.diffuseColor = m_objectMaterials[index].diffuseColor;
-			material.specularColor = m_objectMaterials[index].specularColor;
-			material.shininess = m_objectMaterials[index].shininess;
+			decoder.Add(g_SceneTextures[i].filename);
 		}
-		else
+		times[0] = decoder.DecodeAll();
+		decoder.Clear();
+
+		auto start = std::chrono::steady_clock::now();
+		for (int r = 0; r < repeats; r++)
+		{
+			ComposeModelMatricesParallel(transforms, objectCount, modelMatrices.data());
+		}
+		times[1] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		start = std::chrono::steady_clock::now();
+		for (int r = 0; r < repeats; r++)
+		{
+			visibleCount = frustumCuller.Cull(frustum);
+		}
+		times[2] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		if (threadCount == 1)
+		{
+			baseTimes[0] = times[0];
+			baseTimes[1] = times[1];
+			baseTimes[2] = times[2];
+		}
+		std::cout << "INFO:   " << threadCount << " threads - decode: " << times[0]
+			<< " ms (" << baseTimes[0] / times[0] << "x), transforms: " << times[1]
+			<< " ms (" << baseTimes[1] / times[1] << "x), culling: " << times[2]
+			<< " ms (" << baseTimes[2] / times[2] << "x), " << visibleCount << " visible" << std::endl;
+
+		if (threadCount == coreCount)
 		{
-			index++;
+			break;
 		}
 	}
 
-	return(true);
+	// back to the workers the rest of the program runs with
+	jobSystem.Start(std::max(1u, coreCount - 1));
 }
 
 /***********************************************************
- *  SetTransformations()
+ *  BindGLTextures()
  *
- *  This method is used for setting the transform buffer
- *  using the passed in transformation values.
+ *  This method is used for binding the loaded textures to
+ *  OpenGL texture memory slots.  There is one texture unit
+ *  per slot, so slots past the last free unit are not bound
+ *  - once the texture arrays are built, only one unit per
+ *  array is needed instead.
  ***********************************************************/
-void SceneManager::SetTransformations(
-	glm::vec3 scaleXYZ,
-	float XrotationDegrees,
-	float YrotationDegrees,
-	float ZrotationDegrees,
-	glm::vec3 positionXYZ)
+void SceneManager::BindGLTextures()
 {
-	// variables for this method
-	glm::mat4 modelView;
-	glm::mat4 scale;
-	glm::mat4 rotationX;
-	glm::mat4 rotationY;
-	glm::mat4 rotationZ;
-	glm::mat4 translation;
-
-	// set the scale value in the transform buffer
-	scale = glm::scale(scaleXYZ);
-	// set the rotation values in the transform buffer
-	rotationX = glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
-	rotationY = glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
-	rotationZ = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
-	// set the translation value in the transform buffer
-	translation = glm::translate(positionXYZ);
+	if (m_textureArrays.GetArrayCount() > 0)
+	{
+		m_textureArrays.Bind();
+		return;
+	}
 
-	modelView = translation * rotationX * rotationY * rotationZ * scale;
+	if (m_loadedTextures > m_spareTextureUnit)
+	{
+		std::cout << "INFO: Only " << m_spareTextureUnit << " texture units are free, "
+			<< (m_loadedTextures - m_spareTextureUnit) << " textures are not bound" << std::endl;
+	}
 
-	if (NULL != m_pShaderManager)
+	for (int i = 0; (i < m_loadedTextures) && (i < m_spareTextureUnit); i++)
 	{
-		m_pShaderManager->setMat4Value(g_ModelName, modelView);
+		// bind textures on corresponding texture units
+		glActiveTexture(GL_TEXTURE0 + i);
+		glBindTexture(GL_TEXTURE_2D, m_textureIDs[i].ID);
 	}
+	glActiveTexture(GL_TEXTURE0);
 }
 
 /***********************************************************
- *  SetShaderColor()
+ *  CreatePlaceholderTexture()
  *
- *  This method is used for setting the passed in color
- *  into the shader for the next draw command
+ *  This method is used for creating the 1 x 1 grey texture
+ *  that the texture slots use until their images arrive.
  ***********************************************************/
-void SceneManager::SetShaderColor(
-	float redColorValue,
-	float greenColorValue,
-	float blueColorValue,
-	float alphaValue)
+bool SceneManager::CreatePlaceholderTexture()
 {
-	// variables for this method
-	glm::vec4 currentColor;
-
-	currentColor.r = redColorValue;
-	currentColor.g = greenColorValue;
-	currentColor.b = blueColorValue;
-	currentColor.a = alphaValue;
+	const unsigned char greyPixel[4] = { 128, 128, 128, 255 };
 
-	if (NULL != m_pShaderManager)
+	if (m_placeholderTextureID != 0)
 	{
-		m_pShaderManager->setIntValue(g_UseTextureName, false);
-		m_pShaderManager->setVec4Value(g_ColorValueName, currentColor);
+		return(true);
 	}
+
+	glGenTextures(1, &m_placeholderTextureID);
+	glBindTexture(GL_TEXTURE_2D, m_placeholderTextureID);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, greyPixel);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	return(m_placeholderTextureID != 0);
 }
 
 /***********************************************************
- *  SetShaderTexture()
+ *  UpdateTextureStreaming()
  *
- *  This method is used for setting the texture data
- *  associated with the passed in ID into the shader.
+ *  This method is used for streaming the next part of the
+ *  requested textures, and binding every texture that was
+ *  completed in place of the placeholder in its slot.
  ***********************************************************/
-void SceneManager::SetShaderTexture(
-	std::string textureTag)
+void SceneManager::UpdateTextureStreaming()
 {
-	if (NULL != m_pShaderManager)
+	if (m_textureStreamer.IsIdle())
+	{
+		// the instanced shader program switches to texture arrays
+		// once every texture is final
+		if ((NULL != m_pInstancedRegistry) && (m_bTextureArraysBuilt == false))
+		{
+			BuildTextureArrays();
+		}
+		return;
+	}
+
+	m_streamedTextures.clear();
+	if (m_textureStreamer.Update(m_streamedTextures) == 0)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < m_streamedTextures.size(); i++)
 	{
-		m_pShaderManager->setIntValue(g_UseTextureName, true);
+		const STREAMED_TEXTURE& texture = m_streamedTextures[i];
+
+		if (texture.textureID == 0)
+		{
+			if (texture.width == 0)
+			{
+				std::cout << "Could not load image:" << texture.filename << std::endl;
+			}
+			else
+			{
+				std::cout << "Not implemented to handle image with " << texture.colorChannels << " channels" << std::endl;
+			}
+			continue;
+		}
+
+		std::cout << "Successfully loaded image:" << texture.filename << ", width:" << texture.width << ", height:" << texture.height << ", channels:" << texture.colorChannels << std::endl;
+		std::cout << "INFO: Texture " << m_textureTags.GetName(texture.slot)
+			<< " decode: " << texture.decodeMilliseconds << " ms"
+			<< ", upload: " << texture.uploadMilliseconds << " ms"
+			<< ", ready after: " << texture.readyMilliseconds << " ms" << std::endl;
+
+		if ((texture.slot < 0) || (texture.slot >= m_loadedTextures))
+		{
+			glDeleteTextures(1, &texture.textureID);
+			continue;
+		}
+		InstallTexture(texture.slot, texture.textureID);
+	}
 
-		int textureID = -1;
-		textureID = FindTextureSlot(textureTag);
-		m_pShaderManager->setSampler2DValue(g_TextureValueName, textureID);
+	if (m_textureStreamer.IsIdle())
+	{
+		std::cout << "INFO: All " << m_loadedTextures << " textures have streamed in" << std::endl;
 	}
 }
 
 /***********************************************************
- *  SetTextureUVScale()
+ *  RegisterTexture()
  *
- *  This method is used for setting the texture UV scale
- *  values into the shader.
+ *  This method is used for putting a loaded texture into
+ *  the next texture slot.  Tags are interned in load order,
+ *  so the ID of the tag is the slot.
  ***********************************************************/
-void SceneManager::SetTextureUVScale(float u, float v)
+void SceneManager::RegisterTexture(GLuint textureID, const char* tag, const char* filename)
 {
-	if (NULL != m_pShaderManager)
+	TEXTURE_INFO textureInfo;
+
+	textureInfo.ID = textureID;
+	textureInfo.arrayIndex = -1;
+	textureInfo.layer = -1;
+	textureInfo.filename = filename;
+	textureInfo.bEvicted = false;
+	m_textureIDs.push_back(textureInfo);
+	m_textureTags.Intern(tag);
+	// the image file is loaded again in place when it changes
+	m_fileWatcher.Watch(filename);
+
+	// the shared placeholder is not counted against the budget
+	if ((textureID != 0) && (textureID != m_placeholderTextureID))
 	{
-		m_pShaderManager->setVec2Value("UVscale", glm::vec2(u, v));
+		m_textureResidency.Add((uint32_t)m_loadedTextures, GetTextureMemory(GL_TEXTURE_2D, textureID));
 	}
+	m_loadedTextures++;
 }
 
-
 /***********************************************************
- *  LoadSceneTextures()
+ *  InstallTexture()
  *
- *  This method is used for preparing the 3D scene by loading
- *  the shapes, textures in memory to support the 3D scene
- *  rendering
+ *  This method is used for putting a 2D texture that has
+ *  finished loading - streamed in or loaded again after
+ *  being evicted - into its slot, in place of the
+ *  placeholder.  Once the texture arrays are in use, the
+ *  texture is moved into a new array when the streaming
+ *  is idle again.
  ***********************************************************/
-
-void SceneManager::LoadSceneTextures()
+void SceneManager::InstallTexture(int textureSlot, GLuint textureID)
 {
-	bool bReturn = false;
-
-	bReturn = CreateGLTexture(
-		"../../Utilities/textures/PencilMaterial.jpg",
-		"pencil");
+	TEXTURE_INFO& textureInfo = m_textureIDs[textureSlot];
 
-	bReturn = CreateGLTexture(
-		"../../Utilities/textures/PencilMaterial2.jpg",
-		"pencil2");
+	textureInfo.ID = textureID;
+	m_textureResidency.Add((uint32_t)textureSlot, GetTextureMemory(GL_TEXTURE_2D, textureID));
 
-	bReturn = CreateGLTexture(
-		"../../Utilities/textures/TipPencil.jpg",
-		"tip1");
-	bReturn = CreateGLTexture(
-		"../../Utilities/textures/Painting.jpg",
-		"photo");
-
-	bReturn = CreateGLTexture(
-		"../../Utilities/textures/Painting2.png",
-		"photo2");
-
-	bReturn = CreateGLTexture(
-		"../../Utilities/textures/drywall1.jpg",
-		"wall");
+	if (m_textureArrays.GetArrayCount() > 0)
+	{
+		m_bTextureArraysBuilt = false;
+	}
+	else if (textureSlot < m_spareTextureUnit)
+	{
+		glActiveTexture(GL_TEXTURE0 + textureSlot);
+		glBindTexture(GL_TEXTURE_2D, textureID);
+		glActiveTexture(GL_TEXTURE0);
+	}
+}
 
-	bReturn = CreateGLTexture(
-		"../../Utilities/textures/NightStand.png",
-		"nightstand");
+/***********************************************************
+ *  BuildTextureArrays()
+ *
+ *  This method is used for copying every loaded 2D texture
+ *  that is not in a texture array yet into a layer of a new
+ *  array for its size, and then freeing the 2D textures.
+ *  From then on, the instanced shader program selects the
+ *  texture of each instance by its layer, so any number of
+ *  textures of the same size are drawn with one draw call
+ *  and no rebinding.  The sort keys of the render objects
+ *  are rebuilt to keep the objects of one texture array
+ *  next to each other.
+ ***********************************************************/
+bool SceneManager::BuildTextureArrays()
+{
+	std::vector<GLuint> textureIDs(m_textureIDs.size(), 0);
+	std::vector<TEXTURE_LAYER> layers;
+	size_t movedCount = 0;
 
-	bReturn = CreateGLTexture(
-		"../../Utilities/textures/plasterWall.jpg",
-		"wall2");
+	m_bTextureArraysBuilt = true;
 
-	bReturn = CreateGLTexture(
-		"../../Utilities/textures/bookcover.png",
-		"bookcover");
+	auto buildStart = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < m_textureIDs.size(); i++)
+	{
+		if (m_textureIDs[i].arrayIndex < 0)
+		{
+			textureIDs[i] = m_textureIDs[i].ID;
+			if (textureIDs[i] != 0)
+			{
+				movedCount++;
+			}
+		}
+	}
+	if (movedCount == 0)
+	{
+		return(false);
+	}
+	if (m_textureArrays.Build(textureIDs.data(), textureIDs.size(), layers) == false)
+	{
+		std::cout << "Could not build the texture arrays, binding a texture unit per texture" << std::endl;
+		return(false);
+	}
+
+	for (size_t i = 0; i < m_textureIDs.size(); i++)
+	{
+		TEXTURE_INFO& textureInfo = m_textureIDs[i];
+		int arrayIndex = layers[i].arrayIndex;
+
+		if (arrayIndex < 0)
+		{
+			continue;
+		}
+
+		textureInfo.arrayIndex = arrayIndex;
+		textureInfo.layer = layers[i].layer;
+		// the placeholder is still shown by the slots that failed
+		// to load, so it is kept
+		if (textureInfo.ID != m_placeholderTextureID)
+		{
+			glDeleteTextures(1, &textureInfo.ID);
+			m_textureResidency.Remove((uint32_t)i);
+		}
+		textureInfo.ID = 0;
+
+		uint32_t arrayKey = g_ArrayResidencyKey | (uint32_t)arrayIndex;
+		if (m_textureResidency.IsResident(arrayKey) == false)
+		{
+			m_textureResidency.Add(arrayKey,
+				GetTextureMemory(GL_TEXTURE_2D_ARRAY, m_textureArrays.GetArray((size_t)arrayIndex)));
+		}
+	}
 	BindGLTextures();
 
-	bReturn = CreateGLTexture(
-		"../../Utilities/textures/bookpaper.png",
-		"bookpaper");
-	BindGLTextures();
+	for (size_t i = 0; i < m_renderObjects.sortKey.size(); i++)
+	{
+		int textureSlot = m_renderObjects.textureSlot[i];
+		bool bTransparent = (textureSlot < 0) && (m_renderObjects.color[i].a < 1.0f);
+
+		m_renderObjects.sortKey[i] = RenderQueue::MakeSortKey(
+			RenderQueue::PASS_MAIN, bTransparent, m_renderObjects.meshID[i],
+			GetTextureUnit(textureSlot), m_renderObjects.materialIndex[i]);
+	}
+
+	std::cout << "INFO: Moved " << movedCount << " textures into texture arrays in "
+		<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count()
+		<< " ms, texture memory: " << (m_textureResidency.GetResidentBytes() / 1024) << " KB" << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetTextureUnit()
+ *
+ *  This method is used for getting the texture unit that
+ *  has to be sampled to draw the passed in texture slot.
+ ***********************************************************/
+int SceneManager::GetTextureUnit(int textureSlot) const
+{
+	if ((textureSlot < 0) || (textureSlot >= m_loadedTextures))
+	{
+		return(-1);
+	}
+	if (m_textureArrays.GetArrayCount() > 0)
+	{
+		return(m_textureIDs[textureSlot].arrayIndex);
+	}
+
+	return(textureSlot);
+}
+
+/***********************************************************
+ *  MarkTextureUsed()
+ *
+ *  This method is used for marking the 2D texture or the
+ *  texture array of a slot as used in this frame.  When the
+ *  texture was evicted, it is loaded again instead, and the
+ *  slot draws the placeholder (or no texture) until then.
+ ***********************************************************/
+void SceneManager::MarkTextureUsed(int textureSlot)
+{
+	if ((textureSlot < 0) || (textureSlot >= m_loadedTextures))
+	{
+		return;
+	}
+
+	const TEXTURE_INFO& textureInfo = m_textureIDs[textureSlot];
+	if (textureInfo.bEvicted)
+	{
+		ReloadTexture(textureSlot);
+	}
+	else if (textureInfo.arrayIndex >= 0)
+	{
+		m_textureResidency.Touch(g_ArrayResidencyKey | (uint32_t)textureInfo.arrayIndex);
+	}
+	else
+	{
+		m_textureResidency.Touch((uint32_t)textureSlot);
+	}
+}
+
+/***********************************************************
+ *  EnforceTextureBudget()
+ *
+ *  This method is used for starting the texture residency
+ *  frame, and evicting the least recently used textures
+ *  until the texture memory is within the budget again.
+ *  Textures drawn in the last frame are never evicted.
+ ***********************************************************/
+void SceneManager::EnforceTextureBudget()
+{
+	uint32_t residencyKey = 0;
+
+	m_textureResidency.NextFrame();
+	while (m_textureResidency.SelectEviction(residencyKey))
+	{
+		EvictTexture(residencyKey);
+	}
+}
+
+/***********************************************************
+ *  EvictTexture()
+ *
+ *  This method is used for freeing a resident 2D texture,
+ *  whose slot shows the placeholder again, or a whole
+ *  texture array, whose slots draw no texture until they
+ *  are loaded again.
+ ***********************************************************/
+void SceneManager::EvictTexture(uint32_t residencyKey)
+{
+	size_t residentBytes = m_textureResidency.GetResidentBytes();
+
+	m_textureResidency.Remove(residencyKey);
+
+	if ((residencyKey & g_ArrayResidencyKey) != 0)
+	{
+		int arrayIndex = (int)(residencyKey & ~g_ArrayResidencyKey);
+
+		for (int i = 0; i < m_loadedTextures; i++)
+		{
+			TEXTURE_INFO& textureInfo = m_textureIDs[i];
+
+			if (textureInfo.arrayIndex == arrayIndex)
+			{
+				textureInfo.arrayIndex = -1;
+				textureInfo.layer = -1;
+				textureInfo.bEvicted = true;
+			}
+		}
+		m_textureArrays.Release((size_t)arrayIndex);
+
+		std::cout << "INFO: Evicted texture array " << arrayIndex;
+	}
+	else
+	{
+		int textureSlot = (int)residencyKey;
+		TEXTURE_INFO& textureInfo = m_textureIDs[textureSlot];
+
+		if ((textureInfo.ID != 0) && (textureInfo.ID != m_placeholderTextureID))
+		{
+			glDeleteTextures(1, &textureInfo.ID);
+		}
+		textureInfo.ID = m_placeholderTextureID;
+		textureInfo.bEvicted = true;
+		if ((m_textureArrays.GetArrayCount() == 0) && (textureSlot < m_spareTextureUnit))
+		{
+			glActiveTexture(GL_TEXTURE0 + textureSlot);
+			glBindTexture(GL_TEXTURE_2D, m_placeholderTextureID);
+			glActiveTexture(GL_TEXTURE0);
+		}
+
+		std::cout << "INFO: Evicted texture " << m_textureTags.GetName(textureSlot);
+	}
+
+	std::cout << " (" << ((residentBytes - m_textureResidency.GetResidentBytes()) / 1024) << " KB)"
+		<< ", texture memory: " << (m_textureResidency.GetResidentBytes() / 1024)
+		<< " KB of " << (m_textureResidency.GetBudget() / 1024) << " KB" << std::endl;
+}
+
+/***********************************************************
+ *  ReloadTexture()
+ *
+ *  This method is used for loading an evicted texture into
+ *  its slot again.  A texture that is baked in the texture
+ *  cache is uploaded from the mapped file right away; any
+ *  other is streamed in when streaming is running, and
+ *  decoded on this thread when it is not.
+ ***********************************************************/
+void SceneManager::ReloadTexture(int textureSlot)
+{
+	TEXTURE_INFO& textureInfo = m_textureIDs[textureSlot];
+	TextureCache textureCache;
+	GLuint textureID = 0;
+
+	textureInfo.bEvicted = false;
+
+	if (textureCache.Open(g_TextureCacheName))
+	{
+		const TEXTURE_CACHE_ENTRY* pEntry = textureCache.FindValidEntry(textureInfo.filename.c_str());
+
+		if (NULL != pEntry)
+		{
+			textureID = CreateCachedTexture(textureCache, *pEntry);
+		}
+		textureCache.Close();
+	}
+
+	if ((textureID == 0) && m_textureStreamer.IsCreated())
+	{
+		std::cout << "INFO: Reloading texture " << m_textureTags.GetName(textureSlot) << std::endl;
+		m_textureStreamer.Request(textureSlot, textureInfo.filename.c_str());
+		return;
+	}
+
+	if (textureID == 0)
+	{
+		DECODED_IMAGE image;
+
+		image.filename = textureInfo.filename;
+		stbi_set_flip_vertically_on_load(true);
+		DecodeImageFile(image);
+		textureID = CreateImageTexture(image);
+		if (NULL != image.pixels)
+		{
+			stbi_image_free(image.pixels);
+		}
+	}
+
+	if (textureID != 0)
+	{
+		InstallTexture(textureSlot, textureID);
+	}
+}
+
+/***********************************************************
+ *  WatchShaderProgram()
+ *
+ *  This method is used for watching the files of a shader
+ *  program, which is relinked from them when they change.
+ *  The program is the one that the passed in registry is
+ *  attached to, and it is relinked with the same defines.
+ ***********************************************************/
+void SceneManager::WatchShaderProgram(
+	UniformRegistry* pRegistry,
+	const char* vertexFile,
+	const char* fragmentFile,
+	const char* defines)
+{
+	WATCHED_PROGRAM program;
+
+	if ((NULL == pRegistry) || (m_fileWatcher.IsCreated() == false))
+	{
+		return;
+	}
+
+	program.pRegistry = pRegistry;
+	program.vertexFile = vertexFile;
+	program.fragmentFile = fragmentFile;
+	program.defines = (NULL != defines) ? defines : "";
+	program.vertexFileID = m_fileWatcher.Watch(vertexFile);
+	program.fragmentFileID = m_fileWatcher.Watch(fragmentFile);
+	m_watchedPrograms.push_back(program);
+}
+
+/***********************************************************
+ *  UpdateHotReload()
+ *
+ *  This method is used for loading the assets whose files
+ *  changed since the last frame.  Only the changed assets
+ *  are loaded, each into the texture slot or the shader
+ *  program it had, so nothing else in the scene notices.
+ *  A program is relinked once, even when both of its files
+ *  changed.
+ ***********************************************************/
+void SceneManager::UpdateHotReload()
+{
+	std::vector<bool> changedPrograms(m_watchedPrograms.size(), false);
+	bool bTexturesChanged = false;
+
+	m_changedFiles.clear();
+	if (m_fileWatcher.Poll(m_changedFiles) == 0)
+	{
+		return;
+	}
+
+	for (size_t f = 0; f < m_changedFiles.size(); f++)
+	{
+		int fileID = m_changedFiles[f];
+		const std::string& filename = m_fileWatcher.GetFilename(fileID);
+
+		for (int i = 0; i < m_loadedTextures; i++)
+		{
+			if ((m_textureIDs[i].filename == filename) && HotReloadTexture(i))
+			{
+				bTexturesChanged = true;
+			}
+		}
+		for (size_t p = 0; p < m_watchedPrograms.size(); p++)
+		{
+			if ((m_watchedPrograms[p].vertexFileID == fileID) || (m_watchedPrograms[p].fragmentFileID == fileID))
+			{
+				changedPrograms[p] = true;
+			}
+		}
+	}
+
+	for (size_t p = 0; p < m_watchedPrograms.size(); p++)
+	{
+		if (changedPrograms[p])
+		{
+			HotReloadProgram(m_watchedPrograms[p]);
+		}
+	}
+
+	// creating the new textures left other units unbound
+	if (bTexturesChanged)
+	{
+		BindGLTextures();
+	}
+}
+
+/***********************************************************
+ *  HotReloadTexture()
+ *
+ *  This method is used for loading a changed image file into
+ *  its texture slot.  A texture that is in a texture array
+ *  is written into its layer when the new image has the
+ *  same size and format; otherwise it leaves the array and
+ *  gets a 2D texture of its own, which moves into a new
+ *  array like any texture that finished loading.  The old
+ *  texture is kept when the file cannot be decoded, for
+ *  instance while an editor is still writing it.
+ ***********************************************************/
+bool SceneManager::HotReloadTexture(int textureSlot)
+{
+	TEXTURE_INFO& textureInfo = m_textureIDs[textureSlot];
+	DECODED_IMAGE image;
+	MIP_IMAGE mipChain;
+	bool bInPlace = false;
+
+	// an evicted texture is loaded from the new file when it is used,
+	// and one that is still streaming in when it arrives
+	if (textureInfo.bEvicted || (textureInfo.ID == m_placeholderTextureID))
+	{
+		return(false);
+	}
+
+	auto reloadStart = std::chrono::steady_clock::now();
+	image.filename = textureInfo.filename;
+	stbi_set_flip_vertically_on_load(true);
+	if ((DecodeImageFile(image) == false) || (NULL == image.pixels))
+	{
+		std::cout << "Could not load image:" << image.filename << std::endl;
+		return(false);
+	}
+
+	mipChain.pPixels = image.pixels;
+	mipChain.width = (uint32_t)image.width;
+	mipChain.height = (uint32_t)image.height;
+	mipChain.colorChannels = (uint32_t)image.colorChannels;
+	GenerateMipChains(&mipChain, 1, GetDefaultMipOptions());
+
+	if (textureInfo.arrayIndex >= 0)
+	{
+		bInPlace = m_textureArrays.UpdateLayer((size_t)textureInfo.arrayIndex, textureInfo.layer,
+			image.width, image.height, image.colorChannels, mipChain.texels.data());
+	}
+	if (bInPlace == false)
+	{
+		GLuint textureID = CreateImageTexture(image, &mipChain);
+
+		if (textureID == 0)
+		{
+			stbi_image_free(image.pixels);
+			return(false);
+		}
+		if (textureInfo.arrayIndex >= 0)
+		{
+			// the old layer is left unused in its array
+			textureInfo.arrayIndex = -1;
+			textureInfo.layer = -1;
+		}
+		else if ((textureInfo.ID != 0) && (textureInfo.ID != m_placeholderTextureID))
+		{
+			glDeleteTextures(1, &textureInfo.ID);
+		}
+		InstallTexture(textureSlot, textureID);
+	}
+	stbi_image_free(image.pixels);
+
+	std::cout << "INFO: Hot reloaded texture " << m_textureTags.GetName(textureSlot)
+		<< (bInPlace ? " into its array layer" : "") << " in "
+		<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - reloadStart).count()
+		<< " ms" << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  HotReloadProgram()
+ *
+ *  This method is used for relinking a shader program from
+ *  its changed files, keeping its program ID and uniform
+ *  handles.  The uniforms that are not set every frame are
+ *  set again, since linking resets them.  A program whose
+ *  new shaders have errors keeps running as it was.
+ ***********************************************************/
+bool SceneManager::HotReloadProgram(const WATCHED_PROGRAM& program)
+{
+	auto reloadStart = std::chrono::steady_clock::now();
+
+	if (program.pRegistry->RelinkProgram(
+		program.vertexFile.c_str(),
+		program.fragmentFile.c_str(),
+		program.defines.c_str()) == false)
+	{
+		std::cout << "Could not hot reload shaders, keeping the running program:"
+			<< program.vertexFile << ", " << program.fragmentFile << std::endl;
+		m_pShaderManager->use();
+		return(false);
+	}
+
+	for (size_t i = 0; i < m_instancedVariants.size(); i++)
+	{
+		if (m_instancedVariants[i].pRegistry == program.pRegistry)
+		{
+			SetInstancedMaterials(m_instancedVariants[i]);
+		}
+	}
+	if (program.pRegistry == m_pUniformRegistry)
+	{
+		m_pShaderManager->use();
+		SetLightUniforms(m_pShaderManager);
+	}
+	m_pShaderManager->use();
+
+	std::cout << "INFO: Hot reloaded shaders " << program.vertexFile << ", " << program.fragmentFile << " in "
+		<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - reloadStart).count()
+		<< " ms" << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyGLTextures()
+ *
+ *  This method is used for freeing the memory in all the
+ *  used texture memory slots.
+ ***********************************************************/
+void SceneManager::DestroyGLTextures()
+{
+	for (int i = 0; i < m_loadedTextures; i++)
+	{
+		TEXTURE_INFO& textureInfo = m_textureIDs[i];
+
+		// the placeholder is shared, and freed on its own
+		if ((textureInfo.ID != 0) && (textureInfo.ID != m_placeholderTextureID))
+		{
+			glDeleteTextures(1, &textureInfo.ID);
+		}
+		textureInfo.ID = 0;
+		textureInfo.arrayIndex = -1;
+		textureInfo.layer = -1;
+	}
+	m_textureArrays.Destroy();
+	m_textureResidency.Clear();
+}
+
+/***********************************************************
+ *  FindTextureID()
+ *
+ *  This method is used for getting an ID for the previously
+ *  loaded texture bitmap associated with the passed in tag.
+ ***********************************************************/
+int SceneManager::FindTextureID(const char* tag)
+{
+	int textureSlot = FindTextureSlot(tag);
+
+	if ((textureSlot < 0) || (textureSlot >= m_loadedTextures))
+	{
+		return(-1);
+	}
+
+	return(m_textureIDs[textureSlot].ID);
+}
+
+/***********************************************************
+ *  FindTextureSlot()
+ *
+ *  This method is used for getting a slot index for the previously
+ *  loaded texture bitmap associated with the passed in tag.
+ ***********************************************************/
+int SceneManager::FindTextureSlot(const char* tag)
+{
+	return(m_textureTags.Find(tag));
+}
+
+/***********************************************************
+ *  FindMaterial()
+ *
+ *  This method is used for getting a material from the previously
+ *  defined materials list that is associated with the passed in tag.
+ *  False is returned when no material has the tag.
+ ***********************************************************/
+bool SceneManager::FindMaterial(const char* tag, OBJECT_MATERIAL& material)
+{
+	int materialIndex = FindMaterialIndex(tag);
+
+	if (materialIndex < 0)
+	{
+		return(false);
+	}
+
+	material = m_objectMaterials[materialIndex];
+
+	return(true);
+}
+
+/***********************************************************
+ *  FindMaterialIndex()
+ *
+ *  This method is used for getting the index of a previously
+ *  defined material that is associated with the passed in tag.
+ ***********************************************************/
+int SceneManager::FindMaterialIndex(const char* tag)
+{
+	return(m_materialTags.Find(tag));
+}
+
+/***********************************************************
+ *  InternMaterialTags()
+ *
+ *  This method is used for interning the tags of the defined
+ *  materials, so that a tag ID is the index of its material.
+ *  Tags that are used more than once are reported here, when
+ *  the scene is loaded, since only the first one can be found.
+ ***********************************************************/
+void SceneManager::InternMaterialTags()
+{
+	m_materialTags.Clear();
+
+	for (size_t i = 0; i < m_objectMaterials.size(); i++)
+	{
+		const char* tag = m_objectMaterials[i].tag.c_str();
+
+		if (m_materialTags.Find(tag) >= 0)
+		{
+			std::cout << "Material tag is defined more than once:" << tag << std::endl;
+		}
+
+		// duplicates get a placeholder name that keeps the IDs
+		// equal to the material indices
+		if (m_materialTags.Intern(tag) != (int)i)
+		{
+			std::string placeholder = std::string(tag) + "#" + std::to_string(i);
+			m_materialTags.Intern(placeholder.c_str());
+		}
+	}
+}
+
+/***********************************************************
+ *  ResolveShaderUniforms()
+ *
+ *  This method is used for resolving the locations of the
+ *  shader uniforms set for every draw, once, after the
+ *  shaders have been loaded.
+ ***********************************************************/
+void SceneManager::ResolveShaderUniforms(UniformRegistry* pUniformRegistry)
+{
+	m_pUniformRegistry = pUniformRegistry;
+	if (NULL == m_pUniformRegistry)
+	{
+		return;
+	}
+
+	m_pUniformRegistry->Resolve(g_ModelName, m_modelUniform);
+	m_pUniformRegistry->Resolve(g_ColorValueName, m_colorUniform);
+	m_pUniformRegistry->Resolve(g_TextureValueName, m_textureUniform);
+	m_pUniformRegistry->Resolve(g_UseTextureName, m_useTextureUniform);
+	m_pUniformRegistry->Resolve(g_UVScaleName, m_UVScaleUniform);
+	m_pUniformRegistry->Resolve("material.ambientColor", m_materialUniforms.ambientColor);
+	m_pUniformRegistry->Resolve("material.ambientStrength", m_materialUniforms.ambientStrength);
+	m_pUniformRegistry->Resolve("material.diffuseColor", m_materialUniforms.diffuseColor);
+	m_pUniformRegistry->Resolve("material.specularColor", m_materialUniforms.specularColor);
+	m_pUniformRegistry->Resolve("material.shininess", m_materialUniforms.shininess);
+}
+
+/***********************************************************
+ *  ComputeModelMatrix()
+ *
+ *  This method is used for calculating the model matrix
+ *  from the passed in transformation values.
+ ***********************************************************/
+glm::mat4 SceneManager::ComputeModelMatrix(
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	// variables for this method
+	glm::mat4 scale;
+	glm::mat4 rotationX;
+	glm::mat4 rotationY;
+	glm::mat4 rotationZ;
+	glm::mat4 translation;
+
+	// set the scale value in the transform buffer
+	scale = glm::scale(scaleXYZ);
+	// set the rotation values in the transform buffer
+	rotationX = glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
+	rotationY = glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
+	rotationZ = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
+	// set the translation value in the transform buffer
+	translation = glm::translate(positionXYZ);
+
+	return(translation * rotationX * rotationY * rotationZ * scale);
+}
+
+/***********************************************************
+ *  SetTransformations()
+ *
+ *  This method is used for setting the transform buffer
+ *  using the passed in transformation values.
+ ***********************************************************/
+void SceneManager::SetTransformations(
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	// variables for this method
+	glm::mat4 modelView;
+
+	modelView = ComputeModelMatrix(
+		scaleXYZ,
+		XrotationDegrees,
+		YrotationDegrees,
+		ZrotationDegrees,
+		positionXYZ);
+
+	if (NULL != m_pUniformRegistry)
+	{
+		m_pUniformRegistry->Set(m_modelUniform, modelView);
+	}
+}
+
+/***********************************************************
+ *  SetShaderColor()
+ *
+ *  This method is used for setting the passed in color
+ *  into the shader for the next draw command
+ ***********************************************************/
+void SceneManager::SetShaderColor(
+	float redColorValue,
+	float greenColorValue,
+	float blueColorValue,
+	float alphaValue)
+{
+	// variables for this method
+	glm::vec4 currentColor;
+
+	currentColor.r = redColorValue;
+	currentColor.g = greenColorValue;
+	currentColor.b = blueColorValue;
+	currentColor.a = alphaValue;
+
+	if (NULL != m_pUniformRegistry)
+	{
+		m_pUniformRegistry->Set(m_useTextureUniform, false);
+		m_pUniformRegistry->Set(m_colorUniform, currentColor);
+	}
+}
+
+/***********************************************************
+ *  SetShaderTexture()
+ *
+ *  This method is used for setting the texture data
+ *  associated with the passed in ID into the shader.
+ ***********************************************************/
+void SceneManager::SetShaderTexture(
+	const char* textureTag)
+{
+	SetShaderTextureSlot(FindTextureSlot(textureTag));
+}
+
+/***********************************************************
+ *  SetShaderTextureSlot()
+ *
+ *  This method is used for setting the texture data in the
+ *  passed in texture slot into the shader.
+ ***********************************************************/
+void SceneManager::SetShaderTextureSlot(int textureSlot)
+{
+	if (NULL != m_pUniformRegistry)
+	{
+		m_pUniformRegistry->Set(m_useTextureUniform, true);
+		m_pUniformRegistry->Set(m_textureUniform, textureSlot);
+	}
+}
+
+/***********************************************************
+ *  SetTextureUVScale()
+ *
+ *  This method is used for setting the texture UV scale
+ *  values into the shader.
+ ***********************************************************/
+void SceneManager::SetTextureUVScale(float u, float v)
+{
+	if (NULL != m_pUniformRegistry)
+	{
+		m_pUniformRegistry->Set(m_UVScaleUniform, glm::vec2(u, v));
+	}
+}
+
+
+/***********************************************************
+ *  LoadSceneTextures()
+ *
+ *  This method is used for preparing the 3D scene by loading
+ *  the shapes, textures in memory to support the 3D scene
+ *  rendering.  Textures that are in the baked texture cache
+ *  and unchanged since they were baked are uploaded from it
+ *  first.  When texture streaming is running, every other
+ *  texture starts out as the placeholder and streams in
+ *  over the first frames.  Otherwise all of the image files
+ *  are decoded in parallel first, their mip chains are
+ *  generated together on every CPU core, and then they are
+ *  uploaded to OpenGL one at a time on this thread, and the
+ *  time of each step is displayed.
+ ***********************************************************/
+
+void SceneManager::LoadSceneTextures()
+{
+	const size_t textureCount = sizeof(g_SceneTextures) / sizeof(g_SceneTextures[0]);
+	TextureCache textureCache;
+	TextureDecoder decoder;
+	double decodeTotal = 0.0;
+	double uploadTotal = 0.0;
+
+	// textures that are baked and unchanged are uploaded straight
+	// from the mapped cache file, the rest are decoded
+	if (textureCache.Open(g_TextureCacheName))
+	{
+		auto cacheStart = std::chrono::steady_clock::now();
+		size_t cachedCount = 0;
+
+		for (size_t i = 0; i < textureCount; i++)
+		{
+			const TEXTURE_CACHE_ENTRY* pEntry = textureCache.FindValidEntry(g_SceneTextures[i].filename);
+
+			if ((NULL != pEntry) && UploadCachedTexture(textureCache, *pEntry, g_SceneTextures[i].tag))
+			{
+				cachedCount++;
+			}
+		}
+		textureCache.Close();
+
+		std::cout << "INFO: Uploaded " << cachedCount << " textures from the texture cache in "
+			<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cacheStart).count()
+			<< " ms" << std::endl;
+	}
+
+	if (m_textureStreamer.IsCreated())
+	{
+		for (size_t i = 0; i < textureCount; i++)
+		{
+			if (FindTextureSlot(g_SceneTextures[i].tag) < 0)
+			{
+				CreateGLTexture(g_SceneTextures[i].filename, g_SceneTextures[i].tag);
+			}
+		}
+		BindGLTextures();
+		return;
+	}
+
+	std::vector<size_t> decodedTextures;
+	for (size_t i = 0; i < textureCount; i++)
+	{
+		if (FindTextureSlot(g_SceneTextures[i].tag) < 0)
+		{
+			decoder.Add(g_SceneTextures[i].filename);
+			decodedTextures.push_back(i);
+		}
+	}
+	double decodeWallTime = decoder.DecodeAll();
+
+	// the mip chains of every decoded image are generated together,
+	// spread over the CPU cores
+	std::vector<MIP_IMAGE> mipChains(decodedTextures.size());
+	auto mipStart = std::chrono::steady_clock::now();
+	for (size_t d = 0; d < decodedTextures.size(); d++)
+	{
+		const DECODED_IMAGE& image = decoder.GetImage(d);
+
+		mipChains[d].pPixels = image.pixels;
+		mipChains[d].width = (uint32_t)image.width;
+		mipChains[d].height = (uint32_t)image.height;
+		mipChains[d].colorChannels = (uint32_t)image.colorChannels;
+	}
+	GenerateMipChains(mipChains.data(), mipChains.size(), GetDefaultMipOptions());
+	double mipTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mipStart).count();
+
+	for (size_t d = 0; d < decodedTextures.size(); d++)
+	{
+		size_t i = decodedTextures[d];
+		const DECODED_IMAGE& image = decoder.GetImage(d);
+		auto uploadStart = std::chrono::steady_clock::now();
+
+		UploadGLTexture(image, g_SceneTextures[i].tag, &mipChains[d]);
+		double uploadTime = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - uploadStart).count();
+
+		std::cout << "INFO: Texture " << g_SceneTextures[i].tag
+			<< " decode: " << image.decodeMilliseconds << " ms"
+			<< ", upload: " << uploadTime << " ms" << std::endl;
+		decodeTotal += image.decodeMilliseconds;
+		uploadTotal += uploadTime;
+		decoder.Release(d);
+		mipChains[d].texels.clear();
+	}
 
+	// the sum of the decode times is what decoding one file after
+	// another would have taken
+	std::cout << "INFO: Decoded " << decodedTextures.size() << " textures in " << decodeWallTime
+		<< " ms (" << decodeTotal << " ms on one thread, speedup "
+		<< ((decodeWallTime > 0.0) ? (decodeTotal / decodeWallTime) : 1.0)
+		<< "x), generated their mip chains in " << mipTime << " ms (" << GetMipGeneratorPathName()
+		<< "), uploaded in " << uploadTotal << " ms" << std::endl;
 
+	BindGLTextures();
 }
 
 /**************************************************************/
@@ -408,25 +1782,34 @@ void SceneManager::LoadSceneTextures()
  *  
  ***********************************************************/
 void SceneManager::SetShaderMaterial(
-	std::string materialTag)
+	const char* materialTag)
 {
-	if (m_objectMaterials.size() > 0)
-	{
-		OBJECT_MATERIAL material;
-		bool bReturn = false;
+	SetShaderMaterialIndex(FindMaterialIndex(materialTag));
+}
 
-		// find the defined material that matches the tag
-		bReturn = FindMaterial(materialTag, material);
-		if (bReturn == true)
-		{
-			// pass the material properties into the shader
-			m_pShaderManager->setVec3Value("material.ambientColor", material.ambientColor);
-			m_pShaderManager->setFloatValue("material.ambientStrength", material.ambientStrength);
-			m_pShaderManager->setVec3Value("material.diffuseColor", material.diffuseColor);
-			m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
-			m_pShaderManager->setFloatValue("material.shininess", material.shininess);
-		}
+
+/***********************************************************
+ *  SetShaderMaterialIndex()
+ *
+ *  This method is used for passing the material at the
+ *  passed in index of the defined materials into the shader.
+ ***********************************************************/
+void SceneManager::SetShaderMaterialIndex(int materialIndex)
+{
+	if ((materialIndex < 0) || ((size_t)materialIndex >= m_objectMaterials.size()) ||
+		(NULL == m_pUniformRegistry))
+	{
+		return;
 	}
+
+	const OBJECT_MATERIAL& material = m_objectMaterials[materialIndex];
+
+	// pass the material properties into the shader
+	m_pUniformRegistry->Set(m_materialUniforms.ambientColor, material.ambientColor);
+	m_pUniformRegistry->Set(m_materialUniforms.ambientStrength, material.ambientStrength);
+	m_pUniformRegistry->Set(m_materialUniforms.diffuseColor, material.diffuseColor);
+	m_pUniformRegistry->Set(m_materialUniforms.specularColor, material.specularColor);
+	m_pUniformRegistry->Set(m_materialUniforms.shininess, material.shininess);
 }
 
 
@@ -477,23 +1860,116 @@ void SceneManager::DefineObjectMaterials()
  ***********************************************************/
 void SceneManager::SetupSceneLights() 
 {
-	m_pShaderManager->setVec3Value("lightSources[0].position", 8.0, 15.0, 10.0); //repositioned to be more centered in the middle of the objects from above
-	m_pShaderManager->setVec3Value("lightSources[0].ambientColor", 0.09f, 0.1f, 0.7f);
-	m_pShaderManager->setVec3Value("lightSources[0].diffuseColor", 1.28f, 0.2f, 2.9f);
-	m_pShaderManager->setVec3Value("lightSources[0].specularColor", 1.0f, 0.5f, 1.9f);
-	m_pShaderManager->setFloatValue("lightSources[0].focalStrength", 2.9); //make the strength a little more prominate
-	m_pShaderManager->setFloatValue("lightSources[0].specularIntensity", 40.0f); //more intensity 
+	m_lightSources.clear();
+
+	AddLightSource(
+		glm::vec3(15.0f, 20.0f, 1.0f), //repositioned to be more centered in the middle of the objects from above
+		glm::vec3(0.056f, 0.16f, 0.94f),
+		glm::vec3(0.55f, 0.2f, 0.85f),
+		glm::vec3(1.0f, 0.5f, 1.9f),
+		0.5f, //make the strength a little more prominate
+		30.0f); //more intensity 
+
+	m_bUseLighting = true;
+
+	// the main shader program takes the lights as loose uniforms,
+	// the programs with the light block read them from the buffer
+	SetLightUniforms(m_pShaderManager);
+	m_bLightsChanged = true;
+}
+
+/***********************************************************
+ *  AddLightSource()
+ *
+ *  This method is used for adding a light source to the
+ *  3D scene, up to the maximum the shaders support.
+ ***********************************************************/
+void SceneManager::AddLightSource(
+	glm::vec3 position,
+	glm::vec3 ambientColor,
+	glm::vec3 diffuseColor,
+	glm::vec3 specularColor,
+	float focalStrength,
+	float specularIntensity)
+{
+	LIGHT_SOURCE light;
+
+	if (m_lightSources.size() >= MAX_LIGHT_SOURCES)
+	{
+		std::cout << "Could not add light source, " << MAX_LIGHT_SOURCES << " lights max" << std::endl;
+		return;
+	}
+
+	light.position = position;
+	light.ambientColor = ambientColor;
+	light.diffuseColor = diffuseColor;
+	light.specularColor = specularColor;
+	light.focalStrength = focalStrength;
+	light.specularIntensity = specularIntensity;
+	m_lightSources.push_back(light);
+	m_bLightsChanged = true;
+}
+
+/***********************************************************
+ *  SetLightUniforms()
+ *
+ *  This method is used for setting the light sources into
+ *  the loose light uniforms of the passed in shader program,
+ *  which must be in use.
+ ***********************************************************/
+void SceneManager::SetLightUniforms(ShaderManager* pShaderManager)
+{
+	for (size_t i = 0; i < m_lightSources.size(); i++)
+	{
+		const LIGHT_SOURCE& light = m_lightSources[i];
+		std::string name = "lightSources[" + std::to_string(i) + "].";
+
+		pShaderManager->setVec3Value(name + "position", light.position);
+		pShaderManager->setVec3Value(name + "ambientColor", light.ambientColor);
+		pShaderManager->setVec3Value(name + "diffuseColor", light.diffuseColor);
+		pShaderManager->setVec3Value(name + "specularColor", light.specularColor);
+		pShaderManager->setFloatValue(name + "focalStrength", light.focalStrength);
+		pShaderManager->setFloatValue(name + "specularIntensity", light.specularIntensity);
+	}
+
+	pShaderManager->setBoolValue(g_UseLightingName, m_bUseLighting);
+}
+
+/***********************************************************
+ *  UpdateLightBlock()
+ *
+ *  This method is used for writing all of the light sources
+ *  into the light uniform block with one buffer write, only
+ *  when they have changed.
+ ***********************************************************/
+void SceneManager::UpdateLightBlock()
+{
+	LIGHT_BLOCK lightBlock;
 
-	m_pShaderManager->setVec3Value("lightSources[0].position", 15.0, 20.0, 1.0); //repositioned to be more centered in the middle of the objects from above
-	m_pShaderManager->setVec3Value("lightSources[0].ambientColor", 0.056f, 0.16f, 0.94f);
-	m_pShaderManager->setVec3Value("lightSources[0].diffuseColor", 0.55f, 0.2f, 0.85f);
-	m_pShaderManager->setVec3Value("lightSources[0].specularColor", 1.0f, 0.5f, 1.9f);
-	m_pShaderManager->setFloatValue("lightSources[0].focalStrength", 0.5); //make the strength a little more prominate
-	m_pShaderManager->setFloatValue("lightSources[0].specularIntensity", 30.0f); //more intensity 
+	if ((m_bLightsChanged == false) || (m_lightBlock.IsCreated() == false))
+	{
+		return;
+	}
 
-	m_pShaderManager->setBoolValue("bUseLighting", true);
+	for (size_t i = 0; i < MAX_LIGHT_SOURCES; i++)
+	{
+		// unused lights are black, so they add nothing
+		LIGHT_SOURCE light = { glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f), 0.0f, 0.0f };
+		if (i < m_lightSources.size())
+		{
+			light = m_lightSources[i];
+		}
 
+		lightBlock.lightSources[i].position = glm::vec4(light.position, 1.0f);
+		lightBlock.lightSources[i].ambientColor = glm::vec4(light.ambientColor, 0.0f);
+		lightBlock.lightSources[i].diffuseColor = glm::vec4(light.diffuseColor, 0.0f);
+		lightBlock.lightSources[i].specularColor = glm::vec4(light.specularColor, 0.0f);
+		lightBlock.lightSources[i].params = glm::vec4(light.focalStrength, light.specularIntensity, 0.0f, 0.0f);
+	}
+	lightBlock.lightInfo = glm::ivec4((int)m_lightSources.size(), m_bUseLighting ? 1 : 0, 0, 0);
 
+	m_lightBlock.Update(&lightBlock, sizeof(lightBlock));
+	m_bLightsChanged = false;
 }
 
 
@@ -506,9 +1982,24 @@ void SceneManager::SetupSceneLights()
  ***********************************************************/
 void SceneManager::PrepareScene()
 {
+	GLint textureUnits = 0;
+
+	// the last texture unit is kept free for the sampler that
+	// the instanced shader program is not reading
+	glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &textureUnits);
+	if (textureUnits > 1)
+	{
+		m_spareTextureUnit = textureUnits - 1;
+	}
+
+	m_textureStreamer.Create(g_TextureUploadBudget);
+	m_fileWatcher.Create();
 	LoadSceneTextures();
 	DefineObjectMaterials();
+	InternMaterialTags();
+	LoadInstancedShaders();
 	SetupSceneLights();
+	PrepareInstancedVariants();
 
 
 	// only one instance of a particular mesh needs to be
@@ -521,565 +2012,1079 @@ void SceneManager::PrepareScene()
 	m_basicMeshes->LoadTaperedCylinderMesh();
 	m_basicMeshes->LoadBoxMesh();
 	m_basicMeshes->LoadPyramid4Mesh();
-	
-	
+
+	if (NULL != m_pInstancedShader)
+	{
+		m_instancedMeshes->LoadPlaneMesh();
+		m_instancedMeshes->LoadCylinderMesh();
+		m_instancedMeshes->LoadConeMesh();
+		m_instancedMeshes->LoadTaperedCylinderMesh();
+		m_instancedMeshes->LoadBoxMesh();
+		m_instancedMeshes->LoadPyramid4Mesh();
+	}
+
+	// the render table is filled once, after the textures and
+	// materials that it refers to have been defined
+	DefineRenderObjects();
 }
 
 /***********************************************************
- *  RenderScene()
+ *  AddSceneNode()
  *
- *  This method is used for rendering the 3D scene by 
- *  transforming and drawing the basic 3D shapes
+ *  This method is used for adding a node to the scene
+ *  hierarchy.  The transformation values are relative to
+ *  the parent node, or to the world when the parent is -1.
  ***********************************************************/
-void SceneManager::RenderScene()
+int SceneManager::AddSceneNode(
+	int parent,
+	glm::vec3 scaleXYZ,
+	glm::vec3 rotationDegrees,
+	glm::vec3 positionXYZ)
 {
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.						***/
-	/******************************************************************/
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(20.0f, 1.0f, 10.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 0.0f, 0.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	SCENE_NODE node;
 
-	SetShaderColor(0.65, 0.50, 0.39, 1);
-	SetShaderTexture("nightstand");
-	SetTextureUVScale(1.0, 1.0);
-	SetShaderMaterial("wood");
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawPlaneMesh();
-	/****************************************************************/
-
-		// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(25.0f, 1.0f, 30.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 90.0f;
-	ZrotationDegrees = 90.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 0.0f, -7.5f);
+	// a parent must already exist so that parents are always
+	// updated before their children
+	if (parent >= (int)m_sceneNodes.size())
+	{
+		std::cout << "Scene node is using an unknown parent:" << parent << std::endl;
+		parent = -1;
+	}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	node.parent = parent;
+	node.scaleXYZ = scaleXYZ;
+	node.rotationDegrees = rotationDegrees;
+	node.positionXYZ = positionXYZ;
+	node.bDirty = true;
+	node.bWorldChanged = false;
 
-	SetShaderColor(0.831, 0.871, 0.933, 1.0);
-	SetShaderTexture("wall2");
-	SetTextureUVScale(1.0, 1.0);
+	m_sceneNodes.push_back(node);
+	m_bSceneNodesDirty = true;
 
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawPlaneMesh();
-	/****************************************************************/
+	return((int)m_sceneNodes.size() - 1);
+}
 
 /***********************************************************
+ *  SetSceneNodeTransform()
  *
- *
- *          Plane for Photo on wall
- *
- *
+ *  This method is used for changing the local transformation
+ *  values of a scene node.  The node and its children are
+ *  recalculated on the next update.
  ***********************************************************/
+void SceneManager::SetSceneNodeTransform(
+	int node,
+	glm::vec3 scaleXYZ,
+	glm::vec3 rotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	if ((node < 0) || (node >= (int)m_sceneNodes.size()))
+	{
+		return;
+	}
 
- // set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(6.0f, 5.0f, 5.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 90.0f;
-	ZrotationDegrees = 90.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(1.5f, 6.8f, -7.4f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	SetShaderColor(1, 1, 1, 0.0);
-	SetShaderTexture("photo2");
-	SetTextureUVScale(1.0, 1.0);
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawPlaneMesh();
-	/****************************************************************/
-
-
-
+	m_sceneNodes[node].scaleXYZ = scaleXYZ;
+	m_sceneNodes[node].rotationDegrees = rotationDegrees;
+	m_sceneNodes[node].positionXYZ = positionXYZ;
+	m_sceneNodes[node].bDirty = true;
+	m_bSceneNodesDirty = true;
+}
 
 /***********************************************************
+ *  UpdateSceneNodes()
  *
- *
- *          PENCIL OBJECT (1)
- *
- *
+ *  This method is used for recalculating the cached matrices
+ *  of the scene nodes that changed, along with their children.
+ *  When nothing changed, no matrix math is done at all.
  ***********************************************************/
+bool SceneManager::UpdateSceneNodes()
+{
+	if (m_bSceneNodesDirty == false)
+	{
+		return(false);
+	}
 
- // set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(0.2f, 5.0f, 0.2f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 35.0f;
-	ZrotationDegrees = 90.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 0.2f, .0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-
-
-	// set the color for the mesh
-	SetShaderColor(0.984, 0.769, 0.376, 1);
-	SetShaderTexture("pencil");
-	SetTextureUVScale(1.0, 1.0);
-	SetShaderMaterial("wood");
-
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawCylinderMesh();
-
-	/****************************************************************/
+	// gather the local transforms of the changed nodes so that
+	// their matrices are composed together in one SIMD batch
+	m_transformBatch.Clear();
+	for (size_t i = 0; i < m_sceneNodes.size(); i++)
+	{
+		if (m_sceneNodes[i].bDirty == true)
+		{
+			m_transformBatch.Add(
+				m_sceneNodes[i].scaleXYZ,
+				m_sceneNodes[i].rotationDegrees,
+				m_sceneNodes[i].positionXYZ);
+		}
+	}
+	m_transformBatch.Compose();
 
-	//Tip of the pencil
+	size_t batchIndex = 0;
+	for (size_t i = 0; i < m_sceneNodes.size(); i++)
+	{
+		SCENE_NODE& node = m_sceneNodes[i];
+		bool bParentChanged = false;
 
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(0.2f, 0.45f, 0.2f);
+		if (node.parent >= 0)
+		{
+			bParentChanged = m_sceneNodes[node.parent].bWorldChanged;
+		}
 
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 35.0f;
-	ZrotationDegrees = -90.0f;
+		if (node.bDirty == true)
+		{
+			node.localMatrix = m_transformBatch.GetModelMatrix(batchIndex);
+			batchIndex++;
+		}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 0.2f, 0.0f);
+		node.bWorldChanged = node.bDirty || bParentChanged;
+		if (node.bWorldChanged == true)
+		{
+			if (node.parent >= 0)
+				node.worldMatrix = m_sceneNodes[node.parent].worldMatrix * node.localMatrix;
+			else
+				node.worldMatrix = node.localMatrix;
+		}
+		node.bDirty = false;
+	}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	m_bSceneNodesDirty = false;
 
-	// set the color for the mesh
-	SetShaderColor(0.92, .78, 0.62, 1);
-	SetShaderColor(0.92, .78, 0.62, 1);
-	SetShaderTexture("tip1");
-	SetTextureUVScale(1.0, 1.0);
+	return(true);
+}
 
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawTaperedCylinderMesh();
+/***********************************************************
+ *  UpdateObjectBounds()
+ *
+ *  This method is used for moving the bounding volume of
+ *  each object whose scene node changed in the last update
+ *  into world space.  Objects that are new to the render
+ *  table are always moved.  Each object writes only its own
+ *  volume, so large tables are moved in blocks on the job
+ *  system.
+ ***********************************************************/
+void SceneManager::UpdateObjectBounds()
+{
+	const size_t objectCount = m_renderObjects.meshID.size();
+	const size_t firstNew = m_frustumCuller.Size();
 
-	/****************************************************************/
+	m_frustumCuller.Resize(objectCount);
+	GetJobSystem().ParallelFor(objectCount, g_BoundsBlockSize, [&](size_t first, size_t last)
+	{
+		for (size_t i = first; i < last; i++)
+		{
+			const SCENE_NODE& node = m_sceneNodes[m_renderObjects.sceneNode[i]];
 
-	//Eraser of the pencil
+			if ((node.bWorldChanged == true) || (i >= firstNew))
+			{
+				m_frustumCuller.SetBounds(i, TransformBoundingVolume(
+					g_MeshBounds[m_renderObjects.meshID[i]], node.worldMatrix));
+			}
+		}
+	});
+}
 
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(0.2f, 0.4f, 0.2f);
+/***********************************************************
+ *  SetViewProjection()
+ *
+ *  This method is used for setting the view-projection matrix
+ *  of the camera, whose frustum the objects are culled with.
+ ***********************************************************/
+void SceneManager::SetViewProjection(const glm::mat4& viewProjection)
+{
+	ExtractFrustumPlanes(viewProjection, m_frustumPlanes);
+	m_bFrustumSet = true;
+}
 
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 35.0f;
-	ZrotationDegrees = 90.0f;
+/***********************************************************
+ *  AddRenderObject()
+ *
+ *  This method is used for adding an object to the render
+ *  table.  The texture and material tags are resolved here,
+ *  once, by their compile time hashes, so that rendering
+ *  never has to search for them.  A NULL texture tag draws
+ *  the object with its color.
+ *  The object gets its own scene node under the passed in
+ *  parent node (-1 places it directly in the world).
+ ***********************************************************/
+int SceneManager::AddRenderObject(
+	MESH_ID meshID,
+	int parentNode,
+	glm::vec3 scaleXYZ,
+	glm::vec3 rotationDegrees,
+	glm::vec3 positionXYZ,
+	glm::vec4 color,
+	const TAG_NAME* pTextureTag,
+	const TAG_NAME* pMaterialTag)
+{
+	int textureSlot = -1;
+	int materialIndex = -1;
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-4.045f, 0.2f, 2.83);
+	if (NULL != pTextureTag)
+	{
+		textureSlot = m_textureTags.Find(pTextureTag->hash);
+		if (textureSlot < 0)
+		{
+			std::cout << "Render object is using an unknown texture:" << pTextureTag->name << std::endl;
+		}
+	}
+	if (NULL != pMaterialTag)
+	{
+		materialIndex = m_materialTags.Find(pMaterialTag->hash);
+		if (materialIndex < 0)
+		{
+			std::cout << "Render object is using an unknown material:" << pMaterialTag->name << std::endl;
+		}
+	}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	m_renderObjects.meshID.push_back(meshID);
+	m_renderObjects.sceneNode.push_back(
+		AddSceneNode(parentNode, scaleXYZ, rotationDegrees, positionXYZ));
+	m_renderObjects.color.push_back(color);
+	m_renderObjects.textureSlot.push_back(textureSlot);
+	m_renderObjects.UVscale.push_back(glm::vec2(1.0f, 1.0f));
+	m_renderObjects.materialIndex.push_back(materialIndex);
+
+	// only untextured colors can be see-through, and those are
+	// drawn after everything else so that they blend correctly
+	bool bTransparent = (textureSlot < 0) && (color.a < 1.0f);
+	m_renderObjects.sortKey.push_back(RenderQueue::MakeSortKey(
+		RenderQueue::PASS_MAIN, bTransparent, meshID, textureSlot, materialIndex));
+
+	// return the index of the new object in the render table
+	return((int)m_renderObjects.meshID.size() - 1);
+}
 
-	// set the color for the mesh
-	SetShaderColor(0.99, 0.65, 0.59, 1);
+/***********************************************************
+ *  DrawMesh()
+ *
+ *  This method is used for drawing the basic mesh that is
+ *  associated with the passed in mesh ID.
+ ***********************************************************/
+void SceneManager::DrawMesh(int meshID)
+{
+	switch (meshID)
+	{
+	case MESH_PLANE:
+		m_basicMeshes->DrawPlaneMesh();
+		break;
+	case MESH_BOX:
+		m_basicMeshes->DrawBoxMesh();
+		break;
+	case MESH_CYLINDER:
+		m_basicMeshes->DrawCylinderMesh();
+		break;
+	case MESH_CONE:
+		m_basicMeshes->DrawConeMesh();
+		break;
+	case MESH_TAPERED_CYLINDER:
+		m_basicMeshes->DrawTaperedCylinderMesh();
+		break;
+	case MESH_PYRAMID4:
+		m_basicMeshes->DrawPyramid4Mesh();
+		break;
+	}
+}
 
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawCylinderMesh();
+/***********************************************************
+ *  DrawMeshInstanced()
+ *
+ *  This method is used for drawing count instances of the
+ *  basic mesh that is associated with the passed in mesh ID,
+ *  starting at the passed in instance of the instance buffer.
+ ***********************************************************/
+void SceneManager::DrawMeshInstanced(int meshID, size_t firstInstance, size_t count)
+{
+	switch (meshID)
+	{
+	case MESH_PLANE:
+		m_instancedMeshes->DrawPlaneMeshInstanced(firstInstance, count);
+		break;
+	case MESH_BOX:
+		m_instancedMeshes->DrawBoxMeshInstanced(firstInstance, count);
+		break;
+	case MESH_CYLINDER:
+		m_instancedMeshes->DrawCylinderMeshInstanced(firstInstance, count);
+		break;
+	case MESH_CONE:
+		m_instancedMeshes->DrawConeMeshInstanced(firstInstance, count);
+		break;
+	case MESH_TAPERED_CYLINDER:
+		m_instancedMeshes->DrawTaperedCylinderMeshInstanced(firstInstance, count);
+		break;
+	case MESH_PYRAMID4:
+		m_instancedMeshes->DrawPyramid4MeshInstanced(firstInstance, count);
+		break;
+	}
+}
 
-	/****************************************************************/
+/***********************************************************
+ *  AddMeshDrawCommand()
+ *
+ *  This method is used for adding an indirect draw command
+ *  for count instances of the basic mesh that is associated
+ *  with the passed in mesh ID.
+ ***********************************************************/
+bool SceneManager::AddMeshDrawCommand(int meshID, size_t firstInstance, size_t count)
+{
+	InstancedMeshes::SHAPE shape;
 
-	//cone mesh for the Lead of the pencil 
+	switch (meshID)
+	{
+	case MESH_PLANE:
+		shape = InstancedMeshes::SHAPE_PLANE;
+		break;
+	case MESH_BOX:
+		shape = InstancedMeshes::SHAPE_BOX;
+		break;
+	case MESH_CYLINDER:
+		shape = InstancedMeshes::SHAPE_CYLINDER;
+		break;
+	case MESH_CONE:
+		shape = InstancedMeshes::SHAPE_CONE;
+		break;
+	case MESH_TAPERED_CYLINDER:
+		shape = InstancedMeshes::SHAPE_TAPERED_CYLINDER;
+		break;
+	case MESH_PYRAMID4:
+		shape = InstancedMeshes::SHAPE_PYRAMID4;
+		break;
+	default:
+		return(false);
+	}
 
-	//xyz scale for the cone mesh
-	scaleXYZ = glm::vec3(0.11f, 0.45f, 0.11f);
+	m_instancedMeshes->AddDrawCommand(shape, firstInstance, count);
+	return(true);
+}
 
-	//set the XYZ rotation of the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 35.0f;
-	ZrotationDegrees = -90.0f;
+/***********************************************************
+ *  LoadInstancedShaders()
+ *
+ *  This method is used for loading the shader program that
+ *  draws the basic shapes with instancing.  Only the plain
+ *  variant, with no texture and no lighting, is loaded here
+ *  - when it cannot be loaded, every object is drawn on its
+ *  own instead.  The other variants are loaded when the
+ *  lights are known, or when a draw first needs them.
+ ***********************************************************/
+bool SceneManager::LoadInstancedShaders()
+{
+	if (LoadInstancedVariant(0) == false)
+	{
+		std::cout << "Could not load the instanced shaders, drawing every object on its own" << std::endl;
+		return(false);
+	}
 
-	positionXYZ = glm::vec3(0.35, 0.2, -0.25f);
+	m_pInstancedShader = m_instancedVariants[0].pShader;
+	m_pInstancedRegistry = m_instancedVariants[0].pRegistry;
 
-	//set the transformation into memory to be used to draw the meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	// the lit variants read the lights from the light block
+	if (m_lightBlock.IsCreated() == false)
+	{
+		m_lightBlock.Create(BLOCK_LIGHTS, sizeof(LIGHT_BLOCK));
+	}
 
-	//set color of the mesh
-	SetShaderColor(0.329412, 0.329411, 0.329412, 1);
-	SetShaderMaterial("wood");
+	return(true);
+}
 
-	//draw the mesh with the transformation for the cone
-	m_basicMeshes->DrawConeMesh();
+/***********************************************************
+ *  GetInstancedVariantIndex()
+ *
+ *  This method is used for finding the instanced variant
+ *  that draws with a texture mode and the current lights.
+ *  Turning the lighting off or adding a light picks another
+ *  variant, rather than another branch in the shader.
+ ***********************************************************/
+int SceneManager::GetInstancedVariantIndex(INSTANCED_TEXTURE_MODE textureMode) const
+{
+	int lightingMode = 0;
 
+	if (m_bUseLighting)
+	{
+		lightingMode = 1 + (int)m_lightSources.size();
+	}
 
-	/***********************************************************
-	 *
-	 *
-	 *          PENCIL OBJECT (2)
-	 *
-	 *
-	 ***********************************************************/
+	return(((int)textureMode * g_InstancedLightingModes) + lightingMode);
+}
 
-	 // set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(0.2f, 5.0f, 0.2f);
+/***********************************************************
+ *  LoadInstancedVariant()
+ *
+ *  This method is used for loading one variant of the
+ *  instanced shader program.  The defines select the code
+ *  in the shaders, so each variant only has the texture
+ *  lookup and the light loop that it draws with, and each
+ *  variant has a program binary cache file of its own.
+ ***********************************************************/
+bool SceneManager::LoadInstancedVariant(int variantIndex)
+{
+	INSTANCED_VARIANT& variant = m_instancedVariants[variantIndex];
+	int textureMode = variantIndex / g_InstancedLightingModes;
+	int lightingMode = variantIndex % g_InstancedLightingModes;
+	GLuint programID = 0;
 
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 10.0f;
-	ZrotationDegrees = 90.0f;
+	if (variant.bLoadTried)
+	{
+		return(NULL != variant.pRegistry);
+	}
+	variant.bLoadTried = true;
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(2.7f, 0.2f, 1.5f);
+	variant.defines.clear();
+	if (textureMode != INSTANCED_TEXTURE_NONE)
+	{
+		variant.defines += "#define USE_TEXTURE\n";
+	}
+	if (textureMode == INSTANCED_TEXTURE_ARRAY)
+	{
+		variant.defines += "#define USE_TEXTURE_ARRAY\n";
+	}
+	if (lightingMode > 0)
+	{
+		variant.defines += "#define USE_LIGHTING\n";
+		variant.defines += "#define LIGHT_COUNT " + std::to_string(lightingMode - 1) + "\n";
+	}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	programID = LoadCachedProgram(
+		g_InstancedVertexShaderName,
+		g_InstancedFragmentShaderName,
+		variant.defines.c_str());
+	if (programID == 0)
+	{
+		m_pShaderManager->use();
+		return(false);
+	}
 
+	variant.pShader = new ShaderManager();
+	variant.pShader->m_programID = programID;
+	variant.pRegistry = new UniformRegistry();
+	variant.pRegistry->AttachProgram(programID);
+	if (textureMode == INSTANCED_TEXTURE_ARRAY)
+	{
+		variant.pRegistry->Resolve(g_TextureArrayValueName, variant.textureUniform);
+	}
+	else if (textureMode == INSTANCED_TEXTURE_2D)
+	{
+		variant.pRegistry->Resolve(g_TextureValueName, variant.textureUniform);
+	}
 
+	// an unlit variant has no light block, since nothing reads it
+	variant.pRegistry->BindUniformBlock(CAMERA_BLOCK_NAME, BLOCK_CAMERA);
+	if ((lightingMode > 0) && (variant.pRegistry->BindUniformBlock(LIGHT_BLOCK_NAME, BLOCK_LIGHTS) == false))
+	{
+		std::cout << "Could not find the light block in the instanced shaders" << std::endl;
+	}
+	SetInstancedMaterials(variant);
 
-	// set the color for the mesh
-	SetShaderColor(0.984, 0.769, 0.376, 1);
-	SetShaderTexture("pencil2");
-	SetTextureUVScale(1.0, 1.0);
-	SetShaderMaterial("wood");
+	WatchShaderProgram(
+		variant.pRegistry,
+		g_InstancedVertexShaderName,
+		g_InstancedFragmentShaderName,
+		variant.defines.c_str());
 
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawCylinderMesh();
+	// leave the main shader program in use
+	m_pShaderManager->use();
 
-	/****************************************************************/
+	return(true);
+}
 
-	//Tip of the pencil
+/***********************************************************
+ *  PrepareInstancedVariants()
+ *
+ *  This method is used for loading the instanced variants
+ *  of every texture mode with the current lights, before
+ *  the first frame, so that no draw waits for a compile.
+ ***********************************************************/
+void SceneManager::PrepareInstancedVariants()
+{
+	if (NULL == m_pInstancedRegistry)
+	{
+		return;
+	}
 
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(0.2f, 0.45f, 0.2f);
+	for (int mode = 0; mode < INSTANCED_TEXTURE_MODES; mode++)
+	{
+		LoadInstancedVariant(GetInstancedVariantIndex((INSTANCED_TEXTURE_MODE)mode));
+	}
+}
 
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 10.0f;
-	ZrotationDegrees = 90.0f;
+/***********************************************************
+ *  SelectInstancedVariant()
+ *
+ *  This method is used for switching to the instanced
+ *  variant of a draw.  A variant is loaded the first time
+ *  it is needed, and when it does not load, the plain one
+ *  draws in its place.  The sampler is set on every call,
+ *  since the texture unit changes from draw to draw.
+ ***********************************************************/
+SceneManager::INSTANCED_VARIANT* SceneManager::SelectInstancedVariant(
+	INSTANCED_VARIANT* pCurrent,
+	int textureUnit,
+	bool bTextureArrays)
+{
+	INSTANCED_TEXTURE_MODE textureMode = INSTANCED_TEXTURE_NONE;
+	bool bLoaded = false;
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-2.23f, 0.2f, 2.37f);
+	if (textureUnit >= 0)
+	{
+		textureMode = bTextureArrays ? INSTANCED_TEXTURE_ARRAY : INSTANCED_TEXTURE_2D;
+	}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	int variantIndex = GetInstancedVariantIndex(textureMode);
+	INSTANCED_VARIANT* pVariant = &m_instancedVariants[variantIndex];
+	if (pVariant->bLoadTried == false)
+	{
+		// loading leaves the main shader program in use
+		LoadInstancedVariant(variantIndex);
+		bLoaded = true;
+	}
+	if (NULL == pVariant->pRegistry)
+	{
+		pVariant = &m_instancedVariants[0];
+	}
 
-	// set the color for the mesh
-	SetShaderColor(0.92, .78, 0.62, 1);
-	SetShaderTexture("tip1");
-	SetTextureUVScale(1.0, 1.0);
+	if ((pVariant != pCurrent) || bLoaded)
+	{
+		pVariant->pRegistry->UseProgram();
+	}
+	if (textureUnit >= 0)
+	{
+		pVariant->pRegistry->Set(pVariant->textureUniform, textureUnit);
+	}
 
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawTaperedCylinderMesh();
+	return(pVariant);
+}
 
-	/****************************************************************/
+/***********************************************************
+ *  SetInstancedMaterials()
+ *
+ *  This method is used for passing all of the defined
+ *  materials into an instanced variant, once, so that every
+ *  instance can pick its material by index.  The unlit
+ *  variants read no materials, so they are skipped.
+ ***********************************************************/
+void SceneManager::SetInstancedMaterials(const INSTANCED_VARIANT& variant)
+{
+	int materialCount = (int)m_objectMaterials.size();
 
-	//part 1 of eraser topper
+	if ((NULL == variant.pShader) || (variant.defines.find("USE_LIGHTING") == std::string::npos))
+	{
+		return;
+	}
 
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(0.2f, 0.4f, 0.2f);
+	if (materialCount > g_MaxInstancedMaterials)
+	{
+		std::cout << "Instanced shader only supports " << g_MaxInstancedMaterials
+			<< " materials, " << materialCount << " are defined" << std::endl;
+		materialCount = g_MaxInstancedMaterials;
+	}
 
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 10.0f;
-	ZrotationDegrees = 90.0f;
+	variant.pShader->use();
+	for (int i = 0; i < materialCount; i++)
+	{
+		const OBJECT_MATERIAL& material = m_objectMaterials[i];
+		std::string name = "materials[" + std::to_string(i) + "].";
+
+		variant.pShader->setVec3Value(name + "ambientColor", material.ambientColor);
+		variant.pShader->setFloatValue(name + "ambientStrength", material.ambientStrength);
+		variant.pShader->setVec3Value(name + "diffuseColor", material.diffuseColor);
+		variant.pShader->setVec3Value(name + "specularColor", material.specularColor);
+		variant.pShader->setFloatValue(name + "shininess", material.shininess);
+	}
+	m_pShaderManager->use();
+}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(3.09f, 0.2f, 1.43);
+/***********************************************************
+ *  DefineRenderObjects()
+ *
+ *  This method is used for filling the render table with
+ *  the scale, rotation (XYZ degrees), position, color,
+ *  texture and material of every object in the 3D scene.
+ *  The parts of each pencil are placed relative to the
+ *  pencil, which lies along its local -X axis.
+ ***********************************************************/
+void SceneManager::DefineRenderObjects()
+{
+	int pencilNode = -1;
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	// nightstand surface
+	AddRenderObject(MESH_PLANE, -1,
+		glm::vec3(20.0f, 1.0f, 10.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.0f),
+		glm::vec4(0.65f, 0.50f, 0.39f, 1.0f), &g_NightstandTag, &g_WoodTag);
 
-	// set the color for the mesh
-	SetShaderColor(0.859, 0.498, 0.69, 1.0);
+	// back wall
+	AddRenderObject(MESH_PLANE, -1,
+		glm::vec3(25.0f, 1.0f, 30.0f), glm::vec3(0.0f, 90.0f, 90.0f), glm::vec3(0.0f, 0.0f, -7.5f),
+		glm::vec4(0.831f, 0.871f, 0.933f, 1.0f), &g_Wall2Tag, &g_WoodTag);
 
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawCylinderMesh();
+/***********************************************************
+ *
+ *
+ *          Plane for Photo on wall
+ *
+ *
+ ***********************************************************/
 
-	/****************************************************************/
+	AddRenderObject(MESH_PLANE, -1,
+		glm::vec3(6.0f, 5.0f, 5.0f), glm::vec3(0.0f, 90.0f, 90.0f), glm::vec3(1.5f, 6.8f, -7.4f),
+		glm::vec4(1.0f, 1.0f, 1.0f, 0.0f), &g_Photo2Tag, &g_WoodTag);
 
-	//part 2 top of eraser topper
+/***********************************************************
+ *
+ *
+ *          PENCIL OBJECT (1)
+ *
+ *
+ ***********************************************************/
 
-	//xyz scaling for the pryamid mesh
-	scaleXYZ = glm::vec3(0.5, 0.6, 0.5);
+	// the pencil itself - all of its parts move with it
+	pencilNode = AddSceneNode(-1,
+		glm::vec3(1.0f, 1.0f, 1.0f), glm::vec3(0.0f, 35.0f, 0.0f), glm::vec3(0.0f, 0.2f, 0.0f));
 
-	//sets rotation for the mesh
-	XrotationDegrees = 0.0;
-	YrotationDegrees = 0.0;
-	ZrotationDegrees = -90.0;
+	// body of the pencil
+	AddRenderObject(MESH_CYLINDER, pencilNode,
+		glm::vec3(0.2f, 5.0f, 0.2f), glm::vec3(0.0f, 0.0f, 90.0f), glm::vec3(0.0f, 0.0f, 0.0f),
+		glm::vec4(0.984f, 0.769f, 0.376f, 1.0f), &g_PencilTag, &g_WoodTag);
 
-	//sets xyz position for the mesh
-	positionXYZ = glm::vec3(3.38, 0.2f, 1.45);
+	// tip of the pencil
+	AddRenderObject(MESH_TAPERED_CYLINDER, pencilNode,
+		glm::vec3(0.2f, 0.45f, 0.2f), glm::vec3(0.0f, 0.0f, -90.0f), glm::vec3(0.0f, 0.0f, 0.0f),
+		glm::vec4(0.92f, 0.78f, 0.62f, 1.0f), &g_Tip1Tag, &g_WoodTag);
 
-	//set transformations into memory to be used on the drawn meshs
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	// eraser of the pencil
+	AddRenderObject(MESH_CYLINDER, pencilNode,
+		glm::vec3(0.2f, 0.4f, 0.2f), glm::vec3(0.0f, 0.0f, 90.0f), glm::vec3(-4.937f, 0.0f, 0.0f),
+		glm::vec4(0.99f, 0.65f, 0.59f, 1.0f), NULL, &g_WoodTag);
 
-	//sets the shade of the mesh
-	SetShaderColor(0.859, 0.498, 0.69, 1.0);
+	// cone mesh for the lead of the pencil
+	AddRenderObject(MESH_CONE, pencilNode,
+		glm::vec3(0.11f, 0.45f, 0.11f), glm::vec3(0.0f, 0.0f, -90.0f), glm::vec3(0.43f, 0.0f, 0.0f),
+		glm::vec4(0.329412f, 0.329411f, 0.329412f, 1.0f), NULL, &g_WoodTag);
 
-	//draws mesh - pryamid
-	m_basicMeshes->DrawPyramid4Mesh();
+/***********************************************************
+ *
+ *
+ *          PENCIL OBJECT (2)
+ *
+ *
+ ***********************************************************/
 
-	/****************************************************************/
+	// the pencil itself - all of its parts move with it
+	pencilNode = AddSceneNode(-1,
+		glm::vec3(1.0f, 1.0f, 1.0f), glm::vec3(0.0f, 10.0f, 0.0f), glm::vec3(2.7f, 0.2f, 1.5f));
 
-	//cone mesh for the Lead of the pencil 
+	// body of the pencil
+	AddRenderObject(MESH_CYLINDER, pencilNode,
+		glm::vec3(0.2f, 5.0f, 0.2f), glm::vec3(0.0f, 0.0f, 90.0f), glm::vec3(0.0f, 0.0f, 0.0f),
+		glm::vec4(0.984f, 0.769f, 0.376f, 1.0f), &g_Pencil2Tag, &g_WoodTag);
 
-	//xyz scale for the cone mesh
-	scaleXYZ = glm::vec3(0.11f, 0.45f, 0.11f);
+	// tip of the pencil
+	AddRenderObject(MESH_TAPERED_CYLINDER, pencilNode,
+		glm::vec3(0.2f, 0.45f, 0.2f), glm::vec3(0.0f, 0.0f, 90.0f), glm::vec3(-5.006f, 0.0f, 0.0f),
+		glm::vec4(0.92f, 0.78f, 0.62f, 1.0f), &g_Tip1Tag, &g_WoodTag);
 
-	//set the XYZ rotation of the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 10.0f;
-	ZrotationDegrees = 90.0f;
+	// part 1 of eraser topper
+	AddRenderObject(MESH_CYLINDER, pencilNode,
+		glm::vec3(0.2f, 0.4f, 0.2f), glm::vec3(0.0f, 0.0f, 90.0f), glm::vec3(0.396f, 0.0f, 0.0f),
+		glm::vec4(0.859f, 0.498f, 0.69f, 1.0f), NULL, &g_WoodTag);
 
-	positionXYZ = glm::vec3(-2.66f, 0.2f, 2.442f);
+	// part 2 top of eraser topper - not turned with the pencil
+	AddRenderObject(MESH_PYRAMID4, pencilNode,
+		glm::vec3(0.5f, 0.6f, 0.5f), glm::vec3(0.0f, -10.0f, -90.0f), glm::vec3(0.678f, 0.0f, 0.069f),
+		glm::vec4(0.859f, 0.498f, 0.69f, 1.0f), NULL, &g_WoodTag);
 
-	//set the transformation into memory to be used to draw the meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	// cone mesh for the lead of the pencil
+	AddRenderObject(MESH_CONE, pencilNode,
+		glm::vec3(0.11f, 0.45f, 0.11f), glm::vec3(0.0f, 0.0f, 90.0f), glm::vec3(-5.442f, 0.0f, 0.0f),
+		glm::vec4(0.329412f, 0.329411f, 0.329412f, 1.0f), NULL, &g_WoodTag);
 
-	//set color of the mesh
-	SetShaderColor(0.329412, 0.329411, 0.329412, 1);
+/***********************************************************
+ *
+ *
+ *          CANDLE WARMER OBJECT
+ *
+ *
+ ***********************************************************/
 
-	//draw the mesh with the transformation for the cone
-	m_basicMeshes->DrawConeMesh();
+	// main base of the candle warmer
+	AddRenderObject(MESH_CYLINDER, -1,
+		glm::vec3(3.5f, 4.5f, 3.5f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(-3.0f, 1.5f, -2.5f),
+		glm::vec4(0.129f, 0.0f, 0.0f, 0.75f), NULL, &g_GlassTag);
 
+	// bottom base of the candle warmer
+	AddRenderObject(MESH_CYLINDER, -1,
+		glm::vec3(2.5f, 1.5f, 2.5f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(-3.0f, 0.5f, -2.5f),
+		glm::vec4(0.129f, 0.0f, 0.0f, 0.75f), NULL, &g_GlassTag);
 
-	/***********************************************************
-	 *
-	 *
-	 *          CANDLE WARMER OBJECT
-	 *
-	 *
-	 ***********************************************************/
+/***********************************************************
+ *
+ *
+ *          BOOK OBJECT
+ *
+ *
+ ***********************************************************/
 
-	 //main base of the candle warmer
-	  //xyz scale for cylinder mesh
-	scaleXYZ = glm::vec3(3.5f, 4.5f, 3.5f);
+	// pages of the book
+	AddRenderObject(MESH_BOX, -1,
+		glm::vec3(1.5f, 7.0f, 4.5f), glm::vec3(0.0f, -25.0f, 0.0f), glm::vec3(-9.5f, 3.6f, -3.9f),
+		glm::vec4(0.329412f, 0.329412f, 0.329412f, 1.0f), &g_BookPaperTag, &g_GlassTag);
 
-	//set the XYZ roation of the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	AddRenderObject(MESH_BOX, -1,
+		glm::vec3(1.6f, 7.0f, 4.7f), glm::vec3(0.0f, -42.0f, 0.0f), glm::vec3(-8.5f, 3.6f, -3.5f),
+		glm::vec4(0.329412f, 0.329412f, 0.329412f, 1.0f), &g_BookPaperTag, &g_PaperbackTag);
 
-	//xyz postion of the shape
-	positionXYZ = glm::vec3(-3.0f, 1.5f, -2.5f);
+	// cover of the book
+	AddRenderObject(MESH_PLANE, -1,
+		glm::vec3(3.45f, 5.0f, 2.4f), glm::vec3(0.0f, -42.0f, 90.0f), glm::vec3(-7.84f, 3.6f, -2.98f),
+		glm::vec4(0.7f, 0.4f, 0.9f, 1.0f), &g_BookCoverTag, &g_PaperbackTag);
+}
 
-	//set the transformation into memory to be used to draw the meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+/***********************************************************
+ *  ResetBoundState()
+ *
+ *  This method is used for marking all of the render state
+ *  as unknown, so that the next draw sets all of it.
+ ***********************************************************/
+void SceneManager::ResetBoundState(BOUND_STATE& state)
+{
+	state.meshID = -1;
+	state.color = glm::vec4(-1.0f);
+	state.useTexture = -1;
+	state.textureSlot = -1;
+	state.UVscale = glm::vec2(-1.0f, -1.0f);
+	state.materialIndex = -1;
+}
 
-	//color of shape
-	SetShaderColor(0.129f, 0.0f, 0.0f, 0.75f);
-	SetShaderMaterial("glass");
+/***********************************************************
+ *  ApplyRenderState()
+ *
+ *  This method is used for setting the color, texture and
+ *  material of a render object into the shader, skipping
+ *  everything that is already bound.  The mesh is always
+ *  bound by the draw, but a switch is still counted.
+ ***********************************************************/
+int SceneManager::ApplyRenderState(size_t objectIndex, BOUND_STATE& state, bool bApply)
+{
+	const glm::vec4& color = m_renderObjects.color[objectIndex];
+	const glm::vec2& UVscale = m_renderObjects.UVscale[objectIndex];
+	int meshID = m_renderObjects.meshID[objectIndex];
+	int textureSlot = m_renderObjects.textureSlot[objectIndex];
+	int useTexture = (textureSlot >= 0) ? 1 : 0;
+	int materialIndex = m_renderObjects.materialIndex[objectIndex];
+	int stateChanges = 0;
 
-	//draws the cylinder mesh shape
-	m_basicMeshes->DrawCylinderMesh();
+	bApply = bApply && (NULL != m_pUniformRegistry);
 
-	/****************************************************************/
+	if (state.meshID != meshID)
+	{
+		state.meshID = meshID;
+		stateChanges++;
+	}
+	if (state.color != color)
+	{
+		if (bApply)
+			m_pUniformRegistry->Set(m_colorUniform, color);
+		state.color = color;
+		stateChanges++;
+	}
+	if (state.useTexture != useTexture)
+	{
+		if (bApply)
+			m_pUniformRegistry->Set(m_useTextureUniform, useTexture != 0);
+		state.useTexture = useTexture;
+		stateChanges++;
+	}
+	if (useTexture != 0)
+	{
+		if (state.textureSlot != textureSlot)
+		{
+			if (bApply)
+				m_pUniformRegistry->Set(m_textureUniform, textureSlot);
+			state.textureSlot = textureSlot;
+			stateChanges++;
+		}
+		if (state.UVscale != UVscale)
+		{
+			if (bApply)
+				m_pUniformRegistry->Set(m_UVScaleUniform, UVscale);
+			state.UVscale = UVscale;
+			stateChanges++;
+		}
+	}
+	if ((materialIndex >= 0) && (state.materialIndex != materialIndex))
+	{
+		if (bApply)
+			SetShaderMaterialIndex(materialIndex);
+		state.materialIndex = materialIndex;
+		stateChanges++;
+	}
 
-	//bottom base of the candle warmer
-	//xyz scale for cylinder mesh
-	scaleXYZ = glm::vec3(2.5f, 1.5f, 2.5f);
+	return(stateChanges);
+}
 
-	//set the XYZ roation of the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+/***********************************************************
+ *  ReportRenderStats()
+ *
+ *  This method is used for keeping the counters of the
+ *  frame, and displaying the number of draws, culled objects
+ *  and state changes before and after sorting, whenever
+ *  those numbers change.
+ ***********************************************************/
+void SceneManager::ReportRenderStats(const RENDER_STATS& stats)
+{
+	m_frameStats = stats;
 
-	//xyz postion of the shape
-	positionXYZ = glm::vec3(-3.0f, 0.5f, -2.5f);
+	if ((stats.draws == m_renderStats.draws) &&
+		(stats.drawCalls == m_renderStats.drawCalls) &&
+		(stats.culled == m_renderStats.culled) &&
+		(stats.stateChangesUnsorted == m_renderStats.stateChangesUnsorted) &&
+		(stats.stateChangesSorted == m_renderStats.stateChangesSorted))
+	{
+		return;
+	}
 
-	//set the transformation into memory to be used to draw the meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	m_renderStats = stats;
+	std::cout << "INFO: Render queue draws: " << stats.draws
+		<< " in " << stats.drawCalls << " draw calls"
+		<< ", visible: " << stats.visible << ", culled: " << stats.culled
+		<< ", state changes per frame unsorted: " << stats.stateChangesUnsorted
+		<< ", sorted: " << stats.stateChangesSorted << std::endl;
+}
 
-	//color of shape
-	SetShaderColor(0.129f, 0.0f, 0.0f, 0.75f);
-	SetShaderMaterial("glass");
+/***********************************************************
+ *  RenderInstanced()
+ *
+ *  This method is used for drawing the sorted render queue
+ *  with the instanced shader program.  The instance data of
+ *  every object is uploaded in sorted order, so that each
+ *  run of objects sharing a mesh and a texture is a single
+ *  instanced draw, however many objects are in it.
+ *
+ *  Once the texture arrays are built, the texture of every
+ *  instance is a layer in its instance data, so a run only
+ *  ends where the mesh or the texture array changes.
+ *
+ *  When the driver supports indirect multi-draw, the runs
+ *  become commands in one indirect command buffer, and all
+ *  of the runs that share a texture unit are submitted with
+ *  one glMultiDrawElementsIndirect() call - a single call
+ *  for the textured objects when every texture is in one
+ *  array.  Otherwise each run is its own instanced draw call.
+ *
+ *  Every draw uses the variant of the instanced program for
+ *  its texture mode and the current lights, so the shader
+ *  never branches on whether to sample or light a fragment.
+ ***********************************************************/
+size_t SceneManager::RenderInstanced()
+{
+	const size_t count = m_renderQueue.Size();
+	const bool bTextureArrays = (m_textureArrays.GetArrayCount() > 0);
+	INSTANCED_VARIANT* pVariant = NULL;
+	size_t drawCalls = 0;
+	size_t first = 0;
+
+	m_instanceData.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		uint32_t objectIndex = m_renderQueue.GetObject(i);
+		InstancedMeshes::INSTANCE_DATA& instance = m_instanceData[i];
+		const glm::vec2& UVscale = m_renderObjects.UVscale[objectIndex];
+		int textureSlot = m_renderObjects.textureSlot[objectIndex];
+		int materialIndex = m_renderObjects.materialIndex[objectIndex];
+		float textureLayer = 0.0f;
+
+		// objects without a material use the first one
+		if (materialIndex < 0)
+		{
+			materialIndex = 0;
+		}
 
-	//draws the cylinder mesh shape
-	m_basicMeshes->DrawCylinderMesh();
+		// layer + 1 of the texture, 0 for no texture
+		MarkTextureUsed(textureSlot);
+		if (GetTextureUnit(textureSlot) >= 0)
+		{
+			textureLayer = bTextureArrays ? (float)(m_textureIDs[textureSlot].layer + 1) : 1.0f;
+		}
 
+		instance.model = m_sceneNodes[m_renderObjects.sceneNode[objectIndex]].worldMatrix;
+		instance.color = m_renderObjects.color[objectIndex];
+		instance.params = glm::vec4(
+			(float)materialIndex,
+			textureLayer,
+			UVscale.x,
+			UVscale.y);
+	}
+	m_instancedMeshes->SetInstanceData(m_instanceData.data(), count);
 
+	bool bMultiDraw = m_instancedMeshes->IsMultiDrawIndirectSupported();
+	if (bMultiDraw)
+	{
+		m_instancedMeshes->ClearDrawCommands();
+		m_drawCommandTextures.clear();
+	}
 
-	/***********************************************************
-	*
-	*
-	*          BOOK OBJECT
-	*
-	*
-	***********************************************************/
+	while (first < count)
+	{
+		uint32_t objectIndex = m_renderQueue.GetObject(first);
+		int meshID = m_renderObjects.meshID[objectIndex];
+		int textureUnit = GetTextureUnit(m_renderObjects.textureSlot[objectIndex]);
+		size_t last = first + 1;
 
-	//xyz scaling for the octagon mesh shape
-	scaleXYZ = glm::vec3(1.5, 7.0, 4.5);
+		// extend the run while the mesh and texture unit stay the same
+		while (last < count)
+		{
+			uint32_t nextIndex = m_renderQueue.GetObject(last);
+			if ((m_renderObjects.meshID[nextIndex] != meshID) ||
+				(GetTextureUnit(m_renderObjects.textureSlot[nextIndex]) != textureUnit))
+			{
+				break;
+			}
+			last++;
+		}
 
-	//rotation for the mesh shape xyz
-	XrotationDegrees = 0.0;
-	YrotationDegrees = -25.0;
-	ZrotationDegrees = 0.0;
+		if (bMultiDraw)
+		{
+			if (AddMeshDrawCommand(meshID, first, last - first))
+			{
+				m_drawCommandTextures.push_back(textureUnit);
+			}
+		}
+		else
+		{
+			pVariant = SelectInstancedVariant(pVariant, textureUnit, bTextureArrays);
+			DrawMeshInstanced(meshID, first, last - first);
+			drawCalls++;
+		}
 
-	//position of the mesh shape
-	positionXYZ = glm::vec3(-9.5, 3.6, -3.9);
+		first = last;
+	}
 
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	if (bMultiDraw)
+	{
+		const size_t commandCount = m_drawCommandTextures.size();
+		size_t firstCommand = 0;
 
-	//color of the mesh shape
-	SetShaderColor(0.329412, 0.329412, 0.329412, 1);
-	SetShaderTexture("bookpaper");
-	SetTextureUVScale(1.0, 1.0);
+		m_instancedMeshes->UploadDrawCommands();
 
-	//draws the box shape mesh
-	m_basicMeshes->DrawBoxMesh();
+		// the queue is sorted by texture first, so the commands that
+		// share a texture unit are next to each other - commands
+		// that sample no texture are drawn apart with the untextured
+		// variant, rather than testing every fragment for a texture
+		while (firstCommand < commandCount)
+		{
+			int textureUnit = m_drawCommandTextures[firstCommand];
+			size_t lastCommand = firstCommand + 1;
 
-	//***********************************************************************
+			while ((lastCommand < commandCount) && (m_drawCommandTextures[lastCommand] == textureUnit))
+			{
+				lastCommand++;
+			}
 
+			pVariant = SelectInstancedVariant(pVariant, textureUnit, bTextureArrays);
+			m_instancedMeshes->MultiDrawCommands(firstCommand, lastCommand - firstCommand);
+			drawCalls++;
 
-	//xyz scaling for the octagon mesh shape
-	scaleXYZ = glm::vec3(1.6, 7.0, 4.7);
+			firstCommand = lastCommand;
+		}
+	}
 
-	//rotation for the mesh shape xyz
-	XrotationDegrees = 0.0;
-	YrotationDegrees = -42.0;
-	ZrotationDegrees = 0.0;
+	return(drawCalls);
+}
 
-	//position of the mesh shape
-	positionXYZ = glm::vec3(-8.5, 3.6, -3.5);
+/***********************************************************
+ *  RenderScene()
+ *
+ *  This method is used for rendering the 3D scene.  Every
+ *  object in the render table is submitted to the render
+ *  queue, the queue is sorted by render state, and then the
+ *  basic 3D shapes are drawn with the cached world matrix of
+ *  each object and only the state that changed.  When the
+ *  instanced shader program is loaded, the sorted objects are
+ *  drawn in instanced batches instead.
+ ***********************************************************/
+void SceneManager::RenderScene()
+{
+	const size_t objectCount = m_renderObjects.meshID.size();
+	RENDER_STATS stats;
+	BOUND_STATE unsortedState;
 
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	// only the scene nodes that changed are recalculated, along
+	// with the bounding volumes of their objects
+	if (UpdateSceneNodes() == true)
+	{
+		UpdateObjectBounds();
+	}
+	// the lights are only written when they change
+	UpdateLightBlock();
+	// assets that were changed on disk are loaded again in place
+	UpdateHotReload();
+	// textures arrive over several frames, within an upload budget
+	UpdateTextureStreaming();
+	// and the least recently used leave when over the memory budget
+	EnforceTextureBudget();
+
+	// objects outside of the view frustum are not submitted
+	stats.visible = objectCount;
+	if (m_bFrustumSet == true)
+	{
+		stats.visible = m_frustumCuller.Cull(m_frustumPlanes);
+	}
+	stats.culled = objectCount - stats.visible;
 
-	//color of the mesh shape
-	SetShaderColor(0.329412, 0.329412, 0.329412, 1);
-	SetShaderTexture("bookpaper");
-	SetTextureUVScale(1.0, 1.0);
-	SetShaderMaterial("paperback");
+	m_renderQueue.Clear();
+	for (size_t i = 0; i < objectCount; i++)
+	{
+		if ((m_bFrustumSet == false) || (m_frustumCuller.IsVisible(i) == true))
+		{
+			m_renderQueue.Submit(m_renderObjects.sortKey[i], (uint32_t)i);
+		}
+	}
 
-	//draws the box shape mesh
-	m_basicMeshes->DrawBoxMesh();
+	// count the state changes that the submission order needs
+	stats.draws = m_renderQueue.Size();
+	stats.stateChangesUnsorted = 0;
+	ResetBoundState(unsortedState);
+	for (size_t i = 0; i < m_renderQueue.Size(); i++)
+	{
+		stats.stateChangesUnsorted += ApplyRenderState(m_renderQueue.GetObject(i), unsortedState, false);
+	}
 
+	m_renderQueue.Sort();
 
-	//***********************************************************************
+	stats.stateChangesSorted = 0;
+	if (NULL != m_pInstancedRegistry)
+	{
+		// count the state changes the sorted order would need
+		// if every object was drawn on its own
+		BOUND_STATE sortedState;
+		ResetBoundState(sortedState);
+		for (size_t i = 0; i < m_renderQueue.Size(); i++)
+		{
+			stats.stateChangesSorted += ApplyRenderState(m_renderQueue.GetObject(i), sortedState, false);
+		}
 
-	//xyz scaling for the octagon mesh shape
-	scaleXYZ = glm::vec3(3.45, 5.0, 2.4);
+		stats.drawCalls = RenderInstanced();
+		ReportRenderStats(stats);
+		return;
+	}
 
-	//rotation for the mesh shape xyz
-	XrotationDegrees = 0.0;
-	YrotationDegrees = -42.0;
-	ZrotationDegrees = 90.0;
+	stats.drawCalls = stats.draws;
+	ResetBoundState(m_boundState);
+	for (size_t i = 0; i < m_renderQueue.Size(); i++)
+	{
+		uint32_t objectIndex = m_renderQueue.GetObject(i);
 
-	//position of the mesh shape
-	positionXYZ = glm::vec3(-7.84, 3.6, -2.98);
+		// set the cached world matrix to be used on the drawn mesh
+		if (NULL != m_pUniformRegistry)
+		{
+			m_pUniformRegistry->Set(
+				m_modelUniform,
+				m_sceneNodes[m_renderObjects.sceneNode[objectIndex]].worldMatrix);
+		}
 
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+		stats.stateChangesSorted += ApplyRenderState(objectIndex, m_boundState, true);
+		MarkTextureUsed(m_renderObjects.textureSlot[objectIndex]);
 
-	//color of the mesh shape
-	SetShaderColor(0.7, 0.4, 0.9, 1);
-	SetShaderTexture("bookcover");
-	SetTextureUVScale(1, 1);
-	SetShaderMaterial("paperback");
+		// draw the mesh with transformation values
+		DrawMesh(m_renderObjects.meshID[objectIndex]);
+	}
 
-	//draws the box shape mesh
-	m_basicMeshes->DrawPlaneMesh();
+	ReportRenderStats(stats);
 }
@@ -11,6 +11,20 @@
 
 #include "ShaderManager.h"
 #include "ShapeMeshes.h"
+#include "InstancedMeshes.h"
+#include "TransformBatch.h"
+#include "UniformRegistry.h"
+#include "UniformBlocks.h"
+#include "TagRegistry.h"
+#include "FrustumCuller.h"
+#include "RenderQueue.h"
+#include "TextureDecoder.h"
+#include "MipGenerator.h"
+#include "TextureStreamer.h"
+#include "TextureCache.h"
+#include "TextureArrays.h"
+#include "TextureResidency.h"
+#include "FileWatcher.h"
 
 #include <string>
 #include <vector>
@@ -29,10 +43,18 @@ public:
 	// destructor
 	~SceneManager();
 
+	// the tag of a loaded texture is interned in the texture tag
+	// registry, with the texture slot as its ID.  Once the texture
+	// has been moved into a texture array, its 2D texture is freed
+	// and the ID is 0.  An evicted texture is loaded again from its
+	// file the next time that it is drawn.
 	struct TEXTURE_INFO
 	{
-		std::string tag;
 		uint32_t ID;
+		int arrayIndex;
+		int layer;
+		std::string filename;
+		bool bEvicted;
 	};
 
 	struct OBJECT_MATERIAL
@@ -45,22 +67,265 @@ public:
 		std::string tag;
 	};
 
+	// identifiers for the basic shape meshes that can be drawn
+	enum MESH_ID
+	{
+		MESH_PLANE = 0,
+		MESH_BOX,
+		MESH_CYLINDER,
+		MESH_CONE,
+		MESH_TAPERED_CYLINDER,
+		MESH_PYRAMID4
+	};
+
+	// node in the scene hierarchy - the local transform is relative
+	// to the parent node, and both matrices are cached until the
+	// node (or one of its parents) is changed
+	struct SCENE_NODE
+	{
+		int parent;
+		glm::vec3 scaleXYZ;
+		glm::vec3 rotationDegrees;
+		glm::vec3 positionXYZ;
+		glm::mat4 localMatrix;
+		glm::mat4 worldMatrix;
+		bool bDirty;
+		bool bWorldChanged;
+	};
+
+	// structure-of-arrays table of the objects in the 3D scene,
+	// with every tag already resolved to a slot or index
+	struct RENDER_OBJECTS
+	{
+		std::vector<int> meshID;
+		std::vector<int> sceneNode;
+		std::vector<glm::vec4> color;
+		std::vector<int> textureSlot;
+		std::vector<glm::vec2> UVscale;
+		std::vector<int> materialIndex;
+		std::vector<uint64_t> sortKey;
+	};
+
+	// render state last set into the shader - -1 (or a negative
+	// color) means that the value is not known yet
+	struct BOUND_STATE
+	{
+		int meshID;
+		glm::vec4 color;
+		int useTexture;
+		int textureSlot;
+		glm::vec2 UVscale;
+		int materialIndex;
+	};
+
+	// render queue counters for a frame
+	struct RENDER_STATS
+	{
+		size_t draws;
+		size_t drawCalls;
+		size_t visible;
+		size_t culled;
+		int stateChangesUnsorted;
+		int stateChangesSorted;
+	};
+
+	// light source in the 3D scene
+	struct LIGHT_SOURCE
+	{
+		glm::vec3 position;
+		glm::vec3 ambientColor;
+		glm::vec3 diffuseColor;
+		glm::vec3 specularColor;
+		float focalStrength;
+		float specularIntensity;
+	};
+
+	// handles for the material properties in the shader
+	struct MATERIAL_UNIFORMS
+	{
+		UniformHandle<glm::vec3> ambientColor;
+		UniformHandle<float> ambientStrength;
+		UniformHandle<glm::vec3> diffuseColor;
+		UniformHandle<glm::vec3> specularColor;
+		UniformHandle<float> shininess;
+	};
+
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
+	// pointer to the resolved shader uniform locations
+	UniformRegistry* m_pUniformRegistry;
+	// handles for the uniforms that are set for every draw
+	UniformHandle<glm::mat4> m_modelUniform;
+	UniformHandle<glm::vec4> m_colorUniform;
+	UniformHandle<int> m_textureUniform;
+	UniformHandle<bool> m_useTextureUniform;
+	UniformHandle<glm::vec2> m_UVScaleUniform;
+	MATERIAL_UNIFORMS m_materialUniforms;
 	// pointer to basic shapes object
 	ShapeMeshes* m_basicMeshes;
+	// texture that a variant of the instanced shader program reads
+	enum INSTANCED_TEXTURE_MODE
+	{
+		INSTANCED_TEXTURE_NONE = 0,
+		INSTANCED_TEXTURE_2D,
+		INSTANCED_TEXTURE_ARRAY,
+		INSTANCED_TEXTURE_MODES
+	};
+	// a variant of the instanced shader program, compiled with the
+	// defines of one texture mode and number of lights, so that it
+	// has no branches on uniforms
+	struct INSTANCED_VARIANT
+	{
+		std::string defines;
+		ShaderManager* pShader;
+		UniformRegistry* pRegistry;
+		// sampler of the texture or the texture array, if one is read
+		UniformHandle<int> textureUniform;
+		// true once loading was tried, so a failed one is not retried
+		bool bLoadTried;
+	};
+	// every variant, by texture mode and then by lighting - unlit,
+	// or lit with 0 to MAX_LIGHT_SOURCES lights.  They are loaded
+	// when they are first needed.
+	std::vector<INSTANCED_VARIANT> m_instancedVariants;
+	// the untextured, unlit variant, which is always loaded - NULL
+	// when it could not be loaded and every object is drawn on its
+	// own with the basic shapes instead
+	ShaderManager* m_pInstancedShader;
+	UniformRegistry* m_pInstancedRegistry;
+	// basic shapes that are drawn with instanced draw calls
+	InstancedMeshes* m_instancedMeshes;
+	// per-instance data of the current frame, in sorted order
+	std::vector<InstancedMeshes::INSTANCE_DATA> m_instanceData;
+	// texture unit of each indirect draw command of the frame
+	std::vector<int> m_drawCommandTextures;
+	// light sources of the 3D scene
+	std::vector<LIGHT_SOURCE> m_lightSources;
+	bool m_bUseLighting;
+	// true when the lights changed since the light block was written
+	bool m_bLightsChanged;
+	// light uniform block shared by the programs that declare it
+	UniformBlockBuffer m_lightBlock;
+	// decodes and uploads the scene textures over several frames
+	TextureStreamer m_textureStreamer;
+	// textures that finished streaming in the current frame
+	std::vector<STREAMED_TEXTURE> m_streamedTextures;
+	// 1 x 1 texture shown in a slot until its image has streamed in
+	GLuint m_placeholderTextureID;
 	// total number of loaded textures
 	int m_loadedTextures;
-	// loaded textures info
-	TEXTURE_INFO m_textureIDs[16];
+	// loaded textures info, indexed by texture slot
+	std::vector<TEXTURE_INFO> m_textureIDs;
+	// the textures of the instanced shader program, grouped by size
+	TextureArrays m_textureArrays;
+	// true once the texture arrays have been built, or tried
+	bool m_bTextureArraysBuilt;
+	// texture unit that no texture is bound to, for the sampler
+	// that the instanced shader program is not reading
+	int m_spareTextureUnit;
+	// GPU memory of the resident 2D textures and texture arrays,
+	// with the least recently used evicted when over budget
+	TextureResidency m_textureResidency;
+	// a shader program whose files are watched for hot reloading
+	struct WATCHED_PROGRAM
+	{
+		UniformRegistry* pRegistry;
+		std::string vertexFile;
+		std::string fragmentFile;
+		// #define lines the program is compiled with
+		std::string defines;
+		int vertexFileID;
+		int fragmentFileID;
+	};
+	// watches the texture and shader files, so that a changed one
+	// is loaded again in place while the scene is running
+	FileWatcher m_fileWatcher;
+	std::vector<WATCHED_PROGRAM> m_watchedPrograms;
+	// files that changed since the last frame
+	std::vector<int> m_changedFiles;
 	// defined object materials
 	std::vector<OBJECT_MATERIAL> m_objectMaterials;
+	// interned tags - a texture tag ID is its texture slot and a
+	// material tag ID is its index in the defined materials
+	TagRegistry m_textureTags;
+	TagRegistry m_materialTags;
+	// scene hierarchy - parents are always stored before children
+	std::vector<SCENE_NODE> m_sceneNodes;
+	// true when at least one scene node needs to be updated
+	bool m_bSceneNodesDirty;
+	// local transforms of the changed scene nodes, composed together
+	TransformBatch m_transformBatch;
+	// objects that are drawn every frame
+	RENDER_OBJECTS m_renderObjects;
+	// draws of the current frame, sorted by render state
+	RenderQueue m_renderQueue;
+	// render state currently set into the shader
+	BOUND_STATE m_boundState;
+	// counters of the last reported frame
+	RENDER_STATS m_renderStats;
+	// counters of the last rendered frame
+	RENDER_STATS m_frameStats;
+	// world space bounding volumes of the render objects
+	FrustumCuller m_frustumCuller;
+	// planes of the view frustum that the objects are culled with
+	FRUSTUM_PLANES m_frustumPlanes;
+	// false until the view frustum has been set
+	bool m_bFrustumSet;
 
 	// load texture images and convert to OpenGL texture data
-	bool CreateGLTexture(const char* filename, std::string tag);
+	bool CreateGLTexture(const char* filename, const char* tag);
+	// convert an already decoded image to OpenGL texture data, with
+	// its mip chain when it was already generated
+	bool UploadGLTexture(const DECODED_IMAGE& image, const char* tag, const MIP_IMAGE* pMipChain = NULL);
+	// convert a baked texture cache entry to OpenGL texture data
+	bool UploadCachedTexture(
+		const TextureCache& textureCache,
+		const TEXTURE_CACHE_ENTRY& entry,
+		const char* tag);
+	// create the OpenGL texture of a decoded image or of a baked
+	// texture cache entry, returning 0 when it cannot be created
+	GLuint CreateImageTexture(const DECODED_IMAGE& image, const MIP_IMAGE* pMipChain = NULL);
+	GLuint CreateCachedTexture(
+		const TextureCache& textureCache,
+		const TEXTURE_CACHE_ENTRY& entry);
 	// bind loaded OpenGL textures to slots in memory
 	void BindGLTextures();
+	// create the texture that is shown while the others stream in
+	bool CreatePlaceholderTexture();
+	// swap in the textures that finished streaming this frame
+	void UpdateTextureStreaming();
+	// add a loaded texture to the next texture slot
+	void RegisterTexture(GLuint textureID, const char* tag, const char* filename);
+	// put a texture that finished loading into its slot
+	void InstallTexture(int textureSlot, GLuint textureID);
+	// move every loaded texture into the texture arrays, so that
+	// the instanced shader program picks them by layer
+	bool BuildTextureArrays();
+	// texture unit that is bound for drawing a texture slot - the
+	// unit of its texture array once the arrays are built, the slot
+	// itself before that, and -1 when no texture is drawn
+	int GetTextureUnit(int textureSlot) const;
+
+	// mark the texture of a slot as used in this frame, loading it
+	// again when it was evicted
+	void MarkTextureUsed(int textureSlot);
+	// evict the least recently used textures while over budget
+	void EnforceTextureBudget();
+	// free a resident 2D texture or texture array
+	void EvictTexture(uint32_t residencyKey);
+	// load an evicted texture again - from the texture cache when
+	// it is baked there, otherwise from its image file
+	void ReloadTexture(int textureSlot);
+
+	// load the textures and shader programs whose files changed
+	// since the last frame, in place
+	void UpdateHotReload();
+	// decode the changed image file of a texture slot and upload it
+	// into the same slot - into its array layer when it still fits
+	bool HotReloadTexture(int textureSlot);
+	// relink a watched shader program from its changed files
+	bool HotReloadProgram(const WATCHED_PROGRAM& program);
 
 	// load all of the needed textures before rendering
 	void LoadSceneTextures();
@@ -68,10 +333,13 @@ private:
 	// free the loaded OpenGL textures
 	void DestroyGLTextures();
 	// find a loaded texture by tag
-	int FindTextureID(std::string tag);
-	int FindTextureSlot(std::string tag);
+	int FindTextureID(const char* tag);
+	int FindTextureSlot(const char* tag);
 	// find a defined material by tag
-	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
+	bool FindMaterial(const char* tag, OBJECT_MATERIAL& material);
+	int FindMaterialIndex(const char* tag);
+	// intern the tags of the defined materials
+	void InternMaterialTags();
 
 	// set the transformation values 
 	// into the transform buffer
@@ -91,7 +359,7 @@ private:
 
 	// set the texture data into the shader
 	void SetShaderTexture(
-		std::string textureTag);
+		const char* textureTag);
 
 	// set the UV scale for the texture mapping
 	void SetTextureUVScale(
@@ -99,10 +367,144 @@ private:
 
 	// set the object material into the shader
 	void SetShaderMaterial(
-		std::string materialTag);
+		const char* materialTag);
+
+	// set previously resolved texture and material data into the shader
+	void SetShaderTextureSlot(int textureSlot);
+	void SetShaderMaterialIndex(int materialIndex);
+
+	// add a node to the scene hierarchy, parent -1 is the root
+	int AddSceneNode(
+		int parent,
+		glm::vec3 scaleXYZ,
+		glm::vec3 rotationDegrees,
+		glm::vec3 positionXYZ);
+	// change the local transform of a scene node
+	void SetSceneNodeTransform(
+		int node,
+		glm::vec3 scaleXYZ,
+		glm::vec3 rotationDegrees,
+		glm::vec3 positionXYZ);
+	// recalculate the cached matrices of the changed nodes,
+	// returning true when any node changed
+	bool UpdateSceneNodes();
+	// move the bounding volumes of the objects whose scene node
+	// changed into world space
+	void UpdateObjectBounds();
+
+	// add an object to the render table - the tags are resolved
+	// here so that no string lookups happen while rendering
+	int AddRenderObject(
+		MESH_ID meshID,
+		int parentNode,
+		glm::vec3 scaleXYZ,
+		glm::vec3 rotationDegrees,
+		glm::vec3 positionXYZ,
+		glm::vec4 color,
+		const TAG_NAME* pTextureTag,
+		const TAG_NAME* pMaterialTag);
+
+	// draw the basic mesh associated with the passed in ID
+	void DrawMesh(int meshID);
+	// draw count instances of the basic mesh associated with the
+	// passed in ID, starting at the passed in instance
+	void DrawMeshInstanced(int meshID, size_t firstInstance, size_t count);
+	// add an indirect draw command for count instances of the basic
+	// mesh associated with the passed in ID
+	bool AddMeshDrawCommand(int meshID, size_t firstInstance, size_t count);
+
+	// load the shader program for instanced drawing
+	bool LoadInstancedShaders();
+	// index of the instanced variant that draws with the passed in
+	// texture mode and the current lights
+	int GetInstancedVariantIndex(INSTANCED_TEXTURE_MODE textureMode) const;
+	// compile, or load from the program cache, an instanced variant
+	bool LoadInstancedVariant(int variantIndex);
+	// load the instanced variants that the current lights need
+	void PrepareInstancedVariants();
+	// use the instanced variant for a draw with the passed in texture
+	// unit (-1 for none) and bind its sampler to the unit - the
+	// program is only switched when the variant is not pCurrent
+	INSTANCED_VARIANT* SelectInstancedVariant(INSTANCED_VARIANT* pCurrent, int textureUnit, bool bTextureArrays);
+	// pass the defined materials into an instanced variant
+	void SetInstancedMaterials(const INSTANCED_VARIANT& variant);
+	// add a light source to the 3D scene
+	void AddLightSource(
+		glm::vec3 position,
+		glm::vec3 ambientColor,
+		glm::vec3 diffuseColor,
+		glm::vec3 specularColor,
+		float focalStrength,
+		float specularIntensity);
+	// set the light sources into the loose uniforms of the passed
+	// in shader program, for programs without the light block
+	void SetLightUniforms(ShaderManager* pShaderManager);
+	// write the light sources into the light block if they changed
+	void UpdateLightBlock();
+	// draw the sorted render queue with one instanced draw call
+	// for every run of objects that share a mesh and texture unit,
+	// returning the number of draw calls
+	size_t RenderInstanced();
+
+	// forget the render state, so that it is all set again
+	void ResetBoundState(BOUND_STATE& state);
+	// set the state of a render object that differs from the
+	// bound state, returning the number of state changes - when
+	// bApply is false the changes are only counted
+	int ApplyRenderState(size_t objectIndex, BOUND_STATE& state, bool bApply);
+	// output the render queue counters when they change
+	void ReportRenderStats(const RENDER_STATS& stats);
 
 public:
 
+	// calculate the model matrix for the transformation values
+	static glm::mat4 ComputeModelMatrix(
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ);
+
+	// resolve the shader uniforms used while rendering - must be
+	// called after the shaders are loaded and before PrepareScene()
+	void ResolveShaderUniforms(UniformRegistry* pUniformRegistry);
+	// uniform locations of the instanced shader program, so that
+	// the camera can be set into it - NULL when it is not used
+	UniformRegistry* GetInstancedUniformRegistry() { return(m_pInstancedRegistry); }
+	// set the view-projection matrix that objects are culled with
+	void SetViewProjection(const glm::mat4& viewProjection);
+	// counters of the last rendered frame, including the number
+	// of visible and culled objects
+	const RENDER_STATS& GetFrameStats() const { return(m_frameStats); }
+	// true once every texture has streamed in and, for the instanced
+	// shader program, been moved into the texture arrays - from then
+	// on the frames are drawn the same way every time
+	bool IsSceneLoaded() const
+	{
+		return(m_textureStreamer.IsIdle() && ((NULL == m_pInstancedRegistry) || m_bTextureArraysBuilt));
+	}
+	// most bytes of GPU memory that the textures may use before
+	// the least recently used are evicted - 0 for no limit
+	void SetTextureBudget(size_t budgetBytes) { m_textureResidency.SetBudget(budgetBytes); }
+	// watch the files of a shader program, so that it is relinked
+	// in place, through its uniform registry and with the #define
+	// lines it was compiled with, when they change
+	void WatchShaderProgram(
+		UniformRegistry* pRegistry,
+		const char* vertexFile,
+		const char* fragmentFile,
+		const char* defines = NULL);
+	// bake the scene textures into the texture cache, optionally
+	// block compressed - this needs no OpenGL context
+	static bool BakeSceneTextures(bool bCompress);
+	// time the CPU mip generator on the scene textures, and against
+	// glGenerateMipmap() - this needs an OpenGL context
+	static void BenchmarkMipGeneration();
+	// time texture decoding, model matrices and culling on the job
+	// system with 1 thread up to one per CPU core - this needs no
+	// OpenGL context
+	static void BenchmarkJobScaling();
+
 	// The following methods are for the students to 
 	// customize for their own 3D scene
 	void PrepareScene();
@@ -112,5 +514,7 @@ public:
 	void SetupSceneLights();
 	// pre-define the object materials for lighting
 	void DefineObjectMaterials();
+	// fill the render table with the objects in the 3D scene
+	void DefineRenderObjects();
 
 };
@@ -0,0 +1,171 @@
+///////////////////////////////////////////////////////////////////////////////
+// tagregistry.cpp
+// ============
+// intern tag names into dense IDs that are looked up by hash
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TagRegistry.h"
+
+#include <iostream>
+#include <cstring>
+
+// declaration of global variables
+namespace
+{
+	// starting size of the lookup table
+	const size_t g_InitialTableSize = 32;
+}
+
+/***********************************************************
+ *  TagRegistry()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TagRegistry::TagRegistry()
+{
+	m_table.assign(g_InitialTableSize, -1);
+}
+
+/***********************************************************
+ *  Intern()
+ *
+ *  This method is used for adding a tag to the registry and
+ *  getting its dense ID.  Two different names with the same
+ *  hash are reported, since Find() by hash alone can then
+ *  only return the first of them.
+ ***********************************************************/
+int TagRegistry::Intern(const char* tag)
+{
+	uint32_t hash = HashTag(tag);
+	int ID = Lookup(hash, tag);
+
+	if (ID >= 0)
+	{
+		return(ID);
+	}
+
+	if (Lookup(hash, NULL) >= 0)
+	{
+		std::cout << "Tag hash collision between:" << tag << " and "
+			<< GetName(Lookup(hash, NULL)) << std::endl;
+	}
+
+	// keep the table at most half full so that probes stay short
+	if ((m_names.size() + 1) * 2 > m_table.size())
+	{
+		Grow();
+	}
+
+	ID = (int)m_names.size();
+	m_names.push_back(tag);
+	m_hashes.push_back(hash);
+
+	size_t mask = m_table.size() - 1;
+	size_t slot = hash & mask;
+	while (m_table[slot] >= 0)
+	{
+		slot = (slot + 1) & mask;
+	}
+	m_table[slot] = ID;
+
+	return(ID);
+}
+
+/***********************************************************
+ *  Find()
+ *
+ *  These methods are used for getting the ID of a tag from
+ *  its name or its hash.  -1 is returned for a missing tag.
+ ***********************************************************/
+int TagRegistry::Find(const char* tag) const
+{
+	if (NULL == tag)
+	{
+		return(-1);
+	}
+
+	return(Lookup(HashTag(tag), tag));
+}
+
+int TagRegistry::Find(uint32_t hash) const
+{
+	return(Lookup(hash, NULL));
+}
+
+/***********************************************************
+ *  GetName()
+ *
+ *  This method is used for getting the name of the tag with
+ *  the passed in ID.
+ ***********************************************************/
+const char* TagRegistry::GetName(int ID) const
+{
+	if ((ID < 0) || (ID >= (int)m_names.size()))
+	{
+		return("");
+	}
+
+	return(m_names[ID].c_str());
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all of the tags.
+ ***********************************************************/
+void TagRegistry::Clear()
+{
+	m_names.clear();
+	m_hashes.clear();
+	m_table.assign(g_InitialTableSize, -1);
+}
+
+/***********************************************************
+ *  Lookup()
+ *
+ *  This method is used for probing the table for a tag with
+ *  the passed in hash.  When a name is passed in, it must
+ *  match as well.
+ ***********************************************************/
+int TagRegistry::Lookup(uint32_t hash, const char* tag) const
+{
+	size_t mask = m_table.size() - 1;
+	size_t slot = hash & mask;
+
+	while (m_table[slot] >= 0)
+	{
+		int ID = m_table[slot];
+
+		if ((m_hashes[ID] == hash) &&
+			((NULL == tag) || (strcmp(m_names[ID].c_str(), tag) == 0)))
+		{
+			return(ID);
+		}
+		slot = (slot + 1) & mask;
+	}
+
+	return(-1);
+}
+
+/***********************************************************
+ *  Grow()
+ *
+ *  This method is used for doubling the size of the table
+ *  and inserting every tag again.
+ ***********************************************************/
+void TagRegistry::Grow()
+{
+	m_table.assign(m_table.size() * 2, -1);
+
+	size_t mask = m_table.size() - 1;
+	for (size_t ID = 0; ID < m_names.size(); ID++)
+	{
+		size_t slot = m_hashes[ID] & mask;
+		while (m_table[slot] >= 0)
+		{
+			slot = (slot + 1) & mask;
+		}
+		m_table[slot] = (int)ID;
+	}
+}
@@ -0,0 +1,89 @@
+///////////////////////////////////////////////////////////////////////////////
+// tagregistry.h
+// ============
+// intern tag names into dense IDs that are looked up by hash
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  HashTag()
+ *
+ *  32-bit FNV-1a hash of a tag name.  It is constexpr, so a
+ *  literal tag can be hashed at compile time.
+ ***********************************************************/
+constexpr uint32_t HashTag(const char* tag, uint32_t hash = 2166136261u)
+{
+	return((*tag == '\0') ? hash :
+		HashTag(tag + 1, (hash ^ (uint32_t)(unsigned char)*tag) * 16777619u));
+}
+
+static_assert(HashTag("") == 2166136261u, "HashTag must be FNV-1a");
+static_assert(HashTag("a") == 0xE40C292Cu, "HashTag must be FNV-1a");
+
+/***********************************************************
+ *  TAG_NAME
+ *
+ *  A tag name with its HashTag() value.  Declared constexpr,
+ *  a literal tag is hashed at compile time and found with
+ *  TagRegistry::Find() by hash alone; the name is kept for
+ *  messages.
+ ***********************************************************/
+struct TAG_NAME
+{
+	const char* name;
+	uint32_t hash;
+
+	constexpr explicit TAG_NAME(const char* tagName)
+		: name(tagName), hash(HashTag(tagName))
+	{
+	}
+};
+
+/***********************************************************
+ *  TagRegistry
+ *
+ *  This class interns tag names into dense IDs - the first
+ *  tag is 0, the next 1, and so on - so that the ID can index
+ *  straight into a table.  Lookups hash the name and probe an
+ *  open-addressed table, with no allocations.
+ ***********************************************************/
+class TagRegistry
+{
+public:
+	// constructor
+	TagRegistry();
+
+	// add a tag and return its ID - a tag that was already added
+	// keeps its ID
+	int Intern(const char* tag);
+	// find the ID of a tag, -1 when it was never added
+	int Find(const char* tag) const;
+	// find the ID of a tag by its HashTag() value, -1 when no tag
+	// has that hash - Intern() reports hashes that are shared
+	int Find(uint32_t hash) const;
+
+	// name of the tag with the passed in ID
+	const char* GetName(int ID) const;
+	// number of tags that have been added
+	int Size() const { return((int)m_names.size()); }
+	// remove all of the tags
+	void Clear();
+
+private:
+	// names and hashes of the tags, indexed by ID
+	std::vector<std::string> m_names;
+	std::vector<uint32_t> m_hashes;
+	// open-addressed table of IDs (-1 = empty), a power of 2 in size
+	std::vector<int> m_table;
+
+	// find the ID of a tag, comparing names when one is passed in
+	int Lookup(uint32_t hash, const char* tag) const;
+	// double the table size and re-insert every tag
+	void Grow();
+};
@@ -0,0 +1,408 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturearrays.cpp
+// ============
+// group same-sized textures into the layers of OpenGL texture arrays
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureArrays.h"
+
+#include <algorithm>
+
+/***********************************************************
+ *  TextureArrays()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureArrays::TextureArrays()
+{
+}
+
+/***********************************************************
+ *  ~TextureArrays()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureArrays::~TextureArrays()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for sorting the passed in textures
+ *  into groups of the same size, format and mip levels, and
+ *  copying every group into the layers of its own texture
+ *  array.  A group that has more textures than an array can
+ *  hold layers is split over several arrays.  New arrays take
+ *  the indices of released ones first, so that the indices
+ *  (and the texture units they are bound to) stay few.
+ ***********************************************************/
+bool TextureArrays::Build(
+	const GLuint* textureIDs,
+	size_t textureCount,
+	std::vector<TEXTURE_LAYER>& layers)
+{
+	std::vector<ARRAY_GROUP> groups;
+	GLint maxLayers = 0;
+	bool bCreated = false;
+	size_t freeIndex = 0;
+
+	TEXTURE_LAYER noLayer;
+	noLayer.arrayIndex = -1;
+	noLayer.layer = -1;
+	layers.assign(textureCount, noLayer);
+
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+	if ((NULL == textureIDs) || (maxLayers <= 0))
+	{
+		return(false);
+	}
+
+	for (size_t i = 0; i < textureCount; i++)
+	{
+		ARRAY_GROUP texture;
+		GLint compressed = GL_FALSE;
+		GLint maxLevel = 0;
+
+		if (textureIDs[i] == 0)
+		{
+			continue;
+		}
+
+		glBindTexture(GL_TEXTURE_2D, textureIDs[i]);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &texture.width);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &texture.height);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &texture.internalFormat);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &compressed);
+		glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+		texture.bCompressed = (compressed == GL_TRUE);
+
+		// count the mip levels that were actually created
+		texture.levelCount = 0;
+		while (texture.levelCount <= maxLevel)
+		{
+			GLint levelWidth = 0;
+
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, texture.levelCount, GL_TEXTURE_WIDTH, &levelWidth);
+			if (levelWidth == 0)
+			{
+				break;
+			}
+			texture.levelCount++;
+		}
+		if ((texture.width == 0) || (texture.height == 0) || (texture.levelCount == 0))
+		{
+			continue;
+		}
+
+		// find a group with the same layout and a free layer
+		size_t group = 0;
+		while (group < groups.size())
+		{
+			const ARRAY_GROUP& other = groups[group];
+
+			if ((other.width == texture.width) &&
+				(other.height == texture.height) &&
+				(other.internalFormat == texture.internalFormat) &&
+				(other.levelCount == texture.levelCount) &&
+				(other.textures.size() < (size_t)maxLayers))
+			{
+				break;
+			}
+			group++;
+		}
+		if (group == groups.size())
+		{
+			groups.push_back(texture);
+		}
+		groups[group].textures.push_back(i);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	for (size_t group = 0; group < groups.size(); group++)
+	{
+		const ARRAY_GROUP& arrayGroup = groups[group];
+		GLuint arrayID = CreateArray(arrayGroup, textureIDs[arrayGroup.textures[0]]);
+
+		if (arrayID == 0)
+		{
+			continue;
+		}
+
+		while ((freeIndex < m_arrays.size()) && (m_arrays[freeIndex] != 0))
+		{
+			freeIndex++;
+		}
+		if (freeIndex == m_arrays.size())
+		{
+			m_arrays.push_back(0);
+		}
+		m_arrays[freeIndex] = arrayID;
+
+		for (size_t layer = 0; layer < arrayGroup.textures.size(); layer++)
+		{
+			size_t texture = arrayGroup.textures[layer];
+
+			CopyLayer(arrayGroup, textureIDs[texture], arrayID, (GLint)layer);
+			layers[texture].arrayIndex = (int)freeIndex;
+			layers[texture].layer = (int)layer;
+		}
+		bCreated = true;
+	}
+
+	return(bCreated);
+}
+
+/***********************************************************
+ *  UpdateLayer()
+ *
+ *  This method is used for writing a new image into the
+ *  layer of a texture, in place, so that the array and the
+ *  layer index stay the same.  Only an uncompressed array
+ *  with the same size, format and number of mip levels as
+ *  the new image can be written.
+ ***********************************************************/
+bool TextureArrays::UpdateLayer(
+	size_t arrayIndex,
+	GLint layer,
+	GLint width,
+	GLint height,
+	GLint colorChannels,
+	const unsigned char* pMipTexels)
+{
+	GLuint arrayID = GetArray(arrayIndex);
+	GLint arrayWidth = 0;
+	GLint arrayHeight = 0;
+	GLint internalFormat = 0;
+	GLint maxLevel = 0;
+	GLint levelCount = 1;
+	GLint previousArray = 0;
+
+	if ((arrayID == 0) || (NULL == pMipTexels) || ((colorChannels != 3) && (colorChannels != 4)))
+	{
+		return(false);
+	}
+
+	// the arrays stay bound to their units while drawing
+	glGetIntegerv(GL_TEXTURE_BINDING_2D_ARRAY, &previousArray);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, arrayID);
+	glGetTexLevelParameteriv(GL_TEXTURE_2D_ARRAY, 0, GL_TEXTURE_WIDTH, &arrayWidth);
+	glGetTexLevelParameteriv(GL_TEXTURE_2D_ARRAY, 0, GL_TEXTURE_HEIGHT, &arrayHeight);
+	glGetTexLevelParameteriv(GL_TEXTURE_2D_ARRAY, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+	glGetTexParameteriv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+	for (GLint levelWidth = width, levelHeight = height; (levelWidth > 1) || (levelHeight > 1); levelCount++)
+	{
+		levelWidth = std::max(1, levelWidth / 2);
+		levelHeight = std::max(1, levelHeight / 2);
+	}
+
+	if ((arrayWidth != width) || (arrayHeight != height) || (maxLevel + 1 != levelCount) ||
+		(internalFormat != ((colorChannels == 3) ? GL_RGB8 : GL_RGBA8)))
+	{
+		glBindTexture(GL_TEXTURE_2D_ARRAY, (GLuint)previousArray);
+		return(false);
+	}
+
+	GLenum format = (colorChannels == 3) ? GL_RGB : GL_RGBA;
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (GLint level = 0; level < levelCount; level++)
+	{
+		GLsizei levelWidth = std::max(1, width >> level);
+		GLsizei levelHeight = std::max(1, height >> level);
+
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, levelWidth, levelHeight, 1,
+			format, GL_UNSIGNED_BYTE, pMipTexels);
+		pMipTexels += (size_t)levelWidth * (size_t)levelHeight * (size_t)colorChannels;
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, (GLuint)previousArray);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Release()
+ *
+ *  This method is used for freeing one texture array, and
+ *  leaving its index free for the next one that is built.
+ ***********************************************************/
+void TextureArrays::Release(size_t arrayIndex)
+{
+	if ((arrayIndex < m_arrays.size()) && (m_arrays[arrayIndex] != 0))
+	{
+		glDeleteTextures(1, &m_arrays[arrayIndex]);
+		m_arrays[arrayIndex] = 0;
+	}
+}
+
+/***********************************************************
+ *  GetArray()
+ *
+ *  This method is used for getting the texture ID of an
+ *  array, which is 0 when there is no such array.
+ ***********************************************************/
+GLuint TextureArrays::GetArray(size_t arrayIndex) const
+{
+	if (arrayIndex >= m_arrays.size())
+	{
+		return(0);
+	}
+
+	return(m_arrays[arrayIndex]);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the texture arrays.
+ ***********************************************************/
+void TextureArrays::Destroy()
+{
+	// released arrays are 0, which glDeleteTextures() ignores
+	if (m_arrays.empty() == false)
+	{
+		glDeleteTextures((GLsizei)m_arrays.size(), m_arrays.data());
+		m_arrays.clear();
+	}
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for binding the texture arrays to
+ *  the texture units that match their indices.  The units
+ *  of released arrays are left with no array.
+ ***********************************************************/
+void TextureArrays::Bind() const
+{
+	for (size_t i = 0; i < m_arrays.size(); i++)
+	{
+		glActiveTexture(GL_TEXTURE0 + (GLenum)i);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, m_arrays[i]);
+	}
+	glActiveTexture(GL_TEXTURE0);
+}
+
+/***********************************************************
+ *  CreateArray()
+ *
+ *  This method is used for creating a texture array with a
+ *  layer for every texture of the group, with the same
+ *  wrapping and filtering as the 2D textures.  The storage
+ *  is immutable when the driver supports it (OpenGL 4.2),
+ *  and allocated one level at a time otherwise.
+ ***********************************************************/
+GLuint TextureArrays::CreateArray(const ARRAY_GROUP& group, GLuint firstTexture)
+{
+	GLuint arrayID = 0;
+	const GLsizei layerCount = (GLsizei)group.textures.size();
+
+	glGenTextures(1, &arrayID);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, arrayID);
+
+	// set the texture wrapping parameters
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	// set texture filtering parameters
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, group.levelCount - 1);
+
+	if (GLEW_VERSION_4_2 || GLEW_ARB_texture_storage)
+	{
+		glTexStorage3D(GL_TEXTURE_2D_ARRAY, group.levelCount, (GLenum)group.internalFormat,
+			group.width, group.height, layerCount);
+	}
+	else
+	{
+		// compressed levels need their size, which the first
+		// texture of the group already knows
+		glBindTexture(GL_TEXTURE_2D, firstTexture);
+		for (GLint level = 0; level < group.levelCount; level++)
+		{
+			GLsizei width = std::max(1, group.width >> level);
+			GLsizei height = std::max(1, group.height >> level);
+
+			if (group.bCompressed)
+			{
+				GLint levelBytes = 0;
+
+				glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &levelBytes);
+				glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, (GLenum)group.internalFormat,
+					width, height, layerCount, 0, levelBytes * layerCount, NULL);
+			}
+			else
+			{
+				glTexImage3D(GL_TEXTURE_2D_ARRAY, level, group.internalFormat,
+					width, height, layerCount, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+			}
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	return(arrayID);
+}
+
+/***********************************************************
+ *  CopyLayer()
+ *
+ *  This method is used for copying every mip level of a 2D
+ *  texture into one layer of a texture array - on the GPU
+ *  when the driver supports image copies, or through a read
+ *  back to system memory otherwise.
+ ***********************************************************/
+void TextureArrays::CopyLayer(const ARRAY_GROUP& group, GLuint textureID, GLuint arrayID, GLint layer)
+{
+	if (GLEW_VERSION_4_3 || GLEW_ARB_copy_image)
+	{
+		for (GLint level = 0; level < group.levelCount; level++)
+		{
+			GLsizei width = std::max(1, group.width >> level);
+			GLsizei height = std::max(1, group.height >> level);
+
+			glCopyImageSubData(
+				textureID, GL_TEXTURE_2D, level, 0, 0, 0,
+				arrayID, GL_TEXTURE_2D_ARRAY, level, 0, 0, layer,
+				width, height, 1);
+		}
+		return;
+	}
+
+	std::vector<unsigned char> texels;
+
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, arrayID);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (GLint level = 0; level < group.levelCount; level++)
+	{
+		GLsizei width = std::max(1, group.width >> level);
+		GLsizei height = std::max(1, group.height >> level);
+
+		if (group.bCompressed)
+		{
+			GLint levelBytes = 0;
+
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &levelBytes);
+			texels.resize((size_t)levelBytes);
+			glGetCompressedTexImage(GL_TEXTURE_2D, level, texels.data());
+			glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, width, height, 1,
+				(GLenum)group.internalFormat, levelBytes, texels.data());
+		}
+		else
+		{
+			texels.resize((size_t)width * (size_t)height * 4);
+			glGetTexImage(GL_TEXTURE_2D, level, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, width, height, 1,
+				GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+		}
+	}
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
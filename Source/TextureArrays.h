@@ -0,0 +1,99 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturearrays.h
+// ============
+// group same-sized textures into the layers of OpenGL texture arrays
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <vector>
+
+/***********************************************************
+ *  TEXTURE_LAYER
+ *
+ *  Where a texture ended up - the index of its texture array
+ *  and its layer in that array.  Both are -1 when the texture
+ *  could not be moved into an array.
+ ***********************************************************/
+struct TEXTURE_LAYER
+{
+	int arrayIndex;
+	int layer;
+};
+
+/***********************************************************
+ *  TextureArrays
+ *
+ *  This class copies finished 2D textures into texture
+ *  arrays, one array for every size and internal format,
+ *  so that a shader picks a texture by layer index instead
+ *  of by texture unit.  Every mip level is copied on the
+ *  GPU with glCopyImageSubData() when the driver supports
+ *  it (OpenGL 4.3), and read back and uploaded again
+ *  otherwise.  Compressed textures stay compressed.
+ ***********************************************************/
+class TextureArrays
+{
+public:
+	// constructor
+	TextureArrays();
+	// destructor
+	~TextureArrays();
+
+	// copy the passed in 2D textures into new texture arrays,
+	// filling the array and layer of every texture in order.  The
+	// 2D textures are left as they are, and so are the arrays that
+	// were built before.  False when no array was created.
+	bool Build(
+		const GLuint* textureIDs,
+		size_t textureCount,
+		std::vector<TEXTURE_LAYER>& layers);
+	// replace the texels of one layer with a mip chain of RGB or
+	// RGBA texels (every level, largest first, tightly packed) -
+	// false when the chain does not match the size, format or
+	// number of levels of the array, which is left as it was
+	bool UpdateLayer(
+		size_t arrayIndex,
+		GLint layer,
+		GLint width,
+		GLint height,
+		GLint colorChannels,
+		const unsigned char* pMipTexels);
+	// free one texture array - its index is reused by the next build
+	void Release(size_t arrayIndex);
+	// free the texture arrays
+	void Destroy();
+
+	// number of array indices, including the released ones
+	size_t GetArrayCount() const { return(m_arrays.size()); }
+	// texture ID of an array - 0 once it has been released
+	GLuint GetArray(size_t arrayIndex) const;
+	// bind every array to the texture unit that matches its index,
+	// starting at GL_TEXTURE0
+	void Bind() const;
+
+private:
+	// textures that share a size, format and number of mip
+	// levels, and so can share one texture array
+	struct ARRAY_GROUP
+	{
+		GLint width;
+		GLint height;
+		GLint internalFormat;
+		GLint levelCount;
+		bool bCompressed;
+		std::vector<size_t> textures;
+	};
+
+	// the created texture arrays, 0 where one was released
+	std::vector<GLuint> m_arrays;
+
+	// allocate the storage of a texture array for a group
+	GLuint CreateArray(const ARRAY_GROUP& group, GLuint firstTexture);
+	// copy every level of a 2D texture into a layer of an array
+	void CopyLayer(const ARRAY_GROUP& group, GLuint textureID, GLuint arrayID, GLint layer);
+};
@@ -0,0 +1,539 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecache.cpp
+// ============
+// bake decoded, mipmapped textures into one file that is memory-mapped
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureCache.h"
+#include "TextureDecoder.h"
+#include "BlockCompression.h"
+#include "MipGenerator.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+	// the texels of every entry start on this alignment
+	const uint64_t g_DataAlignment = 16;
+}
+
+/***********************************************************
+ *  HashSourceFile()
+ *
+ *  This function is used for hashing the bytes of a source
+ *  image file, so that a baked entry can be checked against
+ *  the file it was baked from.
+ ***********************************************************/
+bool HashSourceFile(const char* filename, uint64_t& hash)
+{
+	unsigned char buffer[65536];
+	FILE* pFile = fopen(filename, "rb");
+
+	if (NULL == pFile)
+	{
+		return(false);
+	}
+
+	hash = 14695981039346656037ull;
+	size_t bytesRead = fread(buffer, 1, sizeof(buffer), pFile);
+	while (bytesRead > 0)
+	{
+		for (size_t i = 0; i < bytesRead; i++)
+		{
+			hash = (hash ^ buffer[i]) * 1099511628211ull;
+		}
+		bytesRead = fread(buffer, 1, sizeof(buffer), pFile);
+	}
+	fclose(pFile);
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetCacheLevelBytes()
+ *
+ *  This function is used for getting the number of bytes of
+ *  a mip level, in the format of the passed in entry.
+ ***********************************************************/
+uint64_t GetCacheLevelBytes(const TEXTURE_CACHE_ENTRY& entry, uint32_t width, uint32_t height)
+{
+	uint64_t blocks = (uint64_t)((width + 3) / 4) * (uint64_t)((height + 3) / 4);
+
+	switch (entry.format)
+	{
+	case CACHE_FORMAT_BC1:
+		return(blocks * BC1_BLOCK_BYTES);
+	case CACHE_FORMAT_BC3:
+	case CACHE_FORMAT_BC7:
+		return(blocks * BC3_BLOCK_BYTES);
+	default:
+		return((uint64_t)width * height * entry.colorChannels);
+	}
+}
+
+/***********************************************************
+ *  BakeTextureCache()
+ *
+ *  This function is used for writing the texture cache.  The
+ *  file is written under a temporary name first and then
+ *  renamed, so that a failed bake leaves the old cache as
+ *  it was.  When compressing, every mip level is compressed
+ *  on its own, and the quality of the largest level against
+ *  the decoded source is displayed.
+ ***********************************************************/
+bool BakeTextureCache(
+	const char* cacheName,
+	const char* const* sourceNames,
+	size_t sourceCount,
+	bool bCompress)
+{
+	TextureCache oldCache;
+	TextureDecoder decoder;
+	std::vector<TEXTURE_CACHE_ENTRY> entries;
+	std::vector<std::vector<unsigned char> > texels;
+	std::vector<size_t> decodeIndices;
+	std::vector<MIP_IMAGE> mipImages;
+	const MIP_OPTIONS mipOptions = GetDefaultMipOptions();
+	size_t reusedCount = 0;
+	auto startTime = std::chrono::steady_clock::now();
+
+	oldCache.Open(cacheName);
+
+	for (size_t i = 0; i < sourceCount; i++)
+	{
+		TEXTURE_CACHE_ENTRY entry;
+		uint64_t hash = 0;
+
+		if (strlen(sourceNames[i]) >= (size_t)TEXTURE_CACHE_NAME_LENGTH)
+		{
+			std::cout << "Texture source name is too long to bake:" << sourceNames[i] << std::endl;
+			continue;
+		}
+		if (HashSourceFile(sourceNames[i], hash) == false)
+		{
+			std::cout << "Could not read texture source:" << sourceNames[i] << std::endl;
+			continue;
+		}
+
+		memset(&entry, 0, sizeof(entry));
+		strcpy(entry.sourceName, sourceNames[i]);
+		entry.sourceHash = hash;
+		entries.push_back(entry);
+		texels.push_back(std::vector<unsigned char>());
+
+		// an unchanged source is copied from the old cache
+		const TEXTURE_CACHE_ENTRY* pOldEntry = oldCache.FindEntry(sourceNames[i]);
+		const unsigned char* pTexels = NULL;
+		if ((NULL != pOldEntry) && (pOldEntry->sourceHash == hash) &&
+			((pOldEntry->format != CACHE_FORMAT_RAW) == bCompress) &&
+			(pOldEntry->mipFilter == (uint32_t)mipOptions.filter))
+		{
+			pTexels = oldCache.GetLevel(*pOldEntry, 0, entry.width, entry.height);
+		}
+
+		if (NULL != pTexels)
+		{
+			entries.back() = *pOldEntry;
+			texels.back().assign(pTexels, pTexels + pOldEntry->dataBytes);
+			reusedCount++;
+		}
+		else
+		{
+			decoder.Add(sourceNames[i]);
+			decodeIndices.push_back(entries.size() - 1);
+		}
+	}
+	oldCache.Close();
+
+	double decodeTime = decoder.DecodeAll();
+
+	// the mip chains of every decoded image are filtered together,
+	// so that small images share the threads with large ones
+	mipImages.resize(decoder.Size());
+	for (size_t i = 0; i < decoder.Size(); i++)
+	{
+		const DECODED_IMAGE& image = decoder.GetImage(i);
+
+		if (NULL == image.pixels)
+		{
+			std::cout << "Could not load image:" << image.filename << std::endl;
+			return(false);
+		}
+
+		mipImages[i].pPixels = image.pixels;
+		mipImages[i].width = (uint32_t)image.width;
+		mipImages[i].height = (uint32_t)image.height;
+		mipImages[i].colorChannels = (uint32_t)image.colorChannels;
+	}
+	GenerateMipChains(mipImages.data(), mipImages.size(), mipOptions);
+
+	for (size_t i = 0; i < decoder.Size(); i++)
+	{
+		const MIP_IMAGE& image = mipImages[i];
+		TEXTURE_CACHE_ENTRY& entry = entries[decodeIndices[i]];
+		std::vector<unsigned char>& entryTexels = texels[decodeIndices[i]];
+
+		entry.width = image.width;
+		entry.height = image.height;
+		entry.colorChannels = image.colorChannels;
+		entry.levelCount = CountMipLevels(entry.width, entry.height);
+		entry.format = CACHE_FORMAT_RAW;
+		entry.mipFilter = (uint32_t)mipOptions.filter;
+		entryTexels.swap(mipImages[i].texels);
+
+		if (bCompress && ((entry.colorChannels == 3) || (entry.colorChannels == 4)))
+		{
+			std::vector<unsigned char> compressedTexels;
+			std::vector<unsigned char> levelBlocks;
+			bool bAlpha = (entry.colorChannels == 4);
+			const unsigned char* pLevel = entryTexels.data();
+			uint32_t width = entry.width;
+			uint32_t height = entry.height;
+			double PSNR = 0.0;
+
+			for (uint32_t level = 0; level < entry.levelCount; level++)
+			{
+				CompressImage(pLevel, (int)width, (int)height, (int)entry.colorChannels, bAlpha, levelBlocks);
+				if (level == 0)
+				{
+					PSNR = ComputeCompressedPSNR(pLevel, (int)width, (int)height,
+						(int)entry.colorChannels, bAlpha, levelBlocks.data());
+				}
+				compressedTexels.insert(compressedTexels.end(), levelBlocks.begin(), levelBlocks.end());
+
+				pLevel += (size_t)width * height * entry.colorChannels;
+				width = (width > 1) ? (width / 2) : 1;
+				height = (height > 1) ? (height / 2) : 1;
+			}
+
+			std::cout << "INFO: Texture " << entry.sourceName << (bAlpha ? " BC3: " : " BC1: ")
+				<< compressedTexels.size() << " bytes from " << entryTexels.size()
+				<< ", PSNR: " << PSNR << " dB" << std::endl;
+			entry.format = bAlpha ? CACHE_FORMAT_BC3 : CACHE_FORMAT_BC1;
+			entryTexels.swap(compressedTexels);
+		}
+		entry.dataBytes = entryTexels.size();
+		decoder.Release(i);
+	}
+
+	// the texels follow the index, each entry on an aligned offset
+	uint64_t dataOffset = sizeof(TEXTURE_CACHE_HEADER) + (entries.size() * sizeof(TEXTURE_CACHE_ENTRY));
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		dataOffset = ((dataOffset + g_DataAlignment - 1) / g_DataAlignment) * g_DataAlignment;
+		entries[i].dataOffset = dataOffset;
+		dataOffset += entries[i].dataBytes;
+	}
+
+	std::string tempName = std::string(cacheName) + ".tmp";
+	FILE* pFile = fopen(tempName.c_str(), "wb");
+	if (NULL == pFile)
+	{
+		std::cout << "Could not write texture cache:" << tempName << std::endl;
+		return(false);
+	}
+
+	TEXTURE_CACHE_HEADER header;
+	header.magic = TEXTURE_CACHE_MAGIC;
+	header.version = TEXTURE_CACHE_VERSION;
+	header.entryCount = (uint32_t)entries.size();
+	header.reserved = 0;
+
+	bool bWritten = (fwrite(&header, sizeof(header), 1, pFile) == 1);
+	if (entries.empty() == false)
+	{
+		bWritten = bWritten && (fwrite(entries.data(), sizeof(TEXTURE_CACHE_ENTRY), entries.size(), pFile) == entries.size());
+	}
+	for (size_t i = 0; (i < entries.size()) && bWritten; i++)
+	{
+		const unsigned char padding[g_DataAlignment] = { 0 };
+		long position = ftell(pFile);
+		size_t paddingBytes = (size_t)(entries[i].dataOffset - (uint64_t)position);
+
+		bWritten = (fwrite(padding, 1, paddingBytes, pFile) == paddingBytes) &&
+			(fwrite(texels[i].data(), 1, texels[i].size(), pFile) == texels[i].size());
+	}
+	bWritten = (fclose(pFile) == 0) && bWritten;
+
+	if (bWritten == false)
+	{
+		std::cout << "Could not write texture cache:" << tempName << std::endl;
+		remove(tempName.c_str());
+		return(false);
+	}
+
+	// rename() does not replace an existing file everywhere
+	remove(cacheName);
+	if (rename(tempName.c_str(), cacheName) != 0)
+	{
+		std::cout << "Could not write texture cache:" << cacheName << std::endl;
+		return(false);
+	}
+
+	double bakeTime = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - startTime).count();
+	std::cout << "INFO: Baked " << entries.size() << " textures into " << cacheName
+		<< " (" << dataOffset << " bytes, " << reusedCount << " unchanged, "
+		<< decoder.Size() << " decoded in " << decodeTime << " ms) in " << bakeTime << " ms" << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  TextureCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureCache::TextureCache()
+{
+	m_pData = NULL;
+	m_size = 0;
+	m_pEntries = NULL;
+	m_entryCount = 0;
+#ifdef _WIN32
+	m_fileHandle = INVALID_HANDLE_VALUE;
+	m_mappingHandle = NULL;
+#else
+	m_fileDescriptor = -1;
+#endif
+}
+
+/***********************************************************
+ *  ~TextureCache()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureCache::~TextureCache()
+{
+	Close();
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for mapping a texture cache file into
+ *  memory.  The header and every entry are checked against
+ *  the size of the file, so that a truncated or foreign file
+ *  is never read past its end.
+ ***********************************************************/
+bool TextureCache::Open(const char* cacheName)
+{
+	Close();
+
+#ifdef _WIN32
+	m_fileHandle = CreateFileA(cacheName, GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (m_fileHandle == INVALID_HANDLE_VALUE)
+	{
+		return(false);
+	}
+
+	LARGE_INTEGER fileSize;
+	if ((GetFileSizeEx(m_fileHandle, &fileSize) == FALSE) || (fileSize.QuadPart == 0))
+	{
+		Close();
+		return(false);
+	}
+	m_size = (size_t)fileSize.QuadPart;
+
+	m_mappingHandle = CreateFileMappingA(m_fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (NULL == m_mappingHandle)
+	{
+		Close();
+		return(false);
+	}
+	m_pData = (const unsigned char*)MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0);
+#else
+	struct stat fileInfo;
+
+	m_fileDescriptor = open(cacheName, O_RDONLY);
+	if (m_fileDescriptor < 0)
+	{
+		return(false);
+	}
+	if ((fstat(m_fileDescriptor, &fileInfo) != 0) || (fileInfo.st_size == 0))
+	{
+		Close();
+		return(false);
+	}
+	m_size = (size_t)fileInfo.st_size;
+
+	void* pMapped = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, m_fileDescriptor, 0);
+	m_pData = (pMapped == MAP_FAILED) ? NULL : (const unsigned char*)pMapped;
+#endif
+
+	if (NULL == m_pData)
+	{
+		std::cout << "Could not map texture cache:" << cacheName << std::endl;
+		Close();
+		return(false);
+	}
+
+	const TEXTURE_CACHE_HEADER* pHeader = (const TEXTURE_CACHE_HEADER*)m_pData;
+	if ((m_size < sizeof(TEXTURE_CACHE_HEADER)) ||
+		(pHeader->magic != TEXTURE_CACHE_MAGIC) ||
+		(pHeader->version != TEXTURE_CACHE_VERSION) ||
+		(((m_size - sizeof(TEXTURE_CACHE_HEADER)) / sizeof(TEXTURE_CACHE_ENTRY)) < pHeader->entryCount))
+	{
+		std::cout << "Texture cache is not valid:" << cacheName << std::endl;
+		Close();
+		return(false);
+	}
+
+	m_pEntries = (const TEXTURE_CACHE_ENTRY*)(m_pData + sizeof(TEXTURE_CACHE_HEADER));
+	m_entryCount = pHeader->entryCount;
+	for (uint32_t i = 0; i < m_entryCount; i++)
+	{
+		const TEXTURE_CACHE_ENTRY& entry = m_pEntries[i];
+
+		if ((entry.dataOffset > m_size) || (entry.dataBytes > (m_size - entry.dataOffset)) ||
+			(entry.format > CACHE_FORMAT_BC7) ||
+			(memchr(entry.sourceName, '\0', sizeof(entry.sourceName)) == NULL))
+		{
+			std::cout << "Texture cache is not valid:" << cacheName << std::endl;
+			Close();
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for unmapping the texture cache file.
+ ***********************************************************/
+void TextureCache::Close()
+{
+#ifdef _WIN32
+	if (NULL != m_pData)
+	{
+		UnmapViewOfFile(m_pData);
+	}
+	if (NULL != m_mappingHandle)
+	{
+		CloseHandle(m_mappingHandle);
+		m_mappingHandle = NULL;
+	}
+	if (m_fileHandle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_fileHandle);
+		m_fileHandle = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (NULL != m_pData)
+	{
+		munmap((void*)m_pData, m_size);
+	}
+	if (m_fileDescriptor >= 0)
+	{
+		close(m_fileDescriptor);
+		m_fileDescriptor = -1;
+	}
+#endif
+
+	m_pData = NULL;
+	m_size = 0;
+	m_pEntries = NULL;
+	m_entryCount = 0;
+}
+
+/***********************************************************
+ *  FindEntry()
+ *
+ *  This method is used for finding the entry that was baked
+ *  from the passed in source file.
+ ***********************************************************/
+const TEXTURE_CACHE_ENTRY* TextureCache::FindEntry(const char* sourceName) const
+{
+	for (uint32_t i = 0; i < m_entryCount; i++)
+	{
+		if (strcmp(m_pEntries[i].sourceName, sourceName) == 0)
+		{
+			return(&m_pEntries[i]);
+		}
+	}
+
+	return(NULL);
+}
+
+/***********************************************************
+ *  FindValidEntry()
+ *
+ *  This method is used for finding the entry of a source
+ *  file, as long as the file still has the hash it was baked
+ *  with.  When the source file is not there at all, the
+ *  baked entry is all there is, so it is used as it is.
+ ***********************************************************/
+const TEXTURE_CACHE_ENTRY* TextureCache::FindValidEntry(const char* sourceName) const
+{
+	const TEXTURE_CACHE_ENTRY* pEntry = FindEntry(sourceName);
+	uint64_t hash = 0;
+
+	if (NULL == pEntry)
+	{
+		return(NULL);
+	}
+	if ((HashSourceFile(sourceName, hash) == true) && (hash != pEntry->sourceHash))
+	{
+		std::cout << "INFO: Texture cache entry is out of date:" << sourceName << std::endl;
+		return(NULL);
+	}
+
+	return(pEntry);
+}
+
+/***********************************************************
+ *  GetLevel()
+ *
+ *  This method is used for getting the texels and the size
+ *  of one mip level of an entry.  NULL is returned for a
+ *  level that the entry does not have.
+ ***********************************************************/
+const unsigned char* TextureCache::GetLevel(
+	const TEXTURE_CACHE_ENTRY& entry,
+	uint32_t level,
+	uint32_t& width,
+	uint32_t& height) const
+{
+	uint64_t offset = 0;
+
+	if ((NULL == m_pData) || (level >= entry.levelCount))
+	{
+		return(NULL);
+	}
+
+	width = entry.width;
+	height = entry.height;
+	for (uint32_t i = 0; i < level; i++)
+	{
+		offset += GetCacheLevelBytes(entry, width, height);
+		width = (width > 1) ? (width / 2) : 1;
+		height = (height > 1) ? (height / 2) : 1;
+	}
+
+	if ((offset + GetCacheLevelBytes(entry, width, height)) > entry.dataBytes)
+	{
+		return(NULL);
+	}
+
+	return(m_pData + entry.dataOffset + offset);
+}
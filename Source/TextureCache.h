@@ -0,0 +1,145 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecache.h
+// ============
+// bake decoded, mipmapped textures into one file that is memory-mapped
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// "TXC1" - the first bytes of a texture cache file
+const uint32_t TEXTURE_CACHE_MAGIC = 0x31435854u;
+const uint32_t TEXTURE_CACHE_VERSION = 3;
+// longest source file name that an entry can hold
+const int TEXTURE_CACHE_NAME_LENGTH = 128;
+
+// layout of the texels of a texture cache entry
+enum TEXTURE_CACHE_FORMAT
+{
+	// uncompressed, colorChannels bytes per texel
+	CACHE_FORMAT_RAW = 0,
+	// block compressed, 8 bytes per 4 x 4 block, no alpha
+	CACHE_FORMAT_BC1,
+	// block compressed, 16 bytes per 4 x 4 block, with alpha
+	CACHE_FORMAT_BC3,
+	// block compressed, 16 bytes per 4 x 4 block (BPTC) - only
+	// loaded, from entries written by other tools
+	CACHE_FORMAT_BC7
+};
+
+/***********************************************************
+ *  TEXTURE_CACHE_HEADER
+ *
+ *  Start of a texture cache file.  It is followed by the
+ *  entry index and then the texels of every entry.
+ ***********************************************************/
+struct TEXTURE_CACHE_HEADER
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t reserved;
+};
+
+/***********************************************************
+ *  TEXTURE_CACHE_ENTRY
+ *
+ *  One baked texture.  Its texels are already flipped for
+ *  OpenGL and hold every mip level, largest first, with
+ *  tightly packed rows - each level is half the size of the
+ *  one before, rounded down, and at least 1.  Compressed
+ *  levels take whole 4 x 4 blocks, even when they are
+ *  smaller than a block.
+ ***********************************************************/
+struct TEXTURE_CACHE_ENTRY
+{
+	char sourceName[TEXTURE_CACHE_NAME_LENGTH];
+	// 64-bit FNV-1a hash of the source image file when it was baked
+	uint64_t sourceHash;
+	// offset of the texels from the start of the file
+	uint64_t dataOffset;
+	uint64_t dataBytes;
+	uint32_t width;
+	uint32_t height;
+	uint32_t colorChannels;
+	uint32_t levelCount;
+	// TEXTURE_CACHE_FORMAT of the texels
+	uint32_t format;
+	// MIP_FILTER that the smaller levels were generated with
+	uint32_t mipFilter;
+};
+
+static_assert(sizeof(TEXTURE_CACHE_HEADER) == 16, "texture cache header must be packed");
+static_assert(sizeof(TEXTURE_CACHE_ENTRY) == 176, "texture cache entry must be packed");
+
+// hash the contents of a file with 64-bit FNV-1a, returning false
+// when the file cannot be read
+bool HashSourceFile(const char* filename, uint64_t& hash);
+
+// bytes of one mip level of the passed in size in an entry
+uint64_t GetCacheLevelBytes(const TEXTURE_CACHE_ENTRY& entry, uint32_t width, uint32_t height);
+
+// decode the source image files in parallel, generate their mip
+// levels with the default MIP_OPTIONS and write them all into one
+// texture cache file - block compressed to BC1 or BC3 when bCompress
+// is true.  Sources whose hash, format and mip filter match their
+// entry in the existing cache are copied from it instead of being
+// decoded again.
+bool BakeTextureCache(
+	const char* cacheName,
+	const char* const* sourceNames,
+	size_t sourceCount,
+	bool bCompress);
+
+/***********************************************************
+ *  TextureCache
+ *
+ *  This class memory-maps a baked texture cache file, so
+ *  that the texels can be handed straight to OpenGL from
+ *  the mapped pages without decoding anything.
+ ***********************************************************/
+class TextureCache
+{
+public:
+	// constructor
+	TextureCache();
+	// destructor
+	~TextureCache();
+
+	// map a texture cache file and check its index
+	bool Open(const char* cacheName);
+	// unmap the file
+	void Close();
+	bool IsOpen() const { return(NULL != m_pData); }
+
+	// find the entry baked from the passed in source file - NULL
+	// when it is missing
+	const TEXTURE_CACHE_ENTRY* FindEntry(const char* sourceName) const;
+	// find the entry for a source file only if the file has not
+	// changed since it was baked
+	const TEXTURE_CACHE_ENTRY* FindValidEntry(const char* sourceName) const;
+	// texels of a mip level of an entry, with its size
+	const unsigned char* GetLevel(
+		const TEXTURE_CACHE_ENTRY& entry,
+		uint32_t level,
+		uint32_t& width,
+		uint32_t& height) const;
+
+private:
+	// the mapped file
+	const unsigned char* m_pData;
+	size_t m_size;
+	// the entry index, inside the mapped file
+	const TEXTURE_CACHE_ENTRY* m_pEntries;
+	uint32_t m_entryCount;
+
+#ifdef _WIN32
+	void* m_fileHandle;
+	void* m_mappingHandle;
+#else
+	int m_fileDescriptor;
+#endif
+};
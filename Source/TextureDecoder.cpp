@@ -0,0 +1,138 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturedecoder.cpp
+// ============
+// decode many texture image files in parallel on worker threads
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureDecoder.h"
+#include "JobSystem.h"
+
+#include "stb_image.h"
+
+#include <chrono>
+
+/***********************************************************
+ *  DecodeImageFile()
+ *
+ *  This function is used for decoding one image file and
+ *  timing the decode.  It may be called from any thread, as
+ *  long as the stb_image flip setting is not being changed
+ *  at the same time.
+ ***********************************************************/
+bool DecodeImageFile(DECODED_IMAGE& image)
+{
+	auto startTime = std::chrono::steady_clock::now();
+
+	image.pixels = stbi_load(
+		image.filename.c_str(),
+		&image.width,
+		&image.height,
+		&image.colorChannels,
+		0);
+	image.decodeMilliseconds = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - startTime).count();
+
+	return(NULL != image.pixels);
+}
+
+/***********************************************************
+ *  TextureDecoder()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureDecoder::TextureDecoder()
+{
+}
+
+/***********************************************************
+ *  ~TextureDecoder()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureDecoder::~TextureDecoder()
+{
+	Clear();
+}
+
+/***********************************************************
+ *  Add()
+ *
+ *  This method is used for adding an image file to the list
+ *  of files to decode.
+ ***********************************************************/
+size_t TextureDecoder::Add(const char* filename)
+{
+	DECODED_IMAGE image;
+
+	image.filename = filename;
+	image.pixels = NULL;
+	image.width = 0;
+	image.height = 0;
+	image.colorChannels = 0;
+	image.decodeMilliseconds = 0.0;
+	m_images.push_back(image);
+
+	return(m_images.size() - 1);
+}
+
+/***********************************************************
+ *  DecodeAll()
+ *
+ *  This method is used for decoding every added image file
+ *  on the shared job system.  The threads take the next
+ *  file one at a time, so a large image on one thread does
+ *  not hold up the rest.  Every thread writes only to the
+ *  images it took, so no other locking is needed.
+ ***********************************************************/
+double TextureDecoder::DecodeAll(unsigned int threadCount)
+{
+	auto startTime = std::chrono::steady_clock::now();
+
+	// the flip setting is global in stb_image, so it is set once
+	// here, before any of the threads read it
+	stbi_set_flip_vertically_on_load(true);
+
+	GetJobSystem().ParallelFor(m_images.size(), 1, [this](size_t first, size_t last)
+	{
+		for (size_t i = first; i < last; i++)
+		{
+			DecodeImageFile(m_images[i]);
+		}
+	}, threadCount);
+
+	return(std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - startTime).count());
+}
+
+/***********************************************************
+ *  Release()
+ *
+ *  This method is used for freeing the pixels of a decoded
+ *  image.
+ ***********************************************************/
+void TextureDecoder::Release(size_t index)
+{
+	DECODED_IMAGE& image = m_images[index];
+
+	if (NULL != image.pixels)
+	{
+		stbi_image_free(image.pixels);
+		image.pixels = NULL;
+	}
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for freeing all of the decoded
+ *  pixels and removing all of the files.
+ ***********************************************************/
+void TextureDecoder::Clear()
+{
+	for (size_t i = 0; i < m_images.size(); i++)
+	{
+		Release(i);
+	}
+	m_images.clear();
+}
@@ -0,0 +1,69 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturedecoder.h
+// ============
+// decode many texture image files in parallel on worker threads
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  DECODED_IMAGE
+ *
+ *  Pixels of one decoded image file, along with the time it
+ *  took to decode.  The pixels are NULL when the file could
+ *  not be decoded.
+ ***********************************************************/
+struct DECODED_IMAGE
+{
+	std::string filename;
+	unsigned char* pixels;
+	int width;
+	int height;
+	int colorChannels;
+	double decodeMilliseconds;
+};
+
+// decode the image file named in the passed in image with stb_image,
+// filling in its pixels, size and decode time
+bool DecodeImageFile(DECODED_IMAGE& image);
+
+/***********************************************************
+ *  TextureDecoder
+ *
+ *  This class decodes a list of image files with stb_image
+ *  on the shared job system, so that the decode time of
+ *  a texture set is spread over the CPU cores.  Only the
+ *  decoding happens on the workers - the decoded pixels are
+ *  handed back to the thread that owns the OpenGL context to
+ *  be uploaded.
+ ***********************************************************/
+class TextureDecoder
+{
+public:
+	// constructor
+	TextureDecoder();
+	// destructor
+	~TextureDecoder();
+
+	// add an image file to decode, returning its index
+	size_t Add(const char* filename);
+	// decode every added file, flipped vertically for OpenGL, on
+	// up to threadCount threads (0 = every thread of the job
+	// system) - returns the wall clock time of the whole decode
+	double DecodeAll(unsigned int threadCount = 0);
+
+	size_t Size() const { return(m_images.size()); }
+	// decoded image at the passed in index
+	const DECODED_IMAGE& GetImage(size_t index) const { return(m_images[index]); }
+	// free the pixels of a decoded image once it is uploaded
+	void Release(size_t index);
+	// free all of the pixels and remove all of the files
+	void Clear();
+
+private:
+	std::vector<DECODED_IMAGE> m_images;
+};
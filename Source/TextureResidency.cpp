@@ -0,0 +1,227 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureresidency.cpp
+// ============
+// keep the GPU memory of the loaded textures within a budget
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureResidency.h"
+
+/***********************************************************
+ *  GetTextureMemory()
+ *
+ *  This function is used for adding up the size of every
+ *  mip level of a texture.  Compressed levels report their
+ *  size directly; the others are width x height x layers x
+ *  the bits of their color channels, so driver padding of
+ *  RGB texels is not counted.
+ ***********************************************************/
+size_t GetTextureMemory(GLenum target, GLuint textureID)
+{
+	GLenum bindingQuery = (target == GL_TEXTURE_2D_ARRAY) ? GL_TEXTURE_BINDING_2D_ARRAY : GL_TEXTURE_BINDING_2D;
+	GLint previousTexture = 0;
+	GLint maxLevel = 0;
+	size_t bytes = 0;
+
+	if (textureID == 0)
+	{
+		return(0);
+	}
+
+	glGetIntegerv(bindingQuery, &previousTexture);
+	glBindTexture(target, textureID);
+	glGetTexParameteriv(target, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+
+	for (GLint level = 0; level <= maxLevel; level++)
+	{
+		GLint width = 0;
+		GLint height = 0;
+		GLint depth = 1;
+		GLint compressed = GL_FALSE;
+
+		glGetTexLevelParameteriv(target, level, GL_TEXTURE_WIDTH, &width);
+		glGetTexLevelParameteriv(target, level, GL_TEXTURE_HEIGHT, &height);
+		if ((width == 0) || (height == 0))
+		{
+			break;
+		}
+		if (target == GL_TEXTURE_2D_ARRAY)
+		{
+			glGetTexLevelParameteriv(target, level, GL_TEXTURE_DEPTH, &depth);
+		}
+
+		glGetTexLevelParameteriv(target, level, GL_TEXTURE_COMPRESSED, &compressed);
+		if (compressed == GL_TRUE)
+		{
+			GLint levelBytes = 0;
+
+			glGetTexLevelParameteriv(target, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &levelBytes);
+			bytes += (size_t)levelBytes;
+		}
+		else
+		{
+			GLint redBits = 0;
+			GLint greenBits = 0;
+			GLint blueBits = 0;
+			GLint alphaBits = 0;
+
+			glGetTexLevelParameteriv(target, level, GL_TEXTURE_RED_SIZE, &redBits);
+			glGetTexLevelParameteriv(target, level, GL_TEXTURE_GREEN_SIZE, &greenBits);
+			glGetTexLevelParameteriv(target, level, GL_TEXTURE_BLUE_SIZE, &blueBits);
+			glGetTexLevelParameteriv(target, level, GL_TEXTURE_ALPHA_SIZE, &alphaBits);
+			bytes += (size_t)width * (size_t)height * (size_t)depth *
+				(size_t)((redBits + greenBits + blueBits + alphaBits + 7) / 8);
+		}
+	}
+
+	glBindTexture(target, (GLuint)previousTexture);
+
+	return(bytes);
+}
+
+/***********************************************************
+ *  TextureResidency()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureResidency::TextureResidency()
+{
+	m_budgetBytes = 0;
+	m_residentBytes = 0;
+	m_frame = 0;
+}
+
+/***********************************************************
+ *  Add()
+ *
+ *  This method is used for tracking a texture that is now
+ *  in GPU memory.  It counts as used in the current frame,
+ *  so that it is not evicted before it is drawn.
+ ***********************************************************/
+void TextureResidency::Add(uint32_t key, size_t bytes)
+{
+	auto found = m_indices.find(key);
+
+	if (found != m_indices.end())
+	{
+		RESIDENT_TEXTURE& texture = m_textures[found->second];
+
+		m_residentBytes = m_residentBytes - texture.bytes + bytes;
+		texture.bytes = bytes;
+		texture.lastUsedFrame = m_frame;
+		return;
+	}
+
+	RESIDENT_TEXTURE texture;
+	texture.key = key;
+	texture.bytes = bytes;
+	texture.lastUsedFrame = m_frame;
+	m_indices[key] = m_textures.size();
+	m_textures.push_back(texture);
+	m_residentBytes += bytes;
+}
+
+/***********************************************************
+ *  Remove()
+ *
+ *  This method is used for forgetting a texture that was
+ *  freed.  The last texture takes its place in the list.
+ ***********************************************************/
+void TextureResidency::Remove(uint32_t key)
+{
+	auto found = m_indices.find(key);
+
+	if (found == m_indices.end())
+	{
+		return;
+	}
+
+	size_t index = found->second;
+	m_residentBytes -= m_textures[index].bytes;
+	m_indices.erase(found);
+	if (index != m_textures.size() - 1)
+	{
+		m_textures[index] = m_textures.back();
+		m_indices[m_textures[index].key] = index;
+	}
+	m_textures.pop_back();
+}
+
+/***********************************************************
+ *  IsResident()
+ *
+ *  This method is used for checking if a texture is being
+ *  tracked as resident.
+ ***********************************************************/
+bool TextureResidency::IsResident(uint32_t key) const
+{
+	return(m_indices.find(key) != m_indices.end());
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for forgetting every texture.
+ ***********************************************************/
+void TextureResidency::Clear()
+{
+	m_textures.clear();
+	m_indices.clear();
+	m_residentBytes = 0;
+}
+
+/***********************************************************
+ *  Touch()
+ *
+ *  This method is used for marking a texture as used in the
+ *  current frame.
+ ***********************************************************/
+void TextureResidency::Touch(uint32_t key)
+{
+	auto found = m_indices.find(key);
+
+	if (found != m_indices.end())
+	{
+		m_textures[found->second].lastUsedFrame = m_frame;
+	}
+}
+
+/***********************************************************
+ *  SelectEviction()
+ *
+ *  This method is used for finding the texture that was
+ *  used the longest time ago, when the resident textures
+ *  are over the budget.  Textures that were used in this
+ *  frame or the last one are skipped.
+ ***********************************************************/
+bool TextureResidency::SelectEviction(uint32_t& key) const
+{
+	const RESIDENT_TEXTURE* pOldest = NULL;
+
+	if ((m_budgetBytes == 0) || (m_residentBytes <= m_budgetBytes))
+	{
+		return(false);
+	}
+
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		const RESIDENT_TEXTURE& texture = m_textures[i];
+
+		if (texture.lastUsedFrame + 1 >= m_frame)
+		{
+			continue;
+		}
+		if ((NULL == pOldest) || (texture.lastUsedFrame < pOldest->lastUsedFrame))
+		{
+			pOldest = &texture;
+		}
+	}
+
+	if (NULL == pOldest)
+	{
+		return(false);
+	}
+
+	key = pOldest->key;
+	return(true);
+}
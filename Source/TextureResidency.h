@@ -0,0 +1,76 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureresidency.h
+// ============
+// keep the GPU memory of the loaded textures within a budget
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// estimated bytes of GPU memory that a texture uses, over all of its
+// mip levels and layers - from the sizes OpenGL reports for it
+size_t GetTextureMemory(GLenum target, GLuint textureID);
+
+/***********************************************************
+ *  TextureResidency
+ *
+ *  This class keeps the size of every resident texture and
+ *  the frame it was last used in.  When the total is over
+ *  the budget, it names the least recently used textures
+ *  for the owner to evict - textures used in the last frame
+ *  are never named, so the visible set always stays.  The
+ *  owner decides what a key means and how an evicted
+ *  texture is loaded again.
+ ***********************************************************/
+class TextureResidency
+{
+public:
+	// constructor
+	TextureResidency();
+
+	// most bytes of texture memory to keep - 0 for no limit
+	void SetBudget(size_t budgetBytes) { m_budgetBytes = budgetBytes; }
+	size_t GetBudget() const { return(m_budgetBytes); }
+	size_t GetResidentBytes() const { return(m_residentBytes); }
+	size_t GetResidentCount() const { return(m_textures.size()); }
+
+	// start tracking a resident texture, or change its size
+	void Add(uint32_t key, size_t bytes);
+	// stop tracking a texture that was freed
+	void Remove(uint32_t key);
+	bool IsResident(uint32_t key) const;
+	// forget every texture
+	void Clear();
+
+	// mark a texture as used in the current frame
+	void Touch(uint32_t key);
+	// start the next frame
+	void NextFrame() { m_frame++; }
+
+	// true when over budget, with the least recently used texture
+	// that can be evicted - false when nothing can be evicted
+	bool SelectEviction(uint32_t& key) const;
+
+private:
+	// a texture that is in GPU memory
+	struct RESIDENT_TEXTURE
+	{
+		uint32_t key;
+		size_t bytes;
+		uint64_t lastUsedFrame;
+	};
+
+	size_t m_budgetBytes;
+	size_t m_residentBytes;
+	uint64_t m_frame;
+	// resident textures, and the index of each key in them
+	std::vector<RESIDENT_TEXTURE> m_textures;
+	std::unordered_map<uint32_t, size_t> m_indices;
+};
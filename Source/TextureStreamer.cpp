@@ -0,0 +1,417 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturestreamer.cpp
+// ============
+// stream decoded texture images to OpenGL over several frames
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureStreamer.h"
+#include "JobSystem.h"
+
+#include "stb_image.h"
+
+#include <cstring>
+
+/***********************************************************
+ *  TextureStreamer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureStreamer::TextureStreamer()
+{
+	m_bufferID = 0;
+	m_pMapped = NULL;
+	m_segmentBytes = 0;
+	m_currentSegment = 0;
+	for (int i = 0; i < FRAME_SEGMENTS; i++)
+	{
+		m_segmentFences[i] = NULL;
+	}
+	m_bStopping = false;
+	m_requested = 0;
+	m_completed = 0;
+}
+
+/***********************************************************
+ *  ~TextureStreamer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureStreamer::~TextureStreamer()
+{
+	// the decode jobs that have not started skip their files, and
+	// the ones that have are waited for
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStopping = true;
+	}
+	GetJobSystem().Wait(m_decodeJobs);
+
+	// free the textures that never finished streaming
+	for (size_t i = 0; i < m_uploadQueue.size(); i++)
+	{
+		UPLOAD_JOB& job = m_uploadQueue[i];
+
+		if (NULL != job.image.pixels)
+		{
+			stbi_image_free(job.image.pixels);
+		}
+		if (job.textureID != 0)
+		{
+			glDeleteTextures(1, &job.textureID);
+		}
+	}
+	m_uploadQueue.clear();
+
+	for (int i = 0; i < FRAME_SEGMENTS; i++)
+	{
+		if (NULL != m_segmentFences[i])
+		{
+			glDeleteSync(m_segmentFences[i]);
+			m_segmentFences[i] = NULL;
+		}
+	}
+	if (m_bufferID != 0)
+	{
+		if (NULL != m_pMapped)
+		{
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_bufferID);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			m_pMapped = NULL;
+		}
+		glDeleteBuffers(1, &m_bufferID);
+		m_bufferID = 0;
+	}
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the pixel buffer ring,
+ *  with a segment of frameBudget bytes for every frame.
+ ***********************************************************/
+bool TextureStreamer::Create(size_t frameBudget)
+{
+	const GLsizeiptr bufferBytes = (GLsizeiptr)(frameBudget * FRAME_SEGMENTS);
+
+	if ((m_bufferID != 0) || (frameBudget == 0))
+	{
+		return(false);
+	}
+
+	m_segmentBytes = frameBudget;
+	m_currentSegment = FRAME_SEGMENTS - 1;
+
+	glGenBuffers(1, &m_bufferID);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_bufferID);
+	if (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage)
+	{
+		// the ring stays mapped for the life of the streamer
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+		glBufferStorage(GL_PIXEL_UNPACK_BUFFER, bufferBytes, NULL, flags);
+		m_pMapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bufferBytes, flags);
+	}
+	else
+	{
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, bufferBytes, NULL, GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	// the flip setting is global in stb_image, so it is set once
+	// here, before any of the decode jobs read it
+	stbi_set_flip_vertically_on_load(true);
+
+	return(m_bufferID != 0);
+}
+
+/***********************************************************
+ *  Request()
+ *
+ *  This method is used for queueing an image file to be
+ *  decoded by a job on the shared job system.
+ ***********************************************************/
+void TextureStreamer::Request(int slot, const char* filename)
+{
+	DECODE_REQUEST request;
+
+	request.slot = slot;
+	request.filename = filename;
+	request.requestTime = std::chrono::steady_clock::now();
+
+	GetJobSystem().Run([this, request]() { DecodeRequest(request); }, &m_decodeJobs);
+	m_requested++;
+}
+
+/***********************************************************
+ *  DecodeRequest()
+ *
+ *  This method is run by the decode job of every request.
+ *  It decodes the image file and hands the decoded pixels
+ *  to the OpenGL thread through the upload queue.
+ ***********************************************************/
+void TextureStreamer::DecodeRequest(const DECODE_REQUEST& request)
+{
+	UPLOAD_JOB job;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_bStopping)
+		{
+			return;
+		}
+	}
+
+	job.slot = request.slot;
+	job.requestTime = request.requestTime;
+	job.textureID = 0;
+	job.nextRow = 0;
+	job.uploadMilliseconds = 0.0;
+	job.image.filename = request.filename;
+	job.image.pixels = NULL;
+	job.image.width = 0;
+	job.image.height = 0;
+	job.image.colorChannels = 0;
+	DecodeImageFile(job.image);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_uploadQueue.push_back(job);
+	}
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for moving on to the next segment of
+ *  the ring and copying as many rows of the decoded images
+ *  as fit in it.  Images are finished in the order that they
+ *  were decoded, and a large image is spread over as many
+ *  frames as it needs.
+ ***********************************************************/
+size_t TextureStreamer::Update(std::vector<STREAMED_TEXTURE>& completed)
+{
+	size_t completedCount = 0;
+	size_t segmentOffset = 0;
+
+	if ((m_bufferID == 0) || IsIdle())
+	{
+		return(0);
+	}
+
+	m_currentSegment = (m_currentSegment + 1) % FRAME_SEGMENTS;
+	GLsync fence = m_segmentFences[m_currentSegment];
+	if (NULL != fence)
+	{
+		glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, (GLuint64)1000000000);
+		glDeleteSync(fence);
+		m_segmentFences[m_currentSegment] = NULL;
+	}
+
+	while (segmentOffset < m_segmentBytes)
+	{
+		UPLOAD_JOB* pJob = NULL;
+
+		{
+			// references to deque elements stay valid while the
+			// workers push more jobs onto the back
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_uploadQueue.empty() == false)
+			{
+				pJob = &m_uploadQueue.front();
+			}
+		}
+		if (NULL == pJob)
+		{
+			break;
+		}
+
+		bool bFailed = (NULL == pJob->image.pixels) ||
+			((pJob->image.colorChannels != 3) && (pJob->image.colorChannels != 4));
+		if (bFailed == false)
+		{
+			if (pJob->textureID == 0)
+			{
+				BeginUpload(*pJob);
+			}
+
+			size_t bytesCopied = UploadRows(*pJob, segmentOffset, m_segmentBytes - segmentOffset);
+			segmentOffset += bytesCopied;
+
+			if (pJob->nextRow < pJob->image.height)
+			{
+				// the rest of the image waits for the next frame
+				if (bytesCopied == 0)
+				{
+					break;
+				}
+				continue;
+			}
+		}
+
+		completed.push_back(FinishUpload(*pJob));
+		completedCount++;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_uploadQueue.pop_front();
+		}
+	}
+
+	if (segmentOffset > 0)
+	{
+		m_segmentFences[m_currentSegment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	return(completedCount);
+}
+
+/***********************************************************
+ *  BeginUpload()
+ *
+ *  This method is used for creating the texture of a job
+ *  with storage for the full image, which is then filled in
+ *  by UploadRows().
+ ***********************************************************/
+void TextureStreamer::BeginUpload(UPLOAD_JOB& job)
+{
+	const DECODED_IMAGE& image = job.image;
+	GLenum format = (image.colorChannels == 3) ? GL_RGB : GL_RGBA;
+	GLint internalFormat = (image.colorChannels == 3) ? GL_RGB8 : GL_RGBA8;
+
+	glGenTextures(1, &job.textureID);
+	glBindTexture(GL_TEXTURE_2D, job.textureID);
+
+	// set the texture wrapping parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	// set texture filtering parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, NULL);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+/***********************************************************
+ *  UploadRows()
+ *
+ *  This method is used for copying as many whole rows of a
+ *  job as fit in maxBytes into the ring, and from there into
+ *  the texture.  A single row larger than a whole segment is
+ *  copied straight from the decoded pixels instead.
+ ***********************************************************/
+size_t TextureStreamer::UploadRows(UPLOAD_JOB& job, size_t segmentOffset, size_t maxBytes)
+{
+	const DECODED_IMAGE& image = job.image;
+	const size_t rowBytes = (size_t)image.width * (size_t)image.colorChannels;
+	GLenum format = (image.colorChannels == 3) ? GL_RGB : GL_RGBA;
+	int rows = image.height - job.nextRow;
+	size_t bytesCopied = 0;
+	auto startTime = std::chrono::steady_clock::now();
+
+	if ((size_t)rows > (maxBytes / rowBytes))
+	{
+		rows = (int)(maxBytes / rowBytes);
+	}
+	if ((rows == 0) && ((segmentOffset != 0) || (rowBytes <= m_segmentBytes)))
+	{
+		return(0);
+	}
+
+	const unsigned char* pRows = image.pixels + ((size_t)job.nextRow * rowBytes);
+
+	glBindTexture(GL_TEXTURE_2D, job.textureID);
+	// the rows are tightly packed, whatever the width
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	if (rows == 0)
+	{
+		rows = 1;
+		bytesCopied = rowBytes;
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, job.nextRow, image.width, rows, format, GL_UNSIGNED_BYTE, pRows);
+	}
+	else
+	{
+		size_t bufferOffset = (m_segmentBytes * m_currentSegment) + segmentOffset;
+		bytesCopied = (size_t)rows * rowBytes;
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_bufferID);
+		if (NULL != m_pMapped)
+		{
+			memcpy(m_pMapped + bufferOffset, pRows, bytesCopied);
+		}
+		else
+		{
+			// the segment fence already made sure that the GPU is
+			// done with this range, so the driver does not need to sync
+			void* pMapped = glMapBufferRange(
+				GL_PIXEL_UNPACK_BUFFER,
+				(GLintptr)bufferOffset,
+				(GLsizeiptr)bytesCopied,
+				GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+			if (NULL == pMapped)
+			{
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+				glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+				glBindTexture(GL_TEXTURE_2D, 0);
+				return(0);
+			}
+			memcpy(pMapped, pRows, bytesCopied);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		}
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, job.nextRow, image.width, rows, format, GL_UNSIGNED_BYTE,
+			(void*)bufferOffset);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	job.nextRow += rows;
+	job.uploadMilliseconds += std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - startTime).count();
+
+	return(bytesCopied);
+}
+
+/***********************************************************
+ *  FinishUpload()
+ *
+ *  This method is used for generating the mipmaps of a
+ *  completed texture, freeing its decoded pixels and filling
+ *  in the completed texture.
+ ***********************************************************/
+STREAMED_TEXTURE TextureStreamer::FinishUpload(UPLOAD_JOB& job)
+{
+	STREAMED_TEXTURE texture;
+
+	if (job.textureID != 0)
+	{
+		glBindTexture(GL_TEXTURE_2D, job.textureID);
+		// generate the texture mipmaps for mapping textures to lower resolutions
+		glGenerateMipmap(GL_TEXTURE_2D);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	texture.slot = job.slot;
+	texture.textureID = job.textureID;
+	texture.filename = job.image.filename;
+	texture.width = job.image.width;
+	texture.height = job.image.height;
+	texture.colorChannels = job.image.colorChannels;
+	texture.decodeMilliseconds = job.image.decodeMilliseconds;
+	texture.uploadMilliseconds = job.uploadMilliseconds;
+	texture.readyMilliseconds = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - job.requestTime).count();
+
+	if (NULL != job.image.pixels)
+	{
+		stbi_image_free(job.image.pixels);
+		job.image.pixels = NULL;
+	}
+	job.textureID = 0;
+	m_completed++;
+
+	return(texture);
+}
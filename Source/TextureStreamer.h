@@ -0,0 +1,129 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturestreamer.h
+// ============
+// stream decoded texture images to OpenGL over several frames
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TextureDecoder.h"
+#include "JobSystem.h"
+
+#include <GL/glew.h>
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+/***********************************************************
+ *  STREAMED_TEXTURE
+ *
+ *  A texture that finished streaming, to be swapped in for
+ *  the placeholder of its slot.  The texture ID is 0 when
+ *  the image file could not be decoded.
+ ***********************************************************/
+struct STREAMED_TEXTURE
+{
+	int slot;
+	GLuint textureID;
+	std::string filename;
+	int width;
+	int height;
+	int colorChannels;
+	// time spent decoding on a worker thread
+	double decodeMilliseconds;
+	// time spent copying rows on the OpenGL thread, over all frames
+	double uploadMilliseconds;
+	// time from the request until the texture was complete
+	double readyMilliseconds;
+};
+
+/***********************************************************
+ *  TextureStreamer
+ *
+ *  This class decodes requested image files with jobs on
+ *  the shared job system and uploads them a few rows at a
+ *  time through a ring of pixel buffer object segments, one
+ *  segment per frame, so that no frame copies more than the
+ *  upload budget.  The ring is persistently mapped when the driver
+ *  supports buffer storage (OpenGL 4.4), and mapped once per
+ *  frame otherwise.  A fence per segment keeps the CPU from
+ *  writing rows the GPU has not read yet.
+ ***********************************************************/
+class TextureStreamer
+{
+public:
+	// number of frame segments in the pixel buffer ring
+	static const int FRAME_SEGMENTS = 3;
+
+	// constructor
+	TextureStreamer();
+	// destructor
+	~TextureStreamer();
+
+	// create the pixel buffer ring with room for frameBudget bytes
+	// in every frame
+	bool Create(size_t frameBudget);
+	bool IsCreated() const { return(m_bufferID != 0); }
+
+	// queue an image file to be decoded and streamed into a new
+	// texture for the passed in slot
+	void Request(int slot, const char* filename);
+	// true when every requested texture has been completed
+	bool IsIdle() const { return(m_requested == m_completed); }
+
+	// upload up to the frame budget of rows - call once per frame
+	// on the OpenGL thread.  Textures that finished are added to
+	// the completed list, and the number added is returned.
+	size_t Update(std::vector<STREAMED_TEXTURE>& completed);
+
+private:
+	// a decode request waiting for its job to run
+	struct DECODE_REQUEST
+	{
+		int slot;
+		std::string filename;
+		std::chrono::steady_clock::time_point requestTime;
+	};
+	// a decoded image being copied into its texture
+	struct UPLOAD_JOB
+	{
+		int slot;
+		DECODED_IMAGE image;
+		std::chrono::steady_clock::time_point requestTime;
+		GLuint textureID;
+		// first row that has not been copied yet
+		int nextRow;
+		double uploadMilliseconds;
+	};
+
+	// pixel buffer ring
+	GLuint m_bufferID;
+	// persistent mapping of the ring, NULL when it is mapped per frame
+	unsigned char* m_pMapped;
+	size_t m_segmentBytes;
+	int m_currentSegment;
+	GLsync m_segmentFences[FRAME_SEGMENTS];
+
+	// decode jobs and the queue they share with the OpenGL thread
+	JobCounter m_decodeJobs;
+	std::mutex m_mutex;
+	std::deque<UPLOAD_JOB> m_uploadQueue;
+	bool m_bStopping;
+
+	// counts of requested and completed textures, OpenGL thread only
+	size_t m_requested;
+	size_t m_completed;
+
+	// decode the image file of a request, on a job
+	void DecodeRequest(const DECODE_REQUEST& request);
+	// create the texture of a job at its full size
+	void BeginUpload(UPLOAD_JOB& job);
+	// copy rows of a job into its texture, up to the passed in
+	// number of bytes, returning the number of bytes copied
+	size_t UploadRows(UPLOAD_JOB& job, size_t segmentOffset, size_t maxBytes);
+	// fill in the completed texture for a job and free its pixels
+	STREAMED_TEXTURE FinishUpload(UPLOAD_JOB& job);
+};
@@ -0,0 +1,711 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformbatch.cpp
+// ============
+// compose the model matrices of many objects in one SIMD pass
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TransformBatch.h"
+#include "SceneManager.h"
+#include "JobSystem.h"
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+// the SIMD paths are only available on x86 processors
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define TRANSFORM_BATCH_SIMD
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define TARGET_SSE2
+#define TARGET_AVX2
+#else
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// declaration of global variables
+namespace
+{
+	// constants for the sin/cos approximation (Cephes single precision),
+	// shared by the scalar and SIMD paths so that both give the same bits
+	const float g_DegreesToRadians = 0.01745329251994329577f;
+	const float g_FourOverPi = 1.27323954473516f;
+	const float g_DP1 = -0.78515625f;
+	const float g_DP2 = -2.4187564849853515625e-4f;
+	const float g_DP3 = -3.77489497744594108e-8f;
+	const float g_SinCoef0 = -1.9515295891e-4f;
+	const float g_SinCoef1 = 8.3321608736e-3f;
+	const float g_SinCoef2 = -1.6666654611e-1f;
+	const float g_CosCoef0 = 2.443315711809948e-5f;
+	const float g_CosCoef1 = -1.388731625493765e-3f;
+	const float g_CosCoef2 = 4.166664568298827e-2f;
+	// largest difference from the glm path the benchmark accepts,
+	// relative to the object scale - the sin/cos approximation is
+	// good to about 3e-7
+	const float g_MaxModelMatrixError = 1.0e-5f;
+
+	// instruction sets that can be used for a batch
+	enum BATCH_PATH
+	{
+		PATH_SCALAR = 0,
+		PATH_SSE2,
+		PATH_AVX2
+	};
+
+	/***********************************************************
+	 *  SinCosDegrees()
+	 *
+	 *  Calculate the sine and cosine of an angle in degrees.
+	 ***********************************************************/
+	void SinCosDegrees(float degrees, float& sinValue, float& cosValue)
+	{
+		float x = degrees * g_DegreesToRadians;
+		bool bNegative = std::signbit(x);
+		x = std::fabs(x);
+
+		// reduce the angle into [-pi/4, pi/4] and remember the octant
+		int octant = (int)(x * g_FourOverPi);
+		octant = (octant + 1) & ~1;
+		float y = (float)octant;
+		x = ((x + y * g_DP1) + y * g_DP2) + y * g_DP3;
+
+		float z = x * x;
+		float cosPoly = ((g_CosCoef0 * z + g_CosCoef1) * z + g_CosCoef2) * z * z - z * 0.5f + 1.0f;
+		float sinPoly = ((g_SinCoef0 * z + g_SinCoef1) * z + g_SinCoef2) * z * x + x;
+
+		bool bSwap = ((octant & 2) != 0);
+		sinValue = bSwap ? cosPoly : sinPoly;
+		cosValue = bSwap ? sinPoly : cosPoly;
+
+		if (bNegative != ((octant & 4) != 0))
+			sinValue = -sinValue;
+		if (((octant - 2) & 4) == 0)
+			cosValue = -cosValue;
+	}
+
+#ifdef TRANSFORM_BATCH_SIMD
+	/***********************************************************
+	 *  SinCosDegrees4()
+	 *
+	 *  SSE2 version of SinCosDegrees() for 4 angles at once.
+	 ***********************************************************/
+	TARGET_SSE2 void SinCosDegrees4(__m128 degrees, __m128& sinValue, __m128& cosValue)
+	{
+		const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+		__m128 x = _mm_mul_ps(degrees, _mm_set1_ps(g_DegreesToRadians));
+		__m128 sinSign = _mm_and_ps(x, signMask);
+		x = _mm_andnot_ps(signMask, x);
+
+		__m128i octant = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(g_FourOverPi)));
+		octant = _mm_and_si128(_mm_add_epi32(octant, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+		__m128 y = _mm_cvtepi32_ps(octant);
+
+		__m128 sinSwap = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(octant, _mm_set1_epi32(4)), 29));
+		__m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(
+			_mm_andnot_si128(_mm_sub_epi32(octant, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+		__m128 polyMask = _mm_castsi128_ps(_mm_cmpeq_epi32(
+			_mm_and_si128(octant, _mm_set1_epi32(2)), _mm_setzero_si128()));
+		sinSign = _mm_xor_ps(sinSign, sinSwap);
+
+		x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(g_DP1)));
+		x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(g_DP2)));
+		x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(g_DP3)));
+		__m128 z = _mm_mul_ps(x, x);
+
+		__m128 cosPoly = _mm_mul_ps(_mm_set1_ps(g_CosCoef0), z);
+		cosPoly = _mm_mul_ps(_mm_add_ps(cosPoly, _mm_set1_ps(g_CosCoef1)), z);
+		cosPoly = _mm_mul_ps(_mm_add_ps(cosPoly, _mm_set1_ps(g_CosCoef2)), z);
+		cosPoly = _mm_mul_ps(cosPoly, z);
+		cosPoly = _mm_sub_ps(cosPoly, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+		cosPoly = _mm_add_ps(cosPoly, _mm_set1_ps(1.0f));
+
+		__m128 sinPoly = _mm_mul_ps(_mm_set1_ps(g_SinCoef0), z);
+		sinPoly = _mm_mul_ps(_mm_add_ps(sinPoly, _mm_set1_ps(g_SinCoef1)), z);
+		sinPoly = _mm_mul_ps(_mm_add_ps(sinPoly, _mm_set1_ps(g_SinCoef2)), z);
+		sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, x), x);
+
+		__m128 sinResult = _mm_or_ps(_mm_and_ps(polyMask, sinPoly), _mm_andnot_ps(polyMask, cosPoly));
+		__m128 cosResult = _mm_or_ps(_mm_and_ps(polyMask, cosPoly), _mm_andnot_ps(polyMask, sinPoly));
+		sinValue = _mm_xor_ps(sinResult, sinSign);
+		cosValue = _mm_xor_ps(cosResult, cosSign);
+	}
+
+	/***********************************************************
+	 *  StoreMatrices4()
+	 *
+	 *  Transpose 4 objects worth of matrix elements, held one
+	 *  element per register, into 4 column-major matrices.
+	 ***********************************************************/
+	TARGET_SSE2 void StoreMatrices4(__m128 elements[4][4], float* output)
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			__m128 row0 = elements[column][0];
+			__m128 row1 = elements[column][1];
+			__m128 row2 = elements[column][2];
+			__m128 row3 = elements[column][3];
+			_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+			_mm_storeu_ps(output + 0 * 16 + column * 4, row0);
+			_mm_storeu_ps(output + 1 * 16 + column * 4, row1);
+			_mm_storeu_ps(output + 2 * 16 + column * 4, row2);
+			_mm_storeu_ps(output + 3 * 16 + column * 4, row3);
+		}
+	}
+
+	/***********************************************************
+	 *  ComposeModelMatricesSSE2()
+	 *
+	 *  Compose the model matrices 4 objects at a time, and
+	 *  return how many objects were composed.
+	 ***********************************************************/
+	TARGET_SSE2 size_t ComposeModelMatricesSSE2(
+		const TRANSFORM_ARRAYS& transforms,
+		size_t count,
+		float* output)
+	{
+		size_t index = 0;
+		__m128 elements[4][4];
+
+		for (; index + 4 <= count; index += 4)
+		{
+			__m128 sinX, cosX, sinY, cosY, sinZ, cosZ;
+			SinCosDegrees4(_mm_loadu_ps(transforms.rotationX + index), sinX, cosX);
+			SinCosDegrees4(_mm_loadu_ps(transforms.rotationY + index), sinY, cosY);
+			SinCosDegrees4(_mm_loadu_ps(transforms.rotationZ + index), sinZ, cosZ);
+			__m128 scaleX = _mm_loadu_ps(transforms.scaleX + index);
+			__m128 scaleY = _mm_loadu_ps(transforms.scaleY + index);
+			__m128 scaleZ = _mm_loadu_ps(transforms.scaleZ + index);
+			__m128 sinXsinY = _mm_mul_ps(sinX, sinY);
+			__m128 cosXsinY = _mm_mul_ps(cosX, sinY);
+			__m128 zero = _mm_setzero_ps();
+
+			elements[0][0] = _mm_mul_ps(_mm_mul_ps(cosY, cosZ), scaleX);
+			elements[0][1] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(cosX, sinZ), _mm_mul_ps(sinXsinY, cosZ)), scaleX);
+			elements[0][2] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(sinX, sinZ), _mm_mul_ps(cosXsinY, cosZ)), scaleX);
+			elements[0][3] = zero;
+			elements[1][0] = _mm_mul_ps(_mm_sub_ps(zero, _mm_mul_ps(cosY, sinZ)), scaleY);
+			elements[1][1] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(cosX, cosZ), _mm_mul_ps(sinXsinY, sinZ)), scaleY);
+			elements[1][2] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(sinX, cosZ), _mm_mul_ps(cosXsinY, sinZ)), scaleY);
+			elements[1][3] = zero;
+			elements[2][0] = _mm_mul_ps(sinY, scaleZ);
+			elements[2][1] = _mm_mul_ps(_mm_sub_ps(zero, _mm_mul_ps(sinX, cosY)), scaleZ);
+			elements[2][2] = _mm_mul_ps(_mm_mul_ps(cosX, cosY), scaleZ);
+			elements[2][3] = zero;
+			elements[3][0] = _mm_loadu_ps(transforms.positionX + index);
+			elements[3][1] = _mm_loadu_ps(transforms.positionY + index);
+			elements[3][2] = _mm_loadu_ps(transforms.positionZ + index);
+			elements[3][3] = _mm_set1_ps(1.0f);
+
+			StoreMatrices4(elements, output + index * 16);
+		}
+
+		return(index);
+	}
+
+	/***********************************************************
+	 *  ComposeModelMatricesAVX2()
+	 *
+	 *  Compose the model matrices 8 objects at a time, and
+	 *  return how many objects were composed.
+	 ***********************************************************/
+	TARGET_AVX2 size_t ComposeModelMatricesAVX2(
+		const TRANSFORM_ARRAYS& transforms,
+		size_t count,
+		float* output)
+	{
+		const __m256 signMask = _mm256_castsi256_ps(_mm256_set1_epi32((int)0x80000000));
+		size_t index = 0;
+
+		for (; index + 8 <= count; index += 8)
+		{
+			__m256 sinValue[3];
+			__m256 cosValue[3];
+			const float* rotations[3] = {
+				transforms.rotationX + index,
+				transforms.rotationY + index,
+				transforms.rotationZ + index };
+
+			// same steps as SinCosDegrees4(), 8 angles at a time
+			for (int axis = 0; axis < 3; axis++)
+			{
+				__m256 x = _mm256_mul_ps(_mm256_loadu_ps(rotations[axis]), _mm256_set1_ps(g_DegreesToRadians));
+				__m256 sinSign = _mm256_and_ps(x, signMask);
+				x = _mm256_andnot_ps(signMask, x);
+
+				__m256i octant = _mm256_cvttps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(g_FourOverPi)));
+				octant = _mm256_and_si256(_mm256_add_epi32(octant, _mm256_set1_epi32(1)), _mm256_set1_epi32(~1));
+				__m256 y = _mm256_cvtepi32_ps(octant);
+
+				__m256 sinSwap = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(octant, _mm256_set1_epi32(4)), 29));
+				__m256 cosSign = _mm256_castsi256_ps(_mm256_slli_epi32(
+					_mm256_andnot_si256(_mm256_sub_epi32(octant, _mm256_set1_epi32(2)), _mm256_set1_epi32(4)), 29));
+				__m256 polyMask = _mm256_castsi256_ps(_mm256_cmpeq_epi32(
+					_mm256_and_si256(octant, _mm256_set1_epi32(2)), _mm256_setzero_si256()));
+				sinSign = _mm256_xor_ps(sinSign, sinSwap);
+
+				x = _mm256_add_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(g_DP1)));
+				x = _mm256_add_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(g_DP2)));
+				x = _mm256_add_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(g_DP3)));
+				__m256 z = _mm256_mul_ps(x, x);
+
+				__m256 cosPoly = _mm256_mul_ps(_mm256_set1_ps(g_CosCoef0), z);
+				cosPoly = _mm256_mul_ps(_mm256_add_ps(cosPoly, _mm256_set1_ps(g_CosCoef1)), z);
+				cosPoly = _mm256_mul_ps(_mm256_add_ps(cosPoly, _mm256_set1_ps(g_CosCoef2)), z);
+				cosPoly = _mm256_mul_ps(cosPoly, z);
+				cosPoly = _mm256_sub_ps(cosPoly, _mm256_mul_ps(z, _mm256_set1_ps(0.5f)));
+				cosPoly = _mm256_add_ps(cosPoly, _mm256_set1_ps(1.0f));
+
+				__m256 sinPoly = _mm256_mul_ps(_mm256_set1_ps(g_SinCoef0), z);
+				sinPoly = _mm256_mul_ps(_mm256_add_ps(sinPoly, _mm256_set1_ps(g_SinCoef1)), z);
+				sinPoly = _mm256_mul_ps(_mm256_add_ps(sinPoly, _mm256_set1_ps(g_SinCoef2)), z);
+				sinPoly = _mm256_add_ps(_mm256_mul_ps(sinPoly, x), x);
+
+				sinValue[axis] = _mm256_xor_ps(_mm256_blendv_ps(cosPoly, sinPoly, polyMask), sinSign);
+				cosValue[axis] = _mm256_xor_ps(_mm256_blendv_ps(sinPoly, cosPoly, polyMask), cosSign);
+			}
+
+			__m256 sinX = sinValue[0], cosX = cosValue[0];
+			__m256 sinY = sinValue[1], cosY = cosValue[1];
+			__m256 sinZ = sinValue[2], cosZ = cosValue[2];
+			__m256 scaleX = _mm256_loadu_ps(transforms.scaleX + index);
+			__m256 scaleY = _mm256_loadu_ps(transforms.scaleY + index);
+			__m256 scaleZ = _mm256_loadu_ps(transforms.scaleZ + index);
+			__m256 sinXsinY = _mm256_mul_ps(sinX, sinY);
+			__m256 cosXsinY = _mm256_mul_ps(cosX, sinY);
+			__m256 zero = _mm256_setzero_ps();
+			__m256 elements[4][4];
+
+			elements[0][0] = _mm256_mul_ps(_mm256_mul_ps(cosY, cosZ), scaleX);
+			elements[0][1] = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(cosX, sinZ), _mm256_mul_ps(sinXsinY, cosZ)), scaleX);
+			elements[0][2] = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(sinX, sinZ), _mm256_mul_ps(cosXsinY, cosZ)), scaleX);
+			elements[0][3] = zero;
+			elements[1][0] = _mm256_mul_ps(_mm256_sub_ps(zero, _mm256_mul_ps(cosY, sinZ)), scaleY);
+			elements[1][1] = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(cosX, cosZ), _mm256_mul_ps(sinXsinY, sinZ)), scaleY);
+			elements[1][2] = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(sinX, cosZ), _mm256_mul_ps(cosXsinY, sinZ)), scaleY);
+			elements[1][3] = zero;
+			elements[2][0] = _mm256_mul_ps(sinY, scaleZ);
+			elements[2][1] = _mm256_mul_ps(_mm256_sub_ps(zero, _mm256_mul_ps(sinX, cosY)), scaleZ);
+			elements[2][2] = _mm256_mul_ps(_mm256_mul_ps(cosX, cosY), scaleZ);
+			elements[2][3] = zero;
+			elements[3][0] = _mm256_loadu_ps(transforms.positionX + index);
+			elements[3][1] = _mm256_loadu_ps(transforms.positionY + index);
+			elements[3][2] = _mm256_loadu_ps(transforms.positionZ + index);
+			elements[3][3] = _mm256_set1_ps(1.0f);
+
+			// write the 8 matrices as two groups of 4
+			__m128 lowHalf[4][4];
+			__m128 highHalf[4][4];
+			for (int column = 0; column < 4; column++)
+			{
+				for (int row = 0; row < 4; row++)
+				{
+					lowHalf[column][row] = _mm256_castps256_ps128(elements[column][row]);
+					highHalf[column][row] = _mm256_extractf128_ps(elements[column][row], 1);
+				}
+			}
+			StoreMatrices4(lowHalf, output + index * 16);
+			StoreMatrices4(highHalf, output + (index + 4) * 16);
+		}
+
+		return(index);
+	}
+
+	/***********************************************************
+	 *  DetectBatchPath()
+	 *
+	 *  Find the widest instruction set that the CPU and the
+	 *  operating system both support.
+	 ***********************************************************/
+	BATCH_PATH DetectBatchPath()
+	{
+#if defined(_MSC_VER)
+		int cpuInfo[4] = { 0 };
+		__cpuid(cpuInfo, 0);
+		int maxLeaf = cpuInfo[0];
+
+		__cpuid(cpuInfo, 1);
+		bool bSSE2 = (cpuInfo[3] & (1 << 26)) != 0;
+		bool bOSXSAVE = (cpuInfo[2] & (1 << 27)) != 0;
+		bool bAVX = (cpuInfo[2] & (1 << 28)) != 0;
+		bool bAVX2 = false;
+		if ((maxLeaf >= 7) && bOSXSAVE && bAVX && ((_xgetbv(0) & 6) == 6))
+		{
+			__cpuidex(cpuInfo, 7, 0);
+			bAVX2 = (cpuInfo[1] & (1 << 5)) != 0;
+		}
+		if (bAVX2)
+			return(PATH_AVX2);
+		if (bSSE2)
+			return(PATH_SSE2);
+#else
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2"))
+			return(PATH_AVX2);
+		if (__builtin_cpu_supports("sse2"))
+			return(PATH_SSE2);
+#endif
+		return(PATH_SCALAR);
+	}
+#endif
+
+	/***********************************************************
+	 *  GetBatchPath()
+	 *
+	 *  Return the instruction set used for a batch, detecting
+	 *  it on the first call.  The first call can come from
+	 *  several job system workers at once, so the path is a
+	 *  local static, which is initialized only once.
+	 ***********************************************************/
+	BATCH_PATH GetBatchPath()
+	{
+#ifdef TRANSFORM_BATCH_SIMD
+		static const BATCH_PATH batchPath = DetectBatchPath();
+#else
+		static const BATCH_PATH batchPath = PATH_SCALAR;
+#endif
+		return(batchPath);
+	}
+
+	/***********************************************************
+	 *  ComposeScalarRange()
+	 *
+	 *  Compose the model matrices from the first to the last
+	 *  (excluded) index, one transform at a time.
+	 ***********************************************************/
+	void ComposeScalarRange(
+		const TRANSFORM_ARRAYS& transforms,
+		size_t first,
+		size_t last,
+		float* output)
+	{
+		for (size_t i = first; i < last; i++)
+		{
+			float sinX, cosX, sinY, cosY, sinZ, cosZ;
+			SinCosDegrees(transforms.rotationX[i], sinX, cosX);
+			SinCosDegrees(transforms.rotationY[i], sinY, cosY);
+			SinCosDegrees(transforms.rotationZ[i], sinZ, cosZ);
+			float scaleX = transforms.scaleX[i];
+			float scaleY = transforms.scaleY[i];
+			float scaleZ = transforms.scaleZ[i];
+			float sinXsinY = sinX * sinY;
+			float cosXsinY = cosX * sinY;
+			float* matrix = output + i * 16;
+
+			// T * Rx * Ry * Rz * S, written out one column at a time
+			matrix[0] = (cosY * cosZ) * scaleX;
+			matrix[1] = (cosX * sinZ + sinXsinY * cosZ) * scaleX;
+			matrix[2] = (sinX * sinZ - cosXsinY * cosZ) * scaleX;
+			matrix[3] = 0.0f;
+			matrix[4] = (0.0f - cosY * sinZ) * scaleY;
+			matrix[5] = (cosX * cosZ - sinXsinY * sinZ) * scaleY;
+			matrix[6] = (sinX * cosZ + cosXsinY * sinZ) * scaleY;
+			matrix[7] = 0.0f;
+			matrix[8] = sinY * scaleZ;
+			matrix[9] = (0.0f - sinX * cosY) * scaleZ;
+			matrix[10] = (cosX * cosY) * scaleZ;
+			matrix[11] = 0.0f;
+			matrix[12] = transforms.positionX[i];
+			matrix[13] = transforms.positionY[i];
+			matrix[14] = transforms.positionZ[i];
+			matrix[15] = 1.0f;
+		}
+	}
+}
+
+/***********************************************************
+ *  ComposeModelMatrices()
+ *
+ *  This function is used for composing the model matrices
+ *  of a batch of transforms with the widest available SIMD
+ *  instructions.  Any objects left over after the last full
+ *  SIMD group are composed one at a time.
+ ***********************************************************/
+void ComposeModelMatrices(
+	const TRANSFORM_ARRAYS& transforms,
+	size_t count,
+	glm::mat4* modelMatrices)
+{
+	float* output = &modelMatrices[0][0][0];
+	size_t composed = 0;
+
+	if (count == 0)
+	{
+		return;
+	}
+
+#ifdef TRANSFORM_BATCH_SIMD
+	switch (GetBatchPath())
+	{
+	case PATH_AVX2:
+		composed = ComposeModelMatricesAVX2(transforms, count, output);
+		break;
+	case PATH_SSE2:
+		composed = ComposeModelMatricesSSE2(transforms, count, output);
+		break;
+	default:
+		break;
+	}
+#endif
+
+	ComposeScalarRange(transforms, composed, count, output);
+}
+
+/***********************************************************
+ *  ComposeModelMatricesParallel()
+ *
+ *  This function is used for composing the model matrices
+ *  of a batch of transforms in blocks on the job system.
+ *  The blocks are a multiple of the widest SIMD group, so
+ *  only the last block has objects left over, and every
+ *  matrix is the same as from ComposeModelMatrices().
+ ***********************************************************/
+void ComposeModelMatricesParallel(
+	const TRANSFORM_ARRAYS& transforms,
+	size_t count,
+	glm::mat4* modelMatrices)
+{
+	// objects in a block - small batches are composed on the
+	// calling thread
+	const size_t blockSize = 4096;
+
+	GetJobSystem().ParallelFor(count, blockSize, [&](size_t first, size_t last)
+	{
+		TRANSFORM_ARRAYS block = {
+			transforms.scaleX + first, transforms.scaleY + first, transforms.scaleZ + first,
+			transforms.rotationX + first, transforms.rotationY + first, transforms.rotationZ + first,
+			transforms.positionX + first, transforms.positionY + first, transforms.positionZ + first };
+
+		ComposeModelMatrices(block, last - first, modelMatrices + first);
+	});
+}
+
+/***********************************************************
+ *  ComposeModelMatricesScalar()
+ *
+ *  This function is used for composing the model matrices
+ *  of a batch of transforms without any SIMD instructions.
+ ***********************************************************/
+void ComposeModelMatricesScalar(
+	const TRANSFORM_ARRAYS& transforms,
+	size_t count,
+	glm::mat4* modelMatrices)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	ComposeScalarRange(transforms, 0, count, &modelMatrices[0][0][0]);
+}
+
+/***********************************************************
+ *  GetModelMatrixPathName()
+ *
+ *  This function is used for getting the name of the
+ *  instruction set that is used for composing a batch.
+ ***********************************************************/
+const char* GetModelMatrixPathName()
+{
+	switch (GetBatchPath())
+	{
+	case PATH_AVX2:
+		return("AVX2");
+	case PATH_SSE2:
+		return("SSE2");
+	default:
+		return("scalar");
+	}
+}
+
+/***********************************************************
+ *  RunModelMatrixBenchmark()
+ *
+ *  This function is used for timing the existing glm path,
+ *  the scalar fallback and the SIMD path on random transforms,
+ *  and for checking the batch results against the glm path.
+ *  It fails when the SIMD path does not give the same bits
+ *  as the scalar path, or differs from glm by more than
+ *  g_MaxModelMatrixError.
+ ***********************************************************/
+bool RunModelMatrixBenchmark()
+{
+	bool bPassed = true;
+
+	const size_t objectCounts[] = { 1000, 100000, 1000000 };
+	std::mt19937 generator(330);
+	std::uniform_real_distribution<float> scaleRange(0.1f, 10.0f);
+	std::uniform_real_distribution<float> rotationRange(-360.0f, 360.0f);
+	std::uniform_real_distribution<float> positionRange(-50.0f, 50.0f);
+
+	std::cout << "INFO: Model matrix benchmark, SIMD path: " << GetModelMatrixPathName() << std::endl;
+
+	for (size_t objectCount : objectCounts)
+	{
+		std::vector<float> values[9];
+		for (int i = 0; i < 9; i++)
+		{
+			values[i].resize(objectCount);
+		}
+		for (size_t i = 0; i < objectCount; i++)
+		{
+			values[0][i] = scaleRange(generator);
+			values[1][i] = scaleRange(generator);
+			values[2][i] = scaleRange(generator);
+			values[3][i] = rotationRange(generator);
+			values[4][i] = rotationRange(generator);
+			values[5][i] = rotationRange(generator);
+			values[6][i] = positionRange(generator);
+			values[7][i] = positionRange(generator);
+			values[8][i] = positionRange(generator);
+		}
+
+		TRANSFORM_ARRAYS transforms = {
+			values[0].data(), values[1].data(), values[2].data(),
+			values[3].data(), values[4].data(), values[5].data(),
+			values[6].data(), values[7].data(), values[8].data() };
+		std::vector<glm::mat4> glmMatrices(objectCount);
+		std::vector<glm::mat4> scalarMatrices(objectCount);
+		std::vector<glm::mat4> simdMatrices(objectCount);
+
+		// repeat the smaller batches so that the timings are stable
+		int repeats = (int)(2000000 / objectCount);
+		if (repeats < 1)
+		{
+			repeats = 1;
+		}
+
+		auto startTime = std::chrono::steady_clock::now();
+		for (int r = 0; r < repeats; r++)
+		{
+			for (size_t i = 0; i < objectCount; i++)
+			{
+				glmMatrices[i] = SceneManager::ComputeModelMatrix(
+					glm::vec3(values[0][i], values[1][i], values[2][i]),
+					values[3][i], values[4][i], values[5][i],
+					glm::vec3(values[6][i], values[7][i], values[8][i]));
+			}
+		}
+		auto glmTime = std::chrono::steady_clock::now() - startTime;
+
+		startTime = std::chrono::steady_clock::now();
+		for (int r = 0; r < repeats; r++)
+		{
+			ComposeModelMatricesScalar(transforms, objectCount, scalarMatrices.data());
+		}
+		auto scalarTime = std::chrono::steady_clock::now() - startTime;
+
+		startTime = std::chrono::steady_clock::now();
+		for (int r = 0; r < repeats; r++)
+		{
+			ComposeModelMatrices(transforms, objectCount, simdMatrices.data());
+		}
+		auto simdTime = std::chrono::steady_clock::now() - startTime;
+
+		// compare against the glm path, relative to the object scale
+		float maxError = 0.0f;
+		size_t mismatchedMatrices = 0;
+		for (size_t i = 0; i < objectCount; i++)
+		{
+			const float* glmValues = &glmMatrices[i][0][0];
+			const float* scalarValues = &scalarMatrices[i][0][0];
+			const float* simdValues = &simdMatrices[i][0][0];
+			bool bMismatch = false;
+			for (int e = 0; e < 16; e++)
+			{
+				float scale = (e < 12) ? values[e / 4][i] : 1.0f;
+				float error = std::fabs(simdValues[e] - glmValues[e]) / scale;
+				if (error > maxError)
+					maxError = error;
+				if (simdValues[e] != scalarValues[e])
+					bMismatch = true;
+			}
+			if (bMismatch)
+				mismatchedMatrices++;
+		}
+
+		double glmNs = std::chrono::duration<double, std::nano>(glmTime).count() / ((double)objectCount * repeats);
+		double scalarNs = std::chrono::duration<double, std::nano>(scalarTime).count() / ((double)objectCount * repeats);
+		double simdNs = std::chrono::duration<double, std::nano>(simdTime).count() / ((double)objectCount * repeats);
+
+		std::cout << "INFO: " << objectCount << " objects - glm: " << glmNs
+			<< " ns, scalar: " << scalarNs
+			<< " ns, " << GetModelMatrixPathName() << ": " << simdNs
+			<< " ns per matrix (" << glmNs / simdNs << "x)" << std::endl;
+		std::cout << "INFO:   max error vs glm: " << maxError
+			<< ", SIMD/scalar mismatches: " << mismatchedMatrices << std::endl;
+
+		if ((mismatchedMatrices > 0) || (maxError > g_MaxModelMatrixError))
+		{
+			std::cout << "Could not match the glm model matrices within " << g_MaxModelMatrixError
+				<< ":" << objectCount << " objects" << std::endl;
+			bPassed = false;
+		}
+	}
+
+	return(bPassed);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all of the transforms
+ *  from the batch without freeing the storage.
+ ***********************************************************/
+void TransformBatch::Clear()
+{
+	m_scaleX.clear();
+	m_scaleY.clear();
+	m_scaleZ.clear();
+	m_rotationX.clear();
+	m_rotationY.clear();
+	m_rotationZ.clear();
+	m_positionX.clear();
+	m_positionY.clear();
+	m_positionZ.clear();
+}
+
+/***********************************************************
+ *  Add()
+ *
+ *  This method is used for adding a transform to the batch.
+ ***********************************************************/
+size_t TransformBatch::Add(
+	glm::vec3 scaleXYZ,
+	glm::vec3 rotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	m_scaleX.push_back(scaleXYZ.x);
+	m_scaleY.push_back(scaleXYZ.y);
+	m_scaleZ.push_back(scaleXYZ.z);
+	m_rotationX.push_back(rotationDegrees.x);
+	m_rotationY.push_back(rotationDegrees.y);
+	m_rotationZ.push_back(rotationDegrees.z);
+	m_positionX.push_back(positionXYZ.x);
+	m_positionY.push_back(positionXYZ.y);
+	m_positionZ.push_back(positionXYZ.z);
+
+	return(m_scaleX.size() - 1);
+}
+
+/***********************************************************
+ *  Compose()
+ *
+ *  This method is used for composing the model matrices of
+ *  every transform in the batch, spread over the job system
+ *  when the batch is large.
+ ***********************************************************/
+void TransformBatch::Compose()
+{
+	TRANSFORM_ARRAYS transforms = {
+		m_scaleX.data(), m_scaleY.data(), m_scaleZ.data(),
+		m_rotationX.data(), m_rotationY.data(), m_rotationZ.data(),
+		m_positionX.data(), m_positionY.data(), m_positionZ.data() };
+
+	m_modelMatrices.resize(m_scaleX.size());
+	ComposeModelMatricesParallel(transforms, m_scaleX.size(), m_modelMatrices.data());
+}
@@ -0,0 +1,99 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformbatch.h
+// ============
+// compose the model matrices of many objects in one SIMD pass
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  TRANSFORM_ARRAYS
+ *
+ *  Structure-of-arrays view of a set of transforms.  The
+ *  rotations are XYZ Euler angles in degrees, in the same
+ *  form that SceneManager::SetTransformations() takes.
+ ***********************************************************/
+struct TRANSFORM_ARRAYS
+{
+	const float* scaleX;
+	const float* scaleY;
+	const float* scaleZ;
+	const float* rotationX;
+	const float* rotationY;
+	const float* rotationZ;
+	const float* positionX;
+	const float* positionY;
+	const float* positionZ;
+};
+
+// compose T * Rx * Ry * Rz * S for every transform, using the
+// widest instruction set (AVX2, SSE2) that the CPU supports
+void ComposeModelMatrices(
+	const TRANSFORM_ARRAYS& transforms,
+	size_t count,
+	glm::mat4* modelMatrices);
+
+// same as ComposeModelMatrices(), split into blocks that are composed
+// on the threads of the job system
+void ComposeModelMatricesParallel(
+	const TRANSFORM_ARRAYS& transforms,
+	size_t count,
+	glm::mat4* modelMatrices);
+
+// same as ComposeModelMatrices(), one transform at a time - the
+// results are identical to the SIMD paths
+void ComposeModelMatricesScalar(
+	const TRANSFORM_ARRAYS& transforms,
+	size_t count,
+	glm::mat4* modelMatrices);
+
+// name of the instruction set used by ComposeModelMatrices()
+const char* GetModelMatrixPathName();
+
+// time the glm, scalar and SIMD paths at 1k/100k/1M objects and
+// report the largest difference from the glm path - false when the
+// SIMD and scalar bits differ or the difference is too large
+bool RunModelMatrixBenchmark();
+
+/***********************************************************
+ *  TransformBatch
+ *
+ *  This class owns the arrays for a batch of transforms so
+ *  that they can be gathered one at a time and then composed
+ *  together.  The storage is reused between batches.
+ ***********************************************************/
+class TransformBatch
+{
+public:
+	// remove all of the transforms but keep the storage
+	void Clear();
+
+	// add a transform to the batch and return its index
+	size_t Add(
+		glm::vec3 scaleXYZ,
+		glm::vec3 rotationDegrees,
+		glm::vec3 positionXYZ);
+
+	// compose the model matrices of every transform in the batch
+	void Compose();
+
+	size_t Size() const { return(m_scaleX.size()); }
+	const glm::mat4& GetModelMatrix(size_t index) const { return(m_modelMatrices[index]); }
+
+private:
+	std::vector<float> m_scaleX;
+	std::vector<float> m_scaleY;
+	std::vector<float> m_scaleZ;
+	std::vector<float> m_rotationX;
+	std::vector<float> m_rotationY;
+	std::vector<float> m_rotationZ;
+	std::vector<float> m_positionX;
+	std::vector<float> m_positionY;
+	std::vector<float> m_positionZ;
+	std::vector<glm::mat4> m_modelMatrices;
+};
@@ -0,0 +1,246 @@
+///////////////////////////////////////////////////////////////////////////////
+// uniformblocks.cpp
+// ============
+// std140 uniform blocks for the camera and lights, shared by every shader
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "UniformBlocks.h"
+
+#include <iostream>
+#include <cstring>
+
+const char* const CAMERA_BLOCK_NAME = "CameraBlock";
+const char* const LIGHT_BLOCK_NAME = "LightBlock";
+
+/***********************************************************
+ *  UniformRingBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+UniformRingBuffer::UniformRingBuffer()
+{
+	m_bufferID = 0;
+	m_frameBytes = 0;
+	m_frameCount = 0;
+	m_currentFrame = 0;
+	m_frameOffset = 0;
+	m_offsetAlignment = 256;
+	for (int i = 0; i < MAX_FRAMES; i++)
+	{
+		m_frameFences[i] = NULL;
+	}
+}
+
+/***********************************************************
+ *  ~UniformRingBuffer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+UniformRingBuffer::~UniformRingBuffer()
+{
+	for (int i = 0; i < MAX_FRAMES; i++)
+	{
+		if (NULL != m_frameFences[i])
+		{
+			glDeleteSync(m_frameFences[i]);
+			m_frameFences[i] = NULL;
+		}
+	}
+	if (m_bufferID != 0)
+	{
+		glDeleteBuffers(1, &m_bufferID);
+		m_bufferID = 0;
+	}
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the ring buffer, with
+ *  room for frameBytes of uniform data in every frame.
+ ***********************************************************/
+bool UniformRingBuffer::Create(size_t frameBytes, int frameCount)
+{
+	GLint alignment = 0;
+
+	if ((frameCount < 1) || (frameCount > MAX_FRAMES))
+	{
+		std::cout << "Uniform ring buffer cannot have " << frameCount << " frames" << std::endl;
+		return(false);
+	}
+
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	if (alignment > 0)
+	{
+		m_offsetAlignment = (size_t)alignment;
+	}
+
+	// every segment starts on an aligned offset
+	m_frameBytes = ((frameBytes + m_offsetAlignment - 1) / m_offsetAlignment) * m_offsetAlignment;
+	m_frameCount = frameCount;
+	m_currentFrame = frameCount - 1;
+	m_frameOffset = 0;
+
+	glGenBuffers(1, &m_bufferID);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_bufferID);
+	glBufferData(GL_UNIFORM_BUFFER, m_frameBytes * m_frameCount, NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	return(m_bufferID != 0);
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for moving on to the next frame
+ *  segment.  If the GPU has not finished with the frame that
+ *  last wrote the segment, this waits for it.
+ ***********************************************************/
+void UniformRingBuffer::BeginFrame()
+{
+	if (m_bufferID == 0)
+	{
+		return;
+	}
+
+	m_currentFrame = (m_currentFrame + 1) % m_frameCount;
+	m_frameOffset = 0;
+
+	GLsync fence = m_frameFences[m_currentFrame];
+	if (NULL != fence)
+	{
+		glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, (GLuint64)1000000000);
+		glDeleteSync(fence);
+		m_frameFences[m_currentFrame] = NULL;
+	}
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for fencing the segment of the
+ *  current frame, once its draws have been issued.
+ ***********************************************************/
+void UniformRingBuffer::EndFrame()
+{
+	if ((m_bufferID == 0) || (m_frameOffset == 0))
+	{
+		return;
+	}
+
+	if (NULL != m_frameFences[m_currentFrame])
+	{
+		glDeleteSync(m_frameFences[m_currentFrame]);
+	}
+	m_frameFences[m_currentFrame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+/***********************************************************
+ *  WriteBlock()
+ *
+ *  This method is used for copying a uniform block into the
+ *  current frame segment, with one mapped write, and binding
+ *  the written range to the passed in binding point.
+ ***********************************************************/
+bool UniformRingBuffer::WriteBlock(GLuint bindingPoint, const void* data, size_t size)
+{
+	size_t offset = m_frameOffset;
+
+	if (m_bufferID == 0)
+	{
+		return(false);
+	}
+	if ((offset + size) > m_frameBytes)
+	{
+		std::cout << "Uniform ring buffer frame is full, could not write " << size << " bytes" << std::endl;
+		return(false);
+	}
+
+	GLintptr bufferOffset = (GLintptr)((m_frameBytes * m_currentFrame) + offset);
+
+	glBindBuffer(GL_UNIFORM_BUFFER, m_bufferID);
+	// the fence in BeginFrame() already made sure that the GPU is
+	// done with this range, so the driver does not need to sync
+	void* pMapped = glMapBufferRange(
+		GL_UNIFORM_BUFFER,
+		bufferOffset,
+		(GLsizeiptr)size,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (NULL == pMapped)
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		return(false);
+	}
+	memcpy(pMapped, data, size);
+	glUnmapBuffer(GL_UNIFORM_BUFFER);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	glBindBufferRange(GL_UNIFORM_BUFFER, bindingPoint, m_bufferID, bufferOffset, (GLsizeiptr)size);
+
+	// the next block starts on an aligned offset
+	m_frameOffset = ((offset + size + m_offsetAlignment - 1) / m_offsetAlignment) * m_offsetAlignment;
+
+	return(true);
+}
+
+/***********************************************************
+ *  UniformBlockBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+UniformBlockBuffer::UniformBlockBuffer()
+{
+	m_bufferID = 0;
+	m_size = 0;
+}
+
+/***********************************************************
+ *  ~UniformBlockBuffer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+UniformBlockBuffer::~UniformBlockBuffer()
+{
+	if (m_bufferID != 0)
+	{
+		glDeleteBuffers(1, &m_bufferID);
+		m_bufferID = 0;
+	}
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the block buffer and
+ *  binding it to the passed in binding point for good.
+ ***********************************************************/
+bool UniformBlockBuffer::Create(GLuint bindingPoint, size_t size)
+{
+	glGenBuffers(1, &m_bufferID);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_bufferID);
+	glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_STATIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, m_bufferID);
+	m_size = size;
+
+	return(m_bufferID != 0);
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for replacing the contents of the
+ *  block with one buffer write.
+ ***********************************************************/
+void UniformBlockBuffer::Update(const void* data, size_t size)
+{
+	if ((m_bufferID == 0) || (size > m_size))
+	{
+		return;
+	}
+
+	glBindBuffer(GL_UNIFORM_BUFFER, m_bufferID);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
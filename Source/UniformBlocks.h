@@ -0,0 +1,148 @@
+///////////////////////////////////////////////////////////////////////////////
+// uniformblocks.h
+// ============
+// std140 uniform blocks for the camera and lights, shared by every shader
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+// binding points of the shared uniform blocks - every shader
+// program that declares a block is bound to the same point
+enum UNIFORM_BLOCK_BINDING
+{
+	BLOCK_CAMERA = 0,
+	BLOCK_LIGHTS = 1
+};
+
+// names of the shared uniform blocks in the shader code
+extern const char* const CAMERA_BLOCK_NAME;
+extern const char* const LIGHT_BLOCK_NAME;
+
+// maximum number of light sources in the light block
+const int MAX_LIGHT_SOURCES = 4;
+
+/***********************************************************
+ *  CAMERA_BLOCK
+ *
+ *  std140 layout of the camera uniform block.  Only vec4 and
+ *  mat4 members are used so that the C++ and GLSL layouts
+ *  match without any padding rules.
+ ***********************************************************/
+struct CAMERA_BLOCK
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	// xyz: camera position, w: unused
+	glm::vec4 viewPosition;
+};
+
+/***********************************************************
+ *  LIGHT_BLOCK
+ *
+ *  std140 layout of the light uniform block.
+ ***********************************************************/
+struct LIGHT_SOURCE_STD140
+{
+	glm::vec4 position;
+	glm::vec4 ambientColor;
+	glm::vec4 diffuseColor;
+	glm::vec4 specularColor;
+	// x: focal strength, y: specular intensity
+	glm::vec4 params;
+};
+
+struct LIGHT_BLOCK
+{
+	LIGHT_SOURCE_STD140 lightSources[MAX_LIGHT_SOURCES];
+	// x: number of lights, y: lighting enabled (0 or 1)
+	glm::ivec4 lightInfo;
+};
+
+static_assert(sizeof(CAMERA_BLOCK) == 144, "CAMERA_BLOCK must match the std140 layout");
+static_assert(sizeof(LIGHT_SOURCE_STD140) == 80, "LIGHT_SOURCE_STD140 must match the std140 layout");
+static_assert(sizeof(LIGHT_BLOCK) == (80 * MAX_LIGHT_SOURCES) + 16, "LIGHT_BLOCK must match the std140 layout");
+
+/***********************************************************
+ *  UniformRingBuffer
+ *
+ *  This class sub-allocates per-frame uniform data out of one
+ *  buffer that is split into a few frame segments.  Each frame
+ *  writes into the next segment, after waiting on the fence of
+ *  the frame that last used it, so that data the GPU is still
+ *  reading is never overwritten and no write has to stall on
+ *  the whole buffer.
+ ***********************************************************/
+class UniformRingBuffer
+{
+public:
+	// most frame segments that a ring buffer can have
+	static const int MAX_FRAMES = 4;
+
+	// constructor
+	UniformRingBuffer();
+	// destructor
+	~UniformRingBuffer();
+
+	// create the buffer with room for frameBytes in each of the
+	// passed in number of frames
+	bool Create(size_t frameBytes, int frameCount);
+	bool IsCreated() const { return(m_bufferID != 0); }
+
+	// move on to the next frame segment - call once per frame,
+	// before any writes of the frame
+	void BeginFrame();
+	// fence the writes of the current frame - call after the
+	// draws that use them have been issued
+	void EndFrame();
+
+	// copy the data into the current frame segment and bind it to
+	// the passed in block binding point, returning false when the
+	// segment is full
+	bool WriteBlock(GLuint bindingPoint, const void* data, size_t size);
+
+private:
+	GLuint m_bufferID;
+	// bytes in each frame segment
+	size_t m_frameBytes;
+	int m_frameCount;
+	// segment written by the current frame
+	int m_currentFrame;
+	// next free byte in the current segment
+	size_t m_frameOffset;
+	// required alignment of bound ranges
+	size_t m_offsetAlignment;
+	// fence of the last frame that wrote each segment
+	GLsync m_frameFences[MAX_FRAMES];
+};
+
+/***********************************************************
+ *  UniformBlockBuffer
+ *
+ *  This class holds a uniform block that changes rarely, such
+ *  as the lights.  It stays bound to its binding point and is
+ *  only written when its contents change.
+ ***********************************************************/
+class UniformBlockBuffer
+{
+public:
+	// constructor
+	UniformBlockBuffer();
+	// destructor
+	~UniformBlockBuffer();
+
+	// create the buffer and bind it to the passed in binding point
+	bool Create(GLuint bindingPoint, size_t size);
+	bool IsCreated() const { return(m_bufferID != 0); }
+	// replace the contents of the block
+	void Update(const void* data, size_t size);
+
+private:
+	GLuint m_bufferID;
+	size_t m_size;
+};
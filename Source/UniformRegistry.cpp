@@ -0,0 +1,287 @@
+///////////////////////////////////////////////////////////////////////////////
+// uniformregistry.cpp
+// ============
+// resolve shader uniform locations once and set them through typed handles
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "UniformRegistry.h"
+#include "ProgramCache.h"
+
+#include <iostream>
+
+/***********************************************************
+ *  UniformRegistry()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+UniformRegistry::UniformRegistry()
+{
+	m_programID = 0;
+	m_lookupsResolved = 0;
+	m_lookupsAvoided = 0;
+}
+
+/***********************************************************
+ *  AttachCurrentProgram()
+ *
+ *  This method is used for attaching the registry to the
+ *  shader program that is currently in use.
+ ***********************************************************/
+void UniformRegistry::AttachCurrentProgram()
+{
+	GLint programID = 0;
+
+	glGetIntegerv(GL_CURRENT_PROGRAM, &programID);
+	AttachProgram((GLuint)programID);
+}
+
+/***********************************************************
+ *  AttachProgram()
+ *
+ *  This method is used for attaching the registry to the
+ *  passed in shader program.
+ ***********************************************************/
+void UniformRegistry::AttachProgram(GLuint programID)
+{
+	m_programID = programID;
+
+	if (m_programID == 0)
+	{
+		std::cout << "Uniform registry has no shader program in use" << std::endl;
+	}
+}
+
+/***********************************************************
+ *  UseProgram()
+ *
+ *  This method is used for making the attached shader
+ *  program the one that uniforms are set into.
+ ***********************************************************/
+void UniformRegistry::UseProgram()
+{
+	if (m_programID != 0)
+	{
+		glUseProgram(m_programID);
+	}
+}
+
+/***********************************************************
+ *  ResolveLocation()
+ *
+ *  This method is used for looking up the location of the
+ *  passed in uniform name in the attached shader program.
+ *  The name is kept, even when it is not found, so that it
+ *  can be found after the program is relinked.  A name that
+ *  was already resolved keeps its index.
+ ***********************************************************/
+int UniformRegistry::ResolveLocation(const char* name)
+{
+	GLint location = -1;
+
+	if (m_programID == 0)
+	{
+		std::cout << "Could not resolve shader uniform:" << name << std::endl;
+		return(-1);
+	}
+
+	for (size_t i = 0; i < m_names.size(); i++)
+	{
+		if (m_names[i] == name)
+		{
+			return((int)i);
+		}
+	}
+
+	location = glGetUniformLocation(m_programID, name);
+	m_lookupsResolved++;
+	if (location < 0)
+	{
+		std::cout << "Could not resolve shader uniform:" << name << std::endl;
+	}
+
+	m_names.push_back(name);
+	m_locations.push_back(location);
+
+	return((int)m_names.size() - 1);
+}
+
+/***********************************************************
+ *  BindUniformBlock()
+ *
+ *  This method is used for binding the uniform block with
+ *  the passed in name to a uniform buffer binding point, so
+ *  that the program reads the buffer bound to that point.
+ ***********************************************************/
+bool UniformRegistry::BindUniformBlock(const char* blockName, GLuint bindingPoint)
+{
+	GLuint blockIndex = GL_INVALID_INDEX;
+
+	if (m_programID == 0)
+	{
+		return(false);
+	}
+
+	blockIndex = glGetUniformBlockIndex(m_programID, blockName);
+	if (blockIndex == GL_INVALID_INDEX)
+	{
+		return(false);
+	}
+
+	glUniformBlockBinding(m_programID, blockIndex, bindingPoint);
+	m_lookupsResolved++;
+
+	BLOCK_BINDING blockBinding;
+	blockBinding.blockName = blockName;
+	blockBinding.bindingPoint = bindingPoint;
+	m_blockBindings.push_back(blockBinding);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Set()
+ *
+ *  These methods are used for setting the passed in value
+ *  into the uniform at the handle's resolved location.
+ ***********************************************************/
+void UniformRegistry::Set(const UniformHandle<bool>& handle, bool value)
+{
+	glUniform1i(GetLocation(handle), (int)value);
+	m_lookupsAvoided++;
+}
+
+void UniformRegistry::Set(const UniformHandle<int>& handle, int value)
+{
+	glUniform1i(GetLocation(handle), value);
+	m_lookupsAvoided++;
+}
+
+void UniformRegistry::Set(const UniformHandle<float>& handle, float value)
+{
+	glUniform1f(GetLocation(handle), value);
+	m_lookupsAvoided++;
+}
+
+void UniformRegistry::Set(const UniformHandle<glm::vec2>& handle, const glm::vec2& value)
+{
+	glUniform2fv(GetLocation(handle), 1, &value[0]);
+	m_lookupsAvoided++;
+}
+
+void UniformRegistry::Set(const UniformHandle<glm::vec3>& handle, const glm::vec3& value)
+{
+	glUniform3fv(GetLocation(handle), 1, &value[0]);
+	m_lookupsAvoided++;
+}
+
+void UniformRegistry::Set(const UniformHandle<glm::vec4>& handle, const glm::vec4& value)
+{
+	glUniform4fv(GetLocation(handle), 1, &value[0]);
+	m_lookupsAvoided++;
+}
+
+void UniformRegistry::Set(const UniformHandle<glm::mat4>& handle, const glm::mat4& value)
+{
+	glUniformMatrix4fv(GetLocation(handle), 1, GL_FALSE, &value[0][0]);
+	m_lookupsAvoided++;
+}
+
+/***********************************************************
+ *  RelinkProgram()
+ *
+ *  This method is used for loading changed shader files into
+ *  the attached program without replacing it.  The shaders
+ *  are linked into a scratch program first, so that a
+ *  shader with errors never breaks the one being drawn with.
+ *  The shaders that the program was linked with before are
+ *  detached, and every uniform location and block binding is
+ *  looked up again, which keeps all of the handles valid.  A
+ *  variant of a program is relinked with its own defines.
+ ***********************************************************/
+bool UniformRegistry::RelinkProgram(const char* vertexFile, const char* fragmentFile, const char* defines)
+{
+	std::string vertexSource;
+	std::string fragmentSource;
+	GLuint vertexShaderID = 0;
+	GLuint fragmentShaderID = 0;
+	GLuint attachedShaders[8] = { 0 };
+	GLsizei attachedCount = 0;
+	bool bLinked = false;
+
+	if (m_programID == 0)
+	{
+		return(false);
+	}
+
+	if ((ReadShaderFile(vertexFile, vertexSource) == false) ||
+		(ReadShaderFile(fragmentFile, fragmentSource) == false))
+	{
+		return(false);
+	}
+	InjectDefines(vertexSource, defines);
+	InjectDefines(fragmentSource, defines);
+
+	vertexShaderID = CompileShaderSource(GL_VERTEX_SHADER, vertexSource, vertexFile);
+	fragmentShaderID = CompileShaderSource(GL_FRAGMENT_SHADER, fragmentSource, fragmentFile);
+	if ((vertexShaderID != 0) && (fragmentShaderID != 0))
+	{
+		GLuint scratchProgramID = glCreateProgram();
+
+		bLinked = LinkShaders(scratchProgramID, vertexShaderID, fragmentShaderID);
+		if (bLinked == false)
+		{
+			char log[1024] = { 0 };
+
+			glGetProgramInfoLog(scratchProgramID, sizeof(log), NULL, log);
+			std::cout << "Could not link shaders:" << vertexFile << ", " << fragmentFile << std::endl << log << std::endl;
+		}
+		glDeleteProgram(scratchProgramID);
+	}
+
+	if (bLinked)
+	{
+		glGetAttachedShaders(m_programID, 8, &attachedCount, attachedShaders);
+		for (GLsizei i = 0; i < attachedCount; i++)
+		{
+			glDetachShader(m_programID, attachedShaders[i]);
+		}
+		bLinked = LinkShaders(m_programID, vertexShaderID, fragmentShaderID);
+	}
+	glDeleteShader(vertexShaderID);
+	glDeleteShader(fragmentShaderID);
+	if (bLinked == false)
+	{
+		return(false);
+	}
+
+	for (size_t i = 0; i < m_names.size(); i++)
+	{
+		m_locations[i] = glGetUniformLocation(m_programID, m_names[i].c_str());
+		m_lookupsResolved++;
+	}
+	for (size_t i = 0; i < m_blockBindings.size(); i++)
+	{
+		GLuint blockIndex = glGetUniformBlockIndex(m_programID, m_blockBindings[i].blockName.c_str());
+
+		if (blockIndex != GL_INVALID_INDEX)
+		{
+			glUniformBlockBinding(m_programID, blockIndex, m_blockBindings[i].bindingPoint);
+		}
+		m_lookupsResolved++;
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  ReportCounters()
+ *
+ *  This method is used for displaying how many uniform name
+ *  lookups were done, and how many were avoided by handles.
+ ***********************************************************/
+void UniformRegistry::ReportCounters()
+{
+	std::cout << "INFO: Uniform names resolved: " << m_lookupsResolved
+		<< ", uniform lookups avoided: " << m_lookupsAvoided << std::endl;
+}
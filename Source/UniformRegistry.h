@@ -0,0 +1,114 @@
+///////////////////////////////////////////////////////////////////////////////
+// uniformregistry.h
+// ============
+// resolve shader uniform locations once and set them through typed handles
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  UniformHandle
+ *
+ *  A shader uniform of type T, as the index of its location
+ *  in the registry that resolved it - so the handle stays
+ *  valid when the program is relinked and the location
+ *  changes.  The type makes sure that a handle is only ever
+ *  set with a matching value.
+ ***********************************************************/
+template <typename T>
+struct UniformHandle
+{
+	int index = -1;
+};
+
+/***********************************************************
+ *  UniformRegistry
+ *
+ *  This class resolves uniform names to locations once, after
+ *  the shader program has been loaded, so that setting a
+ *  uniform while rendering is a single glUniform* call with
+ *  no name lookup in the driver.
+ ***********************************************************/
+class UniformRegistry
+{
+public:
+	// constructor
+	UniformRegistry();
+
+	// use the shader program that is currently bound
+	void AttachCurrentProgram();
+	// use the passed in shader program
+	void AttachProgram(GLuint programID);
+	// make the attached shader program the one in use, which is
+	// needed before setting uniforms when several programs exist
+	void UseProgram();
+
+	// resolve a uniform name into a handle - returns false, and
+	// reports it, when the name is not an active uniform
+	template <typename T>
+	bool Resolve(const char* name, UniformHandle<T>& handle)
+	{
+		handle.index = ResolveLocation(name);
+		return((handle.index >= 0) && (m_locations[handle.index] >= 0));
+	}
+
+	// bind a uniform block of the program to the passed in binding
+	// point - returns false when the program has no such block
+	bool BindUniformBlock(const char* blockName, GLuint bindingPoint);
+
+	// compile the shader files, with the passed in #define lines if
+	// any, and link them into the attached program in place, keeping
+	// its ID, then resolve every uniform and block binding again.
+	// The program is left as it was when the shaders do not compile
+	// or link.  Uniform values go back to 0, so the ones that are not
+	// set every frame must be set again.
+	bool RelinkProgram(const char* vertexFile, const char* fragmentFile, const char* defines = NULL);
+
+	// set the value of a uniform through its handle
+	void Set(const UniformHandle<bool>& handle, bool value);
+	void Set(const UniformHandle<int>& handle, int value);
+	void Set(const UniformHandle<float>& handle, float value);
+	void Set(const UniformHandle<glm::vec2>& handle, const glm::vec2& value);
+	void Set(const UniformHandle<glm::vec3>& handle, const glm::vec3& value);
+	void Set(const UniformHandle<glm::vec4>& handle, const glm::vec4& value);
+	void Set(const UniformHandle<glm::mat4>& handle, const glm::mat4& value);
+
+	// output the number of lookups that were done and avoided
+	void ReportCounters();
+
+private:
+	// shader program the uniforms belong to
+	GLuint m_programID;
+	// number of names resolved with glGetUniformLocation
+	unsigned long long m_lookupsResolved;
+	// number of uniform sets that did not need a lookup
+	unsigned long long m_lookupsAvoided;
+
+	// names of the resolved uniforms, and their current locations
+	std::vector<std::string> m_names;
+	std::vector<GLint> m_locations;
+	// uniform blocks and the binding points they were bound to
+	struct BLOCK_BINDING
+	{
+		std::string blockName;
+		GLuint bindingPoint;
+	};
+	std::vector<BLOCK_BINDING> m_blockBindings;
+
+	// look up the location of a uniform name in the program, and
+	// return the index that it is kept at
+	int ResolveLocation(const char* name);
+	// location of a handle - -1, which OpenGL ignores, when unresolved
+	template <typename T>
+	GLint GetLocation(const UniformHandle<T>& handle) const
+	{
+		return((handle.index >= 0) ? m_locations[handle.index] : -1);
+	}
+};
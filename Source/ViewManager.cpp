@@ -8,6 +8,8 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "ViewManager.h"
+#include "CameraReplay.h"
+#include "CameraSimulation.h"
 // GLM Math Header inclusions
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
@@ -21,23 +23,55 @@ namespace
 	const int WINDOW_HEIGHT = 800;
 	const char* g_ViewName = "view";
 	const char* g_ProjectionName = "projection";
+	const char* g_ViewPositionName = "viewPosition";
+	// room for the camera blocks of one frame, and the number of
+	// frames the camera ring buffer holds
+	const size_t g_CameraRingFrameBytes = 1024;
+	const int g_CameraRingFrames = 3;
 
 	// camera object used for viewing and interacting with
 	// the 3D scene
 	Camera* g_pCamera = nullptr;
+	// update thread that moves the camera at a fixed rate while
+	// there is a display window - NULL when headless
+	CameraSimulation* g_pCameraSimulation = nullptr;
 
 	// these variables are used for mouse movement processing
 	float gLastX = WINDOW_WIDTH / 2.0f;
 	float gLastY = WINDOW_HEIGHT / 2.0f;
 	bool gFirstMouse = true;
 
-	// time between current frame and last frame
-	float gDeltaTime = 0.0f; 
-	float gLastFrame = 0.0f;
+	// keys that move the camera while they are held down
+	const struct
+	{
+		int key;
+		Camera_Movement movement;
+	} g_MovementKeys[] =
+	{
+		//W key will zoom in forward
+		{ GLFW_KEY_W, FORWARD },
+		//A key will move into the left
+		{ GLFW_KEY_A, LEFT },
+		//S key will move doward
+		{ GLFW_KEY_S, BACKWARD },
+		//D key will move to the right
+		{ GLFW_KEY_D, RIGHT },
+		//Q key will move up
+		{ GLFW_KEY_Q, UP },
+		//E key will move downward
+		{ GLFW_KEY_E, DOWN }
+	};
 
 	// the following variable is false when orthographic projection
 	// is off and true when it is on
 	bool bOrthographicProjection = false;
+
+	// camera path being replayed, NULL when the camera follows
+	// the input - the frames along it and the fixed time step
+	const CameraPath* g_pCameraPath = NULL;
+	int g_ReplayFrame = 0;
+	float g_ReplayDeltaTime = 0.0f;
+	bool g_bReplayDone = false;
 }
 
 /***********************************************************
@@ -51,6 +85,8 @@ ViewManager::ViewManager(
 	// initialize the member variables
 	m_pShaderManager = pShaderManager;
 	m_pWindow = NULL;
+	m_viewWidth = WINDOW_WIDTH;
+	m_viewHeight = WINDOW_HEIGHT;
 	g_pCamera = new Camera();
 	// default camera view parameters
 	g_pCamera->Position = glm::vec3(0.0f, 5.0f, 12.0f);
@@ -68,7 +104,14 @@ ViewManager::~ViewManager()
 {
 	// free up allocated memory
 	m_pShaderManager = NULL;
+	m_cameraUniforms.clear();
 	m_pWindow = NULL;
+	// the update thread lets go of the camera before it is freed
+	if (NULL != g_pCameraSimulation)
+	{
+		delete g_pCameraSimulation;
+		g_pCameraSimulation = NULL;
+	}
 	if (NULL != g_pCamera)
 	{
 		delete g_pCamera;
@@ -112,9 +155,102 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 
 	m_pWindow = window;
 
+	// from now on the camera moves on the update thread, with the
+	// input polled here
+	g_pCameraSimulation = new CameraSimulation();
+	g_pCameraSimulation->Start(g_pCamera, bOrthographicProjection);
+
 	return(window);
 }
 
+/***********************************************************
+ *  CreateHeadlessView()
+ *
+ *  This method is used for viewing the scene without a
+ *  display window, when the frames are rendered into a
+ *  framebuffer of the passed in size.  There are no input
+ *  events, so every frame is seen from the same camera.
+ ***********************************************************/
+void ViewManager::CreateHeadlessView(int width, int height)
+{
+	m_pWindow = NULL;
+	m_viewWidth = width;
+	m_viewHeight = height;
+
+	// enable blending for supporting tranparent rendering
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+/***********************************************************
+ *  StartCameraReplay()
+ *
+ *  This method is used for replaying a camera path from its
+ *  first keyframe.  Each frame then samples the path one
+ *  fixed time step further along, whatever the frame took,
+ *  so every replay renders exactly the same frames, and the
+ *  keyboard and mouse are ignored until the end.
+ ***********************************************************/
+void ViewManager::StartCameraReplay(const CameraPath* pCameraPath, float fixedDeltaTime)
+{
+	g_pCameraPath = pCameraPath;
+	g_ReplayFrame = 0;
+	g_ReplayDeltaTime = fixedDeltaTime;
+	g_bReplayDone = false;
+
+	// keys held when the replay starts are let go of
+	if (NULL != g_pCameraSimulation)
+	{
+		g_pCameraSimulation->SetHeldMovements(0);
+	}
+}
+
+/***********************************************************
+ *  IsCameraReplayDone()
+ *
+ *  This method is used for checking whether the frame at
+ *  the end of the camera path has been prepared.
+ ***********************************************************/
+bool ViewManager::IsCameraReplayDone() const
+{
+	return(g_bReplayDone);
+}
+
+/***********************************************************
+ *  ResolveShaderUniforms()
+ *
+ *  This method is used for resolving the locations of the
+ *  shader uniforms set every frame, once, after the shaders
+ *  have been loaded.
+ ***********************************************************/
+void ViewManager::ResolveShaderUniforms(UniformRegistry* pUniformRegistry)
+{
+	CAMERA_UNIFORMS cameraUniforms;
+
+	if (NULL == pUniformRegistry)
+	{
+		return;
+	}
+
+	if (m_cameraRing.IsCreated() == false)
+	{
+		m_cameraRing.Create(g_CameraRingFrameBytes, g_CameraRingFrames);
+	}
+
+	cameraUniforms.pUniformRegistry = pUniformRegistry;
+	cameraUniforms.bUsesCameraBlock =
+		pUniformRegistry->BindUniformBlock(CAMERA_BLOCK_NAME, BLOCK_CAMERA);
+
+	// programs without the camera block get loose uniforms
+	if (cameraUniforms.bUsesCameraBlock == false)
+	{
+		pUniformRegistry->Resolve(g_ViewName, cameraUniforms.view);
+		pUniformRegistry->Resolve(g_ProjectionName, cameraUniforms.projection);
+		pUniformRegistry->Resolve(g_ViewPositionName, cameraUniforms.viewPosition);
+	}
+	m_cameraUniforms.push_back(cameraUniforms);
+}
+
 /***********************************************************
  *  Mouse_Position_Callback()
  *
@@ -123,6 +259,11 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
  ***********************************************************/
 void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos)
 {
+	// the camera path owns the camera during a replay
+	if (NULL != g_pCameraPath)
+	{
+		return;
+	}
 	if (gFirstMouse)
 	{
 		gLastX = xMousePos;
@@ -138,17 +279,20 @@ void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos,
 	gLastX = xMousePos;
 	gLastY = yMousePos;
 
-	//Move camera based off the calculated offsets
-	g_pCamera->ProcessMouseMovement(xOffset, yOffset);
+	//Move camera based off the calculated offsets, on the next tick
+	if (NULL != g_pCameraSimulation)
+	{
+		g_pCameraSimulation->AddMouseMovement(xOffset, yOffset);
+	}
 }
 
 //When we scroll up or down with scroll wheel on mouse, it will speed up camera. Scrolling down is slow and scroll up is speed
 void ViewManager::Mouse_Scroll_Callback(GLFWwindow* window, double xOffset, double yOffset)
 {
-	//if camera is not null, process the scroll 
-	if (g_pCamera != nullptr)
+	//if the camera is moving, process the scroll on the next tick
+	if ((g_pCameraSimulation != nullptr) && (NULL == g_pCameraPath))
 	{
-		g_pCamera->ProcessMouseScroll(yOffset);
+		g_pCameraSimulation->AddMouseScroll(yOffset);
 	}
 }
 
@@ -156,53 +300,39 @@ void ViewManager::Mouse_Scroll_Callback(GLFWwindow* window, double xOffset, doub
  *  ProcessKeyboardEvents()
  *
  *  This method is called to process any keyboard events
- *  that may be waiting in the event queue.
+ *  that may be waiting in the event queue.  The keys are
+ *  read on this thread, as GLFW needs, and handed to the
+ *  camera update thread.
  ***********************************************************/
 void ViewManager::ProcessKeyboardEvents()
 {
+	// a headless view has no keyboard
+	if (NULL == m_pWindow)
+	{
+		return;
+	}
 	// close the window if the escape key has been pressed
 	if (glfwGetKey(m_pWindow, GLFW_KEY_ESCAPE) == GLFW_PRESS)
 	{
 		glfwSetWindowShouldClose(m_pWindow, true);
 	}
-	//if camera is not in use then exit method
-	if (NULL == g_pCamera)
+	//if camera is not moving then exit method
+	if (NULL == g_pCameraSimulation)
 	{
 		return;
 	}
-	//processing WASD keys to zoom in and out, left to right
-
-	//W key will zoom in forward
-	if (glfwGetKey(m_pWindow, GLFW_KEY_W) == GLFW_PRESS)
+	//processing WASD keys to zoom in and out, left to right - the
+	//update thread moves the camera for as long as they are held
+	uint32_t movementBits = 0;
+	for (size_t i = 0; i < sizeof(g_MovementKeys) / sizeof(g_MovementKeys[0]); i++)
 	{
-		//processes W key
-		g_pCamera->ProcessKeyboard(FORWARD, gDeltaTime);
-	}
-	//A key will move into the left
-	if (glfwGetKey(m_pWindow, GLFW_KEY_A) == GLFW_PRESS)
-	{
-		g_pCamera->ProcessKeyboard(LEFT, gDeltaTime);
-	}
-	//S key will move doward
-	if (glfwGetKey(m_pWindow, GLFW_KEY_S) == GLFW_PRESS)
-	{
-		g_pCamera->ProcessKeyboard(BACKWARD, gDeltaTime);
-	}
-	//D key will move to the right
-	if (glfwGetKey(m_pWindow, GLFW_KEY_D) == GLFW_PRESS)
-	{
-		g_pCamera->ProcessKeyboard(RIGHT, gDeltaTime);
-	}
-	//Q key will move up
-	if (glfwGetKey(m_pWindow, GLFW_KEY_Q) == GLFW_PRESS)
-	{
-		g_pCamera->ProcessKeyboard(UP, gDeltaTime);
-	}
-	//E key will move downward
-	if (glfwGetKey(m_pWindow, GLFW_KEY_E) == GLFW_PRESS)
-	{
-		g_pCamera->ProcessKeyboard(DOWN, gDeltaTime);
+		if (glfwGetKey(m_pWindow, g_MovementKeys[i].key) == GLFW_PRESS)
+		{
+			movementBits |= (1u << g_MovementKeys[i].movement);
+		}
 	}
+	g_pCameraSimulation->SetHeldMovements(movementBits);
+
 	//p key is to put into perspective 3d
 	if (glfwGetKey(m_pWindow, GLFW_KEY_P) == GLFW_PRESS)
 	{
@@ -213,6 +343,7 @@ void ViewManager::ProcessKeyboardEvents()
 	{
 		bOrthographicProjection = true;
 	}
+	g_pCameraSimulation->SetOrthographic(bOrthographicProjection);
 }
 
 /***********************************************************
@@ -226,37 +357,86 @@ void ViewManager::PrepareSceneView()
 {
 	glm::mat4 view;
 	glm::mat4 projection;
+	CAMERA_BLOCK cameraBlock;
+	CAMERA_STATE camera;
+
+	if (NULL != g_pCameraPath)
+	{
+		// a replay steps by the fixed time, and takes the camera
+		// from the path rather than the update thread - the time
+		// is counted in frames, so that it does not drift from
+		// adding up the time steps
+		float replayTime = (float)g_ReplayFrame * g_ReplayDeltaTime;
+		CAMERA_KEYFRAME keyframe = g_pCameraPath->Sample(replayTime);
 
-	// per-frame timing
-	float currentFrame = glfwGetTime();
-	gDeltaTime = currentFrame - gLastFrame;
-	gLastFrame = currentFrame;
+		camera.position = keyframe.position;
+		camera.front = keyframe.front;
+		camera.up = glm::vec3(0.0f, 1.0f, 0.0f);
+		camera.zoom = keyframe.zoom;
+		camera.bOrthographic = keyframe.bOrthographic;
 
-	// process any keyboard events that may be waiting in the 
-	// event queue
-	ProcessKeyboardEvents();
+		// the last frame is the one at or just past the end, and
+		// the camera stays where the replay left it
+		if (replayTime >= g_pCameraPath->GetDuration())
+		{
+			g_bReplayDone = true;
+			g_pCameraPath = NULL;
+			gFirstMouse = true;
+			bOrthographicProjection = camera.bOrthographic;
+			if (NULL != g_pCameraSimulation)
+			{
+				g_pCameraSimulation->SetState(camera);
+			}
+			else
+			{
+				SetCameraState(*g_pCamera, camera);
+			}
+		}
+		g_ReplayFrame++;
+	}
+	else
+	{
+		// process any keyboard events that may be waiting in the 
+		// event queue
+		ProcessKeyboardEvents();
+
+		// the camera between the last two ticks of the update
+		// thread, or where it stands when there is no input
+		if (NULL != g_pCameraSimulation)
+		{
+			camera = g_pCameraSimulation->GetInterpolatedState();
+		}
+		else
+		{
+			camera.position = g_pCamera->Position;
+			camera.front = g_pCamera->Front;
+			camera.up = g_pCamera->Up;
+			camera.zoom = g_pCamera->Zoom;
+			camera.bOrthographic = bOrthographicProjection;
+		}
+	}
 
 	// get the current view matrix from the camera
-	view = g_pCamera->GetViewMatrix();
+	view = glm::lookAt(camera.position, camera.position + camera.front, camera.up);
 
 	// define the current projection matrix
 
 	//changed this line of code to have the otpion to switch between ortho or perspective depending on the button of O and P
-	if (bOrthographicProjection == false)
+	if (camera.bOrthographic == false)
 	{
-		projection = glm::perspective(glm::radians(g_pCamera->Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
+		projection = glm::perspective(glm::radians(camera.zoom), (GLfloat)m_viewWidth / (GLfloat)m_viewHeight, 0.1f, 100.0f);
 	}
 	else
 	{
 		double scale = 0.0;
-		if (WINDOW_WIDTH > WINDOW_HEIGHT)
+		if (m_viewWidth > m_viewHeight)
 		{
-			scale = (double)WINDOW_HEIGHT / WINDOW_WIDTH;
+			scale = (double)m_viewHeight / m_viewWidth;
 			projection = glm::ortho(-10.0f, 10.0f, -10.0f * (float)scale, 10.0f * (float)scale, 0.1f, 100.0f);
 		}
-		else if (WINDOW_WIDTH < WINDOW_HEIGHT)
+		else if (m_viewWidth < m_viewHeight)
 		{
-			scale = (double)WINDOW_WIDTH / (double)WINDOW_HEIGHT;
+			scale = (double)m_viewWidth / (double)m_viewHeight;
 			projection = glm::ortho(-10.0f * (float)scale, 10.0f * (float)scale, -10.0f, 10.0f, 0.1f, 100.0f);
 		}
 		else
@@ -265,14 +445,36 @@ void ViewManager::PrepareSceneView()
 		}
 	}
 
-	// if the shader manager object is valid
-	if (NULL != m_pShaderManager)
+	m_viewProjection = projection * view;
+
+	// fence the draws of the last frame, then write the camera
+	// block of this frame with one buffer write
+	m_cameraRing.EndFrame();
+	m_cameraRing.BeginFrame();
+	cameraBlock.view = view;
+	cameraBlock.projection = projection;
+	cameraBlock.viewPosition = glm::vec4(camera.position, 1.0f);
+	m_cameraRing.WriteBlock(BLOCK_CAMERA, &cameraBlock, sizeof(cameraBlock));
+
+	// set the camera into every shader program that has resolved
+	// loose uniforms - the first program is left in use afterwards
+	for (size_t i = m_cameraUniforms.size(); i > 0; i--)
 	{
+		const CAMERA_UNIFORMS& cameraUniforms = m_cameraUniforms[i - 1];
+
+		if (cameraUniforms.bUsesCameraBlock == true)
+		{
+			continue;
+		}
+		if (m_cameraUniforms.size() > 1)
+		{
+			cameraUniforms.pUniformRegistry->UseProgram();
+		}
 		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ViewName, view);
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ProjectionName, projection);
+		cameraUniforms.pUniformRegistry->Set(cameraUniforms.view, view);
+		// set the projection matrix into the shader for proper rendering
+		cameraUniforms.pUniformRegistry->Set(cameraUniforms.projection, projection);
 		// set the view position of the camera into the shader for proper rendering
-		m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
+		cameraUniforms.pUniformRegistry->Set(cameraUniforms.viewPosition, camera.position);
 	}
 }
\ No newline at end of file
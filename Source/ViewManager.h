@@ -10,11 +10,17 @@
 #pragma once
 
 #include "ShaderManager.h"
+#include "UniformRegistry.h"
+#include "UniformBlocks.h"
 #include "camera.h"
 
 // GLFW library
 #include "GLFW/glfw3.h" 
 
+#include <vector>
+
+class CameraPath;
+
 class ViewManager
 {
 public:
@@ -31,8 +37,28 @@ public:
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
-	// active OpenGL display window
+	// handles for the camera uniforms of one shader program - a
+	// program with the camera uniform block needs no handles
+	struct CAMERA_UNIFORMS
+	{
+		UniformRegistry* pUniformRegistry;
+		bool bUsesCameraBlock;
+		UniformHandle<glm::mat4> view;
+		UniformHandle<glm::mat4> projection;
+		UniformHandle<glm::vec3> viewPosition;
+	};
+	// camera uniforms of every shader program that draws the scene
+	std::vector<CAMERA_UNIFORMS> m_cameraUniforms;
+	// per-frame camera block, written once and shared by every
+	// shader program that declares it
+	UniformRingBuffer m_cameraRing;
+	// view-projection matrix of the current frame
+	glm::mat4 m_viewProjection;
+	// active OpenGL display window - NULL when rendering headless
 	GLFWwindow* m_pWindow;
+	// size of the rendered frames, for the aspect ratio
+	int m_viewWidth;
+	int m_viewHeight;
 
 	// process keyboard events for interaction with the 3D scene
 	void ProcessKeyboardEvents();
@@ -40,7 +66,22 @@ private:
 public:
 	// create the initial OpenGL display window
 	GLFWwindow* CreateDisplayWindow(const char* windowTitle);
+	// render without a display window, into frames of the passed in
+	// size - the camera stays where it starts, with no input
+	void CreateHeadlessView(int width, int height);
+	// drive the camera along a path in place of the keyboard and
+	// mouse, advancing it by the same time step every frame
+	void StartCameraReplay(const CameraPath* pCameraPath, float fixedDeltaTime);
+	// true once a replay has shown the last keyframe of its path
+	bool IsCameraReplayDone() const;
+
+	// resolve the shader uniforms used every frame - must be
+	// called after the shaders are loaded, once for each shader
+	// program that the camera is set into
+	void ResolveShaderUniforms(UniformRegistry* pUniformRegistry);
 	
 	// prepare the conversion from 3D object display to 2D scene display
 	void PrepareSceneView();
+	// view-projection matrix set by the last PrepareSceneView()
+	const glm::mat4& GetViewProjection() const { return(m_viewProjection); }
 };
\ No newline at end of file
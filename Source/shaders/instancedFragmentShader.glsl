@@ -0,0 +1,120 @@
+///////////////////////////////////////////////////////////////////////////////
+// instancedFragmentShader.glsl
+// ============
+// fragment shader for the basic shapes drawn with instanced draw calls
+//
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+struct Material
+{
+	vec3 ambientColor;
+	float ambientStrength;
+	vec3 diffuseColor;
+	vec3 specularColor;
+	float shininess;
+};
+
+// vec4 members keep the std140 layout identical to the C++ side
+struct LightSource
+{
+	vec4 position;
+	vec4 ambientColor;
+	vec4 diffuseColor;
+	vec4 specularColor;
+	// x: focal strength, y: specular intensity
+	vec4 params;
+};
+
+// the program is compiled into variants, one for every combination
+// of these defines, so that no fragment branches on a uniform:
+//   USE_TEXTURE        sample the texture of the draw
+//   USE_TEXTURE_ARRAY  with USE_TEXTURE, sample a texture array layer
+//   USE_LIGHTING       light the fragment with the first LIGHT_COUNT
+//                      lights, which has to be set with it
+#define TOTAL_LIGHTS 4
+#define TOTAL_MATERIALS 16
+
+#if defined(USE_LIGHTING) && !defined(LIGHT_COUNT)
+#error LIGHT_COUNT must be defined with USE_LIGHTING
+#endif
+
+in vec3 fragmentPosition;
+in vec3 fragmentVertexNormal;
+in vec2 fragmentTextureCoordinate;
+in vec4 fragmentColor;
+flat in int fragmentMaterialIndex;
+flat in int fragmentTextureLayer;
+
+out vec4 outFragmentColor;
+
+// camera of the current frame, shared with every other program
+layout(std140) uniform CameraBlock
+{
+	mat4 view;
+	mat4 projection;
+	vec4 viewPosition;
+};
+
+// lights of the scene - x: number of lights, y: lighting enabled,
+// which the variant was already picked by
+layout(std140) uniform LightBlock
+{
+	LightSource lightSources[TOTAL_LIGHTS];
+	ivec4 lightInfo;
+};
+
+// the texture of an instance is either the one bound for the draw,
+// or a layer of the texture array bound for the draw
+#if defined(USE_TEXTURE_ARRAY)
+uniform sampler2DArray objectTextureArray;
+#elif defined(USE_TEXTURE)
+uniform sampler2D objectTexture;
+#endif
+uniform Material materials[TOTAL_MATERIALS];
+
+vec3 CalcLightSource(LightSource light, Material material, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection);
+
+void main()
+{
+#if defined(USE_TEXTURE_ARRAY)
+	vec4 objectColor = vec4(texture(objectTextureArray, vec3(fragmentTextureCoordinate, float(fragmentTextureLayer))).xyz, 1.0f);
+#elif defined(USE_TEXTURE)
+	vec4 objectColor = vec4(texture(objectTexture, fragmentTextureCoordinate).xyz, 1.0f);
+#else
+	vec4 objectColor = fragmentColor;
+#endif
+
+#if defined(USE_LIGHTING)
+	Material material = materials[clamp(fragmentMaterialIndex, 0, TOTAL_MATERIALS - 1)];
+	vec3 phongResult = vec3(0.0f);
+	vec3 lightNormal = normalize(fragmentVertexNormal);
+	vec3 viewDirection = normalize(viewPosition.xyz - fragmentPosition);
+
+	// the count is a constant, so the loop unrolls
+	for (int i = 0; i < LIGHT_COUNT; i++)
+	{
+		phongResult += CalcLightSource(lightSources[i], material, lightNormal, fragmentPosition, viewDirection);
+	}
+
+	outFragmentColor = vec4(phongResult * objectColor.xyz, objectColor.w);
+#else
+	outFragmentColor = objectColor;
+#endif
+}
+
+// calculate the ambient, diffuse and specular light of one light source
+vec3 CalcLightSource(LightSource light, Material material, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection)
+{
+	vec3 ambient = light.ambientColor.xyz * material.ambientStrength * material.ambientColor;
+
+	vec3 lightDirection = normalize(light.position.xyz - vertexPosition);
+	float impact = max(dot(lightNormal, lightDirection), 0.0f);
+	vec3 diffuse = impact * light.diffuseColor.xyz * material.diffuseColor;
+
+	vec3 reflectDirection = reflect(-lightDirection, lightNormal);
+	float specularComponent = pow(max(dot(viewDirection, reflectDirection), 0.0f), light.params.x);
+	vec3 specular = light.params.y * specularComponent * material.specularColor * light.specularColor.xyz;
+
+	return(ambient + diffuse + specular);
+}
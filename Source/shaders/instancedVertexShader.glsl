@@ -0,0 +1,47 @@
+///////////////////////////////////////////////////////////////////////////////
+// instancedVertexShader.glsl
+// ============
+// vertex shader for the basic shapes drawn with instanced draw calls
+//
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+layout(location = 0) in vec3 inVertexPosition;
+layout(location = 1) in vec3 inVertexNormal;
+layout(location = 2) in vec2 inTextureCoordinate;
+
+// per-instance data - the model matrix takes locations 3 to 6
+layout(location = 3) in mat4 instanceModel;
+layout(location = 7) in vec4 instanceColor;
+// x: material index, y: texture array layer + 1 (0 when no texture
+// is used), z and w: texture UV scale
+layout(location = 8) in vec4 instanceParams;
+
+out vec3 fragmentPosition;
+out vec3 fragmentVertexNormal;
+out vec2 fragmentTextureCoordinate;
+out vec4 fragmentColor;
+flat out int fragmentMaterialIndex;
+flat out int fragmentTextureLayer;
+
+// camera of the current frame, shared with every other program
+layout(std140) uniform CameraBlock
+{
+	mat4 view;
+	mat4 projection;
+	vec4 viewPosition;
+};
+
+void main()
+{
+	vec4 worldPosition = instanceModel * vec4(inVertexPosition, 1.0f);
+
+	gl_Position = projection * view * worldPosition;
+
+	fragmentPosition = vec3(worldPosition);
+	fragmentVertexNormal = mat3(transpose(inverse(instanceModel))) * inVertexNormal;
+	fragmentTextureCoordinate = inTextureCoordinate * instanceParams.zw;
+	fragmentColor = instanceColor;
+	fragmentMaterialIndex = int(instanceParams.x);
+	fragmentTextureLayer = max(int(instanceParams.y + 0.5f) - 1, 0);
+}